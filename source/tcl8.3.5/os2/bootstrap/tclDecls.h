@@ -1241,6 +1241,86 @@ EXTERN Tcl_DriverFlushProc * Tcl_ChannelFlushProc _ANSI_ARGS_((
 /* 411 */
 EXTERN Tcl_DriverHandlerProc * Tcl_ChannelHandlerProc _ANSI_ARGS_((
 				Tcl_ChannelType * chanTypePtr));
+/* Slot 412 is reserved */
+/* Slot 413 is reserved */
+/* Slot 414 is reserved */
+/* Slot 415 is reserved */
+/* Slot 416 is reserved */
+/* Slot 417 is reserved */
+/* Slot 418 is reserved */
+/* Slot 419 is reserved */
+/* Slot 420 is reserved */
+/* Slot 421 is reserved */
+/* Slot 422 is reserved */
+/* Slot 423 is reserved */
+/* Slot 424 is reserved */
+/* Slot 425 is reserved */
+/* Slot 426 is reserved */
+/* Slot 427 is reserved */
+/* Slot 428 is reserved */
+/* Slot 429 is reserved */
+/* Slot 430 is reserved */
+/* Slot 431 is reserved */
+/* Slot 432 is reserved */
+/* Slot 433 is reserved */
+/* Slot 434 is reserved */
+/* Slot 435 is reserved */
+/* Slot 436 is reserved */
+/* Slot 437 is reserved */
+/* Slot 438 is reserved */
+/* Slot 439 is reserved */
+/* Slot 440 is reserved */
+/* Slot 441 is reserved */
+/* Slot 442 is reserved */
+/* Slot 443 is reserved */
+/* Slot 444 is reserved */
+/* Slot 445 is reserved */
+/* Slot 446 is reserved */
+/* Slot 447 is reserved */
+/* Slot 448 is reserved */
+/* Slot 449 is reserved */
+/* Slot 450 is reserved */
+/* Slot 451 is reserved */
+/* Slot 452 is reserved */
+/* Slot 453 is reserved */
+/* Slot 454 is reserved */
+/* Slot 455 is reserved */
+/* Slot 456 is reserved */
+/* Slot 457 is reserved */
+/* Slot 458 is reserved */
+/* Slot 459 is reserved */
+/* Slot 460 is reserved */
+/* Slot 461 is reserved */
+/* Slot 462 is reserved */
+/* Slot 463 is reserved */
+/* Slot 464 is reserved */
+/* Slot 465 is reserved */
+/* Slot 466 is reserved */
+/* Slot 467 is reserved */
+/* Slot 468 is reserved */
+/* Slot 469 is reserved */
+/* Slot 470 is reserved */
+/* Slot 471 is reserved */
+/* Slot 472 is reserved */
+/* Slot 473 is reserved */
+/* Slot 474 is reserved */
+/* Slot 475 is reserved */
+/* Slot 476 is reserved */
+/* 477 */
+EXTERN void		Tcl_QueueEventCoalesced _ANSI_ARGS_((
+				Tcl_Event * evPtr, 
+				Tcl_QueuePosition position, 
+				Tcl_EventKeyProc * keyProc));
+/* 478 */
+EXTERN int		Tcl_SetNotifierStats _ANSI_ARGS_((int enable));
+/* 479 */
+EXTERN Tcl_Obj *	Tcl_GetNotifierStats _ANSI_ARGS_((int reset));
+/* 480 */
+EXTERN int		Tcl_DoEvents _ANSI_ARGS_((int flags, int maxEvents, 
+				Tcl_Time * timePtr));
+/* 481 */
+EXTERN int		Tcl_PreloadFile _ANSI_ARGS_((Tcl_Interp * interp, 
+				char * fileName));
 
 typedef struct TclStubHooks {
     struct TclPlatStubs *tclPlatStubs;
@@ -1719,6 +1799,76 @@ typedef struct TclStubs {
     Tcl_DriverGetHandleProc * (*tcl_ChannelGetHandleProc) _ANSI_ARGS_((Tcl_ChannelType * chanTypePtr)); /* 409 */
     Tcl_DriverFlushProc * (*tcl_ChannelFlushProc) _ANSI_ARGS_((Tcl_ChannelType * chanTypePtr)); /* 410 */
     Tcl_DriverHandlerProc * (*tcl_ChannelHandlerProc) _ANSI_ARGS_((Tcl_ChannelType * chanTypePtr)); /* 411 */
+    void *reserved412;
+    void *reserved413;
+    void *reserved414;
+    void *reserved415;
+    void *reserved416;
+    void *reserved417;
+    void *reserved418;
+    void *reserved419;
+    void *reserved420;
+    void *reserved421;
+    void *reserved422;
+    void *reserved423;
+    void *reserved424;
+    void *reserved425;
+    void *reserved426;
+    void *reserved427;
+    void *reserved428;
+    void *reserved429;
+    void *reserved430;
+    void *reserved431;
+    void *reserved432;
+    void *reserved433;
+    void *reserved434;
+    void *reserved435;
+    void *reserved436;
+    void *reserved437;
+    void *reserved438;
+    void *reserved439;
+    void *reserved440;
+    void *reserved441;
+    void *reserved442;
+    void *reserved443;
+    void *reserved444;
+    void *reserved445;
+    void *reserved446;
+    void *reserved447;
+    void *reserved448;
+    void *reserved449;
+    void *reserved450;
+    void *reserved451;
+    void *reserved452;
+    void *reserved453;
+    void *reserved454;
+    void *reserved455;
+    void *reserved456;
+    void *reserved457;
+    void *reserved458;
+    void *reserved459;
+    void *reserved460;
+    void *reserved461;
+    void *reserved462;
+    void *reserved463;
+    void *reserved464;
+    void *reserved465;
+    void *reserved466;
+    void *reserved467;
+    void *reserved468;
+    void *reserved469;
+    void *reserved470;
+    void *reserved471;
+    void *reserved472;
+    void *reserved473;
+    void *reserved474;
+    void *reserved475;
+    void *reserved476;
+    void (*tcl_QueueEventCoalesced) _ANSI_ARGS_((Tcl_Event * evPtr, Tcl_QueuePosition position, Tcl_EventKeyProc * keyProc)); /* 477 */
+    int (*tcl_SetNotifierStats) _ANSI_ARGS_((int enable)); /* 478 */
+    Tcl_Obj * (*tcl_GetNotifierStats) _ANSI_ARGS_((int reset)); /* 479 */
+    int (*tcl_DoEvents) _ANSI_ARGS_((int flags, int maxEvents, Tcl_Time * timePtr)); /* 480 */
+    int (*tcl_PreloadFile) _ANSI_ARGS_((Tcl_Interp * interp, char * fileName)); /* 481 */
 } TclStubs;
 
 #ifdef __cplusplus
@@ -3367,6 +3517,91 @@ extern TclStubs *tclStubsPtr;
 #define Tcl_ChannelHandlerProc \
 	(tclStubsPtr->tcl_ChannelHandlerProc) /* 411 */
 #endif
+/* Slot 412 is reserved */
+/* Slot 413 is reserved */
+/* Slot 414 is reserved */
+/* Slot 415 is reserved */
+/* Slot 416 is reserved */
+/* Slot 417 is reserved */
+/* Slot 418 is reserved */
+/* Slot 419 is reserved */
+/* Slot 420 is reserved */
+/* Slot 421 is reserved */
+/* Slot 422 is reserved */
+/* Slot 423 is reserved */
+/* Slot 424 is reserved */
+/* Slot 425 is reserved */
+/* Slot 426 is reserved */
+/* Slot 427 is reserved */
+/* Slot 428 is reserved */
+/* Slot 429 is reserved */
+/* Slot 430 is reserved */
+/* Slot 431 is reserved */
+/* Slot 432 is reserved */
+/* Slot 433 is reserved */
+/* Slot 434 is reserved */
+/* Slot 435 is reserved */
+/* Slot 436 is reserved */
+/* Slot 437 is reserved */
+/* Slot 438 is reserved */
+/* Slot 439 is reserved */
+/* Slot 440 is reserved */
+/* Slot 441 is reserved */
+/* Slot 442 is reserved */
+/* Slot 443 is reserved */
+/* Slot 444 is reserved */
+/* Slot 445 is reserved */
+/* Slot 446 is reserved */
+/* Slot 447 is reserved */
+/* Slot 448 is reserved */
+/* Slot 449 is reserved */
+/* Slot 450 is reserved */
+/* Slot 451 is reserved */
+/* Slot 452 is reserved */
+/* Slot 453 is reserved */
+/* Slot 454 is reserved */
+/* Slot 455 is reserved */
+/* Slot 456 is reserved */
+/* Slot 457 is reserved */
+/* Slot 458 is reserved */
+/* Slot 459 is reserved */
+/* Slot 460 is reserved */
+/* Slot 461 is reserved */
+/* Slot 462 is reserved */
+/* Slot 463 is reserved */
+/* Slot 464 is reserved */
+/* Slot 465 is reserved */
+/* Slot 466 is reserved */
+/* Slot 467 is reserved */
+/* Slot 468 is reserved */
+/* Slot 469 is reserved */
+/* Slot 470 is reserved */
+/* Slot 471 is reserved */
+/* Slot 472 is reserved */
+/* Slot 473 is reserved */
+/* Slot 474 is reserved */
+/* Slot 475 is reserved */
+/* Slot 476 is reserved */
+#ifndef Tcl_QueueEventCoalesced
+#define Tcl_QueueEventCoalesced \
+	(tclStubsPtr->tcl_QueueEventCoalesced) /* 477 */
+#endif
+#ifndef Tcl_SetNotifierStats
+#define Tcl_SetNotifierStats \
+	(tclStubsPtr->tcl_SetNotifierStats) /* 478 */
+#endif
+#ifndef Tcl_GetNotifierStats
+#define Tcl_GetNotifierStats \
+	(tclStubsPtr->tcl_GetNotifierStats) /* 479 */
+#endif
+#ifndef Tcl_DoEvents
+#define Tcl_DoEvents \
+	(tclStubsPtr->tcl_DoEvents) /* 480 */
+#endif
+#ifndef Tcl_PreloadFile
+#define Tcl_PreloadFile \
+	(tclStubsPtr->tcl_PreloadFile) /* 481 */
+#endif
 
 #endif /* defined(USE_TCL_STUBS) && !defined(USE_TCL_STUB_PROCS) */
 
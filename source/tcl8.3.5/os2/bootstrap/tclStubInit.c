@@ -869,6 +869,76 @@ TclStubs tclStubs = {
     Tcl_ChannelGetHandleProc, /* 409 */
     Tcl_ChannelFlushProc, /* 410 */
     Tcl_ChannelHandlerProc, /* 411 */
+    NULL, /* 412 */
+    NULL, /* 413 */
+    NULL, /* 414 */
+    NULL, /* 415 */
+    NULL, /* 416 */
+    NULL, /* 417 */
+    NULL, /* 418 */
+    NULL, /* 419 */
+    NULL, /* 420 */
+    NULL, /* 421 */
+    NULL, /* 422 */
+    NULL, /* 423 */
+    NULL, /* 424 */
+    NULL, /* 425 */
+    NULL, /* 426 */
+    NULL, /* 427 */
+    NULL, /* 428 */
+    NULL, /* 429 */
+    NULL, /* 430 */
+    NULL, /* 431 */
+    NULL, /* 432 */
+    NULL, /* 433 */
+    NULL, /* 434 */
+    NULL, /* 435 */
+    NULL, /* 436 */
+    NULL, /* 437 */
+    NULL, /* 438 */
+    NULL, /* 439 */
+    NULL, /* 440 */
+    NULL, /* 441 */
+    NULL, /* 442 */
+    NULL, /* 443 */
+    NULL, /* 444 */
+    NULL, /* 445 */
+    NULL, /* 446 */
+    NULL, /* 447 */
+    NULL, /* 448 */
+    NULL, /* 449 */
+    NULL, /* 450 */
+    NULL, /* 451 */
+    NULL, /* 452 */
+    NULL, /* 453 */
+    NULL, /* 454 */
+    NULL, /* 455 */
+    NULL, /* 456 */
+    NULL, /* 457 */
+    NULL, /* 458 */
+    NULL, /* 459 */
+    NULL, /* 460 */
+    NULL, /* 461 */
+    NULL, /* 462 */
+    NULL, /* 463 */
+    NULL, /* 464 */
+    NULL, /* 465 */
+    NULL, /* 466 */
+    NULL, /* 467 */
+    NULL, /* 468 */
+    NULL, /* 469 */
+    NULL, /* 470 */
+    NULL, /* 471 */
+    NULL, /* 472 */
+    NULL, /* 473 */
+    NULL, /* 474 */
+    NULL, /* 475 */
+    NULL, /* 476 */
+    Tcl_QueueEventCoalesced, /* 477 */
+    Tcl_SetNotifierStats, /* 478 */
+    Tcl_GetNotifierStats, /* 479 */
+    Tcl_DoEvents, /* 480 */
+    Tcl_PreloadFile, /* 481 */
 };
 
 /* !END!: Do not edit above this line. */
@@ -0,0 +1,272 @@
+# encimage.tcl --
+#
+#	This script compiles the table-driven encoding files (*.enc) in
+#	a directory into a single binary image that tclOS2Enc.c can load
+#	into shared memory at startup, so no process has to parse the
+#	hexadecimal text of an encoding file before using it.
+#
+#	Usage: tclsh encimage.tcl encodingDir imageFile
+#
+#	The image holds the same tables that LoadTableEncoding builds in
+#	tclEncoding.c, in both directions.  Identical pages are stored
+#	only once.  All numbers are little-endian.
+#
+#	header:	    char magic[8]	"TCLENC1\0"
+#		    long imageSize	size of the image in bytes
+#		    long numEncodings	number of directory entries
+#		    long pagesOffset	offset of page 0
+#		    long numPages	number of pages
+#	directory:  one 64-byte entry per encoding:
+#		    char name[48]	NUL-terminated encoding name
+#		    short fallback	character used if there is no mapping
+#		    short nullSize	1, or 2 for double-byte encodings
+#		    long prefixOffset	offset of 256 prefix byte flags
+#		    long toUnicodeOffset    offset of 256 page numbers
+#		    long fromUnicodeOffset  offset of 256 page numbers
+#	indices:    the prefix flags and page numbers of each encoding
+#	pages:	    256 unsigned shorts each; page 0 is all zeroes
+#
+#	Escape-sequence encodings (type E) are not tables and are left
+#	out; they are still loaded from their .enc files.
+#
+# Copyright (c) 2002 Illya Vaes
+# See the file "license.terms" for information on usage and redistribution
+# of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+
+package require Tcl 8
+
+namespace eval encimage {
+    # pageIndex --
+    #
+    #	Maps the contents of a page (as a list of 256 numbers) to its
+    #	number in the image, so that identical pages are interned.
+
+    array set pageIndex {}
+
+    # pages --
+    #
+    #	The binary contents of the pages, in order.
+
+    variable pages {}
+
+    # emptyPage --
+    #
+    #	A page with no mappings.
+
+    variable emptyPage {}
+    for {set i 0} {$i < 256} {incr i} {
+	lappend emptyPage 0
+    }
+    set pageIndex($emptyPage) 0
+    lappend pages [binary format s256 $emptyPage]
+
+    # encodings --
+    #
+    #	One element per compiled encoding: the name, fallback, null size
+    #	and the binary prefix flags and page indices.
+
+    variable encodings {}
+}
+
+# encimage::internPage --
+#
+#	Return the number of the page with the given contents, adding it
+#	to the image if it isn't there yet.
+#
+# Arguments:
+#	page	List of 256 numbers.
+#
+# Results:
+#	The page number.
+
+proc encimage::internPage {page} {
+    variable pageIndex
+    variable pages
+
+    if {![info exists pageIndex($page)]} {
+	set pageIndex($page) [llength $pages]
+	lappend pages [binary format s256 $page]
+    }
+    return $pageIndex($page)
+}
+
+# encimage::compile --
+#
+#	Parse an encoding file and compute its tables the way
+#	LoadTableEncoding does.
+#
+# Arguments:
+#	name	Name of the encoding.
+#	file	Name of the .enc file.
+#
+# Results:
+#	Returns 1 if the encoding was added to the image, 0 if it is not
+#	a table encoding.
+
+proc encimage::compile {name file} {
+    variable emptyPage
+    variable encodings
+
+    set f [open $file r]
+    while {[gets $f line] >= 0} {
+	if {[string index $line 0] != "#"} {
+	    break
+	}
+    }
+    set type [string trim $line]
+    if {[lsearch -exact {S D M} $type] < 0} {
+	close $f
+	return 0
+    }
+    gets $f line
+    scan $line "%x %d %d" fallback symbol numPages
+
+    # Read the pages that map to Unicode.  The hex text of a page is
+    # big-endian, so "binary scan S" recovers the 16-bit values.
+
+    for {set i 0} {$i < $numPages} {incr i} {
+	set line ""
+	while {$line == "" && [gets $f line] >= 0} {
+	    set line [string trim $line]
+	}
+	scan $line %x hi
+	set hex ""
+	while {[string length $hex] < 1024 && [gets $f line] >= 0} {
+	    append hex [string trim $line]
+	}
+	binary scan [binary format H1024 $hex] S256 values
+	set page {}
+	foreach value $values {
+	    lappend page [expr {$value & 0xffff}]
+	}
+	set toUnicode($hi) $page
+    }
+    close $f
+
+    # Prefix bytes, and the inverse mapping.  Later entries replace
+    # earlier ones, as in LoadTableEncoding.
+
+    set prefix {}
+    for {set hi 0} {$hi < 256} {incr hi} {
+	if {$type == "D" || ($hi != 0 && [info exists toUnicode($hi)])} {
+	    lappend prefix 1
+	} else {
+	    lappend prefix 0
+	}
+	if {![info exists toUnicode($hi)]} {
+	    continue
+	}
+	set lo 0
+	foreach ch $toUnicode($hi) {
+	    if {$ch != 0} {
+		set fromUnicode($ch) [expr {($hi << 8) + $lo}]
+		set fromPages([expr {$ch >> 8}]) 1
+	    }
+	    incr lo
+	}
+    }
+    if {$type == "M" && [info exists fromPages(0)]} {
+	if {![info exists fromUnicode(92)]} {
+	    set fromUnicode(92) 92
+	}
+    }
+    if {$symbol && [info exists toUnicode(0)]} {
+	set lo 0
+	foreach ch $toUnicode(0) {
+	    if {$ch != 0} {
+		set fromUnicode($lo) $lo
+		set fromPages(0) 1
+	    }
+	    incr lo
+	}
+    }
+
+    set toIndex {}
+    set fromIndex {}
+    for {set hi 0} {$hi < 256} {incr hi} {
+	if {[info exists toUnicode($hi)]} {
+	    lappend toIndex [internPage $toUnicode($hi)]
+	} else {
+	    lappend toIndex 0
+	}
+	if {[info exists fromPages($hi)]} {
+	    set page {}
+	    set base [expr {$hi << 8}]
+	    for {set lo 0} {$lo < 256} {incr lo} {
+		if {[info exists fromUnicode([expr {$base + $lo}])]} {
+		    lappend page $fromUnicode([expr {$base + $lo}])
+		} else {
+		    lappend page 0
+		}
+	    }
+	    lappend fromIndex [internPage $page]
+	} else {
+	    lappend fromIndex 0
+	}
+    }
+
+    lappend encodings [list $name $fallback [expr {($type == "D") ? 2 : 1}] \
+	    [binary format c256 $prefix] [binary format s256 $toIndex] \
+	    [binary format s256 $fromIndex]]
+    return 1
+}
+
+# encimage::write --
+#
+#	Write the image.
+#
+# Arguments:
+#	file	Name of the image file.
+#
+# Results:
+#	None.
+
+proc encimage::write {file} {
+    variable encodings
+    variable pages
+
+    set numEncodings [llength $encodings]
+    set indexOffset [expr {24 + 64 * $numEncodings}]
+    set indexSize [expr {256 + 512 + 512}]
+    set pagesOffset [expr {$indexOffset + $indexSize * $numEncodings}]
+    set pagesOffset [expr {($pagesOffset + 511) & ~511}]
+    set numPages [llength $pages]
+    set imageSize [expr {$pagesOffset + 512 * $numPages}]
+
+    set directory ""
+    set indices ""
+    set offset $indexOffset
+    foreach encoding $encodings {
+	foreach {name fallback nullSize prefix toIndex fromIndex} \
+		$encoding break
+	append directory [binary format a47x1ssiii $name $fallback \
+		$nullSize $offset [expr {$offset + 256}] \
+		[expr {$offset + 768}]]
+	append indices $prefix $toIndex $fromIndex
+	incr offset $indexSize
+    }
+
+    set f [open $file w]
+    fconfigure $f -translation binary
+    puts -nonewline $f [binary format a8iiii "TCLENC1" $imageSize \
+	    $numEncodings $pagesOffset $numPages]
+    puts -nonewline $f $directory
+    puts -nonewline $f $indices
+    puts -nonewline $f [binary format x[expr {$pagesOffset - $offset}]]
+    puts -nonewline $f [join $pages ""]
+    close $f
+}
+
+if {[llength $argv] != 2} {
+    puts stderr "usage: $argv0 encodingDir imageFile"
+    exit 1
+}
+foreach file [lsort [glob [file join [lindex $argv 0] *.enc]]] {
+    set name [file rootname [file tail $file]]
+    if {[string length $name] >= 48} {
+	puts stderr "$file: encoding name too long"
+	continue
+    }
+    encimage::compile $name $file
+}
+encimage::write [lindex $argv 1]
@@ -588,6 +588,7 @@ typedef void (Tcl_EventCheckProc) _ANSI_ARGS_((ClientData clientData,
 	int flags));
 typedef int (Tcl_EventDeleteProc) _ANSI_ARGS_((Tcl_Event *evPtr,
         ClientData clientData));
+typedef ClientData (Tcl_EventKeyProc) _ANSI_ARGS_((Tcl_Event *evPtr));
 typedef void (Tcl_EventSetupProc) _ANSI_ARGS_((ClientData clientData,
 	int flags));
 typedef void (Tcl_ExitProc) _ANSI_ARGS_((ClientData clientData));
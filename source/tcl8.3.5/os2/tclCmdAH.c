@@ -23,18 +23,219 @@
 
 typedef int (StatProc)_ANSI_ARGS_((CONST char *path, struct stat *buf));
 
+/*
+ * The "format" command compiles each format string it is given into a
+ * FormatSpec, which is kept as the internal representation of the object
+ * holding the format string.  A FormatSpec is a sequence of fields, each
+ * either a span of literal text or a conversion whose flags, width,
+ * precision and argument indices have already been parsed, so later calls
+ * with the same format string don't have to scan it again.  Format strings
+ * with errors are not compiled; they are handled by the original code,
+ * which produces the error message.
+ */
+
+typedef struct FormatField {
+    int conversion;		/* Conversion character ('d', 's', ...; 'i'
+				 * is stored as 'd'), or 0 if the field is
+				 * literal text. */
+    int start;			/* For literal text: offset of the text in
+				 * the format string. */
+    int length;			/* For literal text: number of bytes. */
+    char flags[8];		/* Flag characters ("-", "0", "+", " " and
+				 * "#") in the order given, null-terminated. */
+    int minus;			/* Non-zero means flags include "-". */
+    int zero;			/* Non-zero means flags include "0". */
+    int width;			/* Field width, or 0 if none was given. */
+    int widthIndex;		/* Index in objv of the argument holding the
+				 * width if it was given as "*", or -1. */
+    int gotPrecision;		/* Non-zero means a precision was given. */
+    int precision;		/* Precision, or 0 if none was given. */
+    int precisionIndex;		/* Index in objv of the argument holding the
+				 * precision if it was given as "*", or -1. */
+    int useShort;		/* Non-zero means the "h" modifier was
+				 * given. */
+    int objIndex;		/* Index in objv of the value to convert. */
+} FormatField;
+
+typedef struct FormatSpec {
+    int refCount;		/* Number of objects using this spec, plus one
+				 * while Tcl_FormatObjCmd is running it. */
+    int gotXpg;			/* Non-zero means the format uses XPG3 %n$
+				 * specifiers; selects the error message for
+				 * a missing argument. */
+    int literalSize;		/* Total number of bytes of literal text,
+				 * used to size the result. */
+    int numFields;		/* Number of entries in fields. */
+    FormatField fields[1];	/* The fields of the format string.  The
+				 * actual size of this array is numFields. */
+} FormatSpec;
+
+static void		DupFormatInternalRep _ANSI_ARGS_((Tcl_Obj *srcPtr,
+			    Tcl_Obj *copyPtr));
+static void		FreeFormatInternalRep _ANSI_ARGS_((Tcl_Obj *objPtr));
+static int		SetFormatFromAny _ANSI_ARGS_((Tcl_Interp *interp,
+			    Tcl_Obj *objPtr));
+
+static Tcl_ObjType formatType = {
+    "format",				/* name */
+    FreeFormatInternalRep,		/* freeIntRepProc */
+    DupFormatInternalRep,		/* dupIntRepProc */
+    (Tcl_UpdateStringProc *) NULL,	/* updateStringProc */
+    SetFormatFromAny			/* setFromAnyProc */
+};
+
+/*
+ * The results of stat() calls made for "file" subcommands can be kept
+ * for a short time in a per-interpreter StatCache (associated data with
+ * key "tclStatCache"), so that scripts that check the same files over
+ * and over don't go to the file system every time.  The cache is off
+ * until "file statlist -ttl" gives its entries a lifetime.  It is emptied
+ * whenever the interpreter goes idle and by the "file" subcommands that
+ * change the file system; changes made in other ways (by writing to a
+ * channel, say) are only seen once the entries have expired.
+ */
+
+typedef struct StatCacheEntry {
+    int status;			/* Value returned by TclStat: 0 or -1. */
+    int errorNum;		/* Value of errno if status is -1. */
+    struct stat buf;		/* Information returned by TclStat if
+				 * status is 0. */
+    Tcl_Time time;		/* When TclStat was called. */
+} StatCacheEntry;
+
+typedef struct StatCache {
+    long ttl;			/* Lifetime of entries in milliseconds, or 0
+				 * if the cache is disabled. */
+    Tcl_HashTable table;	/* Maps from native file names to
+				 * StatCacheEntry's. */
+    int idlePending;		/* Non-zero means StatCacheIdleProc has been
+				 * scheduled to empty the cache. */
+} StatCache;
+
+/*
+ * Maximum number of entries in a StatCache.  When a new entry would
+ * exceed it, the cache is emptied first.
+ */
+
+#define STAT_CACHE_MAX_ENTRIES	4096
+
+/*
+ * One element of the result of "file statlist".
+ */
+
+typedef struct StatResult {
+    char *nativeName;		/* Translated file name (malloc-ed), or NULL
+				 * if the name couldn't be translated. */
+    int status;			/* 0 if buf is valid, -1 otherwise. */
+    struct stat buf;		/* Information about the file. */
+} StatResult;
+
+/*
+ * Largest number of threads "file statlist -threads" will use.
+ */
+
+#define STAT_MAX_THREADS	16
+
+#ifdef TCL_THREADS
+/*
+ * "file statlist -threads" hands the names it has to stat to a pool of
+ * worker threads, which stat them in parallel so that the file system
+ * has them at hand when the interpreter's thread calls TclStat for them
+ * (see PrefetchStats).  The pool is shared by all interpreters and works
+ * on one job at a time.  Its threads are started when a job first needs
+ * them and run until Tcl is finalized.
+ */
+
+typedef struct StatJob {
+    StatResult *results;	/* The names to stat. */
+    int *todo;			/* Indices in results of those names. */
+    int numTodo;		/* Number of entries in todo. */
+    int next;			/* Index in todo of the next name to stat. */
+    int numBusy;		/* Number of threads stat'ing a name of this
+				 * job right now. */
+    int numWorkers;		/* Number of pool threads among those. */
+    int maxWorkers;		/* Largest value numWorkers may take. */
+} StatJob;
+
+TCL_DECLARE_MUTEX(statPoolMutex)
+static Tcl_Condition statWorkCond;	/* Notified when a job is posted or
+					 * the pool is to exit. */
+static Tcl_Condition statDoneCond;	/* Notified when a pool thread is
+					 * done with a name or exits. */
+static StatJob *statJobPtr = NULL;	/* Job being worked on, or NULL. */
+static int statNumThreads = 0;		/* Number of threads in the pool. */
+static int statPoolExiting = 0;		/* Non-zero means the pool threads
+					 * are to exit. */
+static int statExitHandler = 0;		/* Non-zero means StatPoolExitProc
+					 * has been registered. */
+#endif
+
+/*
+ * One varList/list pair of a "foreach" command.
+ */
+
+typedef struct ForeachList {
+    Tcl_Obj *varListPtr;	/* The list of loop variable names. */
+    Tcl_Obj *valueListPtr;	/* The list of values. */
+    int varc;			/* Number of loop variables. */
+    Tcl_Obj **varv;		/* Elements of varListPtr. */
+    int valuec;			/* Number of values. */
+    Tcl_Obj **valuev;		/* Elements of valueListPtr. */
+    int index;			/* Index in valuev of the next value. */
+    Var **varPtrs;		/* For each loop variable, the variable it
+				 * was bound to (see BindLoopVar), or NULL
+				 * if it is set by name. */
+} ForeachList;
+
 /*
  * Prototypes for local procedures defined in this file:
  */
 
+static Var *		BindLoopVar _ANSI_ARGS_((Tcl_Interp *interp,
+			    Tcl_Obj *namePtr));
+static int		CachedStat _ANSI_ARGS_((Tcl_Interp *interp,
+			    CONST char *nativeName, struct stat *statPtr));
 static int		CheckAccess _ANSI_ARGS_((Tcl_Interp *interp,
 			    Tcl_Obj *objPtr, int mode));
+static void		ClearStatCache _ANSI_ARGS_((StatCache *cachePtr));
+static void		DeleteStatCacheProc _ANSI_ARGS_((
+			    ClientData clientData, Tcl_Interp *interp));
+static int		FileStatListCmd _ANSI_ARGS_((Tcl_Interp *interp,
+			    int objc, Tcl_Obj *CONST objv[]));
+static void		FlushStatCache _ANSI_ARGS_((Tcl_Interp *interp));
+static int		FormatCompiled _ANSI_ARGS_((Tcl_Interp *interp,
+			    FormatSpec *specPtr, char *format, int objc,
+			    Tcl_Obj *CONST objv[]));
+static char *		FormatRoom _ANSI_ARGS_((Tcl_Obj *resultPtr,
+			    int *availPtr, int used, int needed));
+static void		FormatSpecifier _ANSI_ARGS_((char *newFormat,
+			    FormatField *fieldPtr, int minus, int width,
+			    int precision, int useLong));
+static StatCache *	GetStatCache _ANSI_ARGS_((Tcl_Interp *interp));
 static int		GetStatBuf _ANSI_ARGS_((Tcl_Interp *interp,
 			    Tcl_Obj *objPtr, StatProc *statProc,
-			    struct stat *statPtr));
+			    struct stat *statPtr, int reportErrors));
 static char *		GetTypeFromMode _ANSI_ARGS_((int mode));
-static int		SplitPath _ANSI_ARGS_((Tcl_Interp *interp,
-			    Tcl_Obj *objPtr, int *argcPtr, char ***argvPtr));
+#ifdef TCL_THREADS
+static void		PrefetchStats _ANSI_ARGS_((StatResult *results,
+			    int *todo, int numTodo, int numThreads));
+#endif
+static void		ReleaseLoopVar _ANSI_ARGS_((Var *varPtr));
+static int		SetLoopVar _ANSI_ARGS_((Tcl_Interp *interp,
+			    Var *varPtr, Tcl_Obj *namePtr,
+			    Tcl_Obj *valuePtr));
+static TclPathRep *	SplitPath _ANSI_ARGS_((Tcl_Interp *interp,
+			    Tcl_Obj *objPtr));
+static void		StatCacheIdleProc _ANSI_ARGS_((
+			    ClientData clientData));
+static void		StatCacheStore _ANSI_ARGS_((StatCache *cachePtr,
+			    CONST char *nativeName, int status,
+			    int errorNum, struct stat *statPtr));
+#ifdef TCL_THREADS
+static void		StatPoolExitProc _ANSI_ARGS_((ClientData clientData));
+static Tcl_ThreadCreateType StatWorkerProc _ANSI_ARGS_((
+			    ClientData clientData));
+#endif
 static int		StoreStatData _ANSI_ARGS_((Tcl_Interp *interp,
 			    char *varName, struct stat *statPtr));
 static char **		StringifyObjects _ANSI_ARGS_((int objc,
@@ -801,7 +1002,8 @@ Tcl_FileObjCmd(dummy, interp, objc, objv)
 	"mtime",	"mkdir",	"nativename",	"owned",
 	"pathtype",	"readable",	"readlink",	"rename",
 	"rootname",	"size",		"split",	"stat",
-	"tail",		"type",		"volumes",	"writable",
+	"statlist",	"tail",		"type",		"volumes",
+	"writable",
 	(char *) NULL
     };
     enum options {
@@ -812,7 +1014,8 @@ Tcl_FileObjCmd(dummy, interp, objc, objv)
 	FILE_MTIME,	FILE_MKDIR,	FILE_NATIVENAME, FILE_OWNED,
 	FILE_PATHTYPE,	FILE_READABLE,	FILE_READLINK,	FILE_RENAME,
 	FILE_ROOTNAME,	FILE_SIZE,	FILE_SPLIT,	FILE_STAT,
-	FILE_TAIL,	FILE_TYPE,	FILE_VOLUMES,	FILE_WRITABLE
+	FILE_STATLIST,	FILE_TAIL,	FILE_TYPE,	FILE_VOLUMES,
+	FILE_WRITABLE
     };
 
     if (objc < 2) {
@@ -835,7 +1038,7 @@ Tcl_FileObjCmd(dummy, interp, objc, objv)
 		Tcl_WrongNumArgs(interp, 2, objv, "name ?time?");
 		return TCL_ERROR;
 	    }
-	    if (GetStatBuf(interp, objv[2], TclStat, &buf) != TCL_OK) {
+	    if (GetStatBuf(interp, objv[2], TclStat, &buf, 1) != TCL_OK) {
 		return TCL_ERROR;
 	    }
 	    if (objc == 4) {
@@ -857,13 +1060,14 @@ Tcl_FileObjCmd(dummy, interp, objc, objv)
 			    Tcl_PosixError(interp), (char *) NULL);
 		    return TCL_ERROR;
 		}
+		FlushStatCache(interp);
 		/*
 		 * Do another stat to ensure that the we return the
 		 * new recognized atime - hopefully the same as the
 		 * one we sent in.  However, fs's like FAT don't
 		 * even know what atime is.
 		 */
-		if (GetStatBuf(interp, objv[2], TclStat, &buf) != TCL_OK) {
+		if (GetStatBuf(interp, objv[2], TclStat, &buf, 1) != TCL_OK) {
 		    return TCL_ERROR;
 		}
 	    }
@@ -871,6 +1075,9 @@ Tcl_FileObjCmd(dummy, interp, objc, objv)
 	    return TCL_OK;
 	}
 	case FILE_ATTRIBUTES: {
+	    if (objc > 4) {
+		FlushStatCache(interp);
+	    }
             return TclFileAttrsCmd(interp, objc, objv);
 	}
 	case FILE_CHANNELS: {
@@ -885,6 +1092,7 @@ Tcl_FileObjCmd(dummy, interp, objc, objv)
 	    int result;
 	    char **argv;
 
+	    FlushStatCache(interp);
 	    argv = StringifyObjects(objc, objv);
 	    result = TclFileCopyCmd(interp, objc, argv);
 	    ckfree((char *) argv);
@@ -894,6 +1102,7 @@ Tcl_FileObjCmd(dummy, interp, objc, objv)
 	    int result;
 	    char **argv;
 
+	    FlushStatCache(interp);
 	    argv = StringifyObjects(objc, objv);
 	    result = TclFileDeleteCmd(interp, objc, argv);
 	    ckfree((char *) argv);
@@ -902,13 +1111,17 @@ Tcl_FileObjCmd(dummy, interp, objc, objv)
     	case FILE_DIRNAME: {
     	    int argc;
 	    char **argv;
+	    TclPathRep *pathPtr;
 
 	    if (objc != 3) {
 		goto only3Args;
 	    }
-	    if (SplitPath(interp, objv[2], &argc, &argv) != TCL_OK) {
+	    pathPtr = SplitPath(interp, objv[2]);
+	    if (pathPtr == NULL) {
 		return TCL_ERROR;
 	    }
+	    argc = pathPtr->argc;
+	    argv = pathPtr->argv;
 
 	    /*
 	     * Return all but the last component.  If there is only one
@@ -931,7 +1144,7 @@ Tcl_FileObjCmd(dummy, interp, objc, objv)
 	    } else {
 	    	Tcl_SetStringObj(resultPtr, argv[0], -1);
 	    }
-	    ckfree((char *) argv);
+	    TclFreePathRep(pathPtr);
 	    return TCL_OK;
 	}
 	case FILE_EXECUTABLE: {
@@ -966,7 +1179,7 @@ Tcl_FileObjCmd(dummy, interp, objc, objv)
 		goto only3Args;
 	    }
 	    value = 0;
-	    if (GetStatBuf(NULL, objv[2], TclStat, &buf) == TCL_OK) {
+	    if (GetStatBuf(interp, objv[2], TclStat, &buf, 0) == TCL_OK) {
 		value = S_ISDIR(buf.st_mode);
 	    }
 	    Tcl_SetBooleanObj(resultPtr, value);
@@ -980,7 +1193,7 @@ Tcl_FileObjCmd(dummy, interp, objc, objv)
     	    	goto only3Args;
     	    }
 	    value = 0;
-	    if (GetStatBuf(NULL, objv[2], TclStat, &buf) == TCL_OK) {
+	    if (GetStatBuf(interp, objv[2], TclStat, &buf, 0) == TCL_OK) {
 		value = S_ISREG(buf.st_mode);
 	    }
 	    Tcl_SetBooleanObj(resultPtr, value);
@@ -1011,7 +1224,7 @@ Tcl_FileObjCmd(dummy, interp, objc, objv)
     	    	Tcl_WrongNumArgs(interp, 2, objv, "name varName");
     	    	return TCL_ERROR;
     	    }
-	    if (GetStatBuf(interp, objv[2], TclpLstat, &buf) != TCL_OK) {
+	    if (GetStatBuf(interp, objv[2], TclpLstat, &buf, 1) != TCL_OK) {
 		return TCL_ERROR;
 	    }
 	    varName = Tcl_GetString(objv[3]);
@@ -1026,7 +1239,7 @@ Tcl_FileObjCmd(dummy, interp, objc, objv)
 		Tcl_WrongNumArgs(interp, 2, objv, "name ?time?");
 		return TCL_ERROR;
 	    }
-	    if (GetStatBuf(interp, objv[2], TclStat, &buf) != TCL_OK) {
+	    if (GetStatBuf(interp, objv[2], TclStat, &buf, 1) != TCL_OK) {
 		return TCL_ERROR;
 	    }
 	    if (objc == 4) {
@@ -1048,13 +1261,14 @@ Tcl_FileObjCmd(dummy, interp, objc, objv)
 			    Tcl_PosixError(interp), (char *) NULL);
 		    return TCL_ERROR;
 		}
+		FlushStatCache(interp);
 		/*
 		 * Do another stat to ensure that the we return the
 		 * new recognized atime - hopefully the same as the
 		 * one we sent in.  However, fs's like FAT don't
 		 * even know what atime is.
 		 */
-		if (GetStatBuf(interp, objv[2], TclStat, &buf) != TCL_OK) {
+		if (GetStatBuf(interp, objv[2], TclStat, &buf, 1) != TCL_OK) {
 		    return TCL_ERROR;
 		}
 	    }
@@ -1069,6 +1283,7 @@ Tcl_FileObjCmd(dummy, interp, objc, objv)
 		Tcl_WrongNumArgs(interp, 2, objv, "name ?name ...?");
 		return TCL_ERROR;
 	    }
+	    FlushStatCache(interp);
 	    argv = StringifyObjects(objc, objv);
 	    result = TclFileMakeDirsCmd(interp, objc, argv);
 	    ckfree((char *) argv);
@@ -1081,8 +1296,7 @@ Tcl_FileObjCmd(dummy, interp, objc, objv)
 	    if (objc != 3) {
 		goto only3Args;
 	    }
-	    fileName = Tcl_GetString(objv[2]);
-	    fileName = Tcl_TranslateFileName(interp, fileName, &ds);
+	    fileName = TclTranslateFileNameObj(interp, objv[2], &ds);
 	    if (fileName == NULL) {
 		return TCL_ERROR;
 	    }
@@ -1098,7 +1312,7 @@ Tcl_FileObjCmd(dummy, interp, objc, objv)
 		goto only3Args;
 	    }
 	    value = 0;
-	    if (GetStatBuf(NULL, objv[2], TclStat, &buf) == TCL_OK) {
+	    if (GetStatBuf(interp, objv[2], TclStat, &buf, 0) == TCL_OK) {
 		/*
 		 * For Windows, OS/2 and Macintosh, there are no user ids 
 		 * associated with a file, so we always return 1.
@@ -1114,13 +1328,10 @@ Tcl_FileObjCmd(dummy, interp, objc, objv)
 	    return TCL_OK;
 	}
 	case FILE_PATHTYPE: {
-	    char *fileName;
-
 	    if (objc != 3) {
 		goto only3Args;
 	    }
-	    fileName = Tcl_GetString(objv[2]);
-	    switch (Tcl_GetPathType(fileName)) {
+	    switch (TclGetPathRepFromObj(objv[2])->type) {
 	    	case TCL_PATH_ABSOLUTE:
 	    	    Tcl_SetStringObj(resultPtr, "absolute", -1);
 		    break;
@@ -1147,8 +1358,7 @@ Tcl_FileObjCmd(dummy, interp, objc, objv)
 		goto only3Args;
 	    }
 	    
-	    fileName = Tcl_GetString(objv[2]);
-	    fileName = Tcl_TranslateFileName(interp, fileName, &name);
+	    fileName = TclTranslateFileNameObj(interp, objv[2], &name);
 	    if (fileName == NULL) {
 		return TCL_ERROR;
 	    }
@@ -1182,6 +1392,7 @@ Tcl_FileObjCmd(dummy, interp, objc, objv)
 	    int result;
 	    char **argv;
 
+	    FlushStatCache(interp);
 	    argv = StringifyObjects(objc, objv);
 	    result = TclFileRenameCmd(interp, objc, argv);
 	    ckfree((char *) argv);
@@ -1210,28 +1421,27 @@ Tcl_FileObjCmd(dummy, interp, objc, objv)
 	    if (objc != 3) {
 		goto only3Args;
 	    }
-	    if (GetStatBuf(interp, objv[2], TclStat, &buf) != TCL_OK) {
+	    if (GetStatBuf(interp, objv[2], TclStat, &buf, 1) != TCL_OK) {
 		return TCL_ERROR;
 	    }
 	    Tcl_SetLongObj(resultPtr, (long) buf.st_size);
 	    return TCL_OK;
 	}
 	case FILE_SPLIT: {
-	    int i, argc;
-	    char **argv;
-	    char *fileName;
+	    int i;
+	    TclPathRep *pathPtr;
 	    Tcl_Obj *objPtr;
 	    
 	    if (objc != 3) {
 		goto only3Args;
 	    }
-	    fileName = Tcl_GetString(objv[2]);
-	    Tcl_SplitPath(fileName, &argc, &argv);
-	    for (i = 0; i < argc; i++) {
-		objPtr = Tcl_NewStringObj(argv[i], -1);
+	    pathPtr = TclGetPathRepFromObj(objv[2]);
+	    pathPtr->refCount++;
+	    for (i = 0; i < pathPtr->argc; i++) {
+		objPtr = Tcl_NewStringObj(pathPtr->argv[i], -1);
 		Tcl_ListObjAppendElement(NULL, resultPtr, objPtr);
 	    }
-	    ckfree((char *) argv);
+	    TclFreePathRep(pathPtr);
 	    return TCL_OK;
 	}
 	case FILE_STAT: {
@@ -1242,22 +1452,29 @@ Tcl_FileObjCmd(dummy, interp, objc, objv)
 	    	Tcl_WrongNumArgs(interp, 1, objv, "stat name varName");
 		return TCL_ERROR;
 	    }
-	    if (GetStatBuf(interp, objv[2], TclStat, &buf) != TCL_OK) {
+	    if (GetStatBuf(interp, objv[2], TclStat, &buf, 1) != TCL_OK) {
 		return TCL_ERROR;
 	    }
 	    varName = Tcl_GetString(objv[3]);
 	    return StoreStatData(interp, varName, &buf);
 	}
+	case FILE_STATLIST: {
+	    return FileStatListCmd(interp, objc, objv);
+	}
     	case FILE_TAIL: {
 	    int argc;
 	    char **argv;
+	    TclPathRep *pathPtr;
 
 	    if (objc != 3) {
 		goto only3Args;
 	    }
-	    if (SplitPath(interp, objv[2], &argc, &argv) != TCL_OK) {
+	    pathPtr = SplitPath(interp, objv[2]);
+	    if (pathPtr == NULL) {
 		return TCL_ERROR;
 	    }
+	    argc = pathPtr->argc;
+	    argv = pathPtr->argv;
 
 	    /*
 	     * Return the last component, unless it is the only component,
@@ -1270,7 +1487,7 @@ Tcl_FileObjCmd(dummy, interp, objc, objv)
 		    Tcl_SetStringObj(resultPtr, argv[argc - 1], -1);
 	    	}
 	    }
-	    ckfree((char *) argv);
+	    TclFreePathRep(pathPtr);
 	    return TCL_OK;
 	}
 	case FILE_TYPE: {
@@ -1279,7 +1496,7 @@ Tcl_FileObjCmd(dummy, interp, objc, objv)
 	    if (objc != 3) {
 	    	goto only3Args;
 	    }
-	    if (GetStatBuf(interp, objv[2], TclpLstat, &buf) != TCL_OK) {
+	    if (GetStatBuf(interp, objv[2], TclpLstat, &buf, 1) != TCL_OK) {
 		return TCL_ERROR;
 	    }
 	    Tcl_SetStringObj(resultPtr, 
@@ -1317,50 +1534,51 @@ Tcl_FileObjCmd(dummy, interp, objc, objv)
  *	procedure computes the actual full path name.
  *
  * Results:
- *	The return value is TCL_OK if the path could be split, TCL_ERROR
- *	otherwise.  If TCL_ERROR was returned, an error message is left
- *	in interp.  If TCL_OK was returned, *argvPtr is set to a newly
- *	allocated array of strings that represent the individual
- *	directories in the specified path, and *argcPtr is filled with
- *	the length of that array.
+ *	The return value is the split path, or NULL if the path could
+ *	not be split, in which case an error message is left in interp.
+ *	The split form of objPtr is cached in its internal representation,
+ *	so splitting the same object again is cheap.
  *
  * Side effects:
- *	Memory allocated.  The caller must eventually free this memory
- *	by calling ckfree() on *argvPtr.
+ *	The caller must eventually release the returned path by calling
+ *	TclFreePathRep().
  *
  *---------------------------------------------------------------------------
  */
 
-static int
-SplitPath(interp, objPtr, argcPtr, argvPtr)
+static TclPathRep *
+SplitPath(interp, objPtr)
     Tcl_Interp *interp;		/* Interp for error return.  May be NULL. */
     Tcl_Obj *objPtr;		/* Path to be split. */
-    int *argcPtr;		/* Filled with length of following array. */
-    char ***argvPtr;		/* Filled with array of strings representing
-				 * the elements of the specified path. */
 {
+    TclPathRep *pathPtr;
+    Tcl_Obj *homeObj;
+    Tcl_DString ds;
     char *fileName;
 
-    fileName = Tcl_GetString(objPtr);
+    pathPtr = TclGetPathRepFromObj(objPtr);
 
     /*
      * If there is only one element, and it starts with a tilde,
-     * perform tilde substitution and resplit the path.
+     * perform tilde substitution and resplit the path.  The result
+     * isn't cached, since the home directory may change.
      */
 
-    Tcl_SplitPath(fileName, argcPtr, argvPtr);
-    if ((*argcPtr == 1) && (fileName[0] == '~')) {
-	Tcl_DString ds;
-	
-	ckfree((char *) *argvPtr);
-	fileName = Tcl_TranslateFileName(interp, fileName, &ds);
+    if ((pathPtr->argc == 1) && (Tcl_GetString(objPtr)[0] == '~')) {
+	fileName = TclTranslateFileNameObj(interp, objPtr, &ds);
 	if (fileName == NULL) {
-	    return TCL_ERROR;
+	    return NULL;
 	}
-	Tcl_SplitPath(fileName, argcPtr, argvPtr);
+	homeObj = Tcl_NewStringObj(fileName, Tcl_DStringLength(&ds));
 	Tcl_DStringFree(&ds);
-    }
-    return TCL_OK;
+	Tcl_IncrRefCount(homeObj);
+	pathPtr = TclGetPathRepFromObj(homeObj);
+	pathPtr->refCount++;
+	Tcl_DecrRefCount(homeObj);
+	return pathPtr;
+    }
+    pathPtr->refCount++;
+    return pathPtr;
 }
 
 /*
@@ -1374,6 +1592,8 @@ SplitPath(interp, objPtr, argcPtr, argvPtr)
  * Results:
  *	Always returns TCL_OK.  Sets interp's result to boolean true or
  *	false depending on whether the file has the specified attribute.
+ *	Existence checks are answered from the interpreter's stat cache
+ *	when it is enabled.
  *
  * Side effects:
  *	None.
@@ -1392,13 +1612,17 @@ CheckAccess(interp, objPtr, mode)
     int value;
     char *fileName;
     Tcl_DString ds;
-    
-    fileName = Tcl_GetString(objPtr);
-    fileName = Tcl_TranslateFileName(interp, fileName, &ds);
+    struct stat buf;
+
+    fileName = TclTranslateFileNameObj(interp, objPtr, &ds);
     if (fileName == NULL) {
 	value = 0;
     } else {
-	value = (TclAccess(fileName, mode) == 0);
+	if ((mode == F_OK) && (GetStatCache(interp)->ttl > 0)) {
+	    value = (CachedStat(interp, fileName, &buf) == 0);
+	} else {
+	    value = (TclAccess(fileName, mode) == 0);
+	}
         Tcl_DStringFree(&ds);
     }
     Tcl_SetBooleanObj(Tcl_GetObjResult(interp), value);
@@ -1416,40 +1640,48 @@ CheckAccess(interp, objPtr, mode)
  *
  * Results:
  *	The return value is TCL_OK if the specified file exists and can
- *	be stat'ed, TCL_ERROR otherwise.  If TCL_ERROR is returned, an
- *	error message is left in interp's result.  If TCL_OK is returned,
- *	*statPtr is filled with information about the specified file.
+ *	be stat'ed, TCL_ERROR otherwise.  If TCL_ERROR is returned and
+ *	reportErrors is non-zero, an error message is left in interp's
+ *	result.  If TCL_OK is returned, *statPtr is filled with
+ *	information about the specified file.
  *
  * Side effects:
- *	None.
+ *	Calls to TclStat go through the interpreter's stat cache.
  *
  *---------------------------------------------------------------------------
  */
 
 static int
-GetStatBuf(interp, objPtr, statProc, statPtr)
-    Tcl_Interp *interp;		/* Interp for error return.  May be NULL. */
+GetStatBuf(interp, objPtr, statProc, statPtr, reportErrors)
+    Tcl_Interp *interp;		/* Interp for error return and stat
+				 * cache. */
     Tcl_Obj *objPtr;		/* Path name to examine. */
     StatProc *statProc;		/* Either stat() or lstat() depending on
 				 * desired behavior. */
     struct stat *statPtr;	/* Filled with info about file obtained by
 				 * calling (*statProc)(). */
+    int reportErrors;		/* Non-zero means leave an error message
+				 * in interp if the file can't be stat'ed. */
 {
     char *fileName;
     Tcl_DString ds;
     int status;
-    
-    fileName = Tcl_GetString(objPtr);
-    fileName = Tcl_TranslateFileName(interp, fileName, &ds);
+
+    fileName = TclTranslateFileNameObj((reportErrors ? interp : NULL),
+	    objPtr, &ds);
     if (fileName == NULL) {
 	return TCL_ERROR;
     }
 
-    status = (*statProc)(Tcl_DStringValue(&ds), statPtr);
+    if (statProc == TclStat) {
+	status = CachedStat(interp, fileName, statPtr);
+    } else {
+	status = (*statProc)(fileName, statPtr);
+    }
     Tcl_DStringFree(&ds);
-    
+
     if (status < 0) {
-	if (interp != NULL) {
+	if (reportErrors) {
 	    Tcl_AppendResult(interp, "could not read \"",
 		    Tcl_GetString(objPtr), "\": ",
 		    Tcl_PosixError(interp), (char *) NULL);
@@ -1458,244 +1690,958 @@ GetStatBuf(interp, objPtr, statProc, statPtr)
     }
     return TCL_OK;
 }
-
+
 /*
  *----------------------------------------------------------------------
  *
- * StoreStatData --
+ * GetStatCache --
  *
- *	This is a utility procedure that breaks out the fields of a
- *	"stat" structure and stores them in textual form into the
- *	elements of an associative array.
+ *	Returns the stat cache of an interpreter, creating it if it
+ *	doesn't exist yet.
  *
  * Results:
- *	Returns a standard Tcl return value.  If an error occurs then
- *	a message is left in interp's result.
+ *	A pointer to the interpreter's StatCache.
  *
  * Side effects:
- *	Elements of the associative array given by "varName" are modified.
+ *	The first call for an interpreter allocates the cache and
+ *	registers it as associated data of the interpreter, so that
+ *	it is freed when the interpreter is deleted.
  *
  *----------------------------------------------------------------------
  */
 
-static int
-StoreStatData(interp, varName, statPtr)
-    Tcl_Interp *interp;			/* Interpreter for error reports. */
-    char *varName;			/* Name of associative array variable
-					 * in which to store stat results. */
-    struct stat *statPtr;		/* Pointer to buffer containing
-					 * stat data to store in varName. */
+static StatCache *
+GetStatCache(interp)
+    Tcl_Interp *interp;		/* Interpreter whose cache is wanted. */
 {
-    char string[TCL_INTEGER_SPACE];
-
-    TclFormatInt(string, (long) statPtr->st_dev);
-    if (Tcl_SetVar2(interp, varName, "dev", string, TCL_LEAVE_ERR_MSG)
-	    == NULL) {
-	return TCL_ERROR;
-    }
-    TclFormatInt(string, (long) statPtr->st_ino);
-    if (Tcl_SetVar2(interp, varName, "ino", string, TCL_LEAVE_ERR_MSG)
-	    == NULL) {
-	return TCL_ERROR;
-    }
-    TclFormatInt(string, (unsigned short) statPtr->st_mode);
-    if (Tcl_SetVar2(interp, varName, "mode", string, TCL_LEAVE_ERR_MSG)
-	    == NULL) {
-	return TCL_ERROR;
-    }
-    TclFormatInt(string, (long) statPtr->st_nlink);
-    if (Tcl_SetVar2(interp, varName, "nlink", string, TCL_LEAVE_ERR_MSG)
-	    == NULL) {
-	return TCL_ERROR;
-    }
-    TclFormatInt(string, (long) statPtr->st_uid);
-    if (Tcl_SetVar2(interp, varName, "uid", string, TCL_LEAVE_ERR_MSG)
-	    == NULL) {
-	return TCL_ERROR;
-    }
-    TclFormatInt(string, (long) statPtr->st_gid);
-    if (Tcl_SetVar2(interp, varName, "gid", string, TCL_LEAVE_ERR_MSG)
-	    == NULL) {
-	return TCL_ERROR;
-    }
-    sprintf(string, "%lu", (unsigned long) statPtr->st_size);
-    if (Tcl_SetVar2(interp, varName, "size", string, TCL_LEAVE_ERR_MSG)
-	    == NULL) {
-	return TCL_ERROR;
-    }
-    TclFormatInt(string, (long) statPtr->st_atime);
-    if (Tcl_SetVar2(interp, varName, "atime", string, TCL_LEAVE_ERR_MSG)
-	    == NULL) {
-	return TCL_ERROR;
-    }
-    TclFormatInt(string, (long) statPtr->st_mtime);
-    if (Tcl_SetVar2(interp, varName, "mtime", string, TCL_LEAVE_ERR_MSG)
-	    == NULL) {
-	return TCL_ERROR;
-    }
-    TclFormatInt(string, (long) statPtr->st_ctime);
-    if (Tcl_SetVar2(interp, varName, "ctime", string, TCL_LEAVE_ERR_MSG)
-	    == NULL) {
-	return TCL_ERROR;
-    }
-    if (Tcl_SetVar2(interp, varName, "type",
-	    GetTypeFromMode((unsigned short) statPtr->st_mode), 
-	    TCL_LEAVE_ERR_MSG) == NULL) {
-	return TCL_ERROR;
-    }
-    return TCL_OK;
+    StatCache *cachePtr;
+
+    cachePtr = (StatCache *) Tcl_GetAssocData(interp, "tclStatCache",
+	    (Tcl_InterpDeleteProc **) NULL);
+    if (cachePtr == NULL) {
+	cachePtr = (StatCache *) ckalloc(sizeof(StatCache));
+	cachePtr->ttl = 0;
+	Tcl_InitHashTable(&cachePtr->table, TCL_STRING_KEYS);
+	cachePtr->idlePending = 0;
+	Tcl_SetAssocData(interp, "tclStatCache", DeleteStatCacheProc,
+		(ClientData) cachePtr);
+    }
+    return cachePtr;
 }
-
+
 /*
  *----------------------------------------------------------------------
  *
- * GetTypeFromMode --
+ * CachedStat --
  *
- *	Given a mode word, returns a string identifying the type of a
- *	file.
+ *	Calls TclStat for a native file name, unless the interpreter's
+ *	stat cache holds a result for the name that hasn't expired yet.
  *
  * Results:
- *	A static text string giving the file type from mode.
+ *	Same as TclStat: 0 if *statPtr was filled in, -1 with errno set
+ *	otherwise.
  *
  * Side effects:
- *	None.
+ *	The result of TclStat is added to the cache if it is enabled.
  *
  *----------------------------------------------------------------------
  */
 
-static char *
-GetTypeFromMode(mode)
-    int mode;
+static int
+CachedStat(interp, nativeName, statPtr)
+    Tcl_Interp *interp;		/* Interpreter whose cache is used. */
+    CONST char *nativeName;	/* Name as returned by
+				 * Tcl_TranslateFileName. */
+    struct stat *statPtr;	/* Filled with information about the
+				 * file. */
 {
-    if (S_ISREG(mode)) {
-	return "file";
-    } else if (S_ISDIR(mode)) {
-	return "directory";
-    } else if (S_ISCHR(mode)) {
-	return "characterSpecial";
-    } else if (S_ISBLK(mode)) {
-	return "blockSpecial";
-    } else if (S_ISFIFO(mode)) {
-	return "fifo";
-#ifdef S_ISLNK
-    } else if (S_ISLNK(mode)) {
-	return "link";
-#endif
-#ifdef S_ISSOCK
-    } else if (S_ISSOCK(mode)) {
-	return "socket";
-#endif
+    StatCache *cachePtr;
+    StatCacheEntry *entryPtr;
+    Tcl_HashEntry *hPtr;
+    Tcl_Time now;
+    long age;
+    int status;
+
+    cachePtr = (StatCache *) Tcl_GetAssocData(interp, "tclStatCache",
+	    (Tcl_InterpDeleteProc **) NULL);
+    if ((cachePtr == NULL) || (cachePtr->ttl <= 0)) {
+	return TclStat(nativeName, statPtr);
+    }
+
+    TclpGetTime(&now);
+    hPtr = Tcl_FindHashEntry(&cachePtr->table, nativeName);
+    if (hPtr != NULL) {
+	entryPtr = (StatCacheEntry *) Tcl_GetHashValue(hPtr);
+	age = (now.sec - entryPtr->time.sec) * 1000
+		+ (now.usec - entryPtr->time.usec) / 1000;
+	if ((age >= 0) && (age < cachePtr->ttl)) {
+	    if (entryPtr->status == 0) {
+		*statPtr = entryPtr->buf;
+	    } else {
+		errno = entryPtr->errorNum;
+	    }
+	    return entryPtr->status;
+	}
     }
-    return "unknown";
+
+    status = TclStat(nativeName, statPtr);
+    StatCacheStore(cachePtr, nativeName, status, errno, statPtr);
+    return status;
 }
-
+
 /*
  *----------------------------------------------------------------------
  *
- * Tcl_ForObjCmd --
- *
- *      This procedure is invoked to process the "for" Tcl command.
- *      See the user documentation for details on what it does.
+ * StatCacheStore --
  *
- *	With the bytecode compiler, this procedure is only called when
- *	a command name is computed at runtime, and is "for" or the name
- *	to which "for" was renamed: e.g.,
- *	"set z for; $z {set i 0} {$i<100} {incr i} {puts $i}"
+ *	Records the result of a stat call in a stat cache.
  *
  * Results:
- *      A standard Tcl result.
+ *	None.
  *
  * Side effects:
- *      See the user documentation.
+ *	The cache is emptied first if it is full.  An idle handler is
+ *	scheduled to empty it once the interpreter goes idle.
  *
  *----------------------------------------------------------------------
  */
 
-        /* ARGSUSED */
-int
-Tcl_ForObjCmd(dummy, interp, objc, objv)
-    ClientData dummy;                   /* Not used. */
-    Tcl_Interp *interp;                 /* Current interpreter. */
-    int objc;                           /* Number of arguments. */
-    Tcl_Obj *CONST objv[];	/* Argument objects. */
+static void
+StatCacheStore(cachePtr, nativeName, status, errorNum, statPtr)
+    StatCache *cachePtr;	/* Cache to add to. */
+    CONST char *nativeName;	/* Name of the file. */
+    int status;			/* Result of TclStat. */
+    int errorNum;		/* errno after TclStat, if status is -1. */
+    struct stat *statPtr;	/* Information returned by TclStat, if
+				 * status is 0. */
 {
-    int result, value;
-
-    if (objc != 5) {
-        Tcl_WrongNumArgs(interp, 1, objv, "start test next command");
-        return TCL_ERROR;
-    }
+    StatCacheEntry *entryPtr;
+    Tcl_HashEntry *hPtr;
+    int new;
 
-    result = Tcl_EvalObjEx(interp, objv[1], 0);
-    if (result != TCL_OK) {
-        if (result == TCL_ERROR) {
-            Tcl_AddErrorInfo(interp, "\n    (\"for\" initial command)");
-        }
-        return result;
+    if (cachePtr->table.numEntries >= STAT_CACHE_MAX_ENTRIES) {
+	ClearStatCache(cachePtr);
     }
-    while (1) {
-	/*
-	 * We need to reset the result before passing it off to
-	 * Tcl_ExprBooleanObj.  Otherwise, any error message will be appended
-	 * to the result of the last evaluation.
-	 */
-
-	Tcl_ResetResult(interp);
-        result = Tcl_ExprBooleanObj(interp, objv[2], &value);
-        if (result != TCL_OK) {
-            return result;
-        }
-        if (!value) {
-            break;
-        }
-        result = Tcl_EvalObjEx(interp, objv[4], 0);
-        if ((result != TCL_OK) && (result != TCL_CONTINUE)) {
-            if (result == TCL_ERROR) {
-                char msg[32 + TCL_INTEGER_SPACE];
 
-                sprintf(msg, "\n    (\"for\" body line %d)",interp->errorLine);
-                Tcl_AddErrorInfo(interp, msg);
-            }
-            break;
-        }
-        result = Tcl_EvalObjEx(interp, objv[3], 0);
-	if (result == TCL_BREAK) {
-            break;
-        } else if (result != TCL_OK) {
-            if (result == TCL_ERROR) {
-                Tcl_AddErrorInfo(interp, "\n    (\"for\" loop-end command)");
-            }
-            return result;
-        }
+    hPtr = Tcl_CreateHashEntry(&cachePtr->table, nativeName, &new);
+    if (new) {
+	entryPtr = (StatCacheEntry *) ckalloc(sizeof(StatCacheEntry));
+	Tcl_SetHashValue(hPtr, entryPtr);
+    } else {
+	entryPtr = (StatCacheEntry *) Tcl_GetHashValue(hPtr);
     }
-    if (result == TCL_BREAK) {
-        result = TCL_OK;
+    entryPtr->status = status;
+    entryPtr->errorNum = errorNum;
+    if (status == 0) {
+	entryPtr->buf = *statPtr;
     }
-    if (result == TCL_OK) {
-        Tcl_ResetResult(interp);
+    TclpGetTime(&entryPtr->time);
+
+    if (!cachePtr->idlePending) {
+	Tcl_DoWhenIdle(StatCacheIdleProc, (ClientData) cachePtr);
+	cachePtr->idlePending = 1;
     }
-    return result;
 }
-
+
 /*
  *----------------------------------------------------------------------
  *
- * Tcl_ForeachObjCmd --
+ * ClearStatCache --
  *
- *	This object-based procedure is invoked to process the "foreach" Tcl
- *	command.  See the user documentation for details on what it does.
+ *	Frees all entries of a stat cache.
  *
  * Results:
- *	A standard Tcl object result.
+ *	None.
  *
  * Side effects:
- *	See the user documentation.
+ *	The cache is left empty.
  *
  *----------------------------------------------------------------------
  */
 
-	/* ARGSUSED */
-int
+static void
+ClearStatCache(cachePtr)
+    StatCache *cachePtr;	/* Cache to empty. */
+{
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+
+    for (hPtr = Tcl_FirstHashEntry(&cachePtr->table, &search);
+	    hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	ckfree((char *) Tcl_GetHashValue(hPtr));
+    }
+    Tcl_DeleteHashTable(&cachePtr->table);
+    Tcl_InitHashTable(&cachePtr->table, TCL_STRING_KEYS);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FlushStatCache --
+ *
+ *	Forgets all results held in the stat cache of an interpreter.
+ *	Called by the "file" subcommands that change the file system.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The cache is emptied.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FlushStatCache(interp)
+    Tcl_Interp *interp;		/* Interpreter whose cache is flushed. */
+{
+    StatCache *cachePtr;
+
+    cachePtr = (StatCache *) Tcl_GetAssocData(interp, "tclStatCache",
+	    (Tcl_InterpDeleteProc **) NULL);
+    if ((cachePtr == NULL) || (cachePtr->table.numEntries == 0)) {
+	return;
+    }
+    ClearStatCache(cachePtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * StatCacheIdleProc --
+ *
+ *	Idle handler that empties a stat cache, so that its results
+ *	don't outlive the event loop iteration that produced them.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The cache is emptied.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+StatCacheIdleProc(clientData)
+    ClientData clientData;	/* The StatCache. */
+{
+    StatCache *cachePtr = (StatCache *) clientData;
+
+    cachePtr->idlePending = 0;
+    ClearStatCache(cachePtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DeleteStatCacheProc --
+ *
+ *	Frees the stat cache of an interpreter.  It gets invoked via the
+ *	Tcl AssocData mechanism when the interpreter is deleted.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Storage for the cache is freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+DeleteStatCacheProc(clientData, interp)
+    ClientData clientData;	/* The StatCache. */
+    Tcl_Interp *interp;		/* Interpreter being deleted. */
+{
+    StatCache *cachePtr = (StatCache *) clientData;
+
+    if (cachePtr->idlePending) {
+	Tcl_CancelIdleCall(StatCacheIdleProc, (ClientData) cachePtr);
+    }
+    ClearStatCache(cachePtr);
+    Tcl_DeleteHashTable(&cachePtr->table);
+    ckfree((char *) cachePtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FileStatListCmd --
+ *
+ *	This procedure implements "file statlist ?-fields fieldList?
+ *	?-threads count? ?-ttl milliseconds? nameList", which stats all
+ *	of the files named in nameList.  The result is a flat list
+ *	holding each name followed by a list of field names and values,
+ *	which is empty if the file couldn't be stat'ed.  -fields picks
+ *	the fields to return (the default is all of the elements set by
+ *	"file stat").  -threads lets that many threads stat the names
+ *	ahead of time (see PrefetchStats); the results themselves always
+ *	come from TclStat, so they are the same as without -threads.
+ *	-ttl sets the lifetime of the interpreter's stat cache,
+ *	for this and all later "file" subcommands; 0 disables the cache.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	The interpreter's stat cache is used and updated.  Nothing is
+ *	changed if an argument is bad.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+FileStatListCmd(interp, objc, objv)
+    Tcl_Interp *interp;		/* Current interpreter. */
+    int objc;			/* Number of arguments. */
+    Tcl_Obj *CONST objv[];	/* Argument objects; objv[1] is
+				 * "statlist". */
+{
+    static char *options[] = {
+	"-fields",	"-threads",	"-ttl",		(char *) NULL
+    };
+    enum options {
+	STATLIST_FIELDS, STATLIST_THREADS, STATLIST_TTL
+    };
+    static char *statFields[] = {
+	"dev",		"ino",		"mode",		"nlink",
+	"uid",		"gid",		"size",		"atime",
+	"mtime",	"ctime",	"type",		(char *) NULL
+    };
+    enum statFields {
+	STAT_DEV,	STAT_INO,	STAT_MODE,	STAT_NLINK,
+	STAT_UID,	STAT_GID,	STAT_SIZE,	STAT_ATIME,
+	STAT_MTIME,	STAT_CTIME,	STAT_TYPE,	STAT_NUM_FIELDS
+    };
+    int allFields[STAT_NUM_FIELDS];
+    int *fields, numFields, numThreads, numNames, numTodo, index, i, j;
+    int *todo;
+    long ttl;
+    Tcl_Obj *ttlObj, **fieldObjv, **nameObjv, *resultPtr, *listPtr;
+    Tcl_Obj *valuePtr;
+    StatCache *cachePtr;
+    StatResult *results, *resPtr;
+    Tcl_DString ds;
+    char *nativeName, string[TCL_INTEGER_SPACE];
+    int result = TCL_ERROR;
+
+    for (i = 0; i < STAT_NUM_FIELDS; i++) {
+	allFields[i] = i;
+    }
+    fields = allFields;
+    numFields = STAT_NUM_FIELDS;
+    numThreads = 0;
+    ttlObj = NULL;
+    ttl = 0;
+
+    /*
+     * Check all of the arguments before any of them takes effect.
+     */
+
+    for (i = 2; i < objc - 1; i += 2) {
+	if (Tcl_GetIndexFromObj(interp, objv[i], options, "option", 0,
+		&index) != TCL_OK) {
+	    goto done;
+	}
+	if (i + 1 == objc - 1) {
+	    break;
+	}
+	switch ((enum options) index) {
+	    case STATLIST_FIELDS:
+		if (Tcl_ListObjGetElements(interp, objv[i + 1], &numFields,
+			&fieldObjv) != TCL_OK) {
+		    goto done;
+		}
+		if (numFields == 0) {
+		    Tcl_AppendResult(interp,
+			    "bad field list \"\": must name at least one field",
+			    (char *) NULL);
+		    goto done;
+		}
+		if (fields != allFields) {
+		    ckfree((char *) fields);
+		}
+		fields = (int *) ckalloc((unsigned)
+			((numFields + 1) * sizeof(int)));
+		for (j = 0; j < numFields; j++) {
+		    if (Tcl_GetIndexFromObj(interp, fieldObjv[j], statFields,
+			    "field", 0, &fields[j]) != TCL_OK) {
+			goto done;
+		    }
+		}
+		break;
+	    case STATLIST_THREADS:
+		if (Tcl_GetIntFromObj(interp, objv[i + 1], &numThreads)
+			!= TCL_OK) {
+		    goto done;
+		}
+		if (numThreads < 0) {
+		    Tcl_AppendResult(interp, "bad thread count \"",
+			    Tcl_GetString(objv[i + 1]),
+			    "\": must be a non-negative integer",
+			    (char *) NULL);
+		    goto done;
+		}
+		if (numThreads > STAT_MAX_THREADS) {
+		    numThreads = STAT_MAX_THREADS;
+		}
+		break;
+	    case STATLIST_TTL:
+		if (Tcl_GetLongFromObj(interp, objv[i + 1], &ttl) != TCL_OK) {
+		    goto done;
+		}
+		if (ttl < 0) {
+		    Tcl_AppendResult(interp, "bad time to live \"",
+			    Tcl_GetString(objv[i + 1]),
+			    "\": must be a non-negative integer",
+			    (char *) NULL);
+		    goto done;
+		}
+		ttlObj = objv[i + 1];
+		break;
+	}
+    }
+    if ((objc < 3) || (i != objc - 1)) {
+	Tcl_WrongNumArgs(interp, 2, objv,
+		"?-fields fieldList? ?-threads count? ?-ttl milliseconds? "
+		"nameList");
+	goto done;
+    }
+    if (Tcl_ListObjGetElements(interp, objv[objc - 1], &numNames,
+	    &nameObjv) != TCL_OK) {
+	goto done;
+    }
+
+    cachePtr = GetStatCache(interp);
+    if (ttlObj != NULL) {
+	cachePtr->ttl = ttl;
+	if (ttl == 0) {
+	    FlushStatCache(interp);
+	}
+    }
+
+    /*
+     * Translate the names.  Names that can't be translated (unknown
+     * users in tilde paths) are reported like files that don't exist.
+     * Those whose results aren't cached are queued for the pool.
+     */
+
+    results = (StatResult *) ckalloc((unsigned)
+	    ((numNames + 1) * sizeof(StatResult)));
+    todo = (int *) ckalloc((unsigned) ((numNames + 1) * sizeof(int)));
+    numTodo = 0;
+    for (i = 0; i < numNames; i++) {
+	resPtr = &results[i];
+	resPtr->nativeName = NULL;
+	resPtr->status = -1;
+	nativeName = TclTranslateFileNameObj(NULL, nameObjv[i], &ds);
+	if (nativeName == NULL) {
+	    continue;
+	}
+	resPtr->nativeName = ckalloc((unsigned) Tcl_DStringLength(&ds) + 1);
+	strcpy(resPtr->nativeName, nativeName);
+	Tcl_DStringFree(&ds);
+	if ((numThreads > 1) && ((cachePtr->ttl == 0)
+		|| (Tcl_FindHashEntry(&cachePtr->table, resPtr->nativeName)
+		== NULL))) {
+	    todo[numTodo++] = i;
+	}
+    }
+
+#ifdef TCL_THREADS
+    if (numTodo > 1) {
+	PrefetchStats(results, todo, numTodo, numThreads);
+    }
+#endif
+
+    /*
+     * Stat the names in this thread, through the stat hooks and the
+     * cache.  After the pool has been at them, these calls should be
+     * answered without waiting for the disk.
+     */
+
+    for (i = 0; i < numNames; i++) {
+	resPtr = &results[i];
+	if (resPtr->nativeName != NULL) {
+	    resPtr->status = CachedStat(interp, resPtr->nativeName,
+		    &resPtr->buf);
+	}
+    }
+
+    resultPtr = Tcl_GetObjResult(interp);
+    for (i = 0; i < numNames; i++) {
+	resPtr = &results[i];
+	listPtr = Tcl_NewObj();
+	for (j = 0; (resPtr->status == 0) && (j < numFields); j++) {
+	    switch ((enum statFields) fields[j]) {
+		case STAT_DEV:
+		    valuePtr = Tcl_NewLongObj((long) resPtr->buf.st_dev);
+		    break;
+		case STAT_INO:
+		    valuePtr = Tcl_NewLongObj((long) resPtr->buf.st_ino);
+		    break;
+		case STAT_MODE:
+		    valuePtr = Tcl_NewIntObj(
+			    (unsigned short) resPtr->buf.st_mode);
+		    break;
+		case STAT_NLINK:
+		    valuePtr = Tcl_NewLongObj((long) resPtr->buf.st_nlink);
+		    break;
+		case STAT_UID:
+		    valuePtr = Tcl_NewLongObj((long) resPtr->buf.st_uid);
+		    break;
+		case STAT_GID:
+		    valuePtr = Tcl_NewLongObj((long) resPtr->buf.st_gid);
+		    break;
+		case STAT_SIZE:
+		    sprintf(string, "%lu", (unsigned long) resPtr->buf.st_size);
+		    valuePtr = Tcl_NewStringObj(string, -1);
+		    break;
+		case STAT_ATIME:
+		    valuePtr = Tcl_NewLongObj((long) resPtr->buf.st_atime);
+		    break;
+		case STAT_MTIME:
+		    valuePtr = Tcl_NewLongObj((long) resPtr->buf.st_mtime);
+		    break;
+		case STAT_CTIME:
+		    valuePtr = Tcl_NewLongObj((long) resPtr->buf.st_ctime);
+		    break;
+		default:
+		    valuePtr = Tcl_NewStringObj(GetTypeFromMode(
+			    (unsigned short) resPtr->buf.st_mode), -1);
+		    break;
+	    }
+	    Tcl_ListObjAppendElement(NULL, listPtr,
+		    Tcl_NewStringObj(statFields[fields[j]], -1));
+	    Tcl_ListObjAppendElement(NULL, listPtr, valuePtr);
+	}
+	Tcl_ListObjAppendElement(NULL, resultPtr, nameObjv[i]);
+	Tcl_ListObjAppendElement(NULL, resultPtr, listPtr);
+	if (resPtr->nativeName != NULL) {
+	    ckfree(resPtr->nativeName);
+	}
+    }
+    ckfree((char *) todo);
+    ckfree((char *) results);
+    result = TCL_OK;
+
+    done:
+    if (fields != allFields) {
+	ckfree((char *) fields);
+    }
+    return result;
+}
+
+#ifdef TCL_THREADS
+/*
+ *----------------------------------------------------------------------
+ *
+ * PrefetchStats --
+ *
+ *	Stats the names of "file statlist -threads" with the threads of
+ *	the pool and this thread, so that the TclStat calls made for
+ *	them afterwards find the file system information in memory.
+ *	The prefetching calls go straight to TclpStat: TclStat holds the
+ *	lock on the list of stat hooks while it calls them, which would
+ *	make the threads take turns.  Their results are thrown away, so
+ *	the stat hooks still decide what "file statlist" returns.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Starts threads for the pool if it has fewer than numThreads - 1
+ *	of them.  Does nothing if another job is using the pool.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+PrefetchStats(results, todo, numTodo, numThreads)
+    StatResult *results;	/* Names to stat. */
+    int *todo;			/* Indices in results of the names. */
+    int numTodo;		/* Number of entries in todo. */
+    int numThreads;		/* Number of threads to use, including
+				 * this one. */
+{
+    StatJob job;
+    Tcl_ThreadId threadId;
+    struct stat buf;
+    int index;
+
+    if (numThreads > numTodo) {
+	numThreads = numTodo;
+    }
+
+    Tcl_MutexLock(&statPoolMutex);
+    if ((statJobPtr != NULL) || statPoolExiting) {
+	Tcl_MutexUnlock(&statPoolMutex);
+	return;
+    }
+    if (!statExitHandler) {
+	Tcl_CreateExitHandler(StatPoolExitProc, (ClientData) NULL);
+	statExitHandler = 1;
+    }
+    while (statNumThreads < numThreads - 1) {
+	if (Tcl_CreateThread(&threadId, StatWorkerProc, (ClientData) NULL,
+		TCL_THREAD_STACK_DEFAULT, TCL_THREAD_NOFLAGS) != TCL_OK) {
+	    break;
+	}
+	statNumThreads++;
+    }
+
+    job.results = results;
+    job.todo = todo;
+    job.numTodo = numTodo;
+    job.next = 0;
+    job.numBusy = 0;
+    job.numWorkers = 0;
+    job.maxWorkers = numThreads - 1;
+    statJobPtr = &job;
+    Tcl_ConditionNotify(&statWorkCond);
+
+    while (job.next < job.numTodo) {
+	index = job.todo[job.next++];
+	job.numBusy++;
+	Tcl_MutexUnlock(&statPoolMutex);
+	TclpStat(results[index].nativeName, &buf);
+	Tcl_MutexLock(&statPoolMutex);
+	job.numBusy--;
+    }
+    while (job.numBusy > 0) {
+	Tcl_ConditionWait(&statDoneCond, &statPoolMutex, NULL);
+    }
+    statJobPtr = NULL;
+    Tcl_MutexUnlock(&statPoolMutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * StatWorkerProc --
+ *
+ *	Body of the threads of the "file statlist -threads" pool.  Waits
+ *	for jobs and stats their names until the pool is told to exit.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Exits the thread.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_ThreadCreateType
+StatWorkerProc(clientData)
+    ClientData clientData;	/* Not used. */
+{
+    StatJob *jobPtr;
+    struct stat buf;
+    int index;
+
+    Tcl_MutexLock(&statPoolMutex);
+    while (!statPoolExiting) {
+	jobPtr = statJobPtr;
+	if ((jobPtr == NULL) || (jobPtr->next >= jobPtr->numTodo)
+		|| (jobPtr->numWorkers >= jobPtr->maxWorkers)) {
+	    Tcl_ConditionWait(&statWorkCond, &statPoolMutex, NULL);
+	    continue;
+	}
+	index = jobPtr->todo[jobPtr->next++];
+	jobPtr->numBusy++;
+	jobPtr->numWorkers++;
+	Tcl_MutexUnlock(&statPoolMutex);
+	TclpStat(jobPtr->results[index].nativeName, &buf);
+	Tcl_MutexLock(&statPoolMutex);
+	jobPtr->numWorkers--;
+	jobPtr->numBusy--;
+	Tcl_ConditionNotify(&statDoneCond);
+    }
+    statNumThreads--;
+    Tcl_ConditionNotify(&statDoneCond);
+    Tcl_MutexUnlock(&statPoolMutex);
+
+    Tcl_ExitThread(0);
+    TCL_THREAD_CREATE_RETURN;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * StatPoolExitProc --
+ *
+ *	Exit handler that stops the threads of the "file statlist
+ *	-threads" pool.  It waits for them, so that none of them is
+ *	still running when Tcl's mutexes are finalized.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The pool is emptied; the next job starts new threads.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+StatPoolExitProc(clientData)
+    ClientData clientData;	/* Not used. */
+{
+    Tcl_MutexLock(&statPoolMutex);
+    statPoolExiting = 1;
+    Tcl_ConditionNotify(&statWorkCond);
+    while (statNumThreads > 0) {
+	Tcl_ConditionWait(&statDoneCond, &statPoolMutex, NULL);
+    }
+    statPoolExiting = 0;
+    statExitHandler = 0;
+    Tcl_MutexUnlock(&statPoolMutex);
+    Tcl_ConditionFinalize(&statWorkCond);
+    Tcl_ConditionFinalize(&statDoneCond);
+}
+#endif
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * StoreStatData --
+ *
+ *	This is a utility procedure that breaks out the fields of a
+ *	"stat" structure and stores them in textual form into the
+ *	elements of an associative array.
+ *
+ * Results:
+ *	Returns a standard Tcl return value.  If an error occurs then
+ *	a message is left in interp's result.
+ *
+ * Side effects:
+ *	Elements of the associative array given by "varName" are modified.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+StoreStatData(interp, varName, statPtr)
+    Tcl_Interp *interp;			/* Interpreter for error reports. */
+    char *varName;			/* Name of associative array variable
+					 * in which to store stat results. */
+    struct stat *statPtr;		/* Pointer to buffer containing
+					 * stat data to store in varName. */
+{
+    char string[TCL_INTEGER_SPACE];
+
+    TclFormatInt(string, (long) statPtr->st_dev);
+    if (Tcl_SetVar2(interp, varName, "dev", string, TCL_LEAVE_ERR_MSG)
+	    == NULL) {
+	return TCL_ERROR;
+    }
+    TclFormatInt(string, (long) statPtr->st_ino);
+    if (Tcl_SetVar2(interp, varName, "ino", string, TCL_LEAVE_ERR_MSG)
+	    == NULL) {
+	return TCL_ERROR;
+    }
+    TclFormatInt(string, (unsigned short) statPtr->st_mode);
+    if (Tcl_SetVar2(interp, varName, "mode", string, TCL_LEAVE_ERR_MSG)
+	    == NULL) {
+	return TCL_ERROR;
+    }
+    TclFormatInt(string, (long) statPtr->st_nlink);
+    if (Tcl_SetVar2(interp, varName, "nlink", string, TCL_LEAVE_ERR_MSG)
+	    == NULL) {
+	return TCL_ERROR;
+    }
+    TclFormatInt(string, (long) statPtr->st_uid);
+    if (Tcl_SetVar2(interp, varName, "uid", string, TCL_LEAVE_ERR_MSG)
+	    == NULL) {
+	return TCL_ERROR;
+    }
+    TclFormatInt(string, (long) statPtr->st_gid);
+    if (Tcl_SetVar2(interp, varName, "gid", string, TCL_LEAVE_ERR_MSG)
+	    == NULL) {
+	return TCL_ERROR;
+    }
+    sprintf(string, "%lu", (unsigned long) statPtr->st_size);
+    if (Tcl_SetVar2(interp, varName, "size", string, TCL_LEAVE_ERR_MSG)
+	    == NULL) {
+	return TCL_ERROR;
+    }
+    TclFormatInt(string, (long) statPtr->st_atime);
+    if (Tcl_SetVar2(interp, varName, "atime", string, TCL_LEAVE_ERR_MSG)
+	    == NULL) {
+	return TCL_ERROR;
+    }
+    TclFormatInt(string, (long) statPtr->st_mtime);
+    if (Tcl_SetVar2(interp, varName, "mtime", string, TCL_LEAVE_ERR_MSG)
+	    == NULL) {
+	return TCL_ERROR;
+    }
+    TclFormatInt(string, (long) statPtr->st_ctime);
+    if (Tcl_SetVar2(interp, varName, "ctime", string, TCL_LEAVE_ERR_MSG)
+	    == NULL) {
+	return TCL_ERROR;
+    }
+    if (Tcl_SetVar2(interp, varName, "type",
+	    GetTypeFromMode((unsigned short) statPtr->st_mode), 
+	    TCL_LEAVE_ERR_MSG) == NULL) {
+	return TCL_ERROR;
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetTypeFromMode --
+ *
+ *	Given a mode word, returns a string identifying the type of a
+ *	file.
+ *
+ * Results:
+ *	A static text string giving the file type from mode.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static char *
+GetTypeFromMode(mode)
+    int mode;
+{
+    if (S_ISREG(mode)) {
+	return "file";
+    } else if (S_ISDIR(mode)) {
+	return "directory";
+    } else if (S_ISCHR(mode)) {
+	return "characterSpecial";
+    } else if (S_ISBLK(mode)) {
+	return "blockSpecial";
+    } else if (S_ISFIFO(mode)) {
+	return "fifo";
+#ifdef S_ISLNK
+    } else if (S_ISLNK(mode)) {
+	return "link";
+#endif
+#ifdef S_ISSOCK
+    } else if (S_ISSOCK(mode)) {
+	return "socket";
+#endif
+    }
+    return "unknown";
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_ForObjCmd --
+ *
+ *      This procedure is invoked to process the "for" Tcl command.
+ *      See the user documentation for details on what it does.
+ *
+ *	With the bytecode compiler, this procedure is only called when
+ *	a command name is computed at runtime, and is "for" or the name
+ *	to which "for" was renamed: e.g.,
+ *	"set z for; $z {set i 0} {$i<100} {incr i} {puts $i}"
+ *
+ * Results:
+ *      A standard Tcl result.
+ *
+ * Side effects:
+ *      See the user documentation.
+ *
+ *----------------------------------------------------------------------
+ */
+
+        /* ARGSUSED */
+int
+Tcl_ForObjCmd(dummy, interp, objc, objv)
+    ClientData dummy;                   /* Not used. */
+    Tcl_Interp *interp;                 /* Current interpreter. */
+    int objc;                           /* Number of arguments. */
+    Tcl_Obj *CONST objv[];	/* Argument objects. */
+{
+    int result, value;
+
+    if (objc != 5) {
+        Tcl_WrongNumArgs(interp, 1, objv, "start test next command");
+        return TCL_ERROR;
+    }
+
+    result = Tcl_EvalObjEx(interp, objv[1], 0);
+    if (result != TCL_OK) {
+        if (result == TCL_ERROR) {
+            Tcl_AddErrorInfo(interp, "\n    (\"for\" initial command)");
+        }
+        return result;
+    }
+    while (1) {
+	/*
+	 * We need to reset the result before passing it off to
+	 * Tcl_ExprBooleanObj.  Otherwise, any error message will be appended
+	 * to the result of the last evaluation.
+	 */
+
+	Tcl_ResetResult(interp);
+        result = Tcl_ExprBooleanObj(interp, objv[2], &value);
+        if (result != TCL_OK) {
+            return result;
+        }
+        if (!value) {
+            break;
+        }
+        result = Tcl_EvalObjEx(interp, objv[4], 0);
+        if ((result != TCL_OK) && (result != TCL_CONTINUE)) {
+            if (result == TCL_ERROR) {
+                char msg[32 + TCL_INTEGER_SPACE];
+
+                sprintf(msg, "\n    (\"for\" body line %d)",interp->errorLine);
+                Tcl_AddErrorInfo(interp, msg);
+            }
+            break;
+        }
+        result = Tcl_EvalObjEx(interp, objv[3], 0);
+	if (result == TCL_BREAK) {
+            break;
+        } else if (result != TCL_OK) {
+            if (result == TCL_ERROR) {
+                Tcl_AddErrorInfo(interp, "\n    (\"for\" loop-end command)");
+            }
+            return result;
+        }
+    }
+    if (result == TCL_BREAK) {
+        result = TCL_OK;
+    }
+    if (result == TCL_OK) {
+        Tcl_ResetResult(interp);
+    }
+    return result;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_ForeachObjCmd --
+ *
+ *	This object-based procedure is invoked to process the "foreach" Tcl
+ *	command.  See the user documentation for details on what it does.
+ *	The loop variables are looked up once, when the loop starts (see
+ *	BindLoopVar), rather than by name on every iteration.
+ *
+ * Results:
+ *	A standard Tcl object result.
+ *
+ * Side effects:
+ *	See the user documentation.
+ *
+ *----------------------------------------------------------------------
+ */
+
+	/* ARGSUSED */
+int
 Tcl_ForeachObjCmd(dummy, interp, objc, objv)
     ClientData dummy;		/* Not used. */
     Tcl_Interp *interp;		/* Current interpreter. */
@@ -1707,31 +2653,26 @@ Tcl_ForeachObjCmd(dummy, interp, objc, objv)
     int j, maxj;		/* Number of loop iterations */
     int v;			/* v selects a loop variable */
     int numLists;		/* Count of value lists */
+    int numVars;		/* Count of loop variables */
     Tcl_Obj *bodyPtr;
+    ForeachList *listPtr;
+    Var **nextVarPtr;
 
     /*
-     * We copy the argument object pointers into a local array to avoid
-     * the problem that "objv" might become invalid. It is a pointer into
-     * the evaluation stack and that stack might be grown and reallocated
-     * if the loop body requires a large amount of stack space.
+     * The pointers to the argument objects are kept in the ForeachList
+     * structures rather than used through "objv", which might become
+     * invalid: it is a pointer into the evaluation stack and that stack
+     * might be grown and reallocated if the loop body requires a large
+     * amount of stack space.  The lists are used in place; they are only
+     * converted again if the body changes their internal representation.
      */
     
-#define NUM_ARGS 9
-    Tcl_Obj *(argObjStorage[NUM_ARGS]);
-    Tcl_Obj **argObjv = argObjStorage;
-    
 #define STATIC_LIST_SIZE 4
-    int indexArray[STATIC_LIST_SIZE];	  /* Array of value list indices */
-    int varcListArray[STATIC_LIST_SIZE];  /* # loop variables per list */
-    Tcl_Obj **varvListArray[STATIC_LIST_SIZE]; /* Array of var name lists */
-    int argcListArray[STATIC_LIST_SIZE];  /* Array of value list sizes */
-    Tcl_Obj **argvListArray[STATIC_LIST_SIZE]; /* Array of value lists */
-
-    int *index = indexArray;
-    int *varcList = varcListArray;
-    Tcl_Obj ***varvList = varvListArray;
-    int *argcList = argcListArray;
-    Tcl_Obj ***argvList = argvListArray;
+#define STATIC_VAR_SIZE 8
+    ForeachList listArray[STATIC_LIST_SIZE];
+    Var *varPtrArray[STATIC_VAR_SIZE];
+    ForeachList *lists = listArray;
+    Var **varPtrs = varPtrArray;
 
     if (objc < 4 || (objc%2 != 0)) {
 	Tcl_WrongNumArgs(interp, 1, objv,
@@ -1739,125 +2680,137 @@ Tcl_ForeachObjCmd(dummy, interp, objc, objv)
 	return TCL_ERROR;
     }
 
-    /*
-     * Create the object argument array "argObjv". Make sure argObjv is
-     * large enough to hold the objc arguments.
-     */
-
-    if (objc > NUM_ARGS) {
-	argObjv = (Tcl_Obj **) ckalloc(objc * sizeof(Tcl_Obj *));
-    }
-    for (i = 0;  i < objc;  i++) {
-	argObjv[i] = objv[i];
-    }
-
     /*
      * Manage numList parallel value lists.
-     * argvList[i] is a value list counted by argcList[i]
-     * varvList[i] is the list of variables associated with the value list
-     * varcList[i] is the number of variables associated with the value list
-     * index[i] is the current pointer into the value list argvList[i]
+     * lists[i].valuev is a value list counted by lists[i].valuec
+     * lists[i].varv is the list of variables associated with the value list
+     * lists[i].varc is the number of variables associated with the value list
+     * lists[i].index is the current pointer into the value list
      */
 
     numLists = (objc-2)/2;
     if (numLists > STATIC_LIST_SIZE) {
-	index = (int *) ckalloc(numLists * sizeof(int));
-	varcList = (int *) ckalloc(numLists * sizeof(int));
-	varvList = (Tcl_Obj ***) ckalloc(numLists * sizeof(Tcl_Obj **));
-	argcList = (int *) ckalloc(numLists * sizeof(int));
-	argvList = (Tcl_Obj ***) ckalloc(numLists * sizeof(Tcl_Obj **));
+	lists = (ForeachList *) ckalloc(numLists * sizeof(ForeachList));
     }
     for (i = 0;  i < numLists;  i++) {
-	index[i] = 0;
-	varcList[i] = 0;
-	varvList[i] = (Tcl_Obj **) NULL;
-	argcList[i] = 0;
-	argvList[i] = (Tcl_Obj **) NULL;
-    }
+	listPtr = &lists[i];
+	listPtr->varListPtr = objv[1+i*2];
+	listPtr->valueListPtr = objv[2+i*2];
+	listPtr->varc = 0;
+	listPtr->varv = (Tcl_Obj **) NULL;
+	listPtr->valuec = 0;
+	listPtr->valuev = (Tcl_Obj **) NULL;
+	listPtr->index = 0;
+	listPtr->varPtrs = (Var **) NULL;
+    }
+    bodyPtr = objv[objc-1];
 
     /*
      * Break up the value lists and variable lists into elements
      */
 
     maxj = 0;
+    numVars = 0;
     for (i = 0;  i < numLists;  i++) {
-	result = Tcl_ListObjGetElements(interp, argObjv[1+i*2],
-	        &varcList[i], &varvList[i]);
+	listPtr = &lists[i];
+	result = Tcl_ListObjGetElements(interp, listPtr->varListPtr,
+	        &listPtr->varc, &listPtr->varv);
 	if (result != TCL_OK) {
 	    goto done;
 	}
-	if (varcList[i] < 1) {
+	if (listPtr->varc < 1) {
 	    Tcl_AppendToObj(Tcl_GetObjResult(interp),
 	            "foreach varlist is empty", -1);
 	    result = TCL_ERROR;
 	    goto done;
 	}
+	numVars += listPtr->varc;
 	
-	result = Tcl_ListObjGetElements(interp, argObjv[2+i*2],
-	        &argcList[i], &argvList[i]);
+	result = Tcl_ListObjGetElements(interp, listPtr->valueListPtr,
+	        &listPtr->valuec, &listPtr->valuev);
 	if (result != TCL_OK) {
 	    goto done;
 	}
 	
-	j = argcList[i] / varcList[i];
-	if ((argcList[i] % varcList[i]) != 0) {
+	j = listPtr->valuec / listPtr->varc;
+	if ((listPtr->valuec % listPtr->varc) != 0) {
 	    j++;
 	}
 	if (j > maxj) {
 	    maxj = j;
 	}
     }
+    if (maxj == 0) {
+	goto done;
+    }
+
+    /*
+     * Bind the loop variables.
+     */
+
+    if (numVars > STATIC_VAR_SIZE) {
+	varPtrs = (Var **) ckalloc(numVars * sizeof(Var *));
+    }
+    nextVarPtr = varPtrs;
+    for (i = 0;  i < numLists;  i++) {
+	listPtr = &lists[i];
+	listPtr->varPtrs = nextVarPtr;
+	for (v = 0;  v < listPtr->varc;  v++) {
+	    listPtr->varPtrs[v] = BindLoopVar(interp, listPtr->varv[v]);
+	}
+	nextVarPtr += listPtr->varc;
+    }
 
     /*
      * Iterate maxj times through the lists in parallel
      * If some value lists run out of values, set loop vars to ""
      */
     
-    bodyPtr = argObjv[objc-1];
     for (j = 0;  j < maxj;  j++) {
 	for (i = 0;  i < numLists;  i++) {
+	    listPtr = &lists[i];
+
 	    /*
 	     * If a variable or value list object has been converted to
 	     * another kind of Tcl object, convert it back to a list object
 	     * and refetch the pointer to its element array.
 	     */
 
-	    if (argObjv[1+i*2]->typePtr != &tclListType) {
-		result = Tcl_ListObjGetElements(interp, argObjv[1+i*2],
-		        &varcList[i], &varvList[i]);
+	    if (listPtr->varListPtr->typePtr != &tclListType) {
+		result = Tcl_ListObjGetElements(interp, listPtr->varListPtr,
+		        &listPtr->varc, &listPtr->varv);
 		if (result != TCL_OK) {
 		    panic("Tcl_ForeachObjCmd: could not reconvert variable list %d to a list object\n", i);
 		}
 	    }
-	    if (argObjv[2+i*2]->typePtr != &tclListType) {
-		result = Tcl_ListObjGetElements(interp, argObjv[2+i*2],
-	                &argcList[i], &argvList[i]);
+	    if (listPtr->valueListPtr->typePtr != &tclListType) {
+		result = Tcl_ListObjGetElements(interp, listPtr->valueListPtr,
+	                &listPtr->valuec, &listPtr->valuev);
 		if (result != TCL_OK) {
 		    panic("Tcl_ForeachObjCmd: could not reconvert value list %d to a list object\n", i);
 		}
 	    }
 	    
-	    for (v = 0;  v < varcList[i];  v++) {
-		int k = index[i]++;
-		Tcl_Obj *valuePtr, *varValuePtr;
+	    for (v = 0;  v < listPtr->varc;  v++) {
+		int k = listPtr->index++;
+		Tcl_Obj *valuePtr;
 		int isEmptyObj = 0;
 		
-		if (k < argcList[i]) {
-		    valuePtr = argvList[i][k];
+		if (k < listPtr->valuec) {
+		    valuePtr = listPtr->valuev[k];
 		} else {
 		    valuePtr = Tcl_NewObj(); /* empty string */
 		    isEmptyObj = 1;
 		}
-		varValuePtr = Tcl_ObjSetVar2(interp, varvList[i][v],
-			NULL, valuePtr, 0);
-		if (varValuePtr == NULL) {
+		if (SetLoopVar(interp, listPtr->varPtrs[v], listPtr->varv[v],
+			valuePtr) != TCL_OK) {
 		    if (isEmptyObj) {
 			Tcl_DecrRefCount(valuePtr);
 		    }
 		    Tcl_ResetResult(interp);
 		    Tcl_AppendStringsToObj(Tcl_GetObjResult(interp),
 			"couldn't set loop variable: \"",
-			Tcl_GetString(varvList[i][v]), "\"", (char *) NULL);
+			Tcl_GetString(listPtr->varv[v]), "\"", (char *) NULL);
 		    result = TCL_ERROR;
 		    goto done;
 		}
@@ -1889,19 +2842,152 @@ Tcl_ForeachObjCmd(dummy, interp, objc, objv)
     }
 
     done:
-    if (numLists > STATIC_LIST_SIZE) {
-	ckfree((char *) index);
-	ckfree((char *) varcList);
-	ckfree((char *) argcList);
-	ckfree((char *) varvList);
-	ckfree((char *) argvList);
+    for (i = 0;  i < numLists;  i++) {
+	listPtr = &lists[i];
+	if (listPtr->varPtrs == NULL) {
+	    continue;
+	}
+	for (v = 0;  v < listPtr->varc;  v++) {
+	    if (listPtr->varPtrs[v] != NULL) {
+		ReleaseLoopVar(listPtr->varPtrs[v]);
+	    }
+	}
     }
-    if (argObjv != argObjStorage) {
-	ckfree((char *) argObjv);
+    if (varPtrs != varPtrArray) {
+	ckfree((char *) varPtrs);
+    }
+    if (numLists > STATIC_LIST_SIZE) {
+	ckfree((char *) lists);
     }
     return result;
 #undef STATIC_LIST_SIZE
-#undef NUM_ARGS
+#undef STATIC_VAR_SIZE
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * BindLoopVar --
+ *
+ *	Looks up a loop variable of a "foreach" command, creating it if
+ *	necessary, so that SetLoopVar can set it without looking it up
+ *	again.  The variable's reference count is incremented so that it
+ *	survives being unset by the loop body.  Names of array elements
+ *	are not bound.
+ *
+ * Results:
+ *	The variable, or NULL if it must be set by name.
+ *
+ * Side effects:
+ *	May create the variable (undefined).  ReleaseLoopVar must be
+ *	called for each variable returned.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Var *
+BindLoopVar(interp, namePtr)
+    Tcl_Interp *interp;		/* Interpreter running the loop. */
+    Tcl_Obj *namePtr;		/* Name of the loop variable. */
+{
+    Var *varPtr, *arrayPtr;
+    char *name;
+    int length;
+
+    name = Tcl_GetStringFromObj(namePtr, &length);
+    if ((length > 0) && (name[length-1] == ')')) {
+	return NULL;
+    }
+    varPtr = TclLookupVar(interp, name, (char *) NULL, 0, "set",
+	    /*createPart1*/ 1, /*createPart2*/ 0, &arrayPtr);
+    if ((varPtr == NULL) || (arrayPtr != NULL)) {
+	return NULL;
+    }
+    varPtr->refCount++;
+    return varPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SetLoopVar --
+ *
+ *	Sets a loop variable of a "foreach" command.  The variable bound
+ *	by BindLoopVar is set directly if it is still a plain scalar
+ *	without traces; otherwise the variable is set by name, which
+ *	takes care of traces, links and errors.
+ *
+ * Results:
+ *	TCL_OK, or TCL_ERROR if the variable couldn't be set.
+ *
+ * Side effects:
+ *	Sets the variable.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+SetLoopVar(interp, varPtr, namePtr, valuePtr)
+    Tcl_Interp *interp;		/* Interpreter running the loop. */
+    Var *varPtr;		/* Variable returned by BindLoopVar, or
+				 * NULL. */
+    Tcl_Obj *namePtr;		/* Name of the loop variable. */
+    Tcl_Obj *valuePtr;		/* New value of the variable. */
+{
+    Tcl_Obj *oldValuePtr;
+
+    if ((varPtr == NULL) || (varPtr->tracePtr != NULL)
+	    || (varPtr->flags & (VAR_ARRAY|VAR_LINK))
+	    || ((varPtr->flags & VAR_IN_HASHTABLE) && (varPtr->hPtr == NULL))) {
+	if (Tcl_ObjSetVar2(interp, namePtr, NULL, valuePtr, 0) == NULL) {
+	    return TCL_ERROR;
+	}
+	return TCL_OK;
+    }
+
+    oldValuePtr = TclIsVarUndefined(varPtr) ? NULL : varPtr->value.objPtr;
+    if (valuePtr != oldValuePtr) {
+	varPtr->value.objPtr = valuePtr;
+	Tcl_IncrRefCount(valuePtr);
+	if (oldValuePtr != NULL) {
+	    Tcl_DecrRefCount(oldValuePtr);
+	}
+    }
+    TclSetVarScalar(varPtr);
+    TclClearVarUndefined(varPtr);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ReleaseLoopVar --
+ *
+ *	Drops the reference to a loop variable taken by BindLoopVar.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	If the variable is undefined and nothing else refers to it, it is
+ *	deleted, as CleanupVar in tclVar.c does.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ReleaseLoopVar(varPtr)
+    Var *varPtr;		/* Variable returned by BindLoopVar. */
+{
+    varPtr->refCount--;
+    if (TclIsVarUndefined(varPtr) && (varPtr->refCount == 0)
+	    && (varPtr->tracePtr == NULL)
+	    && (varPtr->flags & VAR_IN_HASHTABLE)) {
+	if (varPtr->hPtr != NULL) {
+	    Tcl_DeleteHashEntry(varPtr->hPtr);
+	}
+	ckfree((char *) varPtr);
+    }
 }
 
 /*
@@ -1998,9 +3084,32 @@ Tcl_FormatObjCmd(dummy, interp, objc, objv)
      * at a time, making many individual calls to sprintf.
      */
 
-    if (objc < 2) {
-        Tcl_WrongNumArgs(interp, 1, objv, "formatString ?arg arg ...?");
-	return TCL_ERROR;
+    if (objc < 2) {
+        Tcl_WrongNumArgs(interp, 1, objv, "formatString ?arg arg ...?");
+	return TCL_ERROR;
+    }
+
+    /*
+     * Use the compiled form of the format string if it has one or can
+     * be given one.  The FormatSpec is preserved while it runs, since
+     * converting an argument that is the format string object itself
+     * would free it.
+     */
+
+    if ((objv[1]->typePtr == &formatType) || (Tcl_ConvertToType(
+	    (Tcl_Interp *) NULL, objv[1], &formatType) == TCL_OK)) {
+	FormatSpec *specPtr;
+	int result;
+
+	specPtr = (FormatSpec *) objv[1]->internalRep.otherValuePtr;
+	specPtr->refCount++;
+	result = FormatCompiled(interp, specPtr, Tcl_GetString(objv[1]),
+		objc, objv);
+	specPtr->refCount--;
+	if (specPtr->refCount <= 0) {
+	    ckfree((char *) specPtr);
+	}
+	return result;
     }
 
     format = (char *) Tcl_GetStringFromObj(objv[1], &formatLen);
@@ -2366,6 +3475,562 @@ Tcl_FormatObjCmd(dummy, interp, objc, objv)
     return TCL_ERROR;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * FormatCompiled --
+ *
+ *	Does the work of Tcl_FormatObjCmd for a format string that has
+ *	been compiled into a FormatSpec.  Literal text, integers, strings
+ *	and characters are written directly into the result object; only
+ *	floating-point values and the less common integer conversions
+ *	still go through sprintf.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	See the user documentation.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+FormatCompiled(interp, specPtr, format, objc, objv)
+    Tcl_Interp *interp;		/* Current interpreter. */
+    FormatSpec *specPtr;	/* Compiled form of the format string. */
+    char *format;		/* The format string; holds the literal
+				 * text of the fields. */
+    int objc;			/* Number of arguments. */
+    Tcl_Obj *CONST objv[];	/* Argument objects. */
+{
+    Tcl_Obj *resultPtr;
+    FormatField *fieldPtr;
+    char newFormat[40], digits[TCL_INTEGER_SPACE];
+    char *dst, *src, padChar;
+    int i, used, avail, size, width, precision, minus, stringLen, pad;
+    long intValue;
+    double doubleValue;
+
+    resultPtr = Tcl_NewObj();
+    avail = specPtr->literalSize + 16 * specPtr->numFields;
+    Tcl_SetObjLength(resultPtr, avail);
+    used = 0;
+
+    for (i = 0, fieldPtr = specPtr->fields; i < specPtr->numFields;
+	    i++, fieldPtr++) {
+	if (fieldPtr->conversion == 0) {
+	    dst = FormatRoom(resultPtr, &avail, used, fieldPtr->length);
+	    memcpy(dst, format + fieldPtr->start, (size_t) fieldPtr->length);
+	    used += fieldPtr->length;
+	    continue;
+	}
+
+	width = fieldPtr->width;
+	minus = fieldPtr->minus;
+	if (fieldPtr->widthIndex >= 0) {
+	    if (fieldPtr->widthIndex >= objc) {
+		goto badIndex;
+	    }
+	    if (Tcl_GetIntFromObj(interp,	/* INTL: Tcl source. */
+		    objv[fieldPtr->widthIndex], &width) != TCL_OK) {
+		goto fmtError;
+	    }
+	    if (width < 0) {
+		width = -width;
+		minus = 1;
+	    }
+	    if (width > 100000) {
+		width = 100000;
+	    } else if (width < 0) {
+		width = 0;
+	    }
+	}
+	precision = fieldPtr->precision;
+	if (fieldPtr->precisionIndex >= 0) {
+	    if (fieldPtr->precisionIndex >= objc) {
+		goto badIndex;
+	    }
+	    if (Tcl_GetIntFromObj(interp,	/* INTL: Tcl source. */
+		    objv[fieldPtr->precisionIndex], &precision) != TCL_OK) {
+		goto fmtError;
+	    }
+	}
+	if (fieldPtr->objIndex >= objc) {
+	    goto badIndex;
+	}
+	padChar = (fieldPtr->zero ? '0' : ' ');
+
+	switch (fieldPtr->conversion) {
+	    case 'd':
+	    case 'o':
+	    case 'u':
+	    case 'x':
+	    case 'X':
+		if (Tcl_GetLongFromObj(interp,	/* INTL: Tcl source. */
+			objv[fieldPtr->objIndex], &intValue) != TCL_OK) {
+		    goto fmtError;
+		}
+		if ((fieldPtr->conversion != 'd') || fieldPtr->useShort
+			|| fieldPtr->gotPrecision
+			|| (strpbrk(fieldPtr->flags, "+ #") != NULL)) {
+		    size = 40 + precision;
+		    if (width > size) {
+			size = width;
+		    }
+		    dst = FormatRoom(resultPtr, &avail, used, size);
+		    FormatSpecifier(newFormat, fieldPtr, minus, width,
+			    precision, ((unsigned long) intValue > UINT_MAX));
+		    if (fieldPtr->useShort) {
+			sprintf(dst, newFormat, (short) intValue);
+		    } else {
+			sprintf(dst, newFormat, intValue);
+		    }
+		    used += strlen(dst);
+		    break;
+		}
+
+		/*
+		 * Plain decimal conversions are done here.  Values that
+		 * fit in an unsigned int are printed with "%d", i.e. as an
+		 * int, just as the sprintf-based code would do.
+		 */
+
+		if ((unsigned long) intValue <= UINT_MAX) {
+		    intValue = (long) (int) intValue;
+		}
+		size = TclFormatInt(digits, intValue);
+		pad = (width > size) ? (width - size) : 0;
+		dst = FormatRoom(resultPtr, &avail, used, size + pad);
+		if (minus) {
+		    memcpy(dst, digits, (size_t) size);
+		    memset(dst + size, ' ', (size_t) pad);
+		} else if (fieldPtr->zero) {
+		    src = digits;
+		    if (*src == '-') {
+			*dst++ = *src++;
+		    }
+		    memset(dst, '0', (size_t) pad);
+		    memcpy(dst + pad, src, (size_t) (size - (src - digits)));
+		} else {
+		    memset(dst, ' ', (size_t) pad);
+		    memcpy(dst + pad, digits, (size_t) size);
+		}
+		used += size + pad;
+		break;
+	    case 's':
+		src = Tcl_GetStringFromObj(objv[fieldPtr->objIndex], &size);
+		pad = 0;
+		if (fieldPtr->gotPrecision || (width > 0)) {
+		    stringLen = Tcl_NumUtfChars(src, size);
+		    if (fieldPtr->gotPrecision && (precision < stringLen)) {
+			stringLen = precision;
+		    }
+		    size = Tcl_UtfAtIndex(src, stringLen) - src;
+		    if (width > stringLen) {
+			pad = width - stringLen;
+		    }
+		}
+		dst = FormatRoom(resultPtr, &avail, used, size + pad);
+		if (!minus) {
+		    memset(dst, padChar, (size_t) pad);
+		    dst += pad;
+		}
+		memcpy(dst, src, (size_t) size);
+		if (minus) {
+		    memset(dst + size, padChar, (size_t) pad);
+		}
+		used += size + pad;
+		break;
+	    case 'c':
+		if (Tcl_GetLongFromObj(interp,	/* INTL: Tcl source. */
+			objv[fieldPtr->objIndex], &intValue) != TCL_OK) {
+		    goto fmtError;
+		}
+		pad = (width > 1) ? (width - 1) : 0;
+		dst = FormatRoom(resultPtr, &avail, used, pad + TCL_UTF_MAX);
+		if (!minus) {
+		    memset(dst, padChar, (size_t) pad);
+		    dst += pad;
+		}
+		size = Tcl_UniCharToUtf((int) intValue, dst);
+		if (minus) {
+		    memset(dst + size, padChar, (size_t) pad);
+		}
+		used += size + pad;
+		break;
+	    default:
+		if (Tcl_GetDoubleFromObj(interp, /* INTL: Tcl source. */
+			objv[fieldPtr->objIndex], &doubleValue) != TCL_OK) {
+		    goto fmtError;
+		}
+		size = MAX_FLOAT_SIZE;
+		if (precision > 10) {
+		    size += precision;
+		}
+		if (width > size) {
+		    size = width;
+		}
+		dst = FormatRoom(resultPtr, &avail, used, size);
+		FormatSpecifier(newFormat, fieldPtr, minus, width, precision,
+			0);
+		sprintf(dst, newFormat, doubleValue); /* INTL: user locale. */
+		used += strlen(dst);
+		break;
+	}
+    }
+
+    Tcl_SetObjLength(resultPtr, used);
+    Tcl_SetObjResult(interp, resultPtr);
+    return TCL_OK;
+
+    badIndex:
+    if (specPtr->gotXpg) {
+	Tcl_SetResult(interp, 
+		"\"%n$\" argument index out of range", TCL_STATIC);
+    } else {
+	Tcl_SetResult(interp, 
+		"not enough arguments for all format specifiers", TCL_STATIC);
+    }
+
+    fmtError:
+    Tcl_DecrRefCount(resultPtr);
+    return TCL_ERROR;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FormatRoom --
+ *
+ *	Makes sure that the result object being built by FormatCompiled
+ *	has room for a given number of bytes (plus a terminating null)
+ *	after the bytes already used.
+ *
+ * Results:
+ *	A pointer to the first unused byte of the object's string.
+ *
+ * Side effects:
+ *	The object's string may be reallocated; *availPtr is updated to
+ *	the new number of bytes available.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static char *
+FormatRoom(resultPtr, availPtr, used, needed)
+    Tcl_Obj *resultPtr;		/* Object holding the result; its length
+				 * is kept equal to *availPtr. */
+    int *availPtr;		/* Number of bytes available in it. */
+    int used;			/* Number of those bytes already used. */
+    int needed;			/* Number of additional bytes needed. */
+{
+    if (used + needed > *availPtr) {
+	*availPtr = 2 * (used + needed);
+	Tcl_SetObjLength(resultPtr, *availPtr);
+    }
+    return resultPtr->bytes + used;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FormatSpecifier --
+ *
+ *	Generates the sprintf specifier for a compiled conversion, the
+ *	same way Tcl_FormatObjCmd builds its newFormat.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The specifier is stored in newFormat, which must have room for
+ *	40 bytes.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FormatSpecifier(newFormat, fieldPtr, minus, width, precision, useLong)
+    char *newFormat;		/* Where to store the specifier. */
+    FormatField *fieldPtr;	/* Conversion to generate it for. */
+    int minus;			/* Non-zero means left-justify. */
+    int width;			/* Field width, or 0 if none. */
+    int precision;		/* Precision; only used if the conversion
+				 * has one. */
+    int useLong;		/* Non-zero means add the "l" modifier. */
+{
+    char *p = newFormat;
+
+    *p++ = '%';
+    strcpy(p, fieldPtr->flags);
+    p += strlen(p);
+    if (minus && !fieldPtr->minus) {
+	*p++ = '-';
+    }
+    if (width != 0) {
+	p += TclFormatInt(p, width);	/* INTL: printf format. */
+    }
+    if (fieldPtr->gotPrecision) {
+	*p++ = '.';
+	p += TclFormatInt(p, precision);	/* INTL: printf format. */
+    }
+    if (fieldPtr->useShort) {
+	*p++ = 'h';
+    } else if (useLong) {
+	*p++ = 'l';
+    }
+    *p++ = (char) fieldPtr->conversion;
+    *p = 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SetFormatFromAny --
+ *
+ *	Compiles the string representation of an object into a
+ *	FormatSpec and makes that the object's internal representation.
+ *
+ * Results:
+ *	TCL_OK if the string is a valid format string, TCL_ERROR
+ *	otherwise.  No error message is left in interp; format strings
+ *	with errors are left to Tcl_FormatObjCmd's own scanner, which
+ *	reports them.
+ *
+ * Side effects:
+ *	If successful, any old internal representation is freed and the
+ *	object's type is set to formatType.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+SetFormatFromAny(interp, objPtr)
+    Tcl_Interp *interp;		/* Not used. */
+    Tcl_Obj *objPtr;		/* Object to convert. */
+{
+    FormatSpec *specPtr;
+    FormatField *fieldPtr;
+    Tcl_ObjType *oldTypePtr;
+    char *format, *p, *end, *start;
+    int length, numFields, objIndex, gotSequential, isXpg, numFlags;
+    unsigned long value;
+
+    format = Tcl_GetStringFromObj(objPtr, &length);
+    end = format + length;
+
+    /*
+     * Every "%" can start at most one conversion and one literal span.
+     */
+
+    numFields = 1;
+    for (p = format; p < end; p++) {
+	if (*p == '%') {
+	    numFields += 2;
+	}
+    }
+    specPtr = (FormatSpec *) ckalloc((unsigned) (sizeof(FormatSpec)
+	    + (numFields - 1) * sizeof(FormatField)));
+    specPtr->refCount = 1;
+    specPtr->gotXpg = 0;
+    specPtr->literalSize = 0;
+    specPtr->numFields = 0;
+    objIndex = 2;
+    gotSequential = 0;
+
+    p = format;
+    while (p < end) {
+	fieldPtr = &specPtr->fields[specPtr->numFields];
+	specPtr->numFields++;
+	fieldPtr->conversion = 0;
+	if ((*p != '%') || (p[1] == '%')) {
+	    start = p;
+	    if (*p == '%') {
+		p += 2;
+		fieldPtr->length = 1;
+	    } else {
+		while ((*p != '%') && (p < end)) {
+		    p++;
+		}
+		fieldPtr->length = p - start;
+	    }
+	    fieldPtr->start = start - format;
+	    specPtr->literalSize += fieldPtr->length;
+	    continue;
+	}
+
+	p++;
+	isXpg = 0;
+	if (isdigit(UCHAR(*p))) { /* INTL: Tcl source. */
+	    value = strtoul(p, &start, 10);	/* INTL: "C" locale. */
+	    if (*start == '$') {
+		p = start+1;
+		isXpg = 1;
+		specPtr->gotXpg = 1;
+		if (gotSequential || (value < 1) || (value > INT_MAX - 1)) {
+		    goto error;
+		}
+		objIndex = (int) value + 1;
+	    }
+	}
+	if (!isXpg) {
+	    gotSequential = 1;
+	    if (specPtr->gotXpg) {
+		goto error;
+	    }
+	}
+
+	numFlags = 0;
+	fieldPtr->minus = fieldPtr->zero = 0;
+	while ((*p == '-') || (*p == '#') || (*p == '0')
+		|| (*p == ' ') || (*p == '+')) {
+	    if (numFlags == sizeof(fieldPtr->flags) - 1) {
+		goto error;
+	    }
+	    if (*p == '-') {
+		fieldPtr->minus = 1;
+	    } else if (*p == '0') {
+		fieldPtr->zero = 1;
+	    }
+	    fieldPtr->flags[numFlags] = *p;
+	    numFlags++;
+	    p++;
+	}
+	fieldPtr->flags[numFlags] = 0;
+
+	fieldPtr->width = 0;
+	fieldPtr->widthIndex = -1;
+	if (isdigit(UCHAR(*p))) { /* INTL: Tcl source. */
+	    fieldPtr->width = strtoul(p, &p, 10); /* INTL: Tcl source. */
+	    if (fieldPtr->width > 100000) {
+		fieldPtr->width = 100000;
+	    } else if (fieldPtr->width < 0) {
+		fieldPtr->width = 0;
+	    }
+	} else if (*p == '*') {
+	    fieldPtr->widthIndex = objIndex;
+	    objIndex++;
+	    p++;
+	}
+	fieldPtr->gotPrecision = 0;
+	if (*p == '.') {
+	    fieldPtr->gotPrecision = 1;
+	    p++;
+	}
+	fieldPtr->precision = 0;
+	fieldPtr->precisionIndex = -1;
+	if (isdigit(UCHAR(*p))) { /* INTL: Tcl source. */
+	    fieldPtr->precision = strtoul(p, &p, 10); /* INTL: "C" locale. */
+	} else if (*p == '*') {
+	    fieldPtr->precisionIndex = objIndex;
+	    objIndex++;
+	    p++;
+	}
+	fieldPtr->useShort = 0;
+	if (*p == 'l') {
+	    p++;
+	} else if (*p == 'h') {
+	    fieldPtr->useShort = 1;
+	    p++;
+	}
+	switch (*p) {
+	    case 'i':
+		fieldPtr->conversion = 'd';
+		break;
+	    case 'd':
+	    case 'o':
+	    case 'u':
+	    case 'x':
+	    case 'X':
+	    case 's':
+	    case 'c':
+	    case 'e':
+	    case 'E':
+	    case 'f':
+	    case 'g':
+	    case 'G':
+		fieldPtr->conversion = *p;
+		break;
+	    default:
+		goto error;
+	}
+	fieldPtr->objIndex = objIndex;
+	objIndex++;
+	p++;
+    }
+
+    oldTypePtr = objPtr->typePtr;
+    if ((oldTypePtr != NULL) && (oldTypePtr->freeIntRepProc != NULL)) {
+	oldTypePtr->freeIntRepProc(objPtr);
+    }
+    objPtr->internalRep.otherValuePtr = (VOID *) specPtr;
+    objPtr->typePtr = &formatType;
+    return TCL_OK;
+
+    error:
+    ckfree((char *) specPtr);
+    return TCL_ERROR;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DupFormatInternalRep --
+ *
+ *	Initializes the internal representation of a formatType object
+ *	to a copy of another one's; the FormatSpec is shared.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The FormatSpec's reference count is incremented.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+DupFormatInternalRep(srcPtr, copyPtr)
+    Tcl_Obj *srcPtr;		/* Object with internal rep to copy. */
+    Tcl_Obj *copyPtr;		/* Object with internal rep to set. */
+{
+    FormatSpec *specPtr = (FormatSpec *) srcPtr->internalRep.otherValuePtr;
+
+    specPtr->refCount++;
+    copyPtr->internalRep.otherValuePtr = (VOID *) specPtr;
+    copyPtr->typePtr = &formatType;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FreeFormatInternalRep --
+ *
+ *	Releases the FormatSpec held by a formatType object.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The FormatSpec is freed once no object or running format
+ *	command uses it.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FreeFormatInternalRep(objPtr)
+    Tcl_Obj *objPtr;		/* Object whose internal rep to free. */
+{
+    FormatSpec *specPtr = (FormatSpec *) objPtr->internalRep.otherValuePtr;
+
+    specPtr->refCount--;
+    if (specPtr->refCount <= 0) {
+	ckfree((char *) specPtr);
+    }
+}
+
 /*
  *---------------------------------------------------------------------------
  *
@@ -54,6 +54,25 @@ TclPlatformType tclPlatform = TCL_PLATFORM_UNIX;
 #define GLOBMODE_JOIN             2
 #define GLOBMODE_DIR              4
 
+/*
+ * Instructions of a compiled glob pattern (see TclCompileGlobPattern).
+ */
+
+typedef struct TclGlobOp {
+    int type;			/* One of the GLOB_OP_* values below. */
+    Tcl_UniChar ch;		/* GLOB_OP_CHAR: the character, in lower
+				 * case for TCL_GLOBPAT_NOCASE patterns. */
+    int numRanges;		/* GLOB_OP_CLASS: number of ranges. */
+    Tcl_UniChar *ranges;	/* GLOB_OP_CLASS: first and last character
+				 * of each range, or NULL. */
+} GlobOp;
+
+#define GLOB_OP_CHAR	0	/* Matches the character ch. */
+#define GLOB_OP_ANY	1	/* "?": matches any character. */
+#define GLOB_OP_STAR	2	/* "*": matches any sequence. */
+#define GLOB_OP_CLASS	3	/* "[...]": matches a character in ranges. */
+#define GLOB_OP_FAIL	4	/* A trailing backslash: never matches. */
+
 /*
  * Prototypes for local procedures defined in this file:
  */
@@ -62,8 +81,25 @@ static char *		DoTildeSubst _ANSI_ARGS_((Tcl_Interp *interp,
 			    CONST char *user, Tcl_DString *resultPtr));
 static CONST char *	ExtractWinRoot _ANSI_ARGS_((CONST char *path,
 			    Tcl_DString *resultPtr, int offset, Tcl_PathType *typePtr));
+static void		CompileGlobAlt _ANSI_ARGS_((TclGlobPattern *patPtr,
+			    CONST char *source, int length));
+static void		DupGlobPatternInternalRep _ANSI_ARGS_((
+			    Tcl_Obj *srcPtr, Tcl_Obj *copyPtr));
+static void		DupPathInternalRep _ANSI_ARGS_((Tcl_Obj *srcPtr,
+			    Tcl_Obj *copyPtr));
+static void		ExpandGlobBraces _ANSI_ARGS_((TclGlobPattern *patPtr,
+			    Tcl_DString *headPtr, char *tail));
 static void		FileNameCleanup _ANSI_ARGS_((ClientData clientData));
 static void		FileNameInit _ANSI_ARGS_((void));
+static void		FreeGlobPatternInternalRep _ANSI_ARGS_((
+			    Tcl_Obj *objPtr));
+static void		FreePathInternalRep _ANSI_ARGS_((Tcl_Obj *objPtr));
+static char *		GlobElementEnd _ANSI_ARGS_((char *separators,
+			    char *tail, char *openBrace, char *closeBrace));
+static int		SetGlobPatternFromAny _ANSI_ARGS_((
+			    Tcl_Interp *interp, Tcl_Obj *objPtr));
+static int		SetPathFromAny _ANSI_ARGS_((Tcl_Interp *interp,
+			    Tcl_Obj *objPtr));
 static int		SkipToChar _ANSI_ARGS_((char **stringPtr,
 			    char *match));
 static char *		SplitMacPath _ANSI_ARGS_((CONST char *path,
@@ -72,6 +108,33 @@ static char *		SplitWinPath _ANSI_ARGS_((CONST char *path,
 			    Tcl_DString *bufPtr));
 static char *		SplitUnixPath _ANSI_ARGS_((CONST char *path,
 			    Tcl_DString *bufPtr));
+
+/*
+ * The glob pattern object type caches a TclGlobPattern in the internal
+ * representation of a pattern that is matched repeatedly.
+ */
+
+static Tcl_ObjType globPatternType = {
+    "globpattern",			/* name */
+    FreeGlobPatternInternalRep,		/* freeIntRepProc */
+    DupGlobPatternInternalRep,		/* dupIntRepProc */
+    NULL,				/* updateStringProc */
+    SetGlobPatternFromAny		/* setFromAnyProc */
+};
+
+/*
+ * The path object type caches the split form of a file name, so that
+ * "file split", "file dirname" and friends don't have to parse the same
+ * name again and again.
+ */
+
+static Tcl_ObjType pathType = {
+    "path",				/* name */
+    FreePathInternalRep,		/* freeIntRepProc */
+    DupPathInternalRep,			/* dupIntRepProc */
+    NULL,				/* updateStringProc */
+    SetPathFromAny			/* setFromAnyProc */
+};
 
 /*
  *----------------------------------------------------------------------
@@ -1231,20 +1294,24 @@ Tcl_GlobObjCmd(dummy, interp, objc, objv)
     Tcl_Obj *CONST objv[];		/* Argument objects. */
 {
     int index, i, globFlags, pathlength, length, join, dir, result;
+    int parallel;
     char *string, *pathOrDir, *separators;
     Tcl_Obj *typePtr, *resultPtr, *look;
     Tcl_DString prefix, directory;
     static char *options[] = {
-	"-directory", "-join", "-nocomplain", "-path", "-types", "--", NULL
+	"-directory", "-join", "-nocomplain", "-parallel", "-path", "-types",
+	"--", NULL
     };
     enum options {
-	GLOB_DIR, GLOB_JOIN, GLOB_NOCOMPLAIN, GLOB_PATH, GLOB_TYPE, GLOB_LAST
+	GLOB_DIR, GLOB_JOIN, GLOB_NOCOMPLAIN, GLOB_PARALLEL, GLOB_PATH,
+	GLOB_TYPE, GLOB_LAST
     };
     enum pathDirOptions {PATH_NONE = -1 , PATH_GENERAL = 0, PATH_DIR = 1};
     GlobTypeData *globTypes = NULL;
 
     globFlags = 0;
     join = 0;
+    parallel = 0;
     dir = PATH_NONE;
     pathOrDir = NULL;
     typePtr = NULL;
@@ -1292,6 +1359,9 @@ Tcl_GlobObjCmd(dummy, interp, objc, objv)
 	    case GLOB_JOIN:				/* -join */
 		join = 1;
 		break;
+	    case GLOB_PARALLEL:				/* -parallel */
+		parallel = 1;
+		break;
 	    case GLOB_PATH:				/* -path */
 	        if (i == (objc-1)) {
 		    Tcl_AppendToObj(resultPtr,
@@ -1406,6 +1476,7 @@ Tcl_GlobObjCmd(dummy, interp, objc, objv)
 	globTypes->perm = 0;
 	globTypes->macType = NULL;
 	globTypes->macCreator = NULL;
+	globTypes->parallel = 0;
 	while(--length >= 0) {
 	    int len;
 	    char *str;
@@ -1500,6 +1571,21 @@ Tcl_GlobObjCmd(dummy, interp, objc, objv)
 	}
     }
 
+    if (parallel) {
+	/*
+	 * The platform matcher finds the request to read directories
+	 * on worker threads in the type data, so make sure there is one.
+	 */
+	if (globTypes == NULL) {
+	    globTypes = (GlobTypeData*) ckalloc(sizeof(GlobTypeData));
+	    globTypes->type = 0;
+	    globTypes->perm = 0;
+	    globTypes->macType = NULL;
+	    globTypes->macCreator = NULL;
+	}
+	globTypes->parallel = 1;
+    }
+
     /* 
      * Now we perform the actual glob below.  This may involve joining
      * together the pattern arguments, dealing with particular file types
@@ -1822,6 +1908,88 @@ SkipToChar(stringPtr, match)
     return 0;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * GlobElementEnd --
+ *
+ *	Decides whether a path element containing braces can be handed
+ *	to TclpMatchFilesTypes as a whole.  That is the case when the
+ *	braces are not nested, contain no separators, are the only ones
+ *	in the element, and every alternative yields an element with
+ *	wildcards (so that the result doesn't depend on whether a
+ *	literal name is searched for or checked directly).
+ *
+ * Results:
+ *	A pointer to the end of the element (the separator after it or
+ *	the end of the string), or NULL if the braces must be expanded
+ *	by TclDoGlob.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static char *
+GlobElementEnd(separators, tail, openBrace, closeBrace)
+    char *separators;			/* Directory separators. */
+    char *tail;				/* Start of the element. */
+    char *openBrace;			/* The open brace in the element. */
+    char *closeBrace;			/* The matching close brace. */
+{
+    char *p;
+    int outerWild, altWild, allWild;
+
+    outerWild = 0;
+    for (p = tail; p < openBrace; p++) {
+	if (strchr("*[]?\\", *p) != NULL) {
+	    outerWild = 1;
+	}
+    }
+
+    altWild = 0;
+    allWild = 1;
+    for (p = openBrace + 1; p < closeBrace; p++) {
+	if (*p == '\\') {
+	    if (strchr(separators, p[1]) != NULL) {
+		return NULL;
+	    }
+	    altWild = 1;
+	    p++;
+	} else if ((*p == '{') || (strchr(separators, *p) != NULL)) {
+	    return NULL;
+	} else if (*p == ',') {
+	    allWild &= altWild;
+	    altWild = 0;
+	} else if (strchr("*[]?", *p) != NULL) {
+	    altWild = 1;
+	}
+    }
+    allWild &= altWild;
+
+    for (p = closeBrace + 1; *p != '\0'; p++) {
+	if (*p == '\\') {
+	    if (strchr(separators, p[1]) != NULL) {
+		break;			/* Quoted directory separator. */
+	    }
+	    outerWild = 1;
+	    p++;
+	} else if (strchr(separators, *p) != NULL) {
+	    break;
+	} else if ((*p == '{') || (*p == '}')) {
+	    return NULL;
+	} else if (strchr("*[]?", *p) != NULL) {
+	    outerWild = 1;
+	}
+    }
+
+    if (!outerWild && !allWild) {
+	return NULL;
+    }
+    return p;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -2017,6 +2185,20 @@ TclDoGlob(interp, separators, headPtr, tail, types)
     if (openBrace != NULL) {
 	char *element;
 	Tcl_DString newName;
+
+	/*
+	 * If the braces lie within this path element and every expansion
+	 * of it has wildcards anyway, let the platform matcher take the
+	 * whole element: it compiles the alternatives and reads the
+	 * directory once instead of once per alternative.
+	 */
+
+	p = GlobElementEnd(separators, tail, openBrace, closeBrace);
+	if (p != NULL) {
+	    return TclpMatchFilesTypes(interp, separators, headPtr, tail, p,
+		    types);
+	}
+
 	Tcl_DStringInit(&newName);
 
 	/*
@@ -2167,3 +2349,861 @@ TclDoGlob(interp, separators, headPtr, tail, types)
 
     return TCL_OK;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclCompileGlobPattern --
+ *
+ *	Compiles a glob-style pattern, with the syntax understood by
+ *	Tcl_StringCaseMatch, into a form that can be matched against
+ *	many strings without interpreting the pattern again.  Strings
+ *	are first checked against the literal prefix and suffix of the
+ *	pattern, and character classes are turned into lists of ranges.
+ *	If flags contains TCL_GLOBPAT_BRACES, {a,b} alternatives are
+ *	expanded the way glob does it.
+ *
+ * Results:
+ *	The compiled pattern, to be released with TclFreeGlobPattern.
+ *
+ * Side effects:
+ *	Memory is allocated.
+ *
+ *----------------------------------------------------------------------
+ */
+
+TclGlobPattern *
+TclCompileGlobPattern(pattern, length, flags)
+    CONST char *pattern;		/* The pattern to compile. */
+    int length;				/* Number of bytes in pattern, or -1
+					 * if it is null-terminated. */
+    int flags;				/* OR-ed combination of
+					 * TCL_GLOBPAT_NOCASE and
+					 * TCL_GLOBPAT_BRACES. */
+{
+    TclGlobPattern *patPtr;
+    Tcl_DString head, tail;
+
+    if (length < 0) {
+	length = strlen(pattern);
+    }
+    patPtr = (TclGlobPattern *) ckalloc(sizeof(TclGlobPattern));
+    patPtr->refCount = 1;
+    patPtr->flags = flags;
+    patPtr->numAlts = 0;
+    patPtr->alts = NULL;
+
+    if (flags & TCL_GLOBPAT_BRACES) {
+	Tcl_DStringInit(&head);
+	Tcl_DStringInit(&tail);
+	Tcl_DStringAppend(&tail, pattern, length);
+	ExpandGlobBraces(patPtr, &head, Tcl_DStringValue(&tail));
+	Tcl_DStringFree(&head);
+	Tcl_DStringFree(&tail);
+    } else {
+	CompileGlobAlt(patPtr, pattern, length);
+    }
+    return patPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ExpandGlobBraces --
+ *
+ *	Expands the first pair of braces in tail, recursively, and
+ *	compiles each resulting alternative.  Braces are found the same
+ *	way TclDoGlob finds them; an unmatched open brace is taken
+ *	literally.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Alternatives are added to patPtr.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ExpandGlobBraces(patPtr, headPtr, tail)
+    TclGlobPattern *patPtr;		/* Pattern to add alternatives to. */
+    Tcl_DString *headPtr;		/* Already expanded part of the
+					 * pattern; restored on return. */
+    char *tail;				/* Rest of the pattern.  Modified
+					 * temporarily. */
+{
+    char *p, *element, *openBrace, *closeBrace;
+    int quoted, length;
+    Tcl_DString newTail;
+
+    openBrace = closeBrace = NULL;
+    quoted = 0;
+    for (p = tail; *p != '\0'; p++) {
+	if (quoted) {
+	    quoted = 0;
+	} else if (*p == '\\') {
+	    quoted = 1;
+	} else if (*p == '{') {
+	    openBrace = p;
+	    p++;
+	    if (SkipToChar(&p, "}")) {
+		closeBrace = p;
+	    }
+	    break;
+	}
+    }
+
+    length = Tcl_DStringLength(headPtr);
+    if (closeBrace == NULL) {
+	Tcl_DStringAppend(headPtr, tail, -1);
+	CompileGlobAlt(patPtr, Tcl_DStringValue(headPtr),
+		Tcl_DStringLength(headPtr));
+	Tcl_DStringSetLength(headPtr, length);
+	return;
+    }
+
+    Tcl_DStringAppend(headPtr, tail, openBrace - tail);
+    Tcl_DStringInit(&newTail);
+    *closeBrace = '\0';
+    for (p = openBrace; p != closeBrace; ) {
+	p++;
+	element = p;
+	SkipToChar(&p, ",");
+	Tcl_DStringSetLength(&newTail, 0);
+	Tcl_DStringAppend(&newTail, element, p-element);
+	Tcl_DStringAppend(&newTail, closeBrace+1, -1);
+	ExpandGlobBraces(patPtr, headPtr, Tcl_DStringValue(&newTail));
+    }
+    *closeBrace = '}';
+    Tcl_DStringFree(&newTail);
+    Tcl_DStringSetLength(headPtr, length);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CompileGlobAlt --
+ *
+ *	Compiles one alternative (a pattern without braces) and adds it
+ *	to patPtr.  The few class constructs whose meaning in
+ *	Tcl_StringCaseMatch depends on which character matched (an
+ *	unterminated class, or a range ending in ']') are not compiled;
+ *	such alternatives are matched by Tcl_StringCaseMatch instead.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	A new alternative is added to patPtr.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+CompileGlobAlt(patPtr, source, length)
+    TclGlobPattern *patPtr;		/* Pattern to add the alternative
+					 * to. */
+    CONST char *source;			/* The alternative. */
+    int length;				/* Number of bytes in source. */
+{
+    TclGlobAlt *altPtr;
+    GlobOp *ops, *opPtr;
+    char *p, *end, *buf;
+    Tcl_UniChar ch, first, last;
+    int nocase, numOps, numRanges, i, j;
+
+    patPtr->alts = (TclGlobAlt *) ckrealloc((char *) patPtr->alts,
+	    (unsigned) ((patPtr->numAlts + 1) * sizeof(TclGlobAlt)));
+    altPtr = &patPtr->alts[patPtr->numAlts++];
+    altPtr->source = ckalloc((unsigned) (length + 1));
+    memcpy(altPtr->source, source, (size_t) length);
+    altPtr->source[length] = '\0';
+    altPtr->numOps = -1;
+    altPtr->ops = NULL;
+    altPtr->startOp = 0;
+    altPtr->prefix = NULL;
+    altPtr->prefixLength = 0;
+    altPtr->suffix = NULL;
+    altPtr->suffixLength = 0;
+    altPtr->exact = 0;
+    altPtr->leadingDot = (source[0] == '.')
+	    || ((source[0] == '\\') && (source[1] == '.'));
+
+    nocase = (patPtr->flags & TCL_GLOBPAT_NOCASE);
+    ops = (GlobOp *) ckalloc((unsigned) ((length + 1) * sizeof(GlobOp)));
+    numOps = 0;
+    p = altPtr->source;
+    end = p + length;
+    while (p < end) {
+	opPtr = &ops[numOps];
+	opPtr->numRanges = 0;
+	opPtr->ranges = NULL;
+	switch (*p) {
+	    case '*':
+		p++;
+		if ((numOps > 0) && (ops[numOps-1].type == GLOB_OP_STAR)) {
+		    continue;
+		}
+		opPtr->type = GLOB_OP_STAR;
+		break;
+	    case '?':
+		p++;
+		opPtr->type = GLOB_OP_ANY;
+		break;
+	    case '[':
+		/*
+		 * Mirror the class parsing of Tcl_StringCaseMatch, which
+		 * has no negation and no quoting inside brackets.
+		 */
+
+		p++;
+		numRanges = 0;
+		opPtr->type = GLOB_OP_CLASS;
+		opPtr->ranges = (Tcl_UniChar *) ckalloc((unsigned)
+			(2 * (end - p + 1) * sizeof(Tcl_UniChar)));
+		numOps++;
+		while (1) {
+		    if (p >= end) {
+			goto fallback;
+		    }
+		    if (*p == ']') {
+			p++;
+			break;
+		    }
+		    p += Tcl_UtfToUniChar(p, &first);
+		    last = first;
+		    if (*p == '-') {
+			p++;
+			if ((p >= end) || (*p == ']')) {
+			    goto fallback;
+			}
+			p += Tcl_UtfToUniChar(p, &last);
+		    }
+		    if (nocase) {
+			first = Tcl_UniCharToLower(first);
+			last = Tcl_UniCharToLower(last);
+		    }
+		    if (first > last) {
+			ch = first;
+			first = last;
+			last = ch;
+		    }
+		    opPtr->ranges[2*numRanges] = first;
+		    opPtr->ranges[2*numRanges + 1] = last;
+		    numRanges++;
+		}
+		opPtr->numRanges = numRanges;
+		continue;
+	    case '\\':
+		p++;
+		if (p >= end) {
+		    opPtr->type = GLOB_OP_FAIL;
+		    break;
+		}
+		/* fall through */
+	    default:
+		p += Tcl_UtfToUniChar(p, &ch);
+		opPtr->type = GLOB_OP_CHAR;
+		opPtr->ch = (nocase ? Tcl_UniCharToLower(ch) : ch);
+		break;
+	}
+	numOps++;
+    }
+    altPtr->numOps = numOps;
+    altPtr->ops = ops;
+
+    /*
+     * Collect the literal characters at both ends for the quick checks
+     * in TclGlobAltMatch.  Case-insensitive patterns can't be checked
+     * bytewise, so they don't get any.
+     */
+
+    if (nocase) {
+	return;
+    }
+    for (i = 0; (i < numOps) && (ops[i].type == GLOB_OP_CHAR); i++) {
+	/* Empty loop body. */
+    }
+    j = numOps;
+    if (i < numOps) {
+	while (ops[j-1].type == GLOB_OP_CHAR) {
+	    j--;
+	}
+    } else {
+	altPtr->exact = 1;
+    }
+    buf = ckalloc((unsigned) ((i + numOps - j) * TCL_UTF_MAX + 1));
+    altPtr->startOp = i;
+    altPtr->prefix = buf;
+    for (i = 0; i < altPtr->startOp; i++) {
+	buf += Tcl_UniCharToUtf(ops[i].ch, buf);
+    }
+    altPtr->prefixLength = buf - altPtr->prefix;
+    altPtr->suffix = buf;
+    for (i = j; i < numOps; i++) {
+	buf += Tcl_UniCharToUtf(ops[i].ch, buf);
+    }
+    altPtr->suffixLength = buf - altPtr->suffix;
+    return;
+
+    fallback:
+    for (i = 0; i < numOps; i++) {
+	if (ops[i].ranges != NULL) {
+	    ckfree((char *) ops[i].ranges);
+	}
+    }
+    ckfree((char *) ops);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclGlobAltMatch --
+ *
+ *	Matches a string against one alternative of a compiled pattern.
+ *
+ * Results:
+ *	1 if the string matches, 0 otherwise, exactly as
+ *	Tcl_StringCaseMatch would answer for the alternative.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclGlobAltMatch(patPtr, alt, string, length)
+    TclGlobPattern *patPtr;		/* Compiled pattern. */
+    int alt;				/* Index of the alternative. */
+    CONST char *string;			/* Null-terminated string to match. */
+    int length;				/* Number of bytes in string, or -1. */
+{
+    TclGlobAlt *altPtr = &patPtr->alts[alt];
+    GlobOp *opPtr, *endPtr, *starPtr;
+    CONST char *starString;
+    Tcl_UniChar ch;
+    int nocase, i, charLen;
+
+    nocase = (patPtr->flags & TCL_GLOBPAT_NOCASE);
+    if (altPtr->numOps < 0) {
+	return Tcl_StringCaseMatch(string, altPtr->source, nocase);
+    }
+    if (length < 0) {
+	length = strlen(string);
+    }
+
+    /*
+     * Reject on the literal ends first.
+     */
+
+    if (altPtr->exact) {
+	return ((length == altPtr->prefixLength)
+		&& (memcmp(string, altPtr->prefix, (size_t) length) == 0));
+    }
+    if ((length < altPtr->prefixLength + altPtr->suffixLength)
+	    || ((altPtr->prefixLength > 0) && (memcmp(string, altPtr->prefix,
+		    (size_t) altPtr->prefixLength) != 0))
+	    || ((altPtr->suffixLength > 0)
+		    && (memcmp(string + length - altPtr->suffixLength,
+			    altPtr->suffix, (size_t) altPtr->suffixLength) != 0))) {
+	return 0;
+    }
+
+    /*
+     * Run the program.  Only the most recent star needs to be retried
+     * with a longer match, since any earlier star could only absorb
+     * what the later one does.
+     */
+
+    string += altPtr->prefixLength;
+    opPtr = altPtr->ops + altPtr->startOp;
+    endPtr = altPtr->ops + altPtr->numOps;
+    starPtr = NULL;
+    starString = NULL;
+    while (1) {
+	if (opPtr == endPtr) {
+	    if (*string == '\0') {
+		return 1;
+	    }
+	    goto backtrack;
+	}
+	if (opPtr->type == GLOB_OP_STAR) {
+	    opPtr++;
+	    if (opPtr == endPtr) {
+		return 1;
+	    }
+	    starPtr = opPtr;
+	    starString = string;
+	    goto retry;
+	}
+	if (*string == '\0') {
+	    return 0;
+	}
+	charLen = Tcl_UtfToUniChar(string, &ch);
+	if (nocase) {
+	    ch = Tcl_UniCharToLower(ch);
+	}
+	switch (opPtr->type) {
+	    case GLOB_OP_CHAR:
+		if (ch != opPtr->ch) {
+		    goto backtrack;
+		}
+		break;
+	    case GLOB_OP_ANY:
+		break;
+	    case GLOB_OP_CLASS:
+		for (i = 0; i < opPtr->numRanges; i++) {
+		    if ((opPtr->ranges[2*i] <= ch)
+			    && (ch <= opPtr->ranges[2*i + 1])) {
+			break;
+		    }
+		}
+		if (i == opPtr->numRanges) {
+		    goto backtrack;
+		}
+		break;
+	    default:
+		goto backtrack;
+	}
+	string += charLen;
+	opPtr++;
+	continue;
+
+	backtrack:
+	if ((starPtr == NULL) || (*starString == '\0')) {
+	    return 0;
+	}
+	starString += Tcl_UtfToUniChar(starString, &ch);
+
+	retry:
+	if (!nocase && (starPtr->type == GLOB_OP_CHAR)
+		&& (starPtr->ch != 0) && (starPtr->ch < 0x80)) {
+	    /*
+	     * Jump straight to the next place the character after the
+	     * star can match.
+	     */
+
+	    starString = strchr(starString, (int) starPtr->ch);
+	    if (starString == NULL) {
+		return 0;
+	    }
+	}
+	string = starString;
+	opPtr = starPtr;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclGlobPatternMatch --
+ *
+ *	Matches a string against a compiled pattern.
+ *
+ * Results:
+ *	1 if the string matches any alternative of the pattern, 0
+ *	otherwise.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclGlobPatternMatch(patPtr, string, length)
+    TclGlobPattern *patPtr;		/* Compiled pattern. */
+    CONST char *string;			/* Null-terminated string to match. */
+    int length;				/* Number of bytes in string, or -1. */
+{
+    int alt;
+
+    if (length < 0) {
+	length = strlen(string);
+    }
+    for (alt = 0; alt < patPtr->numAlts; alt++) {
+	if (TclGlobAltMatch(patPtr, alt, string, length)) {
+	    return 1;
+	}
+    }
+    return 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclFreeGlobPattern --
+ *
+ *	Releases a reference to a compiled pattern.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The pattern is freed when its last reference is released.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclFreeGlobPattern(patPtr)
+    TclGlobPattern *patPtr;		/* Pattern to release. */
+{
+    TclGlobAlt *altPtr;
+    int alt, i;
+
+    if (--patPtr->refCount > 0) {
+	return;
+    }
+    for (alt = 0; alt < patPtr->numAlts; alt++) {
+	altPtr = &patPtr->alts[alt];
+	for (i = 0; i < altPtr->numOps; i++) {
+	    if (altPtr->ops[i].ranges != NULL) {
+		ckfree((char *) altPtr->ops[i].ranges);
+	    }
+	}
+	if (altPtr->ops != NULL) {
+	    ckfree((char *) altPtr->ops);
+	}
+	if (altPtr->prefix != NULL) {
+	    ckfree(altPtr->prefix);
+	}
+	ckfree(altPtr->source);
+    }
+    if (patPtr->alts != NULL) {
+	ckfree((char *) patPtr->alts);
+    }
+    ckfree((char *) patPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclGetGlobPatternFromObj --
+ *
+ *	Returns the compiled form of a pattern object, compiling it if
+ *	the object doesn't already hold one compiled with the same
+ *	flags.  Meant for commands like "string match" and "lsearch
+ *	-glob" that match the same pattern object over and over.
+ *
+ * Results:
+ *	The compiled pattern.  It belongs to the object and stays valid
+ *	as long as the object keeps its internal representation.
+ *
+ * Side effects:
+ *	The object's internal representation is changed to a compiled
+ *	glob pattern.
+ *
+ *----------------------------------------------------------------------
+ */
+
+TclGlobPattern *
+TclGetGlobPatternFromObj(objPtr, flags)
+    Tcl_Obj *objPtr;			/* Object holding the pattern. */
+    int flags;				/* Flags for TclCompileGlobPattern. */
+{
+    TclGlobPattern *patPtr;
+    char *string;
+    int length;
+
+    if (objPtr->typePtr == &globPatternType) {
+	patPtr = (TclGlobPattern *) objPtr->internalRep.otherValuePtr;
+	if (patPtr->flags == flags) {
+	    return patPtr;
+	}
+    }
+    string = Tcl_GetStringFromObj(objPtr, &length);
+    patPtr = TclCompileGlobPattern(string, length, flags);
+    if ((objPtr->typePtr != NULL)
+	    && (objPtr->typePtr->freeIntRepProc != NULL)) {
+	objPtr->typePtr->freeIntRepProc(objPtr);
+    }
+    objPtr->internalRep.otherValuePtr = (VOID *) patPtr;
+    objPtr->typePtr = &globPatternType;
+    return patPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SetGlobPatternFromAny --
+ *
+ *	Converts an object to a compiled glob pattern, with no flags.
+ *
+ * Results:
+ *	Always TCL_OK.
+ *
+ * Side effects:
+ *	See TclGetGlobPatternFromObj.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+SetGlobPatternFromAny(interp, objPtr)
+    Tcl_Interp *interp;			/* Not used. */
+    Tcl_Obj *objPtr;			/* Object to convert. */
+{
+    TclGetGlobPatternFromObj(objPtr, 0);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DupGlobPatternInternalRep --
+ *
+ *	Shares the compiled pattern of srcPtr with copyPtr.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The pattern's reference count is incremented.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+DupGlobPatternInternalRep(srcPtr, copyPtr)
+    Tcl_Obj *srcPtr;			/* Object with the pattern. */
+    Tcl_Obj *copyPtr;			/* Object to share it with. */
+{
+    TclGlobPattern *patPtr;
+
+    patPtr = (TclGlobPattern *) srcPtr->internalRep.otherValuePtr;
+    patPtr->refCount++;
+    copyPtr->internalRep.otherValuePtr = (VOID *) patPtr;
+    copyPtr->typePtr = &globPatternType;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FreeGlobPatternInternalRep --
+ *
+ *	Releases the compiled pattern of an object.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The pattern is freed if no other object shares it.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FreeGlobPatternInternalRep(objPtr)
+    Tcl_Obj *objPtr;			/* Object with the pattern. */
+{
+    TclFreeGlobPattern((TclGlobPattern *) objPtr->internalRep.otherValuePtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclGetPathRepFromObj --
+ *
+ *	Returns the split form of the file name held by an object,
+ *	splitting it with Tcl_SplitPath if the object doesn't already
+ *	hold one split for the current platform.
+ *
+ * Results:
+ *	The split name.  It belongs to the object; callers that may
+ *	change the object while using it must increment its refCount
+ *	and release it with TclFreePathRep.
+ *
+ * Side effects:
+ *	The object's internal representation is changed to a path.
+ *
+ *----------------------------------------------------------------------
+ */
+
+TclPathRep *
+TclGetPathRepFromObj(objPtr)
+    Tcl_Obj *objPtr;			/* Object holding the file name. */
+{
+    TclPathRep *pathPtr;
+    char *fileName;
+
+    if (objPtr->typePtr == &pathType) {
+	pathPtr = (TclPathRep *) objPtr->internalRep.otherValuePtr;
+	if (pathPtr->platform == tclPlatform) {
+	    return pathPtr;
+	}
+    }
+    fileName = Tcl_GetString(objPtr);
+    pathPtr = (TclPathRep *) ckalloc(sizeof(TclPathRep));
+    pathPtr->refCount = 1;
+    pathPtr->platform = tclPlatform;
+    pathPtr->type = Tcl_GetPathType(fileName);
+    Tcl_SplitPath(fileName, &pathPtr->argc, &pathPtr->argv);
+    pathPtr->nativeName = NULL;
+    pathPtr->nativeLength = 0;
+    if ((objPtr->typePtr != NULL)
+	    && (objPtr->typePtr->freeIntRepProc != NULL)) {
+	objPtr->typePtr->freeIntRepProc(objPtr);
+    }
+    objPtr->internalRep.otherValuePtr = (VOID *) pathPtr;
+    objPtr->typePtr = &pathType;
+    return pathPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclFreePathRep --
+ *
+ *	Releases a reference to a split file name.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The structure is freed when its last reference is released.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclFreePathRep(pathPtr)
+    TclPathRep *pathPtr;		/* Split name to release. */
+{
+    if (--pathPtr->refCount > 0) {
+	return;
+    }
+    ckfree((char *) pathPtr->argv);
+    if (pathPtr->nativeName != NULL) {
+	ckfree(pathPtr->nativeName);
+    }
+    ckfree((char *) pathPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclTranslateFileNameObj --
+ *
+ *	Same as Tcl_TranslateFileName, but for a file name held by an
+ *	object.  The translated name is remembered in the object, unless
+ *	it was produced by tilde substitution.
+ *
+ * Results:
+ *	See Tcl_TranslateFileName.
+ *
+ * Side effects:
+ *	The object's internal representation is changed to a path.
+ *
+ *----------------------------------------------------------------------
+ */
+
+char *
+TclTranslateFileNameObj(interp, objPtr, bufferPtr)
+    Tcl_Interp *interp;		/* Interpreter in which to store error
+				 * message (if necessary). */
+    Tcl_Obj *objPtr;		/* Object holding the file name. */
+    Tcl_DString *bufferPtr;	/* Uninitialized or free DString filled
+				 * with name after tilde substitution. */
+{
+    TclPathRep *pathPtr;
+    char *fileName;
+
+    pathPtr = TclGetPathRepFromObj(objPtr);
+    if (pathPtr->nativeName == NULL) {
+	fileName = Tcl_GetString(objPtr);
+	if (fileName[0] == '~') {
+	    return Tcl_TranslateFileName(interp, fileName, bufferPtr);
+	}
+	Tcl_TranslateFileName(NULL, fileName, bufferPtr);
+	pathPtr->nativeLength = Tcl_DStringLength(bufferPtr);
+	pathPtr->nativeName = ckalloc((unsigned) pathPtr->nativeLength + 1);
+	memcpy((VOID *) pathPtr->nativeName,
+		(VOID *) Tcl_DStringValue(bufferPtr),
+		(size_t) pathPtr->nativeLength + 1);
+	return Tcl_DStringValue(bufferPtr);
+    }
+    Tcl_DStringInit(bufferPtr);
+    Tcl_DStringAppend(bufferPtr, pathPtr->nativeName,
+	    pathPtr->nativeLength);
+    return Tcl_DStringValue(bufferPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SetPathFromAny --
+ *
+ *	Converts an object to a split file name.
+ *
+ * Results:
+ *	Always TCL_OK.
+ *
+ * Side effects:
+ *	See TclGetPathRepFromObj.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+SetPathFromAny(interp, objPtr)
+    Tcl_Interp *interp;			/* Not used. */
+    Tcl_Obj *objPtr;			/* Object to convert. */
+{
+    TclGetPathRepFromObj(objPtr);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DupPathInternalRep --
+ *
+ *	Shares the split file name of srcPtr with copyPtr.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The split name's reference count is incremented.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+DupPathInternalRep(srcPtr, copyPtr)
+    Tcl_Obj *srcPtr;			/* Object with the split name. */
+    Tcl_Obj *copyPtr;			/* Object to share it with. */
+{
+    TclPathRep *pathPtr;
+
+    pathPtr = (TclPathRep *) srcPtr->internalRep.otherValuePtr;
+    pathPtr->refCount++;
+    copyPtr->internalRep.otherValuePtr = (VOID *) pathPtr;
+    copyPtr->typePtr = &pathType;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FreePathInternalRep --
+ *
+ *	Releases the split file name of an object.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The split name is freed if no other object shares it.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FreePathInternalRep(objPtr)
+    Tcl_Obj *objPtr;			/* Object with the split name. */
+{
+    TclFreePathRep((TclPathRep *) objPtr->internalRep.otherValuePtr);
+}
@@ -1351,6 +1351,29 @@ typedef struct ParseValue {
 				 * expandProc. */
 } ParseValue;
 
+/*
+ * The following structure holds the information that
+ * TclIncrCommandComplete keeps between calls about a script that is
+ * assembled a piece at a time, such as a command typed at a terminal.
+ * It must be initialized with TclInitCompleteState whenever the script
+ * is emptied.
+ */
+
+typedef struct TclCompleteState {
+    int offset;			/* The bytes of the script before this
+				 * offset hold complete commands; parsing
+				 * resumes here. */
+    int scanned;		/* Number of bytes of the script that have
+				 * already been examined. */
+    int level;			/* If > 0, the script ends inside an
+				 * unterminated braced word and this is
+				 * its nesting level at byte scanned.
+				 * Only the bytes after it have to be
+				 * examined until the word is closed. */
+    int backslash;		/* Non-zero means the byte at scanned is
+				 * preceded by a backslash. */
+} TclCompleteState;
+
 
 /*
  * Maximum number of levels of nesting permitted in Tcl commands (used
@@ -1494,6 +1517,8 @@ typedef struct GlobTypeData {
     Tcl_Obj* macType;
     /* Acceptable mac creator */
     Tcl_Obj* macCreator;
+    /* Non-zero if directories may be read by worker threads */
+    int parallel;
 } GlobTypeData;
 
 /*
@@ -1513,6 +1538,66 @@ typedef struct GlobTypeData {
 #define TCL_GLOB_PERM_W			(1<<3)
 #define TCL_GLOB_PERM_X			(1<<4)
 
+/*
+ * A glob-style pattern compiled by TclCompileGlobPattern.  If the pattern
+ * was compiled with TCL_GLOBPAT_BRACES, {a,b} alternatives are expanded at
+ * compile time and each one is matched by its own flat program.
+ */
+
+typedef struct TclGlobAlt {
+    char *source;		/* The expanded pattern, null-terminated. */
+    int numOps;			/* Number of instructions in ops, or -1 if
+				 * this alternative is matched by
+				 * Tcl_StringCaseMatch on source. */
+    struct TclGlobOp *ops;	/* The compiled program. */
+    int startOp;		/* First instruction not covered by the
+				 * literal prefix. */
+    char *prefix;		/* Bytes every matching string starts
+				 * with. */
+    int prefixLength;		/* Number of bytes in prefix. */
+    char *suffix;		/* Bytes every matching string ends with. */
+    int suffixLength;		/* Number of bytes in suffix. */
+    int exact;			/* Non-zero if the alternative is a literal
+				 * string, matching only itself. */
+    int leadingDot;		/* Non-zero if the alternative starts with
+				 * a literal '.'. */
+} TclGlobAlt;
+
+typedef struct TclGlobPattern {
+    int refCount;		/* Number of users of this pattern. */
+    int flags;			/* TCL_GLOBPAT_* flags it was compiled
+				 * with. */
+    int numAlts;		/* Number of alternatives. */
+    TclGlobAlt *alts;		/* The alternatives, in the order given by
+				 * the pattern. */
+} TclGlobPattern;
+
+/*
+ * Flags for TclCompileGlobPattern.
+ */
+
+#define TCL_GLOBPAT_NOCASE		(1<<0)
+#define TCL_GLOBPAT_BRACES		(1<<1)
+
+/*
+ * A file name split into its components, as cached in the internal
+ * representation of path objects by TclGetPathRepFromObj.  The native
+ * form is filled in on first use, and never for names starting with a
+ * tilde, since those depend on the current home directories.
+ */
+
+typedef struct TclPathRep {
+    int refCount;		/* Number of users of this structure. */
+    TclPlatformType platform;	/* Platform the name was split for. */
+    Tcl_PathType type;		/* Type of the whole name. */
+    int argc;			/* Number of components. */
+    char **argv;		/* The components, as returned by
+				 * Tcl_SplitPath. */
+    char *nativeName;		/* The name as returned by
+				 * Tcl_TranslateFileName, or NULL. */
+    int nativeLength;		/* Number of bytes in nativeName. */
+} TclPathRep;
+
 /*
  *----------------------------------------------------------------
  * Variables shared among Tcl modules but not used by the outside world.
@@ -1585,6 +1670,11 @@ EXTERN int		TclCleanupChildren _ANSI_ARGS_((Tcl_Interp *interp,
 			    int numPids, Tcl_Pid *pidPtr,
 			    Tcl_Channel errorChan));
 EXTERN void		TclCleanupCommand _ANSI_ARGS_((Command *cmdPtr));
+EXTERN unsigned long	TclCoalescedEventCount _ANSI_ARGS_((void));
+EXTERN Tcl_Obj *	TclCommandCacheInfo _ANSI_ARGS_((
+			    Tcl_Interp *interp));
+EXTERN TclGlobPattern *	TclCompileGlobPattern _ANSI_ARGS_((
+			    CONST char *pattern, int length, int flags));
 EXTERN int		TclCopyChannel _ANSI_ARGS_((Tcl_Interp *interp,
 			    Tcl_Channel inChan, Tcl_Channel outChan,
 			    int toRead, Tcl_Obj *cmdPtr));
@@ -1601,6 +1691,9 @@ EXTERN int		TclCreateProc _ANSI_ARGS_((Tcl_Interp *interp,
 			    Proc **procPtrPtr));
 EXTERN void		TclDeleteCompiledLocalVars _ANSI_ARGS_((
 			    Interp *iPtr, CallFrame *framePtr));
+EXTERN void		TclDeleteTypedEvents _ANSI_ARGS_((int type,
+			    Tcl_EventDeleteProc *proc,
+			    ClientData clientData));
 EXTERN void		TclDeleteVars _ANSI_ARGS_((Interp *iPtr,
 			    Tcl_HashTable *tablePtr));
 EXTERN int		TclDoGlob _ANSI_ARGS_((Tcl_Interp *interp,
@@ -1637,8 +1730,14 @@ EXTERN void		TclFinalizeThreadData _ANSI_ARGS_((void));
 EXTERN void		TclFindEncodings _ANSI_ARGS_((CONST char *argv0));
 EXTERN Proc *		TclFindProc _ANSI_ARGS_((Interp *iPtr,
 			    char *procName));
+EXTERN void		TclFlushCommandCache _ANSI_ARGS_((
+			    Tcl_Interp *interp));
+EXTERN void		TclFlushParseCache _ANSI_ARGS_((Tcl_Interp *interp));
 EXTERN int		TclFormatInt _ANSI_ARGS_((char *buffer, long n));
+EXTERN void		TclFreeGlobPattern _ANSI_ARGS_((
+			    TclGlobPattern *patPtr));
 EXTERN void		TclFreePackageInfo _ANSI_ARGS_((Interp *iPtr));
+EXTERN void		TclFreePathRep _ANSI_ARGS_((TclPathRep *pathPtr));
 EXTERN int		TclGetDate _ANSI_ARGS_((char *p,
 			    unsigned long now, long zone,
 			    unsigned long *timePtr));
@@ -1653,6 +1752,8 @@ EXTERN int		TclGetIntForIndex _ANSI_ARGS_((Tcl_Interp *interp,
 			    Tcl_Obj *objPtr, int endValue, int *indexPtr));
 EXTERN Tcl_Obj *	TclGetIndexedScalar _ANSI_ARGS_((Tcl_Interp *interp,
 			    int localIndex, int leaveErrorMsg));
+EXTERN TclGlobPattern *	TclGetGlobPatternFromObj _ANSI_ARGS_((
+			    Tcl_Obj *objPtr, int flags));
 EXTERN int		TclGetLong _ANSI_ARGS_((Tcl_Interp *interp,
 			    char *string, long *longPtr));
 EXTERN int		TclGetLoadedPackages _ANSI_ARGS_((
@@ -1668,9 +1769,16 @@ EXTERN int		TclGetOpenMode _ANSI_ARGS_((Tcl_Interp *interp,
 			    char *string, int *seekFlagPtr));
 EXTERN Tcl_Command	TclGetOriginalCommand _ANSI_ARGS_((
 			    Tcl_Command command));
+EXTERN TclPathRep *	TclGetPathRepFromObj _ANSI_ARGS_((
+			    Tcl_Obj *objPtr));
 EXTERN int		TclGlob _ANSI_ARGS_((Tcl_Interp *interp,
 			    char *pattern, char *unquotedPrefix, 
 			    int globFlags, GlobTypeData* types));
+EXTERN int		TclGlobAltMatch _ANSI_ARGS_((TclGlobPattern *patPtr,
+			    int alt, CONST char *string, int length));
+EXTERN int		TclGlobPatternMatch _ANSI_ARGS_((
+			    TclGlobPattern *patPtr, CONST char *string,
+			    int length));
 EXTERN int		TclGlobalInvoke _ANSI_ARGS_((Tcl_Interp *interp,
 			    int argc, char **argv, int flags));
 EXTERN int		TclGuessPackageName _ANSI_ARGS_((char *fileName,
@@ -1678,6 +1786,9 @@ EXTERN int		TclGuessPackageName _ANSI_ARGS_((char *fileName,
 EXTERN int		TclHideUnsafeCommands _ANSI_ARGS_((
 			    Tcl_Interp *interp));
 EXTERN int		TclInExit _ANSI_ARGS_((void));
+EXTERN int		TclIncrCommandComplete _ANSI_ARGS_((
+			    TclCompleteState *statePtr, char *script,
+			    int length));
 EXTERN Tcl_Obj *	TclIncrElementOfIndexedArray _ANSI_ARGS_((
 			    Tcl_Interp *interp, int localIndex,
 			    Tcl_Obj *elemPtr, long incrAmount));
@@ -1691,6 +1802,8 @@ EXTERN void		TclInitAlloc _ANSI_ARGS_((void));
 EXTERN void		TclInitCompiledLocals _ANSI_ARGS_((
 			    Tcl_Interp *interp, CallFrame *framePtr,
 			    Namespace *nsPtr));
+EXTERN void		TclInitCompleteState _ANSI_ARGS_((
+			    TclCompleteState *statePtr));
 EXTERN void		TclInitDbCkalloc _ANSI_ARGS_((void));
 EXTERN void		TclInitEncodingSubsystem _ANSI_ARGS_((void));
 EXTERN void		TclInitIOSubsystem _ANSI_ARGS_((void));
@@ -1728,6 +1841,8 @@ EXTERN int		TclOpenFileChannelDeleteProc _ANSI_ARGS_((
 			    TclOpenFileChannelProc_ *proc));
 EXTERN int		TclOpenFileChannelInsertProc _ANSI_ARGS_((
 			    TclOpenFileChannelProc_ *proc));
+EXTERN Tcl_Obj *	TclParseArenaInfo _ANSI_ARGS_((void));
+EXTERN Tcl_Obj *	TclParseCacheInfo _ANSI_ARGS_((Tcl_Interp *interp));
 EXTERN int		TclpAccess _ANSI_ARGS_((CONST char *filename,
 			    int mode));
 EXTERN char *		TclpAlloc _ANSI_ARGS_((unsigned int size));
@@ -1748,6 +1863,8 @@ EXTERN void		TclpFinalizeThreadDataKey _ANSI_ARGS_((
 			    Tcl_ThreadDataKey *keyPtr));
 EXTERN char *		TclpFindExecutable _ANSI_ARGS_((
 			    CONST char *argv0));
+EXTERN Tcl_PackageInitProc * TclpFindSymbol _ANSI_ARGS_((
+			    ClientData clientData, CONST char *symbol));
 EXTERN int		TclpFindVariable _ANSI_ARGS_((CONST char *name,
 			    int *lengthPtr));
 EXTERN void		TclpFree _ANSI_ARGS_((char *ptr));
@@ -1791,6 +1908,7 @@ EXTERN void		TclpUnloadFile _ANSI_ARGS_((ClientData clientData));
 EXTERN char *		TclPrecTraceProc _ANSI_ARGS_((ClientData clientData,
 			    Tcl_Interp *interp, char *name1, char *name2,
 			    int flags));
+EXTERN int		TclPreloadCount _ANSI_ARGS_((int wait, int *donePtr));
 EXTERN int		TclPreventAliasLoop _ANSI_ARGS_((Tcl_Interp *interp,
 			    Tcl_Interp *cmdInterp, Tcl_Command cmd));
 EXTERN void		TclProcCleanupProc _ANSI_ARGS_((Proc *procPtr));
@@ -1807,6 +1925,8 @@ EXTERN void		TclpThreadDataKeyInit _ANSI_ARGS_((
 EXTERN void		TclpThreadDataKeySet _ANSI_ARGS_((
 			    Tcl_ThreadDataKey *keyPtr, VOID *data));
 EXTERN void		TclpThreadExit _ANSI_ARGS_((int status));
+EXTERN void		TclQueueTypedEvent _ANSI_ARGS_((Tcl_Event *evPtr,
+			    Tcl_QueuePosition position, int type));
 EXTERN void		TclRememberCondition _ANSI_ARGS_((Tcl_Condition *mutex));
 EXTERN void		TclRememberDataKey _ANSI_ARGS_((Tcl_ThreadDataKey *mutex));
 EXTERN void		TclRememberMutex _ANSI_ARGS_((Tcl_Mutex *mutex));
@@ -1835,6 +1955,9 @@ EXTERN int		TclStatInsertProc _ANSI_ARGS_((TclStatProc_ *proc));
 EXTERN void		TclTeardownNamespace _ANSI_ARGS_((Namespace *nsPtr));
 EXTERN void		TclTransferResult _ANSI_ARGS_((Tcl_Interp *sourceInterp,
 			    int result, Tcl_Interp *targetInterp));
+EXTERN char *		TclTranslateFileNameObj _ANSI_ARGS_((
+			    Tcl_Interp *interp, Tcl_Obj *objPtr,
+			    Tcl_DString *bufferPtr));
 EXTERN int		TclUpdateReturnInfo _ANSI_ARGS_((Interp *iPtr));
 
 /*
@@ -1937,6 +2060,8 @@ EXTERN int	Tcl_LsortObjCmd _ANSI_ARGS_((ClientData clientData,
 		    Tcl_Interp *interp, int objc, Tcl_Obj *CONST objv[]));
 EXTERN int	Tcl_NamespaceObjCmd _ANSI_ARGS_((ClientData clientData,
 		    Tcl_Interp *interp, int objc, Tcl_Obj *CONST objv[]));
+EXTERN int	Tcl_NotifierObjCmd _ANSI_ARGS_((ClientData clientData,
+		    Tcl_Interp *interp, int objc, Tcl_Obj *CONST objv[]));
 EXTERN int	Tcl_OpenObjCmd _ANSI_ARGS_((ClientData clientData,
 		    Tcl_Interp *interp, int objc, Tcl_Obj *CONST objv[]));
 EXTERN int	Tcl_PackageObjCmd _ANSI_ARGS_((ClientData clientData,
@@ -46,24 +46,103 @@ typedef struct LoadedPackage {
 				 * untrusted scripts).   NULL means the
 				 * package can't be used in unsafe
 				 * interpreters. */
+    int safeInitFound;		/* Non-zero means safeInitProc is valid.
+				 * The safe initialization procedure of a
+				 * package loaded from a file is only
+				 * looked up when a safe interpreter first
+				 * needs it. */
+    long loadTime;		/* Microseconds spent loading the file. */
+    int numInits;		/* Number of calls to the initialization
+				 * procedures made by the "load" command. */
+    long initTime;		/* Total microseconds spent in those
+				 * calls. */
     struct LoadedPackage *nextPtr;
 				/* Next in list of all packages loaded into
 				 * this application process.  NULL means
 				 * end of list. */
+    struct LoadedPackage *nextNamePtr;
+				/* Next older package whose name differs
+				 * from this one's at most in case.  NULL
+				 * means end of list. */
 } LoadedPackage;
 
 /*
  * TCL_THREADS
  * There is a global list of packages that is anchored at firstPackagePtr.
- * Access to this list is governed by a mutex.
+ * So that "load" doesn't have to search the list, the packages are also
+ * indexed by file name and by package name.  Access to the list and the
+ * tables is governed by a mutex.
  */
 
 static LoadedPackage *firstPackagePtr = NULL;
 				/* First in list of all packages loaded into
 				 * this process. */
+static Tcl_HashTable fileTable;	/* Maps from the normalized names of the
+				 * files of dynamically loaded packages (see
+				 * NormalizeFileName) to their
+				 * LoadedPackage. */
+static Tcl_HashTable nameTable;	/* Maps from lower-case package names to the
+				 * newest LoadedPackage with that name; the
+				 * others are linked through nextNamePtr. */
+static int tablesInitialized = 0;
+				/* Non-zero means fileTable, nameTable and
+				 * preloadTable have been initialized. */
 
 TCL_DECLARE_MUTEX(packageMutex)
 
+/*
+ * A file can be loaded ahead of the "load" command that needs it with
+ * Tcl_PreloadFile ("load -async").  Where threads are available, this is
+ * done by up to PRELOAD_MAX_THREADS background threads, which take files
+ * from a queue; otherwise the file is loaded right away.  Either way,
+ * only the file is loaded: its initialization procedures are looked up
+ * and called by the "load" command, which waits for the background
+ * thread if it hasn't finished yet.  Each such file is described by a
+ * structure of the following type.  All the fields, the queue and
+ * preloadTable are protected by packageMutex.
+ */
+
+typedef struct PreloadedFile {
+    char *fileName;		/* Translated name of the file.
+				 * Malloc-ed. */
+    int done;			/* Non-zero means loading has finished and
+				 * code and clientData are valid. */
+    int code;			/* TCL_OK if the file was loaded. */
+    ClientData clientData;	/* Token returned by TclpLoadFile for the
+				 * file. */
+    long loadTime;		/* Microseconds spent loading the file. */
+    struct PreloadedFile *nextPtr;
+				/* Next file in the queue of files waiting
+				 * for a background thread, or NULL. */
+} PreloadedFile;
+
+static Tcl_HashTable preloadTable;
+				/* Maps from normalized file names (see
+				 * NormalizeFileName) to the PreloadedFile's
+				 * that no "load" command has used yet. */
+
+#ifdef TCL_THREADS
+#define PRELOAD_MAX_THREADS	4
+
+static PreloadedFile *firstQueuedPtr = NULL;
+				/* Files waiting for a background thread,
+				 * oldest first. */
+static PreloadedFile *lastQueuedPtr = NULL;
+				/* Last file in that queue. */
+static int numPreloadThreads = 0;
+				/* Number of background threads running. */
+static Tcl_Condition preloadCond;
+				/* Notified whenever a background thread has
+				 * finished loading a file or exits. */
+static int preloadExitHandler = 0;
+				/* Non-zero means WaitForPreloads has been
+				 * registered as an exit handler. */
+static int preloadExiting = 0;
+				/* Non-zero means WaitForPreloads has run:
+				 * Tcl is being finalized, so no more
+				 * background threads may be started. */
+#endif
+
 /*
  * The following structure represents a particular package that has
  * been incorporated into a particular interpreter (by calling its
@@ -84,8 +163,25 @@ typedef struct InterpPackage {
  * Prototypes for procedures that are private to this file:
  */
 
+static void		AddPackage _ANSI_ARGS_((LoadedPackage *pkgPtr));
+static void		FinishPreload _ANSI_ARGS_((PreloadedFile *filePtr));
+static void		InitPackageTables _ANSI_ARGS_((void));
 static void		LoadCleanupProc _ANSI_ARGS_((ClientData clientData,
 			    Tcl_Interp *interp));
+static int		LoadStats _ANSI_ARGS_((Tcl_Interp *interp));
+static long		MicrosSince _ANSI_ARGS_((Tcl_Time *startPtr));
+static void		NormalizeFileName _ANSI_ARGS_((CONST char *fileName,
+			    Tcl_DString *dsPtr));
+#ifdef TCL_THREADS
+static Tcl_ThreadCreateType PreloadThreadProc _ANSI_ARGS_((
+			    ClientData clientData));
+#endif
+static void		ResolveSafeInit _ANSI_ARGS_((LoadedPackage *pkgPtr));
+static int		TakePreloadedFile _ANSI_ARGS_((CONST char *fileName,
+			    ClientData *clientDataPtr, long *loadTimePtr));
+#ifdef TCL_THREADS
+static void		WaitForPreloads _ANSI_ARGS_((ClientData clientData));
+#endif
 
 /*
  *----------------------------------------------------------------------
@@ -93,7 +189,15 @@ static void		LoadCleanupProc _ANSI_ARGS_((ClientData clientData,
  * Tcl_LoadObjCmd --
  *
  *	This procedure is invoked to process the "load" Tcl command.
- *	See the user documentation for details on what it does.
+ *	See the user documentation for details on what it does.  In
+ *	addition, "load -stats" returns, for every package loaded into
+ *	the process, a list of its file name, its package name, the
+ *	microseconds spent loading its file, the number of times the
+ *	"load" command called its initialization procedures and the
+ *	microseconds spent in those calls, and "load -async ?--? fileName
+ *	?fileName ...?" starts loading files in the background (see
+ *	Tcl_PreloadFile).  "--" ends the options, so that a file whose
+ *	name starts with "-" can be loaded.
  *
  * Results:
  *	A standard Tcl result.
@@ -112,33 +216,61 @@ Tcl_LoadObjCmd(dummy, interp, objc, objv)
     Tcl_Obj *CONST objv[];	/* Argument objects. */
 {
     Tcl_Interp *target;
-    LoadedPackage *pkgPtr, *defaultPtr;
-    Tcl_DString pkgName, tmp, initName, safeInitName, fileName;
+    LoadedPackage *pkgPtr, *newPkgPtr;
+    Tcl_DString pkgName, tmp, initName, fileName;
     Tcl_PackageInitProc *initProc, *safeInitProc;
     InterpPackage *ipFirstPtr, *ipPtr;
-    int code, namesMatch, filesMatch;
+    Tcl_HashEntry *hPtr;
+    Tcl_Time start;
+    long loadTime, initTime;
+    int code, new;
     char *p, *tempString, *fullFileName, *packageName;
     ClientData clientData;
     Tcl_UniChar ch;
-    int offset;
+    int offset, first;
 
-    if ((objc < 2) || (objc > 4)) {
+    first = 1;
+    if ((objc >= 2) && (strcmp(Tcl_GetString(objv[1]), "--") == 0)) {
+	first = 2;
+    } else if ((objc == 2)
+	    && (strcmp(Tcl_GetString(objv[1]), "-stats") == 0)) {
+	return LoadStats(interp);
+    }
+    if ((first == 1) && (objc >= 2)
+	    && (strcmp(Tcl_GetString(objv[1]), "-async") == 0)) {
+	int i;
+
+	i = 2;
+	if ((objc > 2) && (strcmp(Tcl_GetString(objv[2]), "--") == 0)) {
+	    i = 3;
+	}
+	if (objc <= i) {
+	    Tcl_WrongNumArgs(interp, 2, objv, "?--? fileName ?fileName ...?");
+	    return TCL_ERROR;
+	}
+	for (; i < objc; i++) {
+	    if (Tcl_PreloadFile(interp, Tcl_GetString(objv[i])) != TCL_OK) {
+		return TCL_ERROR;
+	    }
+	}
+	return TCL_OK;
+    }
+    if ((objc < first + 1) || (objc > first + 3)) {
         Tcl_WrongNumArgs(interp, 1, objv, "fileName ?packageName? ?interp?");
 	return TCL_ERROR;
     }
-    tempString = Tcl_GetString(objv[1]);
+    tempString = Tcl_GetString(objv[first]);
     fullFileName = Tcl_TranslateFileName(interp, tempString, &fileName);
     if (fullFileName == NULL) {
 	return TCL_ERROR;
     }
     Tcl_DStringInit(&pkgName);
     Tcl_DStringInit(&initName);
-    Tcl_DStringInit(&safeInitName);
     Tcl_DStringInit(&tmp);
 
     packageName = NULL;
-    if (objc >= 3) {
-	packageName = Tcl_GetString(objv[2]);
+    if (objc >= first + 2) {
+	packageName = Tcl_GetString(objv[first + 1]);
 	if (packageName[0] == '\0') {
 	    packageName = NULL;
 	}
@@ -156,9 +288,9 @@ Tcl_LoadObjCmd(dummy, interp, objc, objv)
      */
 
     target = interp;
-    if (objc == 4) {
+    if (objc == first + 3) {
 	char *slaveIntName;
-	slaveIntName = Tcl_GetString(objv[3]);
+	slaveIntName = Tcl_GetString(objv[first + 2]);
 	target = Tcl_GetSlave(interp, slaveIntName);
 	if (target == NULL) {
 	    return TCL_ERROR;
@@ -166,61 +298,70 @@ Tcl_LoadObjCmd(dummy, interp, objc, objv)
     }
 
     /*
-     * Scan through the packages that are currently loaded to see if the
-     * package we want is already loaded.  We'll use a loaded package if
-     * it meets any of the following conditions:
+     * See if the package we want is already loaded.  We'll use a loaded
+     * package if it meets any of the following conditions:
      *  - Its name and file match the once we're looking for.
      *  - Its file matches, and we weren't given a name.
      *  - Its name matches, the file name was specified as empty, and there
      *    is only no statically loaded package with the same name.
      */
+
     Tcl_MutexLock(&packageMutex);
+    InitPackageTables();
 
-    defaultPtr = NULL;
-    for (pkgPtr = firstPackagePtr; pkgPtr != NULL; pkgPtr = pkgPtr->nextPtr) {
-	if (packageName == NULL) {
-	    namesMatch = 0;
-	} else {
-	    Tcl_DStringSetLength(&pkgName, 0);
-	    Tcl_DStringAppend(&pkgName, packageName, -1);
-	    Tcl_DStringSetLength(&tmp, 0);
-	    Tcl_DStringAppend(&tmp, pkgPtr->packageName, -1);
-	    Tcl_UtfToLower(Tcl_DStringValue(&pkgName));
-	    Tcl_UtfToLower(Tcl_DStringValue(&tmp));
-	    if (strcmp(Tcl_DStringValue(&tmp),
-		    Tcl_DStringValue(&pkgName)) == 0) {
-		namesMatch = 1;
-	    } else {
-		namesMatch = 0;
-	    }
-	}
-	Tcl_DStringSetLength(&pkgName, 0);
+    pkgPtr = NULL;
+    if (fullFileName[0] != 0) {
+	NormalizeFileName(fullFileName, &tmp);
+	hPtr = Tcl_FindHashEntry(&fileTable, Tcl_DStringValue(&tmp));
+	if (hPtr != NULL) {
+	    pkgPtr = (LoadedPackage *) Tcl_GetHashValue(hPtr);
+	    if (packageName != NULL) {
+		Tcl_DStringSetLength(&pkgName, 0);
+		Tcl_DStringAppend(&pkgName, packageName, -1);
+		Tcl_DStringSetLength(&tmp, 0);
+		Tcl_DStringAppend(&tmp, pkgPtr->packageName, -1);
+		Tcl_UtfToLower(Tcl_DStringValue(&pkgName));
+		Tcl_UtfToLower(Tcl_DStringValue(&tmp));
+		if (strcmp(Tcl_DStringValue(&tmp),
+			Tcl_DStringValue(&pkgName)) != 0) {
+		    /*
+		     * Can't have two different packages loaded from the
+		     * same file.
+		     */
 
-	filesMatch = (strcmp(pkgPtr->fileName, fullFileName) == 0);
-	if (filesMatch && (namesMatch || (packageName == NULL))) {
-	    break;
-	}
-	if (namesMatch && (fullFileName[0] == 0)) {
-	    defaultPtr = pkgPtr;
+		    Tcl_AppendResult(interp, "file \"", fullFileName,
+			    "\" is already loaded for package \"",
+			    pkgPtr->packageName, "\"", (char *) NULL);
+		    code = TCL_ERROR;
+		    Tcl_MutexUnlock(&packageMutex);
+		    goto done;
+		}
+	    }
 	}
-	if (filesMatch && !namesMatch && (fullFileName[0] != 0)) {
+    } else {
+	Tcl_DStringAppend(&tmp, packageName, -1);
+	Tcl_DStringSetLength(&tmp, Tcl_UtfToLower(Tcl_DStringValue(&tmp)));
+	hPtr = Tcl_FindHashEntry(&nameTable, Tcl_DStringValue(&tmp));
+	if (hPtr != NULL) {
 	    /*
-	     * Can't have two different packages loaded from the same
-	     * file.
+	     * Prefer the most recent static package with the name; if
+	     * there is none, use the most recent one loaded from a file.
 	     */
 
-	    Tcl_AppendResult(interp, "file \"", fullFileName,
-		    "\" is already loaded for package \"",
-		    pkgPtr->packageName, "\"", (char *) NULL);
-	    code = TCL_ERROR;
-	    Tcl_MutexUnlock(&packageMutex);
-	    goto done;
+	    for (pkgPtr = (LoadedPackage *) Tcl_GetHashValue(hPtr);
+		    pkgPtr != NULL; pkgPtr = pkgPtr->nextNamePtr) {
+		if (pkgPtr->fileName[0] == 0) {
+		    break;
+		}
+	    }
+	    if (pkgPtr == NULL) {
+		pkgPtr = (LoadedPackage *) Tcl_GetHashValue(hPtr);
+	    }
 	}
     }
     Tcl_MutexUnlock(&packageMutex);
-    if (pkgPtr == NULL) {
-	pkgPtr = defaultPtr;
-    }
+    Tcl_DStringSetLength(&pkgName, 0);
+    Tcl_DStringSetLength(&tmp, 0);
 
     /*
      * Scan through the list of packages already loaded in the target
@@ -313,24 +454,32 @@ Tcl_LoadObjCmd(dummy, interp, objc, objv)
 		Tcl_UtfToTitle(Tcl_DStringValue(&pkgName)));
 
 	/*
-	 * Compute the names of the two initialization procedures,
-	 * based on the package name.
+	 * Compute the name of the initialization procedure, based on
+	 * the package name.
 	 */
     
 	Tcl_DStringAppend(&initName, Tcl_DStringValue(&pkgName), -1);
 	Tcl_DStringAppend(&initName, "_Init", 5);
-	Tcl_DStringAppend(&safeInitName, Tcl_DStringValue(&pkgName), -1);
-	Tcl_DStringAppend(&safeInitName, "_SafeInit", 9);
 
 	/*
-	 * Call platform-specific code to load the package and find the
-	 * two initialization procedures.
+	 * Call platform-specific code to load the package and find its
+	 * initialization procedure, unless the file has been preloaded.
+	 * The safe one is only looked up once a safe interpreter needs it
+	 * (see ResolveSafeInit).
 	 */
 
 	Tcl_MutexLock(&packageMutex);
-	code = TclpLoadFile(interp, fullFileName, Tcl_DStringValue(&initName),
-		Tcl_DStringValue(&safeInitName), &initProc, &safeInitProc,
-		&clientData);
+	if (TakePreloadedFile(fullFileName, &clientData, &loadTime)) {
+	    initProc = TclpFindSymbol(clientData, Tcl_DStringValue(&initName));
+	    safeInitProc = NULL;
+	    code = TCL_OK;
+	} else {
+	    TclpGetTime(&start);
+	    code = TclpLoadFile(interp, fullFileName,
+		    Tcl_DStringValue(&initName), (char *) NULL, &initProc,
+		    &safeInitProc, &clientData);
+	    loadTime = MicrosSince(&start);
+	}
 	Tcl_MutexUnlock(&packageMutex);
 	if (code != TCL_OK) {
 	    goto done;
@@ -347,20 +496,46 @@ Tcl_LoadObjCmd(dummy, interp, objc, objv)
 	 * Create a new record to describe this package.
 	 */
 
-	pkgPtr = (LoadedPackage *) ckalloc(sizeof(LoadedPackage));
-	pkgPtr->fileName	= (char *) ckalloc((unsigned)
-		(strlen(fullFileName) + 1));
-	strcpy(pkgPtr->fileName, fullFileName);
-	pkgPtr->packageName	= (char *) ckalloc((unsigned)
-		(Tcl_DStringLength(&pkgName) + 1));
-	strcpy(pkgPtr->packageName, Tcl_DStringValue(&pkgName));
-	pkgPtr->clientData	= clientData;
-	pkgPtr->initProc	= initProc;
-	pkgPtr->safeInitProc	= safeInitProc;
+	NormalizeFileName(fullFileName, &tmp);
 	Tcl_MutexLock(&packageMutex);
-	pkgPtr->nextPtr		= firstPackagePtr;
-	firstPackagePtr		= pkgPtr;
-	Tcl_MutexUnlock(&packageMutex);
+	hPtr = Tcl_CreateHashEntry(&fileTable, Tcl_DStringValue(&tmp), &new);
+	if (!new) {
+	    /*
+	     * Another thread loaded the same file while we were doing
+	     * it.  Drop our reference to the file and use its package,
+	     * unless we were asked for a different one: as above, there
+	     * can't be two packages loaded from the same file.
+	     */
+
+	    pkgPtr = (LoadedPackage *) Tcl_GetHashValue(hPtr);
+	    Tcl_MutexUnlock(&packageMutex);
+	    TclpUnloadFile(clientData);
+	    if ((packageName != NULL) && (strcmp(pkgPtr->packageName,
+		    Tcl_DStringValue(&pkgName)) != 0)) {
+		Tcl_AppendResult(interp, "file \"", fullFileName,
+			"\" is already loaded for package \"",
+			pkgPtr->packageName, "\"", (char *) NULL);
+		code = TCL_ERROR;
+		goto done;
+	    }
+	} else {
+	    newPkgPtr = (LoadedPackage *) ckalloc(sizeof(LoadedPackage));
+	    newPkgPtr->fileName		= (char *) ckalloc((unsigned)
+		    (strlen(fullFileName) + 1));
+	    strcpy(newPkgPtr->fileName, fullFileName);
+	    newPkgPtr->packageName	= (char *) ckalloc((unsigned)
+		    (Tcl_DStringLength(&pkgName) + 1));
+	    strcpy(newPkgPtr->packageName, Tcl_DStringValue(&pkgName));
+	    newPkgPtr->clientData	= clientData;
+	    newPkgPtr->initProc		= initProc;
+	    newPkgPtr->safeInitProc	= safeInitProc;
+	    newPkgPtr->safeInitFound	= (safeInitProc != NULL);
+	    newPkgPtr->loadTime		= loadTime;
+	    Tcl_SetHashValue(hPtr, newPkgPtr);
+	    AddPackage(newPkgPtr);
+	    Tcl_MutexUnlock(&packageMutex);
+	    pkgPtr = newPkgPtr;
+	}
     }
 
     /*
@@ -369,9 +544,14 @@ Tcl_LoadObjCmd(dummy, interp, objc, objv)
      * interpreter is safe).
      */
 
+    TclpGetTime(&start);
     if (Tcl_IsSafe(target)) {
-	if (pkgPtr->safeInitProc != NULL) {
-	    code = (*pkgPtr->safeInitProc)(target);
+	Tcl_MutexLock(&packageMutex);
+	ResolveSafeInit(pkgPtr);
+	safeInitProc = pkgPtr->safeInitProc;
+	Tcl_MutexUnlock(&packageMutex);
+	if (safeInitProc != NULL) {
+	    code = (*safeInitProc)(target);
 	} else {
 	    Tcl_AppendResult(interp,
 		    "can't use package in a safe interpreter: ",
@@ -383,6 +563,11 @@ Tcl_LoadObjCmd(dummy, interp, objc, objv)
     } else {
 	code = (*pkgPtr->initProc)(target);
     }
+    initTime = MicrosSince(&start);
+    Tcl_MutexLock(&packageMutex);
+    pkgPtr->numInits++;
+    pkgPtr->initTime += initTime;
+    Tcl_MutexUnlock(&packageMutex);
 
     /*
      * Record the fact that the package has been loaded in the
@@ -409,12 +594,354 @@ Tcl_LoadObjCmd(dummy, interp, objc, objv)
     done:
     Tcl_DStringFree(&pkgName);
     Tcl_DStringFree(&initName);
-    Tcl_DStringFree(&safeInitName);
     Tcl_DStringFree(&fileName);
     Tcl_DStringFree(&tmp);
     return code;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_PreloadFile --
+ *
+ *	Starts loading a binary file in the background, so that a later
+ *	"load" command for it only has to wait for the part that hasn't
+ *	been done yet and to call the package's initialization procedure.
+ *	Loading a file that is already loaded or being loaded does
+ *	nothing.
+ *
+ * Results:
+ *	A standard Tcl result.  An error (left in interp's result) is
+ *	only returned if the file name can't be translated; failures to
+ *	load the file are reported by the "load" command.
+ *
+ * Side effects:
+ *	May start a background thread.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+Tcl_PreloadFile(interp, fileName)
+    Tcl_Interp *interp;		/* Used for error reporting. */
+    char *fileName;		/* Name of the file to load. */
+{
+    PreloadedFile *filePtr;
+    Tcl_HashEntry *hPtr;
+    Tcl_DString buffer, key;
+    char *fullFileName;
+    int new;
+#ifdef TCL_THREADS
+    Tcl_ThreadId threadId;
+#endif
+
+    fullFileName = Tcl_TranslateFileName(interp, fileName, &buffer);
+    if (fullFileName == NULL) {
+	return TCL_ERROR;
+    }
+    if (fullFileName[0] == 0) {
+	Tcl_DStringFree(&buffer);
+	return TCL_OK;
+    }
+    Tcl_DStringInit(&key);
+    NormalizeFileName(fullFileName, &key);
+
+    Tcl_MutexLock(&packageMutex);
+    InitPackageTables();
+    if (Tcl_FindHashEntry(&fileTable, Tcl_DStringValue(&key)) != NULL) {
+	new = 0;
+    } else {
+	hPtr = Tcl_CreateHashEntry(&preloadTable, Tcl_DStringValue(&key),
+		&new);
+    }
+    if (!new) {
+	Tcl_MutexUnlock(&packageMutex);
+	Tcl_DStringFree(&key);
+	Tcl_DStringFree(&buffer);
+	return TCL_OK;
+    }
+    filePtr = (PreloadedFile *) ckalloc(sizeof(PreloadedFile));
+    filePtr->fileName = (char *) ckalloc((unsigned)
+	    (strlen(fullFileName) + 1));
+    strcpy(filePtr->fileName, fullFileName);
+    filePtr->done = 0;
+    filePtr->code = TCL_ERROR;
+    filePtr->clientData = NULL;
+    filePtr->loadTime = 0;
+    filePtr->nextPtr = NULL;
+    Tcl_SetHashValue(hPtr, filePtr);
+    Tcl_DStringFree(&key);
+    Tcl_DStringFree(&buffer);
+
+#ifdef TCL_THREADS
+    if (lastQueuedPtr == NULL) {
+	firstQueuedPtr = filePtr;
+    } else {
+	lastQueuedPtr->nextPtr = filePtr;
+    }
+    lastQueuedPtr = filePtr;
+    if (!preloadExiting && (numPreloadThreads < PRELOAD_MAX_THREADS)) {
+	if (!preloadExitHandler) {
+	    Tcl_CreateExitHandler(WaitForPreloads, (ClientData) NULL);
+	    preloadExitHandler = 1;
+	}
+	if (Tcl_CreateThread(&threadId, PreloadThreadProc, (ClientData) NULL,
+		TCL_THREAD_STACK_DEFAULT, TCL_THREAD_NOFLAGS) == TCL_OK) {
+	    numPreloadThreads++;
+	}
+    }
+    if (numPreloadThreads > 0) {
+	Tcl_MutexUnlock(&packageMutex);
+	return TCL_OK;
+    }
+
+    /*
+     * No thread could be started: load the file here.
+     */
+
+    firstQueuedPtr = lastQueuedPtr = NULL;
+#endif
+    Tcl_MutexUnlock(&packageMutex);
+    FinishPreload(filePtr);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FinishPreload --
+ *
+ *	Loads a file that was passed to Tcl_PreloadFile.  Called without
+ *	packageMutex held, so that files can be loaded in parallel.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Loads the file, marks filePtr as done and wakes up any "load"
+ *	command waiting for it.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FinishPreload(filePtr)
+    PreloadedFile *filePtr;	/* File to load. */
+{
+    Tcl_PackageInitProc *proc1, *proc2;
+    ClientData clientData;
+    Tcl_Time start;
+    long loadTime;
+    int code;
+
+    TclpGetTime(&start);
+    code = TclpLoadFile((Tcl_Interp *) NULL, filePtr->fileName,
+	    (char *) NULL, (char *) NULL, &proc1, &proc2, &clientData);
+    loadTime = MicrosSince(&start);
+
+    Tcl_MutexLock(&packageMutex);
+    filePtr->code = code;
+    filePtr->clientData = clientData;
+    filePtr->loadTime = loadTime;
+    filePtr->done = 1;
+#ifdef TCL_THREADS
+    Tcl_ConditionNotify(&preloadCond);
+#endif
+    Tcl_MutexUnlock(&packageMutex);
+}
+
+#ifdef TCL_THREADS
+/*
+ *----------------------------------------------------------------------
+ *
+ * PreloadThreadProc --
+ *
+ *	Main procedure of the background threads started by
+ *	Tcl_PreloadFile: loads queued files until the queue is empty.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Loads files.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_ThreadCreateType
+PreloadThreadProc(clientData)
+    ClientData clientData;	/* Not used. */
+{
+    PreloadedFile *filePtr;
+
+    while (1) {
+	Tcl_MutexLock(&packageMutex);
+	filePtr = firstQueuedPtr;
+	if (filePtr == NULL) {
+	    numPreloadThreads--;
+	    Tcl_ConditionNotify(&preloadCond);
+	    Tcl_MutexUnlock(&packageMutex);
+	    break;
+	}
+	firstQueuedPtr = filePtr->nextPtr;
+	if (firstQueuedPtr == NULL) {
+	    lastQueuedPtr = NULL;
+	}
+	Tcl_MutexUnlock(&packageMutex);
+	FinishPreload(filePtr);
+    }
+
+    Tcl_ExitThread(0);
+    TCL_THREAD_CREATE_RETURN;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * WaitForPreloads --
+ *
+ *	Exit handler that waits until the background threads started by
+ *	Tcl_PreloadFile have loaded all the queued files and exited.
+ *	This has to be done while packageMutex and preloadCond can still
+ *	be used; TclFinalizeLoad runs after they have been finalized.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Files passed to Tcl_PreloadFile from now on are loaded right
+ *	away, without a background thread.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+WaitForPreloads(clientData)
+    ClientData clientData;	/* Not used. */
+{
+    Tcl_MutexLock(&packageMutex);
+    preloadExiting = 1;
+    while (numPreloadThreads > 0) {
+	Tcl_ConditionWait(&preloadCond, &packageMutex, NULL);
+    }
+    Tcl_MutexUnlock(&packageMutex);
+}
+#endif
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TakePreloadedFile --
+ *
+ *	Called by the "load" command, with packageMutex held, to use a
+ *	file loaded by Tcl_PreloadFile.  Waits until the file has been
+ *	loaded if necessary.
+ *
+ * Results:
+ *	1 if the file was preloaded successfully, in which case the
+ *	token for it and the time it took are stored at clientDataPtr
+ *	and loadTimePtr.  0 if the file wasn't preloaded or that failed;
+ *	the caller should load it itself to get an error message.
+ *
+ * Side effects:
+ *	The file is forgotten by the preloading code.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+TakePreloadedFile(fileName, clientDataPtr, loadTimePtr)
+    CONST char *fileName;	/* Translated name of the file. */
+    ClientData *clientDataPtr;	/* Where to store the file's token. */
+    long *loadTimePtr;		/* Where to store the time it took. */
+{
+    PreloadedFile *filePtr;
+    Tcl_HashEntry *hPtr;
+    Tcl_DString key;
+    int result;
+
+    Tcl_DStringInit(&key);
+    NormalizeFileName(fileName, &key);
+    hPtr = Tcl_FindHashEntry(&preloadTable, Tcl_DStringValue(&key));
+    Tcl_DStringFree(&key);
+    if (hPtr == NULL) {
+	return 0;
+    }
+    filePtr = (PreloadedFile *) Tcl_GetHashValue(hPtr);
+#ifdef TCL_THREADS
+    while (!filePtr->done) {
+	Tcl_ConditionWait(&preloadCond, &packageMutex, NULL);
+    }
+#endif
+    Tcl_DeleteHashEntry(hPtr);
+    result = (filePtr->code == TCL_OK);
+    if (result) {
+	*clientDataPtr = filePtr->clientData;
+	*loadTimePtr = filePtr->loadTime;
+    }
+    ckfree(filePtr->fileName);
+    ckfree((char *) filePtr);
+    return result;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclPreloadCount --
+ *
+ *	Used by the "testpreload" command to look at the files passed to
+ *	Tcl_PreloadFile.  If wait is non-zero, it first waits for the
+ *	background threads with WaitForPreloads, as Tcl_Finalize does,
+ *	and then lets Tcl_PreloadFile start threads again.
+ *
+ * Results:
+ *	The number of preloaded files that no "load" command has taken
+ *	yet.  The number of those that have finished loading is stored
+ *	at donePtr.
+ *
+ * Side effects:
+ *	May wait for the background threads to exit.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclPreloadCount(wait, donePtr)
+    int wait;			/* Non-zero means wait for the background
+				 * threads first. */
+    int *donePtr;		/* Where to store the number of files that
+				 * have been loaded. */
+{
+    PreloadedFile *filePtr;
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+    int count, done;
+
+#ifdef TCL_THREADS
+    if (wait) {
+	WaitForPreloads((ClientData) NULL);
+	Tcl_MutexLock(&packageMutex);
+	preloadExiting = 0;
+	Tcl_MutexUnlock(&packageMutex);
+    }
+#endif
+
+    count = done = 0;
+    Tcl_MutexLock(&packageMutex);
+    InitPackageTables();
+    for (hPtr = Tcl_FirstHashEntry(&preloadTable, &search); hPtr != NULL;
+	    hPtr = Tcl_NextHashEntry(&search)) {
+	filePtr = (PreloadedFile *) Tcl_GetHashValue(hPtr);
+	count++;
+	if (filePtr->done) {
+	    done++;
+	}
+    }
+    Tcl_MutexUnlock(&packageMutex);
+    *donePtr = done;
+    return count;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -454,24 +981,36 @@ Tcl_StaticPackage(interp, pkgName, initProc, safeInitProc)
 {
     LoadedPackage *pkgPtr;
     InterpPackage *ipPtr, *ipFirstPtr;
+    Tcl_HashEntry *hPtr;
+    Tcl_DString key;
 
     /*
      * Check to see if someone else has already reported this package as
      * statically loaded.  If this call is redundant then just return.
      */
 
+    Tcl_DStringInit(&key);
+    Tcl_DStringAppend(&key, pkgName, -1);
+    Tcl_DStringSetLength(&key, Tcl_UtfToLower(Tcl_DStringValue(&key)));
     Tcl_MutexLock(&packageMutex);
-    for (pkgPtr = firstPackagePtr; pkgPtr != NULL; pkgPtr = pkgPtr->nextPtr) {
-	if ((pkgPtr->initProc == initProc)
-		&& (pkgPtr->safeInitProc == safeInitProc)
-		&& (strcmp(pkgPtr->packageName, pkgName) == 0)) {
-	    Tcl_MutexUnlock(&packageMutex);
-	    return;
+    InitPackageTables();
+    hPtr = Tcl_FindHashEntry(&nameTable, Tcl_DStringValue(&key));
+    Tcl_DStringFree(&key);
+    if (hPtr != NULL) {
+	for (pkgPtr = (LoadedPackage *) Tcl_GetHashValue(hPtr);
+		pkgPtr != NULL; pkgPtr = pkgPtr->nextNamePtr) {
+	    if ((pkgPtr->initProc != initProc)
+		    || (strcmp(pkgPtr->packageName, pkgName) != 0)) {
+		continue;
+	    }
+	    ResolveSafeInit(pkgPtr);
+	    if (pkgPtr->safeInitProc == safeInitProc) {
+		Tcl_MutexUnlock(&packageMutex);
+		return;
+	    }
 	}
     }
 
-    Tcl_MutexUnlock(&packageMutex);
-
     pkgPtr = (LoadedPackage *) ckalloc(sizeof(LoadedPackage));
     pkgPtr->fileName		= (char *) ckalloc((unsigned) 1);
     pkgPtr->fileName[0]		= 0;
@@ -481,9 +1020,9 @@ Tcl_StaticPackage(interp, pkgName, initProc, safeInitProc)
     pkgPtr->clientData		= NULL;
     pkgPtr->initProc		= initProc;
     pkgPtr->safeInitProc	= safeInitProc;
-    Tcl_MutexLock(&packageMutex);
-    pkgPtr->nextPtr		= firstPackagePtr;
-    firstPackagePtr		= pkgPtr;
+    pkgPtr->safeInitFound	= 1;
+    pkgPtr->loadTime		= 0;
+    AddPackage(pkgPtr);
     Tcl_MutexUnlock(&packageMutex);
 
     if (interp != NULL) {
@@ -660,4 +1199,262 @@ TclFinalizeLoad()
 	ckfree(pkgPtr->packageName);
 	ckfree((char *) pkgPtr);
     }
+    if (tablesInitialized) {
+	Tcl_HashEntry *hPtr;
+	Tcl_HashSearch search;
+	PreloadedFile *filePtr;
+
+	/*
+	 * Unload the preloaded files nobody used.  WaitForPreloads has
+	 * made sure that no background thread is still loading one.
+	 */
+
+	for (hPtr = Tcl_FirstHashEntry(&preloadTable, &search);
+		hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	    filePtr = (PreloadedFile *) Tcl_GetHashValue(hPtr);
+	    if (filePtr->done && (filePtr->code == TCL_OK)) {
+		TclpUnloadFile(filePtr->clientData);
+	    }
+	    ckfree(filePtr->fileName);
+	    ckfree((char *) filePtr);
+	}
+	Tcl_DeleteHashTable(&preloadTable);
+	Tcl_DeleteHashTable(&fileTable);
+	Tcl_DeleteHashTable(&nameTable);
+	tablesInitialized = 0;
+    }
+#ifdef TCL_THREADS
+    preloadExitHandler = 0;
+    preloadExiting = 0;
+#endif
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * InitPackageTables --
+ *
+ *	Initializes the tables that index the loaded packages, if that
+ *	hasn't been done yet.  The caller must hold packageMutex.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Initializes fileTable, nameTable and preloadTable.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+InitPackageTables()
+{
+    if (!tablesInitialized) {
+	Tcl_InitHashTable(&fileTable, TCL_STRING_KEYS);
+	Tcl_InitHashTable(&nameTable, TCL_STRING_KEYS);
+	Tcl_InitHashTable(&preloadTable, TCL_STRING_KEYS);
+	tablesInitialized = 1;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AddPackage --
+ *
+ *	Adds a new package to the list of loaded packages and to the
+ *	index of package names.  The caller must hold packageMutex and,
+ *	for a package loaded from a file, have added it to fileTable.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Links pkgPtr into the list and nameTable and clears its
+ *	statistics.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+AddPackage(pkgPtr)
+    LoadedPackage *pkgPtr;	/* Package to add. */
+{
+    Tcl_HashEntry *hPtr;
+    Tcl_DString key;
+    int new;
+
+    pkgPtr->numInits = 0;
+    pkgPtr->initTime = 0;
+    pkgPtr->nextPtr = firstPackagePtr;
+    firstPackagePtr = pkgPtr;
+
+    Tcl_DStringInit(&key);
+    Tcl_DStringAppend(&key, pkgPtr->packageName, -1);
+    Tcl_DStringSetLength(&key, Tcl_UtfToLower(Tcl_DStringValue(&key)));
+    hPtr = Tcl_CreateHashEntry(&nameTable, Tcl_DStringValue(&key), &new);
+    Tcl_DStringFree(&key);
+    if (new) {
+	pkgPtr->nextNamePtr = NULL;
+    } else {
+	pkgPtr->nextNamePtr = (LoadedPackage *) Tcl_GetHashValue(hPtr);
+    }
+    Tcl_SetHashValue(hPtr, pkgPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NormalizeFileName --
+ *
+ *	Computes the key under which the package loaded from a file is
+ *	kept in fileTable.  On systems whose file names are not case
+ *	sensitive, names that differ only in case or in the kind of
+ *	slash that separates their elements get the same key.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The key is left in *dsPtr, replacing its previous contents.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+NormalizeFileName(fileName, dsPtr)
+    CONST char *fileName;	/* Translated name of the file. */
+    Tcl_DString *dsPtr;		/* Initialized DString to receive the
+				 * key. */
+{
+#if defined(__WIN32__) || defined(__OS2__)
+    char *p;
+#endif
+
+    Tcl_DStringSetLength(dsPtr, 0);
+    Tcl_DStringAppend(dsPtr, fileName, -1);
+#if defined(__WIN32__) || defined(__OS2__)
+    for (p = Tcl_DStringValue(dsPtr); *p != '\0'; p++) {
+	if (*p == '\\') {
+	    *p = '/';
+	}
+    }
+    Tcl_DStringSetLength(dsPtr, Tcl_UtfToLower(Tcl_DStringValue(dsPtr)));
+#endif
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ResolveSafeInit --
+ *
+ *	Makes sure the safeInitProc field of a package is valid, looking
+ *	up the package's safe initialization procedure in its file if
+ *	that hasn't been done yet.  The caller must hold packageMutex.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May fill in pkgPtr->safeInitProc.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ResolveSafeInit(pkgPtr)
+    LoadedPackage *pkgPtr;	/* Package whose safe initialization
+				 * procedure is needed. */
+{
+    Tcl_DString safeInitName;
+
+    if (pkgPtr->safeInitFound) {
+	return;
+    }
+    Tcl_DStringInit(&safeInitName);
+    Tcl_DStringAppend(&safeInitName, pkgPtr->packageName, -1);
+    Tcl_DStringAppend(&safeInitName, "_SafeInit", 9);
+    pkgPtr->safeInitProc = TclpFindSymbol(pkgPtr->clientData,
+	    Tcl_DStringValue(&safeInitName));
+    pkgPtr->safeInitFound = 1;
+    Tcl_DStringFree(&safeInitName);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * MicrosSince --
+ *
+ *	Computes the time elapsed since a given time.
+ *
+ * Results:
+ *	The elapsed time in microseconds.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static long
+MicrosSince(startPtr)
+    Tcl_Time *startPtr;		/* Time returned by TclpGetTime. */
+{
+    Tcl_Time now;
+    long micros;
+
+    TclpGetTime(&now);
+    micros = (now.sec - startPtr->sec) * 1000000
+	    + (now.usec - startPtr->usec);
+    return (micros < 0) ? 0 : micros;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * LoadStats --
+ *
+ *	Implements "load -stats".
+ *
+ * Results:
+ *	A standard Tcl result.  The interp's result is set to a list
+ *	with one element for each package loaded into the process: a
+ *	list of its file name, its package name, the microseconds spent
+ *	loading its file, the number of times its initialization
+ *	procedures were called by "load" and the microseconds spent in
+ *	those calls.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+LoadStats(interp)
+    Tcl_Interp *interp;		/* Interpreter in which to return the
+				 * statistics. */
+{
+    LoadedPackage *pkgPtr;
+    Tcl_Obj *resultPtr, *elemPtr;
+
+    resultPtr = Tcl_NewObj();
+    Tcl_MutexLock(&packageMutex);
+    for (pkgPtr = firstPackagePtr; pkgPtr != NULL; pkgPtr = pkgPtr->nextPtr) {
+	elemPtr = Tcl_NewObj();
+	Tcl_ListObjAppendElement(NULL, elemPtr,
+		Tcl_NewStringObj(pkgPtr->fileName, -1));
+	Tcl_ListObjAppendElement(NULL, elemPtr,
+		Tcl_NewStringObj(pkgPtr->packageName, -1));
+	Tcl_ListObjAppendElement(NULL, elemPtr,
+		Tcl_NewLongObj(pkgPtr->loadTime));
+	Tcl_ListObjAppendElement(NULL, elemPtr,
+		Tcl_NewIntObj(pkgPtr->numInits));
+	Tcl_ListObjAppendElement(NULL, elemPtr,
+		Tcl_NewLongObj(pkgPtr->initTime));
+	Tcl_ListObjAppendElement(NULL, resultPtr, elemPtr);
+    }
+    Tcl_MutexUnlock(&packageMutex);
+    Tcl_SetObjResult(interp, resultPtr);
+    return TCL_OK;
 }
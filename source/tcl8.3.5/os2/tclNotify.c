@@ -21,6 +21,19 @@
 
 extern TclStubs tclStubs;
 
+/*
+ * When notifier statistics are enabled (see Tcl_SetNotifierStats), the
+ * time spent in each kind of work is gathered in structures of the
+ * following type.
+ */
+
+typedef struct ServiceStats {
+    long count;			/* Number of calls timed. */
+    double total;		/* Total time of the calls, in
+				 * microseconds. */
+    long max;			/* Longest call, in microseconds. */
+} ServiceStats;
+
 /*
  * For each event source (created with Tcl_CreateEventSource) there
  * is a structure of the following type:
@@ -31,28 +44,150 @@ typedef struct EventSource {
     Tcl_EventCheckProc *checkProc;
     ClientData clientData;
     struct EventSource *nextPtr;
+    ServiceStats setupStats;	/* Calls of setupProc. */
+    ServiceStats checkStats;	/* Calls of checkProc. */
 } EventSource;
 
+/*
+ * Number of buckets in the histogram of queue lengths.  Bucket 0 counts
+ * empty queues, bucket i queues of 2^(i-1) to 2^i - 1 events, and the
+ * last bucket all longer queues.
+ */
+
+#define DEPTH_BUCKETS	16
+
+/*
+ * The statistics of a notifier, other than those of its event sources.
+ */
+
+typedef struct NotifierStats {
+    ServiceStats events;	/* Events handled by their procs. */
+    Tcl_HashTable procTable;	/* Maps from event procs to the
+				 * ServiceStats of the events they
+				 * handled. */
+    ServiceStats wait;		/* Calls of Tcl_WaitForEvent. */
+    ServiceStats idle;		/* Calls of TclServiceIdle that ran idle
+				 * handlers. */
+    long depth[DEPTH_BUCKETS];	/* Histogram of the length of the queue
+				 * each time Tcl_ServiceEvent looked at
+				 * it. */
+} NotifierStats;
+
+/*
+ * Events queued at the tail of the queue are kept in one of several
+ * EventRings, according to the kind of event they are (see RingIndex).
+ * A ring is a circular array of QueuedEvents in the order the events
+ * were queued.  Events handled or deleted out of order leave a hole
+ * (an entry with a NULL evPtr) behind, which is dropped once it reaches
+ * the front of the ring, or when holes make up more than half of the
+ * ring.
+ */
+
+typedef struct QueuedEvent {
+    Tcl_Event *evPtr;		/* The event, or NULL if it has been
+				 * removed from the ring. */
+    unsigned long seq;		/* Sequence number given to the event when
+				 * it was queued.  Gives the order of events
+				 * in different rings. */
+    Tcl_HashEntry *keyPtr;	/* Entry for the event in the keyTable of
+				 * the ring, or NULL if other events can't
+				 * be coalesced with it. */
+} QueuedEvent;
+
+typedef struct EventRing {
+    QueuedEvent *entries;	/* Storage for the ring (malloc-ed), or
+				 * NULL if nothing was ever queued. */
+    int size;			/* Number of entries allocated; always 0 or
+				 * a power of 2. */
+    int first;			/* Index in entries of the oldest entry. */
+    int count;			/* Number of entries in use, counting the
+				 * holes. */
+    int numHoles;		/* Number of entries whose evPtr is NULL. */
+    Tcl_HashTable *keyTablePtr;	/* Maps CoalesceKeys to the sequence numbers
+				 * of the events that were queued with
+				 * Tcl_QueueEventCoalesced and can still be
+				 * replaced, or NULL if there never were
+				 * any. */
+} EventRing;
+
+/*
+ * The key of an event queued with Tcl_QueueEventCoalesced: events with
+ * the same proc and the same value from their keyProc are coalesced.
+ */
+
+typedef struct CoalesceKey {
+    Tcl_EventProc *proc;	/* Proc of the event. */
+    ClientData key;		/* Result of the keyProc for the event. */
+} CoalesceKey;
+
+/*
+ * The rings of each notifier.  Window, file and timer events are only
+ * looked at when Tcl_ServiceEvent is asked for events of their kind; the
+ * events in the EVENT_RING_OTHER ring are always looked at.
+ */
+
+#define EVENT_RING_WINDOW	0
+#define EVENT_RING_FILE		1
+#define EVENT_RING_TIMER	2
+#define EVENT_RING_OTHER	3
+#define EVENT_RINGS		4
+
+/*
+ * The kind of event held by each ring, indexed by the values above.
+ */
+
+static int ringTypes[EVENT_RINGS] = {
+    TCL_WINDOW_EVENTS, TCL_FILE_EVENTS, TCL_TIMER_EVENTS, 0
+};
+
+/*
+ * Sequence numbers wrap around, so they are compared by the sign of
+ * their difference.
+ */
+
+#define SEQ_BEFORE(seq1, seq2)	((long) ((seq1) - (seq2)) < 0)
+
 /*
  * The following structure keeps track of the state of the notifier on a
- * per-thread basis. The first three elements keep track of the event queue.
- * In addition to the first (next to be serviced) and last events in the queue,
- * we keep track of a "marker" event.  This provides a simple priority
- * mechanism whereby events can be inserted at the front of the queue but
- * behind all other high-priority events already in the queue (this is used for
- * things like a sequence of Enter and Leave events generated during a grab in
- * Tk).  These elements are protected by the queueMutex so that any thread
- * can queue an event on any notifier.  Note that all of the values in this
+ * per-thread basis. The first elements keep track of the event queue.
+ * Events queued with TCL_QUEUE_HEAD or TCL_QUEUE_MARK are kept in a linked
+ * list that is serviced before any other event; in addition to the first
+ * event in that list we keep track of a "marker" event.  This provides a
+ * simple priority mechanism whereby events can be inserted at the front of
+ * the queue but behind all other high-priority events already in the queue
+ * (this is used for things like a sequence of Enter and Leave events
+ * generated during a grab in Tk).  Events queued with TCL_QUEUE_TAIL go
+ * into the rings and are serviced in the order of their sequence numbers.
+ * These elements are only touched by the thread that owns the
+ * notifier.  Other threads queue events by pushing them onto the inbox,
+ * which needs no lock, and the owner moves them into the queue before it
+ * looks at the queue (see DrainInbox).  Note that all of the values in this
  * structure will be initialized to 0.
  */
 
 typedef struct ThreadSpecificData {
-    Tcl_Event *firstEventPtr;	/* First pending event, or NULL if none. */
-    Tcl_Event *lastEventPtr;	/* Last pending event, or NULL if none. */
-    Tcl_Event *markerEventPtr;	/* Last high-priority event in queue, or
+    Tcl_Event *firstEventPtr;	/* First pending high-priority event, or
 				 * NULL if none. */
-    Tcl_Mutex queueMutex;	/* Mutex to protect access to the previous
-				 * three fields. */
+    Tcl_Event *markerEventPtr;	/* Last high-priority event queued with
+				 * TCL_QUEUE_MARK, or NULL if none. */
+    EventRing rings[EVENT_RINGS];
+				/* Events queued at the tail, by kind. */
+    unsigned long nextSeq;	/* Sequence number for the next event queued
+				 * at the tail. */
+    unsigned long numCoalesced;	/* Number of events that were dropped
+				 * because a later event replaced them. */
+    int statsEnabled;		/* Non-zero means statistics are being
+				 * gathered in statsPtr. */
+    NotifierStats *statsPtr;	/* Statistics of this notifier, or NULL if
+				 * they were never enabled. */
+    Tcl_Event *volatile inboxPtr;
+				/* Events queued by other threads and not yet
+				 * moved into the queue, most recent first.
+				 * The nextPtr field of each links to the
+				 * next older event, with the queue position
+				 * requested for the event in its low bits
+				 * (see INBOX_POSITION).  Only changed with
+				 * CompareAndSwapEvent. */
     int serviceMode;		/* One of TCL_SERVICE_NONE or
 				 * TCL_SERVICE_ALL. */
     int blockTimeSet;		/* 0 means there is no maximum block
@@ -67,6 +202,9 @@ typedef struct ThreadSpecificData {
     Tcl_ThreadId threadId;	/* Thread that owns this notifier instance. */
     ClientData clientData;	/* Opaque handle for platform specific
 				 * notifier. */
+    struct NotifierSlot *slotPtr;
+				/* Entry of this notifier in notifierTable,
+				 * or NULL if the table was full. */
     struct ThreadSpecificData *nextPtr;
 				/* Next notifier in global list of notifiers.
 				 * Access is controlled by the listLock global
@@ -77,19 +215,122 @@ static Tcl_ThreadDataKey dataKey;
 
 /*
  * Global list of notifiers.  Access to this list is controlled by the
- * listLock mutex.  If this becomes a performance bottleneck, this could
- * be replaced with a hashtable.
+ * listLock mutex.
  */
 
 static ThreadSpecificData *firstNotifierPtr;
 TCL_DECLARE_MUTEX(listLock)
 
+/*
+ * Other threads find a notifier through notifierTable, a hash table
+ * keyed by thread id with linear probing, without taking listLock.
+ * Slots are only filled and emptied with listLock held.  A thread that
+ * looks up a notifier counts itself in the readers field of its slot
+ * while it uses the notifier, and TclFinalizeNotifier empties the slot
+ * and then waits for the readers to go away before the notifier is
+ * finalized.  A slot that has been used once stays marked as used, so
+ * that lookups keep probing past it.  Notifiers that find the table
+ * too full are only in the list, and are looked up with listLock held.
+ */
+
+typedef struct NotifierSlot {
+    Tcl_ThreadId threadId;	/* Thread that owns the notifier. */
+    struct ThreadSpecificData *volatile tsdPtr;
+				/* The notifier, or NULL if the slot is
+				 * empty. */
+    volatile int readers;	/* Number of threads using the notifier. */
+    int used;			/* Non-zero means the slot has been filled
+				 * at some time. */
+} NotifierSlot;
+
+#define NOTIFIER_TABLE_SIZE	1024
+#define NOTIFIER_TABLE_LIMIT	768
+
+#define NOTIFIER_HASH(threadId) \
+	((((unsigned long) (threadId)) * 2654435761UL \
+		^ (((unsigned long) (threadId)) >> 12)) \
+		& (NOTIFIER_TABLE_SIZE - 1))
+
+static NotifierSlot notifierTable[NOTIFIER_TABLE_SIZE];
+static int numUsedSlots;	/* Number of slots of notifierTable that
+				 * have been used. */
+static int numListOnly;		/* Number of notifiers that are not in
+				 * notifierTable. */
+
+/*
+ * Events in an inbox carry their queue position (TCL_QUEUE_TAIL,
+ * TCL_QUEUE_HEAD or TCL_QUEUE_MARK) in the two low bits of their nextPtr
+ * field, which are always zero in a pointer to memory from ckalloc.
+ */
+
+#define INBOX_POSITION_MASK	3
+#define INBOX_POSITION(evPtr) \
+	((Tcl_QueuePosition) (((unsigned long) (evPtr)->nextPtr) \
+		& INBOX_POSITION_MASK))
+#define INBOX_NEXT(evPtr) \
+	((Tcl_Event *) (((unsigned long) (evPtr)->nextPtr) \
+		& ~((unsigned long) INBOX_POSITION_MASK)))
+#define INBOX_LINK(nextPtr, position) \
+	((Tcl_Event *) (((unsigned long) (nextPtr)) | (unsigned long) (position)))
+
+/*
+ * How CompareAndSwapEvent and AtomicAdd do their work: with the gcc
+ * __sync builtins, with inline assembly on the i386, or, for other
+ * compilers, with the atomicLock mutex.  In the last case lookups in
+ * notifierTable are also done with listLock held.
+ */
+
+#if defined(__GNUC__) && ((__GNUC__ > 4) \
+	|| ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 1)))
+#   define ATOMIC_BUILTINS
+#elif defined(__GNUC__) && defined(__i386__)
+#   define ATOMIC_ASM
+#else
+#   define ATOMIC_LOCK
+TCL_DECLARE_MUTEX(atomicLock)
+#endif
+
 /*
  * Declarations for routines used only in this file.
  */
 
+static int		AtomicAdd _ANSI_ARGS_((volatile int *valuePtr,
+			    int amount));
+static int		CallEventProc _ANSI_ARGS_((
+			    ThreadSpecificData *tsdPtr, Tcl_EventProc *proc,
+			    Tcl_Event *evPtr, int flags));
+static Tcl_Event *	CompareAndSwapEvent _ANSI_ARGS_((
+			    Tcl_Event *volatile *ptrPtr, Tcl_Event *oldPtr,
+			    Tcl_Event *newPtr));
+static void		DeleteRingEvents _ANSI_ARGS_((EventRing *ringPtr,
+			    Tcl_EventDeleteProc *proc,
+			    ClientData clientData));
+static int		DoEvents _ANSI_ARGS_((int flags, int maxEvents,
+			    Tcl_Time *budgetPtr));
+static void		DrainInbox _ANSI_ARGS_((ThreadSpecificData *tsdPtr));
+static ThreadSpecificData * GetNotifier _ANSI_ARGS_((Tcl_ThreadId threadId,
+			    NotifierSlot **slotPtrPtr));
+static void		RecordQueueLength _ANSI_ARGS_((
+			    ThreadSpecificData *tsdPtr));
+static long		RecordTime _ANSI_ARGS_((ServiceStats *statsPtr,
+			    Tcl_Time *startPtr));
 static void		QueueEvent _ANSI_ARGS_((ThreadSpecificData *tsdPtr,
-			    Tcl_Event* evPtr, Tcl_QueuePosition position));
+			    Tcl_Event* evPtr, Tcl_QueuePosition position,
+			    int type, Tcl_EventKeyProc *keyProc));
+static void		ReleaseNotifier _ANSI_ARGS_((NotifierSlot *slotPtr));
+static void		RingAppend _ANSI_ARGS_((EventRing *ringPtr,
+			    Tcl_Event *evPtr, unsigned long seq,
+			    Tcl_HashEntry *keyPtr));
+static int		RingIndex _ANSI_ARGS_((int type));
+static QueuedEvent *	RingNext _ANSI_ARGS_((EventRing *ringPtr,
+			    int haveSeq, unsigned long seq));
+static void		RingRemove _ANSI_ARGS_((EventRing *ringPtr,
+			    QueuedEvent *queuedPtr));
+static void		RingTrim _ANSI_ARGS_((EventRing *ringPtr));
+static void		ResetStats _ANSI_ARGS_((ThreadSpecificData *tsdPtr));
+static int		ServiceBatch _ANSI_ARGS_((int flags, int maxEvents,
+			    Tcl_Time *budgetPtr));
+static Tcl_Obj *	ServiceStatsObj _ANSI_ARGS_((ServiceStats *statsPtr));
 
 /*
  *----------------------------------------------------------------------
@@ -113,6 +354,9 @@ TclInitNotifier()
 {
     ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
 
+    NotifierSlot *slotPtr;
+    int i, n;
+
     Tcl_MutexLock(&listLock);
 
     tsdPtr->threadId = Tcl_GetCurrentThread();
@@ -120,6 +364,42 @@ TclInitNotifier()
     tsdPtr->nextPtr = firstNotifierPtr;
     firstNotifierPtr = tsdPtr;
 
+    /*
+     * Put the notifier in the first empty slot on its probe sequence,
+     * unless that means using a new slot of an already full table.
+     */
+
+    tsdPtr->slotPtr = NULL;
+    for (i = NOTIFIER_HASH(tsdPtr->threadId), n = 0;
+	    n < NOTIFIER_TABLE_SIZE;
+	    i = (i + 1) & (NOTIFIER_TABLE_SIZE - 1), n++) {
+	slotPtr = &notifierTable[i];
+	if (slotPtr->tsdPtr != NULL) {
+	    continue;
+	}
+	if (!slotPtr->used) {
+	    if (numUsedSlots >= NOTIFIER_TABLE_LIMIT) {
+		break;
+	    }
+	    slotPtr->used = 1;
+	    numUsedSlots++;
+	}
+
+	/*
+	 * The thread id must be seen before the notifier, so that a
+	 * lookup never pairs the notifier with the previous owner's id.
+	 */
+
+	slotPtr->threadId = tsdPtr->threadId;
+	AtomicAdd(&slotPtr->readers, 0);
+	slotPtr->tsdPtr = tsdPtr;
+	tsdPtr->slotPtr = slotPtr;
+	break;
+    }
+    if (tsdPtr->slotPtr == NULL) {
+	numListOnly++;
+    }
+
     Tcl_MutexUnlock(&listLock);
 }
 
@@ -146,11 +426,49 @@ TclFinalizeNotifier()
 {
     ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
     ThreadSpecificData **prevPtrPtr;
+    int i;
+
+    for (i = 0; i < EVENT_RINGS; i++) {
+	if (tsdPtr->rings[i].entries != NULL) {
+	    ckfree((char *) tsdPtr->rings[i].entries);
+	    tsdPtr->rings[i].entries = NULL;
+	}
+	if (tsdPtr->rings[i].keyTablePtr != NULL) {
+	    Tcl_DeleteHashTable(tsdPtr->rings[i].keyTablePtr);
+	    ckfree((char *) tsdPtr->rings[i].keyTablePtr);
+	    tsdPtr->rings[i].keyTablePtr = NULL;
+	}
+	tsdPtr->rings[i].size = 0;
+	tsdPtr->rings[i].first = 0;
+	tsdPtr->rings[i].count = 0;
+	tsdPtr->rings[i].numHoles = 0;
+    }
+    if (tsdPtr->statsPtr != NULL) {
+	ResetStats(tsdPtr);
+	Tcl_DeleteHashTable(&tsdPtr->statsPtr->procTable);
+	ckfree((char *) tsdPtr->statsPtr);
+	tsdPtr->statsPtr = NULL;
+	tsdPtr->statsEnabled = 0;
+    }
 
     Tcl_MutexLock(&listLock);
 
+    /*
+     * Take the notifier out of the table and wait until no other thread
+     * is using it.
+     */
+
+    if (tsdPtr->slotPtr != NULL) {
+	tsdPtr->slotPtr->tsdPtr = NULL;
+	while (AtomicAdd(&tsdPtr->slotPtr->readers, 0) != 0) {
+	    Tcl_Sleep(0);
+	}
+	tsdPtr->slotPtr = NULL;
+    } else {
+	numListOnly--;
+    }
+
     Tcl_FinalizeNotifier(tsdPtr->clientData);
-    Tcl_MutexFinalize(&(tsdPtr->queueMutex));
     for (prevPtrPtr = &firstNotifierPtr; *prevPtrPtr != NULL;
 	 prevPtrPtr = &((*prevPtrPtr)->nextPtr)) {
 	if (*prevPtrPtr == tsdPtr) {
@@ -245,6 +563,8 @@ Tcl_CreateEventSource(setupProc, checkProc, clientData)
     sourcePtr->setupProc = setupProc;
     sourcePtr->checkProc = checkProc;
     sourcePtr->clientData = clientData;
+    memset((VOID *) &sourcePtr->setupStats, 0, sizeof(ServiceStats));
+    memset((VOID *) &sourcePtr->checkStats, 0, sizeof(ServiceStats));
     sourcePtr->nextPtr = tsdPtr->firstEventSourcePtr;
     tsdPtr->firstEventSourcePtr = sourcePtr;
 }
@@ -327,7 +647,120 @@ Tcl_QueueEvent(evPtr, position)
 				 * TCL_QUEUE_MARK. */
 {
     ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
-    QueueEvent(tsdPtr, evPtr, position);
+
+    /*
+     * Events other threads queued before this one go first.
+     */
+
+    DrainInbox(tsdPtr);
+    QueueEvent(tsdPtr, evPtr, position, 0, NULL);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_QueueEventCoalesced --
+ *
+ *	Like Tcl_QueueEvent, except that if an event with the same proc
+ *	and the same key (the result of keyProc) is still waiting at the
+ *	tail of the queue, evPtr takes its place and the waiting event is
+ *	freed.  This keeps the queue short when the same thing happens
+ *	again and again before the event loop gets to it; the event is
+ *	serviced as early as the first one would have been, with the
+ *	contents of the latest.  Events queued at the head or the marker
+ *	are never coalesced.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May free an event queued earlier.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+Tcl_QueueEventCoalesced(evPtr, position, keyProc)
+    Tcl_Event* evPtr;		/* Event to add to queue.  The storage
+				 * space must have been allocated the caller
+				 * with malloc (ckalloc), and it becomes
+				 * the property of the event queue.  It
+				 * will be freed after the event has been
+				 * handled. */
+    Tcl_QueuePosition position;	/* One of TCL_QUEUE_TAIL, TCL_QUEUE_HEAD,
+				 * TCL_QUEUE_MARK. */
+    Tcl_EventKeyProc *keyProc;	/* Procedure that returns the key of an
+				 * event. */
+{
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+
+    DrainInbox(tsdPtr);
+    QueueEvent(tsdPtr, evPtr, position, 0, keyProc);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclCoalescedEventCount --
+ *
+ *	Returns the number of events of the current thread that
+ *	Tcl_QueueEventCoalesced has dropped in favor of later events.
+ *
+ * Results:
+ *	See above.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+unsigned long
+TclCoalescedEventCount()
+{
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+
+    return tsdPtr->numCoalesced;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclQueueTypedEvent --
+ *
+ *	Like Tcl_QueueEvent, but also says what kind of event evPtr is.
+ *	An event queued at the tail as TCL_WINDOW_EVENTS, TCL_FILE_EVENTS
+ *	or TCL_TIMER_EVENTS is only offered to its proc by calls to
+ *	Tcl_ServiceEvent whose flags include that bit, so the proc must
+ *	be one that returns 0 whenever the bit is missing.  Events of
+ *	other kinds (type 0) are offered to their procs by every call.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclQueueTypedEvent(evPtr, position, type)
+    Tcl_Event* evPtr;		/* Event to add to queue.  The storage
+				 * space must have been allocated the caller
+				 * with malloc (ckalloc), and it becomes
+				 * the property of the event queue.  It
+				 * will be freed after the event has been
+				 * handled. */
+    Tcl_QueuePosition position;	/* One of TCL_QUEUE_TAIL, TCL_QUEUE_HEAD,
+				 * TCL_QUEUE_MARK. */
+    int type;			/* TCL_WINDOW_EVENTS, TCL_FILE_EVENTS,
+				 * TCL_TIMER_EVENTS or 0. */
+{
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+
+    DrainInbox(tsdPtr);
+    QueueEvent(tsdPtr, evPtr, position, type, NULL);
 }
 
 /*
@@ -335,7 +768,11 @@ Tcl_QueueEvent(evPtr, position)
  *
  * Tcl_ThreadQueueEvent --
  *
- *	Queue an event on the specified thread's event queue.
+ *	Queue an event on the specified thread's event queue.  The event
+ *	is pushed onto the thread's inbox with an atomic compare and swap,
+ *	so threads posting events to the same thread don't contend for a
+ *	lock; the thread moves it into its queue the next time it looks
+ *	at the queue.
  *
  * Results:
  *	None.
@@ -359,25 +796,287 @@ Tcl_ThreadQueueEvent(threadId, evPtr, position)
 				 * TCL_QUEUE_MARK. */
 {
     ThreadSpecificData *tsdPtr;
+    NotifierSlot *slotPtr;
+    Tcl_Event *oldPtr;
 
     /*
-     * Find the notifier associated with the specified thread.
+     * Find the notifier associated with the specified thread and push
+     * the event onto its inbox.  GetNotifier keeps the notifier from
+     * going away meanwhile.
      */
 
+    tsdPtr = GetNotifier(threadId, &slotPtr);
+    if (tsdPtr) {
+	do {
+	    oldPtr = tsdPtr->inboxPtr;
+	    evPtr->nextPtr = INBOX_LINK(oldPtr, position);
+	} while (CompareAndSwapEvent(&tsdPtr->inboxPtr, oldPtr, evPtr)
+		!= oldPtr);
+	ReleaseNotifier(slotPtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CompareAndSwapEvent --
+ *
+ *	Atomically replaces *ptrPtr with newPtr if it is equal to oldPtr.
+ *
+ * Results:
+ *	The value *ptrPtr had before; the swap happened if it is oldPtr.
+ *
+ * Side effects:
+ *	Acts as a full memory barrier, so the contents of an event
+ *	pushed onto an inbox are visible to the thread that takes it
+ *	off.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_Event *
+CompareAndSwapEvent(ptrPtr, oldPtr, newPtr)
+    Tcl_Event *volatile *ptrPtr;	/* Location to update. */
+    Tcl_Event *oldPtr;			/* Value it must have. */
+    Tcl_Event *newPtr;			/* Value to store. */
+{
+#if defined(ATOMIC_BUILTINS)
+    return __sync_val_compare_and_swap(ptrPtr, oldPtr, newPtr);
+#elif defined(ATOMIC_ASM)
+    Tcl_Event *prevPtr;
+
+    __asm__ __volatile__ ("lock; cmpxchgl %2, %1"
+	    : "=a" (prevPtr), "=m" (*ptrPtr)
+	    : "r" (newPtr), "m" (*ptrPtr), "0" (oldPtr)
+	    : "memory", "cc");
+    return prevPtr;
+#else
+    Tcl_Event *prevPtr;
+
+    Tcl_MutexLock(&atomicLock);
+    prevPtr = *ptrPtr;
+    if (prevPtr == oldPtr) {
+	*ptrPtr = newPtr;
+    }
+    Tcl_MutexUnlock(&atomicLock);
+    return prevPtr;
+#endif
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AtomicAdd --
+ *
+ *	Atomically adds amount to *valuePtr.
+ *
+ * Results:
+ *	The new value of *valuePtr.
+ *
+ * Side effects:
+ *	Acts as a full memory barrier, also when amount is 0.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+AtomicAdd(valuePtr, amount)
+    volatile int *valuePtr;		/* Location to update. */
+    int amount;				/* Value to add. */
+{
+#if defined(ATOMIC_BUILTINS)
+    return __sync_add_and_fetch(valuePtr, amount);
+#elif defined(ATOMIC_ASM)
+    int oldValue;
+
+    __asm__ __volatile__ ("lock; xaddl %0, %1"
+	    : "=r" (oldValue), "=m" (*valuePtr)
+	    : "0" (amount), "m" (*valuePtr)
+	    : "memory", "cc");
+    return oldValue + amount;
+#else
+    int newValue;
+
+    Tcl_MutexLock(&atomicLock);
+    newValue = *valuePtr += amount;
+    Tcl_MutexUnlock(&atomicLock);
+    return newValue;
+#endif
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetNotifier --
+ *
+ *	Finds the notifier of a thread, for Tcl_ThreadQueueEvent and
+ *	Tcl_ThreadAlert.  Usually the notifier is found in notifierTable
+ *	without taking any lock.
+ *
+ * Results:
+ *	The notifier, or NULL if the thread has none.  If a notifier is
+ *	returned, *slotPtrPtr is set to its slot in notifierTable, or to
+ *	NULL if the notifier was found with listLock held instead.
+ *
+ * Side effects:
+ *	The notifier can't be finalized until the caller passes
+ *	*slotPtrPtr to ReleaseNotifier.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ThreadSpecificData *
+GetNotifier(threadId, slotPtrPtr)
+    Tcl_ThreadId threadId;		/* Thread whose notifier is wanted. */
+    NotifierSlot **slotPtrPtr;		/* Filled with the slot to pass to
+					 * ReleaseNotifier. */
+{
+    ThreadSpecificData *tsdPtr;
+    NotifierSlot *slotPtr;
+    int i, n;
+
+#ifdef ATOMIC_LOCK
     Tcl_MutexLock(&listLock);
-    for (tsdPtr = firstNotifierPtr; tsdPtr && tsdPtr->threadId != threadId;
-	     tsdPtr = tsdPtr->nextPtr) {
-	/* Empty loop body. */
+#endif
+    for (i = NOTIFIER_HASH(threadId), n = 0; n < NOTIFIER_TABLE_SIZE;
+	    i = (i + 1) & (NOTIFIER_TABLE_SIZE - 1), n++) {
+	slotPtr = &notifierTable[i];
+	if (!slotPtr->used) {
+	    break;
+	}
+	if ((slotPtr->threadId != threadId) || (slotPtr->tsdPtr == NULL)) {
+	    continue;
+	}
+#ifdef ATOMIC_LOCK
+	*slotPtrPtr = NULL;
+	return slotPtr->tsdPtr;
+#else
+	/*
+	 * Announce ourselves, then check that the slot still holds the
+	 * notifier: if it does, TclFinalizeNotifier will wait for us.
+	 */
+
+	AtomicAdd(&slotPtr->readers, 1);
+	tsdPtr = slotPtr->tsdPtr;
+	if ((tsdPtr != NULL) && (slotPtr->threadId == threadId)) {
+	    *slotPtrPtr = slotPtr;
+	    return tsdPtr;
+	}
+	AtomicAdd(&slotPtr->readers, -1);
+#endif
     }
 
     /*
-     * Queue the event if there was a notifier associated with the thread.
+     * Not in the table; look in the list if there are notifiers that
+     * are only there.
      */
 
-    if (tsdPtr) {
-	QueueEvent(tsdPtr, evPtr, position);
+#ifndef ATOMIC_LOCK
+    if (numListOnly == 0) {
+	return NULL;
+    }
+    Tcl_MutexLock(&listLock);
+#endif
+    for (tsdPtr = firstNotifierPtr; tsdPtr != NULL;
+	    tsdPtr = tsdPtr->nextPtr) {
+	if ((tsdPtr->threadId == threadId) && (tsdPtr->slotPtr == NULL)) {
+	    *slotPtrPtr = NULL;
+	    return tsdPtr;
+	}
     }
     Tcl_MutexUnlock(&listLock);
+    return NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ReleaseNotifier --
+ *
+ *	Lets go of a notifier found with GetNotifier.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The notifier may be finalized.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ReleaseNotifier(slotPtr)
+    NotifierSlot *slotPtr;		/* Value stored by GetNotifier. */
+{
+    if (slotPtr == NULL) {
+	Tcl_MutexUnlock(&listLock);
+    } else {
+	AtomicAdd(&slotPtr->readers, -1);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DrainInbox --
+ *
+ *	Moves the events other threads have pushed onto the inbox of
+ *	the current thread's notifier into its event queue, in the order
+ *	they were pushed and at the positions they were queued for.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The inbox is emptied.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+DrainInbox(tsdPtr)
+    ThreadSpecificData *tsdPtr;	/* Notifier of the current thread. */
+{
+    Tcl_Event *evPtr, *nextPtr, *orderedPtr;
+    Tcl_QueuePosition position;
+
+    evPtr = tsdPtr->inboxPtr;
+    if (evPtr == NULL) {
+	return;
+    }
+
+    /*
+     * Take the whole inbox at once.  Since nothing else ever takes
+     * events off an inbox, there is no ABA problem here.
+     */
+
+    while (1) {
+	nextPtr = CompareAndSwapEvent(&tsdPtr->inboxPtr, evPtr, NULL);
+	if (nextPtr == evPtr) {
+	    break;
+	}
+	evPtr = nextPtr;
+    }
+
+    /*
+     * Reverse the list into the order the events were pushed in,
+     * keeping the position of each event in its link.
+     */
+
+    orderedPtr = NULL;
+    while (evPtr != NULL) {
+	nextPtr = INBOX_NEXT(evPtr);
+	evPtr->nextPtr = INBOX_LINK(orderedPtr, INBOX_POSITION(evPtr));
+	orderedPtr = evPtr;
+	evPtr = nextPtr;
+    }
+
+    while (orderedPtr != NULL) {
+	evPtr = orderedPtr;
+	orderedPtr = INBOX_NEXT(evPtr);
+	position = INBOX_POSITION(evPtr);
+	QueueEvent(tsdPtr, evPtr, position, 0, NULL);
+    }
 }
 
 /*
@@ -402,7 +1101,7 @@ Tcl_ThreadQueueEvent(threadId, evPtr, position)
  */
 
 static void
-QueueEvent(tsdPtr, evPtr, position)
+QueueEvent(tsdPtr, evPtr, position, type, keyProc)
     ThreadSpecificData *tsdPtr;	/* Handle to thread local data that indicates
 				 * which event queue to use. */
     Tcl_Event* evPtr;		/* Event to add to queue.  The storage
@@ -413,29 +1112,66 @@ QueueEvent(tsdPtr, evPtr, position)
 				 * handled. */
     Tcl_QueuePosition position;	/* One of TCL_QUEUE_TAIL, TCL_QUEUE_HEAD,
 				 * TCL_QUEUE_MARK. */
+    int type;			/* Kind of event, as for TclQueueTypedEvent. */
+    Tcl_EventKeyProc *keyProc;	/* If not NULL, coalesce the event as
+				 * described for Tcl_QueueEventCoalesced. */
 {
-    Tcl_MutexLock(&(tsdPtr->queueMutex));
+    EventRing *ringPtr;
+    Tcl_HashEntry *keyPtr;
+    QueuedEvent *queuedPtr;
+    Tcl_Event *pendingPtr;
+    CoalesceKey key;
+    unsigned long seq;
+    int isNew;
+
     if (position == TCL_QUEUE_TAIL) {
+	ringPtr = &tsdPtr->rings[RingIndex(type)];
+	keyPtr = NULL;
+	if (keyProc != NULL) {
+	    if (ringPtr->keyTablePtr == NULL) {
+		ringPtr->keyTablePtr = (Tcl_HashTable *)
+			ckalloc(sizeof(Tcl_HashTable));
+		Tcl_InitHashTable(ringPtr->keyTablePtr,
+			sizeof(CoalesceKey) / sizeof(int));
+	    }
+	    memset((VOID *) &key, 0, sizeof(key));
+	    key.proc = evPtr->proc;
+	    key.key = (*keyProc)(evPtr);
+	    keyPtr = Tcl_CreateHashEntry(ringPtr->keyTablePtr, (char *) &key,
+		    &isNew);
+	    if (!isNew) {
+		/*
+		 * Replace the waiting event, unless it is being serviced
+		 * right now: then it is left alone and later events are
+		 * coalesced with this one instead.
+		 */
+
+		seq = (unsigned long) Tcl_GetHashValue(keyPtr);
+		queuedPtr = RingNext(ringPtr, 1, seq - 1);
+		pendingPtr = queuedPtr->evPtr;
+		if (pendingPtr->proc != NULL) {
+		    queuedPtr->evPtr = evPtr;
+		    ckfree((char *) pendingPtr);
+		    tsdPtr->numCoalesced++;
+		    return;
+		}
+		queuedPtr->keyPtr = NULL;
+	    }
+	    Tcl_SetHashValue(keyPtr, (ClientData) tsdPtr->nextSeq);
+	}
+
 	/*
-	 * Append the event on the end of the queue.
+	 * Append the event on the end of the ring for its kind.
 	 */
 
-	evPtr->nextPtr = NULL;
-	if (tsdPtr->firstEventPtr == NULL) {
-	    tsdPtr->firstEventPtr = evPtr;
-	} else {
-	    tsdPtr->lastEventPtr->nextPtr = evPtr;
-	}
-	tsdPtr->lastEventPtr = evPtr;
+	RingAppend(ringPtr, evPtr, tsdPtr->nextSeq, keyPtr);
+	tsdPtr->nextSeq++;
     } else if (position == TCL_QUEUE_HEAD) {
 	/*
 	 * Push the event on the head of the queue.
 	 */
 
 	evPtr->nextPtr = tsdPtr->firstEventPtr;
-	if (tsdPtr->firstEventPtr == NULL) {
-	    tsdPtr->lastEventPtr = evPtr;
-	}	    
 	tsdPtr->firstEventPtr = evPtr;
     } else if (position == TCL_QUEUE_MARK) {
 	/*
@@ -451,13 +1187,9 @@ QueueEvent(tsdPtr, evPtr, position)
 	    tsdPtr->markerEventPtr->nextPtr = evPtr;
 	}
 	tsdPtr->markerEventPtr = evPtr;
-	if (evPtr->nextPtr == NULL) {
-	    tsdPtr->lastEventPtr = evPtr;
-	}
     }
-    Tcl_MutexUnlock(&(tsdPtr->queueMutex));
 }
-
+
 /*
  *----------------------------------------------------------------------
  *
@@ -484,23 +1216,21 @@ Tcl_DeleteEvents(proc, clientData)
 {
     Tcl_Event *evPtr, *prevPtr, *hold;
     ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+    int i;
 
-    Tcl_MutexLock(&(tsdPtr->queueMutex));
+    DrainInbox(tsdPtr);
     for (prevPtr = (Tcl_Event *) NULL, evPtr = tsdPtr->firstEventPtr;
              evPtr != (Tcl_Event *) NULL;
              ) {
         if ((*proc) (evPtr, clientData) == 1) {
             if (tsdPtr->firstEventPtr == evPtr) {
                 tsdPtr->firstEventPtr = evPtr->nextPtr;
-                if (evPtr->nextPtr == (Tcl_Event *) NULL) {
-                    tsdPtr->lastEventPtr = prevPtr;
-                }
-		if (tsdPtr->markerEventPtr == evPtr) {
-		    tsdPtr->markerEventPtr = prevPtr;
-		}
             } else {
                 prevPtr->nextPtr = evPtr->nextPtr;
             }
+	    if (tsdPtr->markerEventPtr == evPtr) {
+		tsdPtr->markerEventPtr = prevPtr;
+	    }
             hold = evPtr;
             evPtr = evPtr->nextPtr;
             ckfree((char *) hold);
@@ -509,9 +1239,44 @@ Tcl_DeleteEvents(proc, clientData)
             evPtr = evPtr->nextPtr;
         }
     }
-    Tcl_MutexUnlock(&(tsdPtr->queueMutex));
+    for (i = 0; i < EVENT_RINGS; i++) {
+	DeleteRingEvents(&tsdPtr->rings[i], proc, clientData);
+    }
 }
-
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclDeleteTypedEvents --
+ *
+ *	Like Tcl_DeleteEvents, but only looks at the events that were
+ *	queued at the tail of the queue by TclQueueTypedEvent with the
+ *	given type, so the other events in the queue cost nothing.  If
+ *	proc is NULL, all of those events are deleted.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Potentially removes one or more events from the event queue.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclDeleteTypedEvents(type, proc, clientData)
+    int type;				/* TCL_WINDOW_EVENTS,
+					 * TCL_FILE_EVENTS, TCL_TIMER_EVENTS
+					 * or 0. */
+    Tcl_EventDeleteProc *proc;		/* The procedure to call, or NULL. */
+    ClientData clientData;    		/* type-specific data. */
+{
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+
+    DrainInbox(tsdPtr);
+    DeleteRingEvents(&tsdPtr->rings[RingIndex(type)], proc, clientData);
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -544,7 +1309,10 @@ Tcl_ServiceEvent(flags)
 {
     Tcl_Event *evPtr, *prevPtr;
     Tcl_EventProc *proc;
-    int result;
+    int result, i, haveSeq;
+    unsigned long seq;
+    EventRing *ringPtr, *bestRingPtr;
+    QueuedEvent *queuedPtr, *bestPtr;
     ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
 
     /*
@@ -567,11 +1335,14 @@ Tcl_ServiceEvent(flags)
     }
 
     /*
-     * Loop through all the events in the queue until we find one
+     * Loop through all the high-priority events until we find one
      * that can actually be handled.
      */
 
-    Tcl_MutexLock(&(tsdPtr->queueMutex));
+    DrainInbox(tsdPtr);
+    if (tsdPtr->statsEnabled) {
+	RecordQueueLength(tsdPtr);
+    }
     for (evPtr = tsdPtr->firstEventPtr; evPtr != NULL;
 	 evPtr = evPtr->nextPtr) {
 	/*
@@ -597,15 +1368,11 @@ Tcl_ServiceEvent(flags)
 	evPtr->proc = NULL;
 
 	/*
-	 * Release the lock before calling the event procedure.  This
-	 * allows other threads to post events if we enter a recursive
-	 * event loop in this thread.  Note that we are making the assumption
-	 * that if the proc returns 0, the event is still in the list.
+	 * Note that we are making the assumption that if the proc
+	 * returns 0, the event is still in the list.
 	 */
 
-	Tcl_MutexUnlock(&(tsdPtr->queueMutex));
-	result = (*proc)(evPtr, flags);
-	Tcl_MutexLock(&(tsdPtr->queueMutex));
+	result = CallEventProc(tsdPtr, proc, evPtr, flags);
 
 	if (result) {
 	    /*
@@ -614,9 +1381,6 @@ Tcl_ServiceEvent(flags)
 
 	    if (tsdPtr->firstEventPtr == evPtr) {
 		tsdPtr->firstEventPtr = evPtr->nextPtr;
-		if (evPtr->nextPtr == NULL) {
-		    tsdPtr->lastEventPtr = NULL;
-		}
 		if (tsdPtr->markerEventPtr == evPtr) {
 		    tsdPtr->markerEventPtr = NULL;
 		}
@@ -628,9 +1392,6 @@ Tcl_ServiceEvent(flags)
 		}
 		if (prevPtr) {
 		    prevPtr->nextPtr = evPtr->nextPtr;
-		    if (evPtr->nextPtr == NULL) {
-			tsdPtr->lastEventPtr = prevPtr;
-		    }
 		    if (tsdPtr->markerEventPtr == evPtr) {
 			tsdPtr->markerEventPtr = prevPtr;
 		    }
@@ -641,7 +1402,6 @@ Tcl_ServiceEvent(flags)
 	    if (evPtr) {
 		ckfree((char *) evPtr);
 	    }
-	    Tcl_MutexUnlock(&(tsdPtr->queueMutex));
 	    return 1;
 	} else {
 	    /*
@@ -649,13 +1409,326 @@ Tcl_ServiceEvent(flags)
 	     * the proc field to allow the event to be attempted again.
 	     */
 
-	    evPtr->proc = proc;
+	    evPtr->proc = proc;
+	}
+    }
+
+    /*
+     * Then go through the events queued at the tail, oldest first,
+     * looking only at the rings of the kinds of events asked for.  The
+     * same tricks as above apply, except that the place of each event
+     * is found again from its sequence number, which is quick.
+     */
+
+    haveSeq = 0;
+    seq = 0;
+    while (1) {
+	bestPtr = NULL;
+	bestRingPtr = NULL;
+	for (i = 0; i < EVENT_RINGS; i++) {
+	    if ((ringTypes[i] != 0) && !(flags & ringTypes[i])) {
+		continue;
+	    }
+	    ringPtr = &tsdPtr->rings[i];
+	    queuedPtr = RingNext(ringPtr, haveSeq, seq);
+	    if ((queuedPtr != NULL) && ((bestPtr == NULL)
+		    || SEQ_BEFORE(queuedPtr->seq, bestPtr->seq))) {
+		bestPtr = queuedPtr;
+		bestRingPtr = ringPtr;
+	    }
+	}
+	if (bestPtr == NULL) {
+	    return 0;
+	}
+	evPtr = bestPtr->evPtr;
+	seq = bestPtr->seq;
+	haveSeq = 1;
+
+	proc = evPtr->proc;
+	if (proc == NULL) {
+	    continue;
+	}
+	evPtr->proc = NULL;
+
+	result = CallEventProc(tsdPtr, proc, evPtr, flags);
+
+	if (result) {
+	    queuedPtr = RingNext(bestRingPtr, 1, seq - 1);
+	    if ((queuedPtr != NULL) && (queuedPtr->seq == seq)
+		    && (queuedPtr->evPtr == evPtr)) {
+		RingRemove(bestRingPtr, queuedPtr);
+		RingTrim(bestRingPtr);
+		ckfree((char *) evPtr);
+	    }
+	    return 1;
+	}
+	evPtr->proc = proc;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RingIndex --
+ *
+ *	Maps the type of an event to the ring that holds events of
+ *	that type.
+ *
+ * Results:
+ *	An index in the rings field of ThreadSpecificData.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+RingIndex(type)
+    int type;			/* TCL_WINDOW_EVENTS, TCL_FILE_EVENTS,
+				 * TCL_TIMER_EVENTS or anything else. */
+{
+    switch (type) {
+	case TCL_WINDOW_EVENTS:
+	    return EVENT_RING_WINDOW;
+	case TCL_FILE_EVENTS:
+	    return EVENT_RING_FILE;
+	case TCL_TIMER_EVENTS:
+	    return EVENT_RING_TIMER;
+	default:
+	    return EVENT_RING_OTHER;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RingAppend --
+ *
+ *	Adds an event to the end of a ring.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The ring's storage is doubled if it is full.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+RingAppend(ringPtr, evPtr, seq, keyPtr)
+    EventRing *ringPtr;		/* Ring to add to. */
+    Tcl_Event *evPtr;		/* Event to add. */
+    unsigned long seq;		/* Sequence number of the event; larger
+				 * than that of any event in the ring. */
+    Tcl_HashEntry *keyPtr;	/* Entry for the event in the ring's
+				 * keyTable, or NULL. */
+{
+    QueuedEvent *newPtr;
+    int i, newSize;
+
+    if (ringPtr->count == ringPtr->size) {
+	newSize = (ringPtr->size == 0) ? 16 : 2 * ringPtr->size;
+	newPtr = (QueuedEvent *)
+		ckalloc((unsigned) (newSize * sizeof(QueuedEvent)));
+	for (i = 0; i < ringPtr->count; i++) {
+	    newPtr[i] = ringPtr->entries[(ringPtr->first + i)
+		    & (ringPtr->size - 1)];
+	}
+	if (ringPtr->entries != NULL) {
+	    ckfree((char *) ringPtr->entries);
+	}
+	ringPtr->entries = newPtr;
+	ringPtr->size = newSize;
+	ringPtr->first = 0;
+    }
+    newPtr = &ringPtr->entries[(ringPtr->first + ringPtr->count)
+	    & (ringPtr->size - 1)];
+    newPtr->evPtr = evPtr;
+    newPtr->seq = seq;
+    newPtr->keyPtr = keyPtr;
+    ringPtr->count++;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RingRemove --
+ *
+ *	Takes an event out of a ring, leaving a hole.  The caller frees
+ *	the event, and should call RingTrim once it is done removing.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Events can no longer be coalesced with the removed one.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+RingRemove(ringPtr, queuedPtr)
+    EventRing *ringPtr;		/* Ring holding the event. */
+    QueuedEvent *queuedPtr;	/* Entry of the event. */
+{
+    if (queuedPtr->keyPtr != NULL) {
+	Tcl_DeleteHashEntry(queuedPtr->keyPtr);
+	queuedPtr->keyPtr = NULL;
+    }
+    queuedPtr->evPtr = NULL;
+    ringPtr->numHoles++;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RingNext --
+ *
+ *	Finds the oldest event in a ring that was queued after the
+ *	event with the given sequence number.  Since the sequence numbers
+ *	in a ring only grow, this is a binary search, and usually the
+ *	first entry is the one.
+ *
+ * Results:
+ *	The entry of the event, or NULL if there is none.  The entry is
+ *	only valid until the ring is next changed.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static QueuedEvent *
+RingNext(ringPtr, haveSeq, seq)
+    EventRing *ringPtr;		/* Ring to look in. */
+    int haveSeq;		/* If 0, seq is ignored and the oldest event
+				 * in the ring is found. */
+    unsigned long seq;		/* Sequence number the event must follow. */
+{
+    QueuedEvent *queuedPtr;
+    int low, high, mid, mask;
+
+    if (ringPtr->count == 0) {
+	return NULL;
+    }
+    mask = ringPtr->size - 1;
+    low = 0;
+    if (haveSeq && !SEQ_BEFORE(seq, ringPtr->entries[ringPtr->first].seq)) {
+	high = ringPtr->count;
+	while (low < high) {
+	    mid = (low + high) / 2;
+	    if (SEQ_BEFORE(seq,
+		    ringPtr->entries[(ringPtr->first + mid) & mask].seq)) {
+		high = mid;
+	    } else {
+		low = mid + 1;
+	    }
+	}
+    }
+    for ( ; low < ringPtr->count; low++) {
+	queuedPtr = &ringPtr->entries[(ringPtr->first + low) & mask];
+	if (queuedPtr->evPtr != NULL) {
+	    return queuedPtr;
+	}
+    }
+    return NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RingTrim --
+ *
+ *	Drops the holes at the front of a ring, and all of its holes
+ *	if they make up more than half of it.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Entries of the ring may move.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+RingTrim(ringPtr)
+    EventRing *ringPtr;		/* Ring to trim. */
+{
+    QueuedEvent *queuedPtr;
+    int i, j, mask;
+
+    mask = ringPtr->size - 1;
+    while ((ringPtr->count > 0)
+	    && (ringPtr->entries[ringPtr->first].evPtr == NULL)) {
+	ringPtr->first = (ringPtr->first + 1) & mask;
+	ringPtr->count--;
+	ringPtr->numHoles--;
+    }
+    if ((ringPtr->numHoles > 0) && (2 * ringPtr->numHoles > ringPtr->count)) {
+	for (i = 0, j = 0; i < ringPtr->count; i++) {
+	    queuedPtr = &ringPtr->entries[(ringPtr->first + i) & mask];
+	    if (queuedPtr->evPtr != NULL) {
+		ringPtr->entries[(ringPtr->first + j) & mask] = *queuedPtr;
+		j++;
+	    }
+	}
+	ringPtr->count = j;
+	ringPtr->numHoles = 0;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DeleteRingEvents --
+ *
+ *	Does the work of Tcl_DeleteEvents for the events in one ring.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Potentially removes one or more events from the ring.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+DeleteRingEvents(ringPtr, proc, clientData)
+    EventRing *ringPtr;			/* Ring to look at. */
+    Tcl_EventDeleteProc *proc;		/* The procedure to call, or NULL
+					 * to delete every event. */
+    ClientData clientData;    		/* type-specific data. */
+{
+    QueuedEvent *queuedPtr;
+    Tcl_Event *evPtr;
+    int i;
+
+    /*
+     * The ring is found again after each call of proc, in case it
+     * queued more events.
+     */
+
+    for (i = 0; i < ringPtr->count; i++) {
+	queuedPtr = &ringPtr->entries[(ringPtr->first + i)
+		& (ringPtr->size - 1)];
+	evPtr = queuedPtr->evPtr;
+	if (evPtr == NULL) {
+	    continue;
+	}
+	if ((proc == NULL) || ((*proc) (evPtr, clientData) == 1)) {
+	    RingRemove(ringPtr, &ringPtr->entries[(ringPtr->first + i)
+		    & (ringPtr->size - 1)]);
+	    ckfree((char *) evPtr);
 	}
     }
-    Tcl_MutexUnlock(&(tsdPtr->queueMutex));
-    return 0;
+    RingTrim(ringPtr);
 }
-
+
 /*
  *----------------------------------------------------------------------
  *
@@ -764,7 +1837,8 @@ Tcl_SetMaxBlockTime(timePtr)
  * Tcl_DoOneEvent --
  *
  *	Process a single event of some sort.  If there's no work to
- *	do, wait for an event to occur, then process it.
+ *	do, wait for an event to occur, then process it.  Callers that
+ *	want to service several queued events at once use Tcl_DoEvents.
  *
  * Results:
  *	The return value is 1 if the procedure actually found an event
@@ -789,9 +1863,130 @@ Tcl_DoOneEvent(flags)
 				 * TCL_TIMER_EVENTS, TCL_IDLE_EVENTS, or
 				 * others defined by event sources. */
 {
-    int result = 0, oldMode;
+    return (DoEvents(flags, 1, NULL) != 0);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_DoEvents --
+ *
+ *	Like Tcl_DoOneEvent, except that once it has found queued events
+ *	it keeps servicing them, without polling the event sources, until
+ *	maxEvents have been serviced, the time given by timePtr has
+ *	elapsed since the first of them was serviced, or the queue holds
+ *	nothing that flags allows.  Time spent waiting for the first
+ *	event doesn't count against timePtr.  This
+ *	saves the cost of the setup and check procs of every event
+ *	source for all but the first event when many are queued.
+ *
+ * Results:
+ *	The number of events, idle handlers or system events that were
+ *	processed; 0 in the same cases in which Tcl_DoOneEvent returns 0.
+ *
+ * Side effects:
+ *	Same as Tcl_DoOneEvent.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+Tcl_DoEvents(flags, maxEvents, timePtr)
+    int flags;			/* Same as for Tcl_DoOneEvent. */
+    int maxEvents;		/* Largest number of queued events to
+				 * service, or 0 for no limit. */
+    Tcl_Time *timePtr;		/* Stop servicing queued events this long
+				 * after the first of them was serviced.
+				 * NULL means no time limit. */
+{
+    if (maxEvents <= 0) {
+	maxEvents = INT_MAX;
+    }
+    return DoEvents(flags, maxEvents, timePtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ServiceBatch --
+ *
+ *	Services queued events by calling Tcl_ServiceEvent until it finds
+ *	nothing to do, maxEvents events have been serviced or the time
+ *	*budgetPtr has elapsed since the first event was serviced.  The
+ *	first event is always serviced.
+ *
+ * Results:
+ *	The number of events serviced.
+ *
+ * Side effects:
+ *	Whatever the handlers of the events do.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ServiceBatch(flags, maxEvents, budgetPtr)
+    int flags;			/* Flags to pass to Tcl_ServiceEvent. */
+    int maxEvents;		/* Largest number of events to service. */
+    Tcl_Time *budgetPtr;	/* Time budget, or NULL. */
+{
+    Tcl_Time now, end;
+    int count = 0;
+
+    while (Tcl_ServiceEvent(flags)) {
+	count++;
+	if (count >= maxEvents) {
+	    break;
+	}
+	if (budgetPtr == NULL) {
+	    continue;
+	}
+	TclpGetTime(&now);
+	if (count == 1) {
+	    end.sec = now.sec + budgetPtr->sec;
+	    end.usec = now.usec + budgetPtr->usec;
+	    if (end.usec >= 1000000) {
+		end.usec -= 1000000;
+		end.sec += 1;
+	    }
+	}
+	if ((now.sec > end.sec) || ((now.sec == end.sec)
+		&& (now.usec >= end.usec))) {
+	    break;
+	}
+    }
+    return count;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DoEvents --
+ *
+ *	Does the work of Tcl_DoOneEvent and Tcl_DoEvents: processes
+ *	one event of some sort, waiting for one if there's no work to
+ *	do, and then any more queued events ServiceBatch allows.
+ *
+ * Results:
+ *	The number of events processed, as for Tcl_DoEvents.
+ *
+ * Side effects:
+ *	See Tcl_DoOneEvent.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+DoEvents(flags, maxEvents, budgetPtr)
+    int flags;			/* Same as for Tcl_DoOneEvent. */
+    int maxEvents;		/* Largest number of queued events to
+				 * service; at least 1. */
+    Tcl_Time *budgetPtr;	/* Time budget for servicing queued events,
+				 * or NULL. */
+{
+    int result = 0, oldMode, timing, count;
     EventSource *sourcePtr;
-    Tcl_Time *timePtr;
+    Tcl_Time *timePtr, start;
     ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
 
     /*
@@ -843,8 +2038,8 @@ Tcl_DoOneEvent(flags)
 	 * Ask Tcl to service a queued event, if there are any.
 	 */
 
-	if (Tcl_ServiceEvent(flags)) {
-	    result = 1;	    
+	result = ServiceBatch(flags, maxEvents, budgetPtr);
+	if (result) {
 	    break;
 	}
 
@@ -870,7 +2065,14 @@ Tcl_DoOneEvent(flags)
 	for (sourcePtr = tsdPtr->firstEventSourcePtr; sourcePtr != NULL;
 	     sourcePtr = sourcePtr->nextPtr) {
 	    if (sourcePtr->setupProc) {
+		timing = tsdPtr->statsEnabled;
+		if (timing) {
+		    TclpGetTime(&start);
+		}
 		(sourcePtr->setupProc)(sourcePtr->clientData, flags);
+		if (timing) {
+		    RecordTime(&sourcePtr->setupStats, &start);
+		}
 	    }
 	}
 	tsdPtr->inTraversal = 0;
@@ -886,7 +2088,14 @@ Tcl_DoOneEvent(flags)
 	 * returns -1, we should abort Tcl_DoOneEvent.
 	 */
 
+	timing = tsdPtr->statsEnabled;
+	if (timing) {
+	    TclpGetTime(&start);
+	}
 	result = Tcl_WaitForEvent(timePtr);
+	if (timing) {
+	    RecordTime(&tsdPtr->statsPtr->wait, &start);
+	}
 	if (result < 0) {
 	    result = 0;
 	    break;
@@ -899,7 +2108,14 @@ Tcl_DoOneEvent(flags)
 	for (sourcePtr = tsdPtr->firstEventSourcePtr; sourcePtr != NULL;
 	     sourcePtr = sourcePtr->nextPtr) {
 	    if (sourcePtr->checkProc) {
+		timing = tsdPtr->statsEnabled;
+		if (timing) {
+		    TclpGetTime(&start);
+		}
 		(sourcePtr->checkProc)(sourcePtr->clientData, flags);
+		if (timing) {
+		    RecordTime(&sourcePtr->checkStats, &start);
+		}
 	    }
 	}
 
@@ -907,8 +2123,9 @@ Tcl_DoOneEvent(flags)
 	 * Check for events queued by the notifier or event sources.
 	 */
 
-	if (Tcl_ServiceEvent(flags)) {
-	    result = 1;
+	count = ServiceBatch(flags, maxEvents, budgetPtr);
+	if (count) {
+	    result = count;
 	    break;
 	}
 
@@ -920,7 +2137,14 @@ Tcl_DoOneEvent(flags)
 
 	idleEvents:
 	if (flags & TCL_IDLE_EVENTS) {
+	    timing = tsdPtr->statsEnabled;
+	    if (timing) {
+		TclpGetTime(&start);
+	    }
 	    if (TclServiceIdle()) {
+		if (timing) {
+		    RecordTime(&tsdPtr->statsPtr->idle, &start);
+		}
 		result = 1;
 		break;
 	    }
@@ -977,8 +2201,9 @@ Tcl_DoOneEvent(flags)
 int
 Tcl_ServiceAll()
 {
-    int result = 0;
+    int result = 0, timing;
     EventSource *sourcePtr;
+    Tcl_Time start;
     ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
 
     if (tsdPtr->serviceMode == TCL_SERVICE_NONE) {
@@ -1012,20 +2237,41 @@ Tcl_ServiceAll()
     for (sourcePtr = tsdPtr->firstEventSourcePtr; sourcePtr != NULL;
 	 sourcePtr = sourcePtr->nextPtr) {
 	if (sourcePtr->setupProc) {
+	    timing = tsdPtr->statsEnabled;
+	    if (timing) {
+		TclpGetTime(&start);
+	    }
 	    (sourcePtr->setupProc)(sourcePtr->clientData, TCL_ALL_EVENTS);
+	    if (timing) {
+		RecordTime(&sourcePtr->setupStats, &start);
+	    }
 	}
     }
     for (sourcePtr = tsdPtr->firstEventSourcePtr; sourcePtr != NULL;
 	 sourcePtr = sourcePtr->nextPtr) {
 	if (sourcePtr->checkProc) {
+	    timing = tsdPtr->statsEnabled;
+	    if (timing) {
+		TclpGetTime(&start);
+	    }
 	    (sourcePtr->checkProc)(sourcePtr->clientData, TCL_ALL_EVENTS);
+	    if (timing) {
+		RecordTime(&sourcePtr->checkStats, &start);
+	    }
 	}
     }
 
     while (Tcl_ServiceEvent(0)) {
 	result = 1;
     }
+    timing = tsdPtr->statsEnabled;
+    if (timing) {
+	TclpGetTime(&start);
+    }
     if (TclServiceIdle()) {
+	if (timing) {
+	    RecordTime(&tsdPtr->statsPtr->idle, &start);
+	}
 	result = 1;
     }
 
@@ -1061,20 +2307,467 @@ Tcl_ThreadAlert(threadId)
     Tcl_ThreadId threadId;	/* Identifier for thread to use. */
 {
     ThreadSpecificData *tsdPtr;
+    NotifierSlot *slotPtr;
 
     /*
      * Find the notifier associated with the specified thread.
-     * Note that we need to hold the listLock while calling
+     * Note that we need to hold on to the notifier while calling
      * Tcl_AlertNotifier to avoid a race condition where
      * the specified thread might destroy its notifier.
      */
 
-    Tcl_MutexLock(&listLock);
-    for (tsdPtr = firstNotifierPtr; tsdPtr; tsdPtr = tsdPtr->nextPtr) {
-	if (tsdPtr->threadId == threadId) {
-	    Tcl_AlertNotifier(tsdPtr->clientData);
+    tsdPtr = GetNotifier(threadId, &slotPtr);
+    if (tsdPtr) {
+	Tcl_AlertNotifier(tsdPtr->clientData);
+	ReleaseNotifier(slotPtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RecordTime --
+ *
+ *	Adds the time elapsed since *startPtr to a ServiceStats.
+ *
+ * Results:
+ *	The elapsed time in microseconds.
+ *
+ * Side effects:
+ *	Updates *statsPtr.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static long
+RecordTime(statsPtr, startPtr)
+    ServiceStats *statsPtr;	/* Statistics to update. */
+    Tcl_Time *startPtr;		/* When the timed call started. */
+{
+    Tcl_Time now;
+    long usec;
+
+    TclpGetTime(&now);
+    usec = (now.sec - startPtr->sec) * 1000000
+	    + (now.usec - startPtr->usec);
+    if (usec < 0) {
+	usec = 0;
+    }
+    statsPtr->count++;
+    statsPtr->total += usec;
+    if (usec > statsPtr->max) {
+	statsPtr->max = usec;
+    }
+    return usec;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CallEventProc --
+ *
+ *	Invokes the proc of a queued event and, when statistics are
+ *	enabled, records how long it took if it handled the event.
+ *
+ * Results:
+ *	The value returned by proc.
+ *
+ * Side effects:
+ *	Whatever proc does.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+CallEventProc(tsdPtr, proc, evPtr, flags)
+    ThreadSpecificData *tsdPtr;	/* Notifier servicing the event. */
+    Tcl_EventProc *proc;	/* Proc of the event. */
+    Tcl_Event *evPtr;		/* Event to pass to proc. */
+    int flags;			/* Flags to pass to proc. */
+{
+    Tcl_Time start;
+    Tcl_HashEntry *hPtr;
+    ServiceStats *procStatsPtr, *eventStatsPtr;
+    long usec;
+    int result, new;
+
+    if (!tsdPtr->statsEnabled) {
+	return (*proc)(evPtr, flags);
+    }
+    TclpGetTime(&start);
+    result = (*proc)(evPtr, flags);
+    if (result) {
+	hPtr = Tcl_CreateHashEntry(&tsdPtr->statsPtr->procTable,
+		(char *) proc, &new);
+	if (new) {
+	    procStatsPtr = (ServiceStats *) ckalloc(sizeof(ServiceStats));
+	    memset((VOID *) procStatsPtr, 0, sizeof(ServiceStats));
+	    Tcl_SetHashValue(hPtr, procStatsPtr);
+	} else {
+	    procStatsPtr = (ServiceStats *) Tcl_GetHashValue(hPtr);
+	}
+	usec = RecordTime(procStatsPtr, &start);
+	eventStatsPtr = &tsdPtr->statsPtr->events;
+	eventStatsPtr->count++;
+	eventStatsPtr->total += usec;
+	if (usec > eventStatsPtr->max) {
+	    eventStatsPtr->max = usec;
+	}
+    }
+    return result;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RecordQueueLength --
+ *
+ *	Counts the events in the queue of a notifier and adds the count
+ *	to its histogram of queue lengths.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Updates tsdPtr->statsPtr->depth.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+RecordQueueLength(tsdPtr)
+    ThreadSpecificData *tsdPtr;	/* Notifier whose queue to count. */
+{
+    Tcl_Event *evPtr;
+    int length, bucket, i;
+
+    length = 0;
+    for (evPtr = tsdPtr->firstEventPtr; evPtr != NULL;
+	    evPtr = evPtr->nextPtr) {
+	length++;
+    }
+    for (i = 0; i < EVENT_RINGS; i++) {
+	length += tsdPtr->rings[i].count - tsdPtr->rings[i].numHoles;
+    }
+    for (bucket = 0; (length > 0) && (bucket < DEPTH_BUCKETS - 1);
+	    bucket++) {
+	length >>= 1;
+    }
+    tsdPtr->statsPtr->depth[bucket]++;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ResetStats --
+ *
+ *	Clears the statistics gathered by a notifier.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Frees the per-proc statistics and zeroes all the others.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ResetStats(tsdPtr)
+    ThreadSpecificData *tsdPtr;	/* Notifier whose statistics to clear. */
+{
+    NotifierStats *statsPtr = tsdPtr->statsPtr;
+    EventSource *sourcePtr;
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+
+    for (sourcePtr = tsdPtr->firstEventSourcePtr; sourcePtr != NULL;
+	    sourcePtr = sourcePtr->nextPtr) {
+	memset((VOID *) &sourcePtr->setupStats, 0, sizeof(ServiceStats));
+	memset((VOID *) &sourcePtr->checkStats, 0, sizeof(ServiceStats));
+    }
+    if (statsPtr == NULL) {
+	return;
+    }
+    for (hPtr = Tcl_FirstHashEntry(&statsPtr->procTable, &search);
+	    hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	ckfree((char *) Tcl_GetHashValue(hPtr));
+	Tcl_DeleteHashEntry(hPtr);
+    }
+    memset((VOID *) &statsPtr->events, 0, sizeof(ServiceStats));
+    memset((VOID *) &statsPtr->wait, 0, sizeof(ServiceStats));
+    memset((VOID *) &statsPtr->idle, 0, sizeof(ServiceStats));
+    memset((VOID *) statsPtr->depth, 0, sizeof(statsPtr->depth));
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ServiceStatsObj --
+ *
+ *	Makes the list "count N total T max M" describing a ServiceStats;
+ *	times are in microseconds.
+ *
+ * Results:
+ *	A new Tcl object with a reference count of 0.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_Obj *
+ServiceStatsObj(statsPtr)
+    ServiceStats *statsPtr;	/* Statistics to describe. */
+{
+    Tcl_Obj *listPtr = Tcl_NewObj();
+
+    Tcl_ListObjAppendElement(NULL, listPtr, Tcl_NewStringObj("count", -1));
+    Tcl_ListObjAppendElement(NULL, listPtr, Tcl_NewLongObj(statsPtr->count));
+    Tcl_ListObjAppendElement(NULL, listPtr, Tcl_NewStringObj("total", -1));
+    Tcl_ListObjAppendElement(NULL, listPtr, Tcl_NewDoubleObj(statsPtr->total));
+    Tcl_ListObjAppendElement(NULL, listPtr, Tcl_NewStringObj("max", -1));
+    Tcl_ListObjAppendElement(NULL, listPtr, Tcl_NewLongObj(statsPtr->max));
+    return listPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_SetNotifierStats --
+ *
+ *	Turns the gathering of statistics by the notifier of the current
+ *	thread on or off.  While it is off, the notifier only tests a
+ *	flag at each place where it would gather them.  Statistics
+ *	gathered earlier are kept until Tcl_GetNotifierStats resets them.
+ *
+ * Results:
+ *	The previous setting: 1 if statistics were being gathered, 0
+ *	otherwise.
+ *
+ * Side effects:
+ *	The first time statistics are enabled, memory is allocated to
+ *	hold them.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+Tcl_SetNotifierStats(enable)
+    int enable;			/* Non-zero means gather statistics. */
+{
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+    int old = tsdPtr->statsEnabled;
+
+    if (enable && (tsdPtr->statsPtr == NULL)) {
+	tsdPtr->statsPtr = (NotifierStats *) ckalloc(sizeof(NotifierStats));
+	memset((VOID *) tsdPtr->statsPtr, 0, sizeof(NotifierStats));
+	Tcl_InitHashTable(&tsdPtr->statsPtr->procTable, TCL_ONE_WORD_KEYS);
+    }
+    tsdPtr->statsEnabled = (enable != 0);
+    return old;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_GetNotifierStats --
+ *
+ *	Describes the statistics gathered by the notifier of the current
+ *	thread.  The result is a list of names and values:
+ *
+ *	enabled		1 if statistics are being gathered.
+ *	events		Time spent in the procs of the events that were
+ *			handled, as a "count N total T max M" list with
+ *			times in microseconds.
+ *	procs		For each event proc, its address and the same
+ *			list for the events it handled.
+ *	sources		For each event source, the address of its setup
+ *			proc and a list "setup {...} check {...}" of the
+ *			time spent in its setup and check procs.
+ *	wait		Time spent in Tcl_WaitForEvent.
+ *	idle		Time spent running idle handlers.
+ *	depth		Histogram of the length of the event queue: pairs
+ *			of a lower bound and the number of times the queue
+ *			held at least that many events (and fewer than the
+ *			next bound).
+ *	coalesced	Number of events dropped by Tcl_QueueEventCoalesced.
+ *
+ * Results:
+ *	A new Tcl object with a reference count of 0.
+ *
+ * Side effects:
+ *	If reset is non-zero, the statistics are cleared once described.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tcl_Obj *
+Tcl_GetNotifierStats(reset)
+    int reset;			/* Non-zero means clear the statistics. */
+{
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+    NotifierStats *statsPtr = tsdPtr->statsPtr;
+    NotifierStats empty;
+    EventSource *sourcePtr;
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+    Tcl_Obj *resultPtr, *listPtr, *subPtr;
+    char buf[TCL_INTEGER_SPACE + 4];
+    long bound;
+    int i;
+
+    if (statsPtr == NULL) {
+	memset((VOID *) &empty, 0, sizeof(NotifierStats));
+	statsPtr = &empty;
+    }
+    resultPtr = Tcl_NewObj();
+
+    Tcl_ListObjAppendElement(NULL, resultPtr,
+	    Tcl_NewStringObj("enabled", -1));
+    Tcl_ListObjAppendElement(NULL, resultPtr,
+	    Tcl_NewIntObj(tsdPtr->statsEnabled));
+
+    Tcl_ListObjAppendElement(NULL, resultPtr,
+	    Tcl_NewStringObj("events", -1));
+    Tcl_ListObjAppendElement(NULL, resultPtr,
+	    ServiceStatsObj(&statsPtr->events));
+
+    listPtr = Tcl_NewObj();
+    if (statsPtr != &empty) {
+	for (hPtr = Tcl_FirstHashEntry(&statsPtr->procTable, &search);
+		hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	    sprintf(buf, "0x%lx",
+		    (unsigned long) Tcl_GetHashKey(&statsPtr->procTable, hPtr));
+	    Tcl_ListObjAppendElement(NULL, listPtr, Tcl_NewStringObj(buf, -1));
+	    Tcl_ListObjAppendElement(NULL, listPtr,
+		    ServiceStatsObj((ServiceStats *) Tcl_GetHashValue(hPtr)));
+	}
+    }
+    Tcl_ListObjAppendElement(NULL, resultPtr,
+	    Tcl_NewStringObj("procs", -1));
+    Tcl_ListObjAppendElement(NULL, resultPtr, listPtr);
+
+    listPtr = Tcl_NewObj();
+    for (sourcePtr = tsdPtr->firstEventSourcePtr; sourcePtr != NULL;
+	    sourcePtr = sourcePtr->nextPtr) {
+	sprintf(buf, "0x%lx", (unsigned long) sourcePtr->setupProc);
+	Tcl_ListObjAppendElement(NULL, listPtr, Tcl_NewStringObj(buf, -1));
+	subPtr = Tcl_NewObj();
+	Tcl_ListObjAppendElement(NULL, subPtr, Tcl_NewStringObj("setup", -1));
+	Tcl_ListObjAppendElement(NULL, subPtr,
+		ServiceStatsObj(&sourcePtr->setupStats));
+	Tcl_ListObjAppendElement(NULL, subPtr, Tcl_NewStringObj("check", -1));
+	Tcl_ListObjAppendElement(NULL, subPtr,
+		ServiceStatsObj(&sourcePtr->checkStats));
+	Tcl_ListObjAppendElement(NULL, listPtr, subPtr);
+    }
+    Tcl_ListObjAppendElement(NULL, resultPtr,
+	    Tcl_NewStringObj("sources", -1));
+    Tcl_ListObjAppendElement(NULL, resultPtr, listPtr);
+
+    Tcl_ListObjAppendElement(NULL, resultPtr, Tcl_NewStringObj("wait", -1));
+    Tcl_ListObjAppendElement(NULL, resultPtr,
+	    ServiceStatsObj(&statsPtr->wait));
+    Tcl_ListObjAppendElement(NULL, resultPtr, Tcl_NewStringObj("idle", -1));
+    Tcl_ListObjAppendElement(NULL, resultPtr,
+	    ServiceStatsObj(&statsPtr->idle));
+
+    listPtr = Tcl_NewObj();
+    for (i = 0, bound = 0; i < DEPTH_BUCKETS; i++) {
+	Tcl_ListObjAppendElement(NULL, listPtr, Tcl_NewLongObj(bound));
+	Tcl_ListObjAppendElement(NULL, listPtr,
+		Tcl_NewLongObj(statsPtr->depth[i]));
+	bound = (bound == 0) ? 1 : (bound << 1);
+    }
+    Tcl_ListObjAppendElement(NULL, resultPtr, Tcl_NewStringObj("depth", -1));
+    Tcl_ListObjAppendElement(NULL, resultPtr, listPtr);
+
+    Tcl_ListObjAppendElement(NULL, resultPtr,
+	    Tcl_NewStringObj("coalesced", -1));
+    Tcl_ListObjAppendElement(NULL, resultPtr,
+	    Tcl_NewLongObj((long) tsdPtr->numCoalesced));
+
+    if (reset) {
+	ResetStats(tsdPtr);
+    }
+    return resultPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_NotifierObjCmd --
+ *
+ *	This procedure is invoked to process the "::tcl::notifier" Tcl
+ *	command:
+ *
+ *	::tcl::notifier instrument ?boolean?
+ *	::tcl::notifier stats ?-reset?
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	See the user documentation.
+ *
+ *----------------------------------------------------------------------
+ */
+
+	/* ARGSUSED */
+int
+Tcl_NotifierObjCmd(dummy, interp, objc, objv)
+    ClientData dummy;		/* Not used. */
+    Tcl_Interp *interp;		/* Current interpreter. */
+    int objc;			/* Number of arguments. */
+    Tcl_Obj *CONST objv[];	/* Argument objects. */
+{
+    static char *options[] = {
+	"instrument",	"stats",	(char *) NULL
+    };
+    enum options {
+	NOTIFIER_INSTRUMENT,	NOTIFIER_STATS
+    };
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+    int index, enable, old;
+
+    if (objc < 2) {
+	Tcl_WrongNumArgs(interp, 1, objv, "option ?arg ...?");
+	return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObj(interp, objv[1], options, "option", 0,
+	    &index) != TCL_OK) {
+	return TCL_ERROR;
+    }
+
+    switch ((enum options) index) {
+	case NOTIFIER_INSTRUMENT: {
+	    if (objc > 3) {
+		Tcl_WrongNumArgs(interp, 2, objv, "?boolean?");
+		return TCL_ERROR;
+	    }
+	    if (objc == 3) {
+		if (Tcl_GetBooleanFromObj(interp, objv[2], &enable)
+			!= TCL_OK) {
+		    return TCL_ERROR;
+		}
+		old = Tcl_SetNotifierStats(enable);
+	    } else {
+		old = tsdPtr->statsEnabled;
+	    }
+	    Tcl_SetObjResult(interp, Tcl_NewBooleanObj(old));
+	    break;
+	}
+	case NOTIFIER_STATS: {
+	    if ((objc > 3) || ((objc == 3)
+		    && (strcmp(Tcl_GetString(objv[2]), "-reset") != 0))) {
+		Tcl_WrongNumArgs(interp, 2, objv, "?-reset?");
+		return TCL_ERROR;
+	    }
+	    Tcl_SetObjResult(interp, Tcl_GetNotifierStats(objc == 3));
 	    break;
 	}
     }
-    Tcl_MutexUnlock(&listLock);
+    return TCL_OK;
 }
@@ -104,6 +104,8 @@ static void             FileCheckProc _ANSI_ARGS_((ClientData clientData,
                             int flags));
 static int		FileCloseProc _ANSI_ARGS_((ClientData instanceData,
 			    Tcl_Interp *interp));
+static int              FileEventDeleteProc _ANSI_ARGS_((Tcl_Event *evPtr,
+                            ClientData clientData));
 static int              FileEventProc _ANSI_ARGS_((Tcl_Event *evPtr,
                             int flags));
 static int		FileGetHandleProc _ANSI_ARGS_((ClientData instanceData,
@@ -250,7 +252,8 @@ FileCheckProc(data, flags)
             evPtr = (FileEvent *) ckalloc(sizeof(FileEvent));
             evPtr->header.proc = FileEventProc;
             evPtr->infoPtr = infoPtr;
-            Tcl_QueueEvent((Tcl_Event *) evPtr, TCL_QUEUE_TAIL);
+            TclQueueTypedEvent((Tcl_Event *) evPtr, TCL_QUEUE_TAIL,
+                    TCL_FILE_EVENTS);
         }
     }
 }
@@ -314,6 +317,10 @@ FileCloseProc(instanceData, interp)
             break;
         }
     }
+    if (fileInfoPtr->flags & FILE_PENDING) {
+        TclDeleteTypedEvents(TCL_FILE_EVENTS, FileEventDeleteProc,
+                (ClientData) fileInfoPtr);
+    }
     ckfree((char *)fileInfoPtr);
     return errorCode;
 }
@@ -369,6 +376,32 @@ FileEventProc(evPtr, flags)
     }
     return 1;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FileEventDeleteProc --
+ *
+ *	Tcl_EventDeleteProc used by FileCloseProc to remove the event
+ *	still queued for a file that is being closed.
+ *
+ * Results:
+ *	1 if evPtr is a FileEvent for the file, 0 otherwise.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+FileEventDeleteProc(evPtr, clientData)
+    Tcl_Event *evPtr;           /* Event to check. */
+    ClientData clientData;      /* FileInfo of the file being closed. */
+{
+    return ((evPtr->proc == FileEventProc)
+            && (((FileEvent *) evPtr)->infoPtr == (FileInfo *) clientData));
+}
 
 /*
  *----------------------------------------------------------------------
@@ -152,6 +152,8 @@ static HWND hwndEdit;        /* Handle for edit control. */
 static char szAppName[] = APP_NAME;
 static int cxFrame, cyFrame, cyCaption, cxVScroll;
 static Tcl_DString command;     /* Used to buffer incomplete commands. */
+static TclCompleteState completeState;
+                                /* Parse state of the contents of command. */
 char cmdBuf[256];        /* Line buffer for commands */
 IPT insPoint;
 PFNWP oldEditProc = NULL;    /* Pointer to system Edit control procedure */
@@ -171,6 +173,8 @@ static int              ConsoleBlockModeProc(ClientData instanceData, int mode);
 static void             ConsoleCheckProc(ClientData clientData, int flags);
 static int              ConsoleCloseProc(ClientData instanceData,
                             Tcl_Interp *interp);
+static int              ConsoleEventDeleteProc(Tcl_Event *evPtr,
+                            ClientData clientData);
 static int              ConsoleEventProc(Tcl_Event *evPtr, int flags);
 static void             ConsoleExitHandler(ClientData clientData);
 static int              ConsoleGetHandleProc(ClientData instanceData,
@@ -262,6 +266,7 @@ CreateTerminal(hab, interp)
                   FCF_SIZEBORDER | FCF_TASKLIST;
 
     Tcl_DStringInit(&command);
+    TclInitCompleteState(&completeState);
     hwnd = hFrame = NULLHANDLE;
     cxFrame = WinQuerySysValue(HWND_DESKTOP, SV_CXSIZEBORDER);
     cyFrame = WinQuerySysValue(HWND_DESKTOP, SV_CYSIZEBORDER);
@@ -396,11 +401,13 @@ TerminalProc(hwnd, message, param1, param2)
                 }
                 cmd = Tcl_DStringAppend(&command, cmdBuf + offset, -1);
                 DisplayString("", 1);
-                if (Tcl_CommandComplete(cmd)) {
+                if (TclIncrCommandComplete(&completeState, cmd,
+                        Tcl_DStringLength(&command))) {
                     Tcl_Interp* interp = (Tcl_Interp*) WinQueryWindowULong(hwnd,
                                          QWL_USER);
                     Tcl_RecordAndEval(interp, cmd, 0);
                     Tcl_DStringFree(&command);
+                    TclInitCompleteState(&completeState);
                     if (interp->result != NULL && *interp->result != '\0') {
                         DisplayString(interp->result, 1);
                     }
@@ -535,6 +542,7 @@ TerminalProc(hwnd, message, param1, param2)
             exp = (ULONG)WinSendMsg(hwndEdit, MLM_EXPORT, MPFROMP(&insPoint),
                                     MPFROMP(&length));
             Tcl_DStringFree(&command);
+            TclInitCompleteState(&completeState);
             Tcl_Eval(interp, "break");
             DisplayString("", 1);
             DisplayString("% ", 0);
@@ -1066,7 +1074,8 @@ ConsoleCheckProc(
 	    evPtr = (ConsoleEvent *) ckalloc(sizeof(ConsoleEvent));
 	    evPtr->header.proc = ConsoleEventProc;
 	    evPtr->infoPtr = infoPtr;
-	    Tcl_QueueEvent((Tcl_Event *) evPtr, TCL_QUEUE_TAIL);
+	    TclQueueTypedEvent((Tcl_Event *) evPtr, TCL_QUEUE_TAIL,
+		    TCL_FILE_EVENTS);
 	}
     }
 }
@@ -1248,6 +1257,10 @@ ConsoleCloseProc(
 	    break;
 	}
     }
+    if (consolePtr->flags & CONSOLE_PENDING) {
+	TclDeleteTypedEvents(TCL_FILE_EVENTS, ConsoleEventDeleteProc,
+		(ClientData) consolePtr);
+    }
     if (consolePtr->writeBuf != NULL) {
 	ckfree(consolePtr->writeBuf);
 	consolePtr->writeBuf = 0;
@@ -1547,6 +1560,32 @@ ConsoleEventProc(
     Tcl_NotifyChannel(infoPtr->channel, infoPtr->watchMask & mask);
     return 1;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ConsoleEventDeleteProc --
+ *
+ *	Tcl_EventDeleteProc used by ConsoleCloseProc to remove the event
+ *	still queued for a console that is being closed.
+ *
+ * Results:
+ *	1 if evPtr is a ConsoleEvent for the console, 0 otherwise.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ConsoleEventDeleteProc(
+    Tcl_Event *evPtr,		/* Event to check. */
+    ClientData clientData)	/* ConsoleInfo of the console being closed. */
+{
+    return ((evPtr->proc == ConsoleEventProc)
+	    && (((ConsoleEvent *) evPtr)->infoPtr == (ConsoleInfo *) clientData));
+}
 
 /*
  *----------------------------------------------------------------------
@@ -0,0 +1,574 @@
+/*
+ * tclOS2Enc.c --
+ *
+ *	This file loads the precompiled image of the table encodings
+ *	(made by encimage.tcl from the .enc files) into named shared
+ *	memory and registers its encodings, so that they don't have to be
+ *	parsed from the encoding files.  The first process that starts
+ *	reads the image; later processes use the same memory.
+ *
+ * Copyright (c) 2002 Illya Vaes
+ *
+ * See the file "license.terms" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ */
+
+#include "tclOS2Int.h"
+
+/*
+ * Name of the image file, in the "encoding" subdirectory of a directory
+ * on the library path.
+ */
+
+#define IMAGE_FILE_NAME	"encoding.img"
+
+/*
+ * The layout of the image; see encimage.tcl.  All offsets are relative
+ * to the start of the image.
+ */
+
+#define IMAGE_MAGIC	"TCLENC1"
+#define IMAGE_NAME_SIZE	48
+
+typedef struct ImageHeader {
+    char magic[8];		/* IMAGE_MAGIC, NUL-terminated. */
+    ULONG imageSize;		/* Size of the image in bytes. */
+    ULONG numEncodings;		/* Number of ImageEncodings following the
+				 * header. */
+    ULONG pagesOffset;		/* Offset of the first page. */
+    ULONG numPages;		/* Number of pages of 256 USHORTs. */
+} ImageHeader;
+
+typedef struct ImageEncoding {
+    char name[IMAGE_NAME_SIZE];	/* Name of the encoding. */
+    USHORT fallback;		/* Character written for Unicode characters
+				 * that have no mapping. */
+    USHORT nullSize;		/* Size of a null character: 1 or 2. */
+    ULONG prefixOffset;		/* Offset of 256 flags telling which bytes
+				 * are the first byte of a two-byte
+				 * character. */
+    ULONG toUnicodeOffset;	/* Offset of the 256 numbers of the pages
+				 * mapping from the encoding to Unicode,
+				 * indexed by the first byte. */
+    ULONG fromUnicodeOffset;	/* Offset of the 256 numbers of the pages
+				 * mapping from Unicode to the encoding,
+				 * indexed by the high byte. */
+} ImageEncoding;
+
+#define IMAGE_PAGE(pagesPtr, pageNum)	((pagesPtr) + ((pageNum) << 8))
+
+/*
+ * The image, once it has been loaded, and the start of its pages.  The
+ * shared memory is never freed: encodings that are still in use during
+ * finalization point into it, and a re-initialized Tcl maps it again.
+ */
+
+static ImageHeader *imagePtr = NULL;
+static USHORT *imagePages = NULL;
+
+/*
+ * The handles of the encodings registered from the image, or NULL if
+ * they are not registered.  Holding them keeps the encodings from being
+ * deleted (and then looked for in the encoding files) when nobody else
+ * uses them.  They are released by FreeImageEncodings when Tcl is
+ * finalized.
+ */
+
+static Tcl_Encoding *imageEncodings = NULL;
+
+/*
+ * Static functions defined in this file:
+ */
+
+static int	CheckImage _ANSI_ARGS_((ImageHeader *headerPtr));
+static void	FreeImageEncodings _ANSI_ARGS_((ClientData clientData));
+static int	ImageFromUtfProc _ANSI_ARGS_((ClientData clientData,
+		    CONST char *src, int srcLen, int flags,
+		    Tcl_EncodingState *statePtr, char *dst, int dstLen,
+		    int *srcReadPtr, int *dstWrotePtr, int *dstCharsPtr));
+static int	ImageToUtfProc _ANSI_ARGS_((ClientData clientData,
+		    CONST char *src, int srcLen, int flags,
+		    Tcl_EncodingState *statePtr, char *dst, int dstLen,
+		    int *srcReadPtr, int *dstWrotePtr, int *dstCharsPtr));
+static ImageHeader *	MapImage _ANSI_ARGS_((CONST char *fileName));
+
+/*
+ *---------------------------------------------------------------------------
+ *
+ * TclOS2InitEncodingImage --
+ *
+ *	Looks for the encoding image in the encoding directories on the
+ *	library path, loads it and registers all of its encodings.  Has
+ *	to be called after the library path is known and before the
+ *	system encoding is set.  If there is no usable image, the
+ *	encodings are loaded from their files as before.  The image is
+ *	only looked for once, but its encodings are registered again
+ *	after Tcl has been finalized and initialized again.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Creates encodings that remain until Tcl is finalized, and an exit
+ *	handler that releases them.
+ *
+ *---------------------------------------------------------------------------
+ */
+
+void
+TclOS2InitEncodingImage()
+{
+    Tcl_Obj *pathPtr;
+    Tcl_DString ds;
+    ImageEncoding *encPtr;
+    Tcl_EncodingType type;
+    int i, objc;
+    Tcl_Obj **objv;
+    ULONG n;
+
+    if (imageEncodings != NULL) {
+	return;
+    }
+    if (imagePtr == NULL) {
+	pathPtr = TclGetLibraryPath();
+	if (pathPtr == NULL) {
+	    return;
+	}
+	objc = 0;
+	Tcl_ListObjGetElements(NULL, pathPtr, &objc, &objv);
+	for (i = 0; (i < objc) && (imagePtr == NULL); i++) {
+	    /*
+	     * On the first call the library path is still native and the
+	     * system encoding is "identity", so this changes nothing.
+	     */
+
+	    Tcl_UtfToExternalDString(NULL, Tcl_GetString(objv[i]), -1, &ds);
+	    Tcl_DStringAppend(&ds, "/encoding/" IMAGE_FILE_NAME, -1);
+	    imagePtr = MapImage(Tcl_DStringValue(&ds));
+	    Tcl_DStringFree(&ds);
+	}
+	if (imagePtr == NULL) {
+	    return;
+	}
+	imagePages = (USHORT *) ((char *) imagePtr + imagePtr->pagesOffset);
+    }
+
+    imageEncodings = (Tcl_Encoding *) ckalloc((unsigned)
+	    ((imagePtr->numEncodings + 1) * sizeof(Tcl_Encoding)));
+    encPtr = (ImageEncoding *) (imagePtr + 1);
+    for (n = 0; n < imagePtr->numEncodings; n++, encPtr++) {
+	type.encodingName = encPtr->name;
+	type.toUtfProc = ImageToUtfProc;
+	type.fromUtfProc = ImageFromUtfProc;
+	type.freeProc = NULL;
+	type.clientData = (ClientData) encPtr;
+	type.nullSize = encPtr->nullSize;
+	imageEncodings[n] = Tcl_CreateEncoding(&type);
+    }
+    Tcl_CreateExitHandler(FreeImageEncodings, (ClientData) NULL);
+}
+
+/*
+ *---------------------------------------------------------------------------
+ *
+ * FreeImageEncodings --
+ *
+ *	Exit handler that releases the encodings registered from the
+ *	image, so that TclOS2InitEncodingImage registers them again if
+ *	Tcl is initialized again after Tcl_Finalize.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Encodings nobody else uses are deleted.
+ *
+ *---------------------------------------------------------------------------
+ */
+
+static void
+FreeImageEncodings(clientData)
+    ClientData clientData;	/* Not used. */
+{
+    ULONG n;
+
+    if (imageEncodings == NULL) {
+	return;
+    }
+    for (n = 0; n < imagePtr->numEncodings; n++) {
+	Tcl_FreeEncoding(imageEncodings[n]);
+    }
+    ckfree((char *) imageEncodings);
+    imageEncodings = NULL;
+}
+
+/*
+ *---------------------------------------------------------------------------
+ *
+ * MapImage --
+ *
+ *	Gets the encoding image from named shared memory, which is filled
+ *	from the image file by the first process that asks for it.  The
+ *	name of the shared memory depends on the size and time stamp of
+ *	the file, so that a rebuilt image gets new memory.
+ *
+ * Results:
+ *	A pointer to the image, or NULL if the file doesn't exist or
+ *	isn't a valid image.
+ *
+ * Side effects:
+ *	The shared memory may be allocated.
+ *
+ *---------------------------------------------------------------------------
+ */
+
+static ImageHeader *
+MapImage(fileName)
+    CONST char *fileName;	/* Native name of the image file. */
+{
+    FILESTATUS3 infoBuf;
+    char memName[CCHMAXPATH];
+    PVOID base;
+    HFILE handle;
+    ULONG action, size, bytesRead;
+    ULONG stamp;
+    ImageHeader header;
+    APIRET rc;			/* Not the global one. */
+
+    if (DosQueryPathInfo((PSZ) fileName, FIL_STANDARD, &infoBuf,
+	    sizeof(infoBuf)) != NO_ERROR) {
+	return NULL;
+    }
+    size = infoBuf.cbFile;
+    if (size < sizeof(ImageHeader)) {
+	return NULL;
+    }
+    stamp = (*(USHORT *) &infoBuf.fdateLastWrite << 16)
+	    | *(USHORT *) &infoBuf.ftimeLastWrite;
+    sprintf(memName, "\\SHAREMEM\\TCLENC\\%08lX.%03lX", stamp,
+	    size & 0xfff);
+
+    rc = DosGetNamedSharedMem(&base, (PSZ) memName, PAG_READ);
+    if (rc == NO_ERROR) {
+	/*
+	 * The process that allocated the memory fills in the magic last;
+	 * if it hasn't finished (or failed), use the encoding files.
+	 */
+
+	if ((strcmp(((ImageHeader *) base)->magic, IMAGE_MAGIC) != 0)
+		|| (((ImageHeader *) base)->imageSize != size)
+		|| (CheckImage((ImageHeader *) base) != TCL_OK)) {
+	    DosFreeMem(base);
+	    return NULL;
+	}
+	return (ImageHeader *) base;
+    }
+
+    rc = DosOpen((PSZ) fileName, &handle, &action, 0, FILE_NORMAL,
+	    OPEN_ACTION_FAIL_IF_NEW | OPEN_ACTION_OPEN_IF_EXISTS,
+	    OPEN_SHARE_DENYWRITE | OPEN_ACCESS_READONLY, (PEAOP2) NULL);
+    if (rc != NO_ERROR) {
+	return NULL;
+    }
+    rc = DosAllocSharedMem(&base, (PSZ) memName, size,
+	    PAG_COMMIT | PAG_READ | PAG_WRITE);
+    if (rc != NO_ERROR) {
+	DosClose(handle);
+	return NULL;
+    }
+    rc = DosRead(handle, &header, sizeof(header), &bytesRead);
+    if ((rc == NO_ERROR) && (bytesRead == sizeof(header))) {
+	rc = DosRead(handle, (char *) base + sizeof(header),
+		size - sizeof(header), &bytesRead);
+    }
+    DosClose(handle);
+    if ((rc != NO_ERROR) || (bytesRead != size - sizeof(header))
+	    || (strcmp(header.magic, IMAGE_MAGIC) != 0)
+	    || (header.imageSize != size)) {
+	DosFreeMem(base);
+	return NULL;
+    }
+    memcpy(base, &header, sizeof(header));
+    ((ImageHeader *) base)->magic[0] = '\0';
+    if (CheckImage((ImageHeader *) base) != TCL_OK) {
+	DosFreeMem(base);
+	return NULL;
+    }
+    ((ImageHeader *) base)->magic[0] = IMAGE_MAGIC[0];
+    DosSetMem(base, size, PAG_READ);
+    return (ImageHeader *) base;
+}
+
+/*
+ *---------------------------------------------------------------------------
+ *
+ * CheckImage --
+ *
+ *	Makes sure that all offsets and page numbers in an image are in
+ *	range.  The magic isn't checked.
+ *
+ * Results:
+ *	TCL_OK if the image can be used, TCL_ERROR otherwise.
+ *
+ * Side effects:
+ *	None.
+ *
+ *---------------------------------------------------------------------------
+ */
+
+static int
+CheckImage(headerPtr)
+    ImageHeader *headerPtr;	/* The image, of headerPtr->imageSize
+				 * bytes. */
+{
+    ULONG size, indexEnd, n;
+    ImageEncoding *encPtr;
+    USHORT *toPtr, *fromPtr;
+    int i;
+
+    size = headerPtr->imageSize;
+    indexEnd = sizeof(ImageHeader)
+	    + headerPtr->numEncodings * sizeof(ImageEncoding);
+    if ((headerPtr->numEncodings > size / sizeof(ImageEncoding))
+	    || (indexEnd > headerPtr->pagesOffset)
+	    || (headerPtr->pagesOffset % sizeof(USHORT) != 0)
+	    || (headerPtr->pagesOffset > size)
+	    || (headerPtr->numPages == 0)
+	    || (headerPtr->numPages > 0x10000)
+	    || ((size - headerPtr->pagesOffset) / (256 * sizeof(USHORT))
+		    < headerPtr->numPages)) {
+	return TCL_ERROR;
+    }
+
+    encPtr = (ImageEncoding *) (headerPtr + 1);
+    for (n = 0; n < headerPtr->numEncodings; n++, encPtr++) {
+	if ((encPtr->name[IMAGE_NAME_SIZE - 1] != '\0')
+		|| ((encPtr->nullSize != 1) && (encPtr->nullSize != 2))
+		|| (encPtr->prefixOffset < indexEnd)
+		|| (encPtr->prefixOffset + 256 > headerPtr->pagesOffset)
+		|| (encPtr->toUnicodeOffset < indexEnd)
+		|| (encPtr->toUnicodeOffset % sizeof(USHORT) != 0)
+		|| (encPtr->toUnicodeOffset + 256 * sizeof(USHORT)
+			> headerPtr->pagesOffset)
+		|| (encPtr->fromUnicodeOffset < indexEnd)
+		|| (encPtr->fromUnicodeOffset % sizeof(USHORT) != 0)
+		|| (encPtr->fromUnicodeOffset + 256 * sizeof(USHORT)
+			> headerPtr->pagesOffset)) {
+	    return TCL_ERROR;
+	}
+	toPtr = (USHORT *) ((char *) headerPtr + encPtr->toUnicodeOffset);
+	fromPtr = (USHORT *) ((char *) headerPtr + encPtr->fromUnicodeOffset);
+	for (i = 0; i < 256; i++) {
+	    if ((toPtr[i] >= headerPtr->numPages)
+		    || (fromPtr[i] >= headerPtr->numPages)) {
+		return TCL_ERROR;
+	    }
+	}
+    }
+    return TCL_OK;
+}
+
+/*
+ *-------------------------------------------------------------------------
+ *
+ * ImageToUtfProc --
+ *
+ *	Convert from an encoding in the image to UTF-8.  This does the
+ *	same as TableToUtfProc in tclEncoding.c.
+ *
+ * Results:
+ *	Returns TCL_OK if conversion was successful.
+ *
+ * Side effects:
+ *	None.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+static int
+ImageToUtfProc(clientData, src, srcLen, flags, statePtr, dst, dstLen,
+	srcReadPtr, dstWrotePtr, dstCharsPtr)
+    ClientData clientData;	/* ImageEncoding. */
+    CONST char *src;		/* Source string in specified encoding. */
+    int srcLen;			/* Source string length in bytes. */
+    int flags;			/* Conversion control flags. */
+    Tcl_EncodingState *statePtr;/* Place for conversion routine to store
+				 * state information used during a piecewise
+				 * conversion.  Contents of statePtr are
+				 * initialized and/or reset by conversion
+				 * routine under control of flags argument. */
+    char *dst;			/* Output buffer in which converted string
+				 * is stored. */
+    int dstLen;			/* The maximum length of output buffer in
+				 * bytes. */
+    int *srcReadPtr;		/* Filled with the number of bytes from the
+				 * source string that were converted. */
+    int *dstWrotePtr;		/* Filled with the number of bytes that were
+				 * stored in the output buffer as a result of
+				 * the conversion. */
+    int *dstCharsPtr;		/* Filled with the number of characters that
+				 * correspond to the bytes stored in the
+				 * output buffer. */
+{
+    CONST char *srcStart, *srcEnd;
+    CONST char *dstEnd, *dstStart, *prefixBytes;
+    int result, byte, numChars;
+    Tcl_UniChar ch;
+    USHORT *toUnicode, *pageZero;
+    ImageEncoding *encPtr;
+
+    srcStart = src;
+    srcEnd = src + srcLen;
+
+    dstStart = dst;
+    dstEnd = dst + dstLen - TCL_UTF_MAX;
+
+    encPtr = (ImageEncoding *) clientData;
+    toUnicode = (USHORT *) ((char *) imagePtr + encPtr->toUnicodeOffset);
+    prefixBytes = (char *) imagePtr + encPtr->prefixOffset;
+    pageZero = IMAGE_PAGE(imagePages, toUnicode[0]);
+
+    result = TCL_OK;
+    for (numChars = 0; src < srcEnd; numChars++) {
+	if (dst > dstEnd) {
+	    result = TCL_CONVERT_NOSPACE;
+	    break;
+	}
+	byte = *((unsigned char *) src);
+	if (prefixBytes[byte]) {
+	    src++;
+	    if (src >= srcEnd) {
+		src--;
+		result = TCL_CONVERT_MULTIBYTE;
+		break;
+	    }
+	    ch = IMAGE_PAGE(imagePages, toUnicode[byte])
+		    [*((unsigned char *) src)];
+	} else {
+	    ch = pageZero[byte];
+	}
+	if ((ch == 0) && (byte != 0)) {
+	    if (flags & TCL_ENCODING_STOPONERROR) {
+		result = TCL_CONVERT_SYNTAX;
+		break;
+	    }
+	    if (prefixBytes[byte]) {
+		src--;
+	    }
+	    ch = (Tcl_UniChar) byte;
+	}
+	dst += Tcl_UniCharToUtf(ch, dst);
+	src++;
+    }
+    *srcReadPtr = src - srcStart;
+    *dstWrotePtr = dst - dstStart;
+    *dstCharsPtr = numChars;
+    return result;
+}
+
+/*
+ *-------------------------------------------------------------------------
+ *
+ * ImageFromUtfProc --
+ *
+ *	Convert from UTF-8 to an encoding in the image.  This does the
+ *	same as TableFromUtfProc in tclEncoding.c.
+ *
+ * Results:
+ *	Returns TCL_OK if conversion was successful.
+ *
+ * Side effects:
+ *	None.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+static int
+ImageFromUtfProc(clientData, src, srcLen, flags, statePtr, dst, dstLen,
+	srcReadPtr, dstWrotePtr, dstCharsPtr)
+    ClientData clientData;	/* ImageEncoding. */
+    CONST char *src;		/* Source string in UTF-8. */
+    int srcLen;			/* Source string length in bytes. */
+    int flags;			/* Conversion control flags. */
+    Tcl_EncodingState *statePtr;/* Place for conversion routine to store
+				 * state information used during a piecewise
+				 * conversion.  Contents of statePtr are
+				 * initialized and/or reset by conversion
+				 * routine under control of flags argument. */
+    char *dst;			/* Output buffer in which converted string
+				 * is stored. */
+    int dstLen;			/* The maximum length of output buffer in
+				 * bytes. */
+    int *srcReadPtr;		/* Filled with the number of bytes from the
+				 * source string that were converted. */
+    int *dstWrotePtr;		/* Filled with the number of bytes that were
+				 * stored in the output buffer as a result of
+				 * the conversion. */
+    int *dstCharsPtr;		/* Filled with the number of characters that
+				 * correspond to the bytes stored in the
+				 * output buffer. */
+{
+    CONST char *srcStart, *srcEnd, *srcClose;
+    CONST char *dstStart, *dstEnd, *prefixBytes;
+    Tcl_UniChar ch;
+    int result, len, word, numChars;
+    USHORT *fromUnicode;
+    ImageEncoding *encPtr;
+
+    encPtr = (ImageEncoding *) clientData;
+    prefixBytes = (char *) imagePtr + encPtr->prefixOffset;
+    fromUnicode = (USHORT *) ((char *) imagePtr + encPtr->fromUnicodeOffset);
+
+    srcStart = src;
+    srcEnd = src + srcLen;
+    srcClose = srcEnd;
+    if ((flags & TCL_ENCODING_END) == 0) {
+	srcClose -= TCL_UTF_MAX;
+    }
+
+    dstStart = dst;
+    dstEnd = dst + dstLen - 1;
+
+    result = TCL_OK;
+    for (numChars = 0; src < srcEnd; numChars++) {
+	if ((src > srcClose) && (!Tcl_UtfCharComplete(src, srcEnd - src))) {
+	    /*
+	     * If there is more string to follow, this will ensure that the
+	     * last UTF-8 character in the source buffer hasn't been cut off.
+	     */
+
+	    result = TCL_CONVERT_MULTIBYTE;
+	    break;
+	}
+	len = Tcl_UtfToUniChar(src, &ch);
+	word = IMAGE_PAGE(imagePages, fromUnicode[ch >> 8])[ch & 0xff];
+	if ((word == 0) && (ch != 0)) {
+	    if (flags & TCL_ENCODING_STOPONERROR) {
+		result = TCL_CONVERT_UNKNOWN;
+		break;
+	    }
+	    word = encPtr->fallback;
+	}
+	if (prefixBytes[(word >> 8)] != 0) {
+	    if (dst + 1 > dstEnd) {
+		result = TCL_CONVERT_NOSPACE;
+		break;
+	    }
+	    dst[0] = (char) (word >> 8);
+	    dst[1] = (char) word;
+	    dst += 2;
+	} else {
+	    if (dst > dstEnd) {
+		result = TCL_CONVERT_NOSPACE;
+		break;
+	    }
+	    dst[0] = (char) word;
+	    dst++;
+	}
+	src += len;
+    }
+    *srcReadPtr = src - srcStart;
+    *dstWrotePtr = dst - dstStart;
+    *dstCharsPtr = numChars;
+    return result;
+}
@@ -23,6 +23,102 @@ static char drives[] = {'0', 'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J',
                         'K', 'L', 'M', 'N', 'O', 'P', 'Q', 'R', 'S', 'T', 'U',
                         'V', 'W', 'X', 'Y', 'Z'};
 
+/*
+ * Directory entries are read by DosFindFirst/DosFindNext in batches of
+ * GLOB_FIND_COUNT entries into a buffer of GLOB_FIND_BUFSIZE bytes, instead
+ * of one entry per system call.
+ */
+
+#define GLOB_FIND_COUNT         512
+#define GLOB_FIND_BUFSIZE       65536
+
+/*
+ * Maximum number of worker threads reading directories ahead of the
+ * matcher for "glob -parallel".
+ */
+
+#define GLOB_THREADS            4
+
+/*
+ * The complete contents of one directory, as read by GlobReadDirectory.
+ * Names are kept in native encoding, packed one after the other with a
+ * terminating null byte each.
+ */
+
+typedef struct GlobListing {
+    char *pattern;              /* Native "dir\*" pattern to search for. */
+    int state;                  /* GLOB_QUEUED, GLOB_READING or GLOB_DONE;
+                                 * only used for read-ahead listings. */
+    APIRET rc;                  /* Result of DosFindFirst. */
+    int numEntries;             /* Number of entries read. */
+    int maxEntries;             /* Space available in attrs and offsets. */
+    ULONG *attrs;               /* File attributes of each entry. */
+    int *offsets;               /* Offset of each entry's name in names. */
+    char *names;                /* Packed entry names. */
+    int namesUsed;              /* Bytes used in names. */
+    int namesSize;              /* Bytes allocated for names. */
+    struct GlobListing *nextPtr;/* Next listing waiting for a worker. */
+} GlobListing;
+
+#define GLOB_QUEUED     0
+#define GLOB_READING    1
+#define GLOB_DONE       2
+
+/*
+ * State shared between a thread running "glob -parallel" and the worker
+ * threads that read subdirectories for it.  Matching, recursion and the
+ * construction of the result stay in the globbing thread, so the order
+ * of the result is the same as without -parallel; workers only fill in
+ * listings that the globbing thread will ask for later.
+ */
+
+typedef struct GlobPool {
+    Tcl_Mutex mutex;            /* Guards everything below except the
+                                 * listings table. */
+    Tcl_Condition cond;         /* Notified when work is queued, a listing
+                                 * is done or a worker exits. */
+    GlobListing *firstPtr;      /* Listings waiting for a worker. */
+    int numWorkers;             /* Number of running worker threads. */
+    int shutdown;               /* Set to make workers exit. */
+    int depth;                  /* Nesting level of TclpMatchFilesTypes. */
+    Tcl_HashTable listings;     /* Read-ahead listings, keyed by the Tcl
+                                 * path of the directory.  Only used by
+                                 * the globbing thread. */
+} GlobPool;
+
+#ifdef TCL_THREADS
+typedef struct ThreadSpecificData {
+    GlobPool *globPoolPtr;      /* Pool of the glob -parallel currently
+                                 * running in this thread, or NULL. */
+} ThreadSpecificData;
+static Tcl_ThreadDataKey dataKey;
+#endif
+
+/*
+ * Static routines for this file:
+ */
+
+static void             GlobFreeListing _ANSI_ARGS_((GlobListing *listPtr));
+static GlobListing *    GlobNewListing _ANSI_ARGS_((CONST char *pattern,
+                            int length));
+static void             GlobReadDirectory _ANSI_ARGS_((GlobListing *listPtr));
+static int              MatchFiles _ANSI_ARGS_((Tcl_Interp *interp,
+                            char *separators, Tcl_DString *dirPtr,
+                            char *pattern, char *tail, GlobTypeData *types,
+                            GlobPool *poolPtr));
+#ifdef TCL_THREADS
+static GlobPool *       GlobCreatePool _ANSI_ARGS_((void));
+static void             GlobDeletePool _ANSI_ARGS_((GlobPool *poolPtr));
+static int              GlobNeedsListing _ANSI_ARGS_((CONST char *tail));
+static void             GlobQueueListings _ANSI_ARGS_((GlobPool *poolPtr,
+                            Tcl_DString *dirPtr, GlobListing *listPtr,
+                            int *matches, int numMatches));
+static GlobListing *    GlobTakeListing _ANSI_ARGS_((GlobPool *poolPtr,
+                            CONST char *key));
+static Tcl_ThreadCreateType GlobWorkerProc _ANSI_ARGS_((
+                            ClientData clientData));
+#endif
+
 
 /*
  *----------------------------------------------------------------------
@@ -108,7 +204,9 @@ TclpFindExecutable(argv0)
  *      in globbing.
  *
  * Side effects:
- *      None.
+ *      If types->parallel is set, the outermost call creates a pool of
+ *      threads reading subdirectories ahead, which is deleted again
+ *      before it returns.
  *
  *---------------------------------------------------------------------- */
 
@@ -123,6 +221,63 @@ TclpMatchFilesTypes(
                                  * not be static. */
     GlobTypeData *types)        /* Object containing list of acceptable types.
                                  * May be NULL. */
+{
+#ifdef TCL_THREADS
+    if ((types != NULL) && types->parallel) {
+        ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+        GlobPool *poolPtr;
+        int result;
+
+        if (tsdPtr->globPoolPtr == NULL) {
+            tsdPtr->globPoolPtr = GlobCreatePool();
+        }
+        poolPtr = tsdPtr->globPoolPtr;
+        poolPtr->depth++;
+        result = MatchFiles(interp, separators, dirPtr, pattern, tail, types,
+                poolPtr);
+        if (--poolPtr->depth == 0) {
+            tsdPtr->globPoolPtr = NULL;
+            GlobDeletePool(poolPtr);
+        }
+        return result;
+    }
+#endif
+    return MatchFiles(interp, separators, dirPtr, pattern, tail, types, NULL);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * MatchFiles --
+ *
+ *      Does the work of TclpMatchFilesTypes.  The directory is read
+ *      completely, in batches, before any matching subdirectory is
+ *      visited, so no search handle stays open during the recursion.
+ *
+ * Results:
+ *      Same as TclpMatchFilesTypes.
+ *
+ * Side effects:
+ *      If poolPtr is not NULL, the listing of the directory may come
+ *      from the pool, and matching subdirectories are queued on the
+ *      pool to be read ahead.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+MatchFiles(
+    Tcl_Interp *interp,         /* Interpreter to receive results. */
+    char *separators,           /* Directory separators to pass to TclDoGlob. */
+    Tcl_DString *dirPtr,        /* Contains path to directory to search. */
+    char *pattern,              /* Pattern to match against. */
+    char *tail,                 /* Pointer to end of pattern.  Tail must
+                                 * point to a location in pattern and must
+                                 * not be static. */
+    GlobTypeData *types,        /* Object containing list of acceptable types.
+                                 * May be NULL. */
+    GlobPool *poolPtr)          /* Read-ahead pool for glob -parallel, or
+                                 * NULL. */
 {
     APIRET rc;
     char drivePat[] = "?:\\";
@@ -131,14 +286,15 @@ TclpMatchFilesTypes(
     int matchDotFiles;
     int dirLength, result = TCL_OK;
     Tcl_DString dirString, patternString;
-    HDIR handle;
     FILESTATUS3 infoBuf;
-    FILEFINDBUF3 data;
+    GlobListing *listPtr;
+    TclGlobPattern *patPtr;
+    Tcl_DString namesString;
+    int i, alt, numMatches, *matches, *nameOffsets;
     Tcl_DString ds;
     char *p = NULL, c;
     char *nativeName;
     Tcl_Obj *resultPtr;
-    ULONG filesAtATime = 1;
     ULONG diskNum = 3;		/* Assume C: for errors */
 #ifdef CASE_SENSITIVE_GLOBBING
     ULONG volFlags;
@@ -380,22 +536,29 @@ TclpMatchFilesTypes(
      */
 
 
-    dir = Tcl_DStringAppend(&dirString, "*", 3);
-    nativeName = Tcl_UtfToExternalDString(NULL, dir, -1, &ds);
+    dir = Tcl_DStringAppend(&dirString, "*", 1);
 
     /*
-     * Now open the directory for reading and iterate over the contents.
+     * Read the whole directory, unless a worker has read it already.
      */
 
-    handle = HDIR_SYSTEM;
-    rc = DosFindFirst(nativeName, &handle, FILE_NORMAL | FILE_DIRECTORY, &data,
-                      sizeof(data), &filesAtATime, FIL_STANDARD);
-#ifdef VERBOSE
-    printf("DosFindFirst %s returns %x (%s)\n", nativeName, rc, data.achName);
+    listPtr = NULL;
+#ifdef TCL_THREADS
+    if (poolPtr != NULL) {
+        listPtr = GlobTakeListing(poolPtr, Tcl_DStringValue(dirPtr));
+    }
 #endif
-    Tcl_DStringFree(&dirString);
+    if (listPtr == NULL) {
+        nativeName = Tcl_UtfToExternalDString(NULL, dir, -1, &ds);
+        listPtr = GlobNewListing(nativeName, Tcl_DStringLength(&ds));
+        Tcl_DStringFree(&ds);
+        GlobReadDirectory(listPtr);
+    }
 
-    if (rc != NO_ERROR) {
+    if (listPtr->rc != NO_ERROR) {
+        rc = listPtr->rc;
+        GlobFreeListing(listPtr);
+        Tcl_DStringFree(&patternString);
         message = "couldn't read directory \"";
         goto error;
     }
@@ -415,64 +578,84 @@ TclpMatchFilesTypes(
     }
 
     /*
-     * Check to see if the pattern needs to compare with dot files.
+     * Compile the pattern once for the whole directory.  Brace
+     * alternatives that TclDoGlob left in this path element are expanded
+     * here, so the directory is read only once for all of them.
      */
 
-    if ((newPattern[0] == '.')
-            || ((pattern[0] == '\\') && (pattern[1] == '.'))) {
-        matchDotFiles = 1;
-    } else {
-        matchDotFiles = 0;
-    }
+    patPtr = TclCompileGlobPattern(newPattern, -1, TCL_GLOBPAT_BRACES);
 
     /*
-     * Now iterate over all of the files in the directory.
+     * Check to see if the file matches the pattern.  We need to convert
+     * the file name to lower case for comparison purposes.  Note that we
+     * are ignoring the case sensitivity flag because Windows doesn't honor
+     * case even if the volume is case sensitive.  If the volume also
+     * doesn't preserve case, then we previously returned the lower case
+     * form of the name.  This didn't seem quite right since there are
+     * non-case-preserving volumes that actually return mixed case.  So now
+     * we are returning exactly what we get from the system.
+     *
+     * The lower case names are computed once and then matched against
+     * each alternative in turn, which keeps the order of the results the
+     * same as when TclDoGlob searched the directory per alternative.
      */
 
-    resultPtr = Tcl_GetObjResult(interp);
-#ifdef VERBOSE
-    for ( rc = NO_ERROR;
-          rc == NO_ERROR;
-          printf("DosFindNext returns %x (%s)\n",
-                 rc = DosFindNext(handle, &data, sizeof(data), &filesAtATime),
-                 data.achName)) {
-#else
-    for (   rc = NO_ERROR;
-            rc == NO_ERROR;
-            rc = DosFindNext(handle, &data, sizeof(data), &filesAtATime)) {
-#endif
-        char *nativeMatchResult;
-        char *name, *fname;
+    Tcl_DStringInit(&namesString);
+    nameOffsets = (int *) ckalloc((unsigned)
+            ((2 * listPtr->numEntries + 1) * sizeof(int)));
+    for (i = 0; i < listPtr->numEntries; i++) {
+        char *name;
+        int length;
 
-        nativeName = data.achName;
+        nativeName = listPtr->names + listPtr->offsets[i];
         name = Tcl_ExternalToUtfDString(NULL, nativeName, -1, &ds);
+        length = Tcl_UtfToLower(name);
+        nameOffsets[2*i] = Tcl_DStringLength(&namesString);
+        nameOffsets[2*i + 1] = length;
+        Tcl_DStringAppend(&namesString, name, length + 1);
+        Tcl_DStringFree(&ds);
+    }
 
+    numMatches = 0;
+    matches = (int *) ckalloc((unsigned)
+            ((patPtr->numAlts * listPtr->numEntries + 1) * sizeof(int)));
+    for (alt = 0; alt < patPtr->numAlts; alt++) {
         /*
-         * Check to see if the file matches the pattern.  We need to convert
-         * the file name to lower case for comparison purposes.  Note that we
-         * are ignoring the case sensitivity flag because Windows doesn't honor
-         * case even if the volume is case sensitive.  If the volume also
-         * doesn't preserve case, then we previously returned the lower case
-         * form of the name.  This didn't seem quite right since there are
-         * non-case-preserving volumes that actually return mixed case.  So now
-         * we are returning exactly what we get from the system.
+         * Check to see if the pattern needs to compare with dot files.
          */
 
-        Tcl_UtfToLower(name);
-        nativeMatchResult = NULL;
+        matchDotFiles = patPtr->alts[alt].leadingDot;
+        for (i = 0; i < listPtr->numEntries; i++) {
+            char *name = Tcl_DStringValue(&namesString) + nameOffsets[2*i];
 
-        if ((matchDotFiles == 0) && (name[0] == '.')) {
-            /*
-             * Ignore hidden files.
-             */
-        } else if (Tcl_StringMatch(name, newPattern) != 0) {
-            nativeMatchResult = nativeName;
+            if ((matchDotFiles == 0) && (name[0] == '.')) {
+                /*
+                 * Ignore hidden files.
+                 */
+            } else if (TclGlobAltMatch(patPtr, alt, name,
+                    nameOffsets[2*i + 1])) {
+                matches[numMatches++] = i;
+            }
         }
-        Tcl_DStringFree(&ds);
+    }
+    ckfree((char *) nameOffsets);
+    Tcl_DStringFree(&namesString);
+    TclFreeGlobPattern(patPtr);
 
-        if (nativeMatchResult == NULL) {
-            continue;
-        }
+#ifdef TCL_THREADS
+    /*
+     * Let the workers read the matching subdirectories while we descend
+     * into the first one.
+     */
+
+    if ((poolPtr != NULL) && (tail != NULL) && GlobNeedsListing(tail)) {
+        GlobQueueListings(poolPtr, dirPtr, listPtr, matches, numMatches);
+    }
+#endif
+
+    resultPtr = Tcl_GetObjResult(interp);
+    for (i = 0; i < numMatches; i++) {
+        char *name, *fname;
 
         /*
          * If the file matches, then we need to process the remainder of the
@@ -481,13 +664,12 @@ TclpMatchFilesTypes(
          * file to the result.
          */
 
-        name = Tcl_ExternalToUtfDString(NULL, nativeMatchResult, -1, &ds);
+        nativeName = listPtr->names + listPtr->offsets[matches[i]];
+        name = Tcl_ExternalToUtfDString(NULL, nativeName, -1, &ds);
         Tcl_DStringAppend(dirPtr, name, -1);
         Tcl_DStringFree(&ds);
 
         fname = Tcl_DStringValue(dirPtr);
-        nativeName = Tcl_ExternalToUtfDString(NULL, fname,
-                                              Tcl_DStringLength(dirPtr), &ds);
 
         /*
          * We only retrieve the attributes of the file if it is
@@ -556,27 +738,24 @@ TclpMatchFilesTypes(
                 Tcl_ListObjAppendElement(interp, resultPtr,
                         Tcl_NewStringObj(fname, Tcl_DStringLength(dirPtr)));
             }
-        } else {
-            if ( (DosQueryPathInfo(dirPtr->string, FIL_STANDARD, &infoBuf,
-                                  sizeof(infoBuf)) == NO_ERROR) &&
-                 (infoBuf.attrFile & FILE_DIRECTORY)) {
-                Tcl_DStringAppend(dirPtr, "/", 1);
-                result = TclDoGlob(interp, separators, dirPtr, tail, types);
-                if (result != TCL_OK) {
-                    break;
-                }
+        } else if (listPtr->attrs[matches[i]] & FILE_DIRECTORY) {
+            /*
+             * The attributes came with the directory entry, so there is
+             * no need to query the path again.
+             */
+
+            Tcl_DStringAppend(dirPtr, "/", 1);
+            result = TclDoGlob(interp, separators, dirPtr, tail, types);
+            if (result != TCL_OK) {
+                break;
             }
         }
-        /*
-         * Free ds here to ensure that nativeName is valid above.
-         */
-
-        Tcl_DStringFree(&ds);
 
         Tcl_DStringSetLength(dirPtr, dirLength);
     }
 
-    DosFindClose(handle);
+    ckfree((char *) matches);
+    GlobFreeListing(listPtr);
     Tcl_DStringFree(&dirString);
     Tcl_DStringFree(&patternString);
 
@@ -591,6 +770,492 @@ TclpMatchFilesTypes(
     return TCL_ERROR;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * GlobNewListing --
+ *
+ *      Allocates an empty listing for the given native search pattern.
+ *
+ * Results:
+ *      The new listing, to be filled by GlobReadDirectory and released
+ *      with GlobFreeListing.
+ *
+ * Side effects:
+ *      Memory is allocated.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static GlobListing *
+GlobNewListing(
+    CONST char *pattern,        /* Native "dir\*" pattern. */
+    int length)                 /* Number of bytes in pattern. */
+{
+    GlobListing *listPtr;
+
+    listPtr = (GlobListing *) ckalloc(sizeof(GlobListing));
+    listPtr->pattern = ckalloc((unsigned) (length + 1));
+    memcpy(listPtr->pattern, pattern, (size_t) length);
+    listPtr->pattern[length] = '\0';
+    listPtr->state = GLOB_QUEUED;
+    listPtr->rc = NO_ERROR;
+    listPtr->numEntries = 0;
+    listPtr->maxEntries = 0;
+    listPtr->attrs = NULL;
+    listPtr->offsets = NULL;
+    listPtr->names = NULL;
+    listPtr->namesUsed = 0;
+    listPtr->namesSize = 0;
+    listPtr->nextPtr = NULL;
+    return listPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GlobFreeListing --
+ *
+ *      Releases a listing allocated by GlobNewListing.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Memory is freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+GlobFreeListing(
+    GlobListing *listPtr)       /* Listing to free. */
+{
+    if (listPtr->attrs != NULL) {
+        ckfree((char *) listPtr->attrs);
+        ckfree((char *) listPtr->offsets);
+    }
+    if (listPtr->names != NULL) {
+        ckfree(listPtr->names);
+    }
+    ckfree(listPtr->pattern);
+    ckfree((char *) listPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GlobReadDirectory --
+ *
+ *      Reads all entries matching listPtr->pattern, asking the system
+ *      for GLOB_FIND_COUNT entries at a time.  This only uses the Dos*
+ *      API and ckalloc, so it may run in a worker thread.
+ *
+ * Results:
+ *      None.  The result of DosFindFirst is left in listPtr->rc.
+ *
+ * Side effects:
+ *      The names and attributes of the entries are stored in the
+ *      listing.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+GlobReadDirectory(
+    GlobListing *listPtr)       /* Listing to fill. */
+{
+    APIRET rc;
+    HDIR handle = HDIR_CREATE;
+    ULONG count = GLOB_FIND_COUNT;
+    char *buffer;
+    FILEFINDBUF3 *entryPtr;
+
+    buffer = ckalloc(GLOB_FIND_BUFSIZE);
+    rc = DosFindFirst(listPtr->pattern, &handle, FILE_NORMAL | FILE_DIRECTORY,
+                      buffer, GLOB_FIND_BUFSIZE, &count, FIL_STANDARD);
+#ifdef VERBOSE
+    printf("DosFindFirst %s returns %x (%d entries)\n", listPtr->pattern, rc,
+           count);
+#endif
+    listPtr->rc = rc;
+
+    while (rc == NO_ERROR) {
+        entryPtr = (FILEFINDBUF3 *) buffer;
+        for ( ; count > 0; count--) {
+            int length = entryPtr->cchName;
+
+            if (listPtr->numEntries == listPtr->maxEntries) {
+                listPtr->maxEntries = (listPtr->maxEntries == 0)
+                        ? GLOB_FIND_COUNT : 2 * listPtr->maxEntries;
+                listPtr->attrs = (ULONG *) ckrealloc((char *) listPtr->attrs,
+                        listPtr->maxEntries * sizeof(ULONG));
+                listPtr->offsets = (int *) ckrealloc((char *) listPtr->offsets,
+                        listPtr->maxEntries * sizeof(int));
+            }
+            if (listPtr->namesUsed + length + 1 > listPtr->namesSize) {
+                listPtr->namesSize = 2 * listPtr->namesSize + length + 1
+                        + GLOB_FIND_BUFSIZE / 16;
+                listPtr->names = ckrealloc(listPtr->names,
+                        (unsigned) listPtr->namesSize);
+            }
+            listPtr->attrs[listPtr->numEntries] = entryPtr->attrFile;
+            listPtr->offsets[listPtr->numEntries] = listPtr->namesUsed;
+            memcpy(listPtr->names + listPtr->namesUsed, entryPtr->achName,
+                    (size_t) length);
+            listPtr->names[listPtr->namesUsed + length] = '\0';
+            listPtr->namesUsed += length + 1;
+            listPtr->numEntries++;
+
+            entryPtr = (FILEFINDBUF3 *)
+                    ((char *) entryPtr + entryPtr->oNextEntryOffset);
+        }
+        count = GLOB_FIND_COUNT;
+        rc = DosFindNext(handle, buffer, GLOB_FIND_BUFSIZE, &count);
+    }
+
+    if (listPtr->rc == NO_ERROR) {
+        DosFindClose(handle);
+    }
+    ckfree(buffer);
+}
+
+#ifdef TCL_THREADS
+/*
+ *----------------------------------------------------------------------
+ *
+ * GlobCreatePool --
+ *
+ *      Creates the read-ahead pool for a "glob -parallel".  Worker
+ *      threads are only started once there is something to read.
+ *
+ * Results:
+ *      The new pool.
+ *
+ * Side effects:
+ *      Memory is allocated.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static GlobPool *
+GlobCreatePool()
+{
+    GlobPool *poolPtr;
+
+    poolPtr = (GlobPool *) ckalloc(sizeof(GlobPool));
+    poolPtr->mutex = NULL;
+    poolPtr->cond = NULL;
+    poolPtr->firstPtr = NULL;
+    poolPtr->numWorkers = 0;
+    poolPtr->shutdown = 0;
+    poolPtr->depth = 0;
+    Tcl_InitHashTable(&poolPtr->listings, TCL_STRING_KEYS);
+    return poolPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GlobDeletePool --
+ *
+ *      Stops the workers of a pool and frees the pool together with
+ *      all listings that were read ahead but never used.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Waits for workers that are still reading a directory.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+GlobDeletePool(
+    GlobPool *poolPtr)          /* Pool to delete. */
+{
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+
+    Tcl_MutexLock(&poolPtr->mutex);
+    poolPtr->shutdown = 1;
+    poolPtr->firstPtr = NULL;
+    Tcl_ConditionNotify(&poolPtr->cond);
+    while (poolPtr->numWorkers > 0) {
+        Tcl_ConditionWait(&poolPtr->cond, &poolPtr->mutex, NULL);
+    }
+    Tcl_MutexUnlock(&poolPtr->mutex);
+
+    /*
+     * Every listing still in the table is either done or was never
+     * picked up, and no worker refers to any of them any more.
+     */
+
+    for (hPtr = Tcl_FirstHashEntry(&poolPtr->listings, &search);
+            hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+        GlobFreeListing((GlobListing *) Tcl_GetHashValue(hPtr));
+    }
+    Tcl_DeleteHashTable(&poolPtr->listings);
+    Tcl_MutexFinalize(&poolPtr->mutex);
+    Tcl_ConditionFinalize(&poolPtr->cond);
+    ckfree((char *) poolPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GlobNeedsListing --
+ *
+ *      Decides whether reading ahead the subdirectories for the given
+ *      remainder of a glob pattern is worthwhile, which is the case
+ *      when its first element contains wildcards and no braces.  Only
+ *      then will TclDoGlob come back with exactly the subdirectory as
+ *      the directory to search.
+ *
+ * Results:
+ *      1 if the subdirectories should be read ahead, 0 otherwise.
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+GlobNeedsListing(
+    CONST char *tail)           /* Remainder of the pattern. */
+{
+    int wild = 0;
+
+    for ( ; (*tail != '\0') && (*tail != '/') && (*tail != '\\'); tail++) {
+        if (*tail == '{') {
+            return 0;
+        }
+        if ((*tail == '*') || (*tail == '?') || (*tail == '[')) {
+            wild = 1;
+        }
+    }
+    return wild;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GlobQueueListings --
+ *
+ *      Queues a listing for each matching subdirectory of a directory,
+ *      and starts worker threads as needed to read them.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      The new listings are entered in the pool's table under the path
+ *      TclDoGlob will pass back for them.  They are put at the front of
+ *      the queue, in directory order, since the globbing thread descends
+ *      into them before the ones queued earlier.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+GlobQueueListings(
+    GlobPool *poolPtr,          /* Pool to queue on. */
+    Tcl_DString *dirPtr,        /* Tcl path of the directory searched. */
+    GlobListing *listPtr,       /* Listing of that directory. */
+    int *matches,               /* Indices of the matching entries. */
+    int numMatches)             /* Number of indices in matches. */
+{
+    GlobListing *firstPtr = NULL, *lastPtr = NULL, *newPtr;
+    Tcl_DString key, native, ds;
+    Tcl_HashEntry *hPtr;
+    int i, new, dirLength, prefixLength, numQueued = 0;
+    char *nativeName;
+
+    /*
+     * The pattern ends in "*"; what precedes it is the native directory
+     * name with its trailing backslash.
+     */
+
+    prefixLength = strlen(listPtr->pattern) - 1;
+    dirLength = Tcl_DStringLength(dirPtr);
+    Tcl_DStringInit(&key);
+    Tcl_DStringInit(&native);
+    Tcl_DStringAppend(&key, Tcl_DStringValue(dirPtr), dirLength);
+    Tcl_DStringAppend(&native, listPtr->pattern, prefixLength);
+
+    for (i = 0; i < numMatches; i++) {
+        if (!(listPtr->attrs[matches[i]] & FILE_DIRECTORY)) {
+            continue;
+        }
+        nativeName = listPtr->names + listPtr->offsets[matches[i]];
+
+        Tcl_DStringSetLength(&key, dirLength);
+        Tcl_ExternalToUtfDString(NULL, nativeName, -1, &ds);
+        Tcl_DStringAppend(&key, Tcl_DStringValue(&ds), Tcl_DStringLength(&ds));
+        Tcl_DStringFree(&ds);
+        Tcl_DStringAppend(&key, "/", 1);
+
+        hPtr = Tcl_CreateHashEntry(&poolPtr->listings, Tcl_DStringValue(&key),
+                &new);
+        if (!new) {
+            continue;
+        }
+
+        Tcl_DStringSetLength(&native, prefixLength);
+        Tcl_DStringAppend(&native, nativeName, -1);
+        Tcl_DStringAppend(&native, "\\*", 2);
+        newPtr = GlobNewListing(Tcl_DStringValue(&native),
+                Tcl_DStringLength(&native));
+        Tcl_SetHashValue(hPtr, (ClientData) newPtr);
+
+        if (lastPtr == NULL) {
+            firstPtr = newPtr;
+        } else {
+            lastPtr->nextPtr = newPtr;
+        }
+        lastPtr = newPtr;
+        numQueued++;
+    }
+    Tcl_DStringFree(&key);
+    Tcl_DStringFree(&native);
+
+    if (numQueued == 0) {
+        return;
+    }
+
+    Tcl_MutexLock(&poolPtr->mutex);
+    lastPtr->nextPtr = poolPtr->firstPtr;
+    poolPtr->firstPtr = firstPtr;
+    while ((poolPtr->numWorkers < GLOB_THREADS)
+            && (poolPtr->numWorkers < numQueued)) {
+        Tcl_ThreadId id;
+
+        if (Tcl_CreateThread(&id, GlobWorkerProc, (ClientData) poolPtr,
+                TCL_THREAD_STACK_DEFAULT, TCL_THREAD_NOFLAGS) != TCL_OK) {
+            /*
+             * Not fatal: whatever no worker picks up is read by the
+             * globbing thread itself.
+             */
+
+            break;
+        }
+        poolPtr->numWorkers++;
+    }
+    Tcl_ConditionNotify(&poolPtr->cond);
+    Tcl_MutexUnlock(&poolPtr->mutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GlobTakeListing --
+ *
+ *      Looks for a read-ahead listing of the directory with the given
+ *      Tcl path.  If a worker is still reading it, waits for it; if no
+ *      worker got to it yet, reads it right here.
+ *
+ * Results:
+ *      The complete listing, which the caller must free with
+ *      GlobFreeListing, or NULL if the directory was not queued.
+ *
+ * Side effects:
+ *      The listing is removed from the pool.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static GlobListing *
+GlobTakeListing(
+    GlobPool *poolPtr,          /* Pool to look in. */
+    CONST char *key)            /* Tcl path of the directory. */
+{
+    Tcl_HashEntry *hPtr;
+    GlobListing *listPtr, **prevPtrPtr;
+
+    hPtr = Tcl_FindHashEntry(&poolPtr->listings, key);
+    if (hPtr == NULL) {
+        return NULL;
+    }
+    listPtr = (GlobListing *) Tcl_GetHashValue(hPtr);
+    Tcl_DeleteHashEntry(hPtr);
+
+    Tcl_MutexLock(&poolPtr->mutex);
+    if (listPtr->state == GLOB_QUEUED) {
+        for (prevPtrPtr = &poolPtr->firstPtr; *prevPtrPtr != listPtr;
+                prevPtrPtr = &(*prevPtrPtr)->nextPtr) {
+            /* Empty loop body. */
+        }
+        *prevPtrPtr = listPtr->nextPtr;
+        listPtr->state = GLOB_READING;
+        Tcl_MutexUnlock(&poolPtr->mutex);
+
+        GlobReadDirectory(listPtr);
+        listPtr->state = GLOB_DONE;
+        return listPtr;
+    }
+    while (listPtr->state != GLOB_DONE) {
+        Tcl_ConditionWait(&poolPtr->cond, &poolPtr->mutex, NULL);
+    }
+    Tcl_MutexUnlock(&poolPtr->mutex);
+    return listPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GlobWorkerProc --
+ *
+ *      Main procedure of a read-ahead worker thread.  Reads queued
+ *      listings until the pool is shut down.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      The thread exits when the pool is shut down.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_ThreadCreateType
+GlobWorkerProc(
+    ClientData clientData)      /* The GlobPool to work for. */
+{
+    GlobPool *poolPtr = (GlobPool *) clientData;
+    GlobListing *listPtr;
+
+    Tcl_MutexLock(&poolPtr->mutex);
+    while (!poolPtr->shutdown) {
+        listPtr = poolPtr->firstPtr;
+        if (listPtr == NULL) {
+            Tcl_ConditionWait(&poolPtr->cond, &poolPtr->mutex, NULL);
+            continue;
+        }
+        poolPtr->firstPtr = listPtr->nextPtr;
+        listPtr->state = GLOB_READING;
+        Tcl_MutexUnlock(&poolPtr->mutex);
+
+        GlobReadDirectory(listPtr);
+
+        Tcl_MutexLock(&poolPtr->mutex);
+        listPtr->state = GLOB_DONE;
+        Tcl_ConditionNotify(&poolPtr->cond);
+    }
+    poolPtr->numWorkers--;
+    Tcl_ConditionNotify(&poolPtr->cond);
+    Tcl_MutexUnlock(&poolPtr->mutex);
+
+    /*
+     * The pool may be gone from here on.
+     */
+
+    Tcl_ExitThread(0);
+    TCL_THREAD_CREATE_RETURN;
+}
+#endif /* TCL_THREADS */
+
 /*
  * TclpMatchFiles --
  *
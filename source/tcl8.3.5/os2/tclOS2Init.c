@@ -412,6 +412,13 @@ TclpSetInitialEncodings()
     char buf[4 + TCL_INTEGER_SPACE];
     ULONG currentCodePages[1], lenCodePages;
 
+    /*
+     * Register the precompiled table encodings first, so that the system
+     * encoding doesn't have to be read from its encoding file.
+     */
+
+    TclOS2InitEncodingImage();
+
     rc = DosQueryCp(sizeof(currentCodePages), currentCodePages, &lenCodePages);
     if (rc != NO_ERROR) {
         Tcl_SetSystemEncoding(NULL, NULL);
@@ -675,6 +682,35 @@ Tcl_Init(interp)
     Tcl_Interp *interp;		/* Interpreter to initialize. */
 {
     Tcl_Obj *pathPtr;
+    char *preload, **fileNames;
+    int i, numFiles;
+
+    /*
+     * Start loading the binary files named by the TCL_PRELOAD environment
+     * variable (a Tcl list) in the background, so that the "load"
+     * commands of the startup scripts find them ready.  Preloading is
+     * only a hint: bad entries are ignored here and reported by "load".
+     */
+
+    preload = Tcl_GetVar2(interp, "env", "TCL_PRELOAD", TCL_GLOBAL_ONLY);
+    if ((preload != NULL) && (Tcl_SplitList(NULL, preload, &numFiles,
+	    &fileNames) == TCL_OK)) {
+	for (i = 0; i < numFiles; i++) {
+	    if (Tcl_PreloadFile(interp, fileNames[i]) != TCL_OK) {
+		Tcl_ResetResult(interp);
+	    }
+	}
+	ckfree((char *) fileNames);
+    }
+
+    /*
+     * The notifier of this port adds a command of its own; it is created
+     * here because the builtin command table of the generic core is
+     * shared with the other ports.
+     */
+
+    Tcl_CreateObjCommand(interp, "::tcl::notifier", Tcl_NotifierObjCmd,
+	    (ClientData) NULL, (Tcl_CmdDeleteProc *) NULL);
 
     if (tclPreInitScript != NULL) {
         if (Tcl_Eval(interp, tclPreInitScript) == TCL_ERROR) {
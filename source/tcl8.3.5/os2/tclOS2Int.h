@@ -58,6 +58,7 @@ extern int openedFiles;	/* How many files opened (DosOpen/DosDuphandle) */
  */
 
 EXTERN void             TclOS2Init(HMODULE hModule);
+EXTERN void             TclOS2InitEncodingImage(void);
 /*
  * Use PM events? TRUE if PM version; set to FALSE by tclOS2Main if that is
  * compiled with CLI_VERSION defined.
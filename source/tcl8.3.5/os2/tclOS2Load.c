@@ -22,7 +22,10 @@
  *
  *	Dynamically loads a binary code file into memory and returns
  *	the addresses of two procedures within that file, if they
- *	are defined.
+ *	are defined.  If sym1 or sym2 is NULL, the corresponding
+ *	procedure isn't looked up; TclpFindSymbol can find it later.
+ *	interp may be NULL if no error message is wanted.  This
+ *	procedure may be called by several threads at once.
  *
  * Results:
  *	A standard Tcl completion code.  If an error occurs, an error
@@ -40,7 +43,8 @@ TclpLoadFile(interp, fileName, sym1, sym2, proc1Ptr, proc2Ptr, clientDataPtr)
     char *fileName;		/* Name of the file containing the desired
 				 * code. */
     char *sym1, *sym2;		/* Names of two procedures to look up in
-				 * the file's symbol table. */
+				 * the file's symbol table.  Either may be
+				 * NULL. */
     Tcl_PackageInitProc **proc1Ptr, **proc2Ptr;
 				/* Where to return the addresses corresponding
 				 * to sym1 and sym2. */
@@ -52,6 +56,8 @@ TclpLoadFile(interp, fileName, sym1, sym2, proc1Ptr, proc2Ptr, clientDataPtr)
     UCHAR LoadError[256];       /* Area for name of DLL that we failed on */
     char *nativeName;
     Tcl_DString ds;
+    APIRET rc;                  /* Not the global one: this procedure may
+                                 * run in several threads at once. */
 
     nativeName = Tcl_UtfToExternalDString(NULL, fileName, -1, &ds);
 #ifdef VERBOSE
@@ -64,6 +70,10 @@ TclpLoadFile(interp, fileName, sym1, sym2, proc1Ptr, proc2Ptr, clientDataPtr)
     *clientDataPtr = (ClientData) handle;
 
     if (rc != NO_ERROR) {
+        if (interp == NULL) {
+            Tcl_DStringFree(&ds);
+            return TCL_ERROR;
+        }
 	Tcl_AppendResult(interp, "couldn't load library \"", nativeName,
 		"\": ", (char *) NULL);
         switch (rc) {
@@ -144,69 +154,78 @@ TclpLoadFile(interp, fileName, sym1, sym2, proc1Ptr, proc2Ptr, clientDataPtr)
                         (char *) NULL);
                 TclOS2ConvertError(rc);
         }
+        Tcl_DStringFree(&ds);
 	return TCL_ERROR;
     }
 
+    Tcl_DStringFree(&ds);
+
+    if (sym1 != NULL) {
+        *proc1Ptr = TclpFindSymbol((ClientData) handle, sym1);
+    } else {
+        *proc1Ptr = NULL;
+    }
+    if (sym2 != NULL) {
+        *proc2Ptr = TclpFindSymbol((ClientData) handle, sym2);
+    } else {
+        *proc2Ptr = NULL;
+    }
+    
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclpFindSymbol --
+ *
+ *	Looks up a procedure in a file loaded by TclpLoadFile.
+ *
+ * Results:
+ *	The address of the procedure, or NULL if the file doesn't
+ *	define it.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tcl_PackageInitProc *
+TclpFindSymbol(clientData, symbol)
+    ClientData clientData;      /* ClientData returned by a previous call
+                                 * to TclpLoadFile(). */
+    CONST char *symbol;         /* Name of the procedure. */
+{
+    PFN proc;
+    Tcl_DString ds;
+    APIRET rc;
+
     /*
-     * For each symbol, check for both Symbol and _Symbol, since some
-     * compilers generate C symbols with a leading '_' by default.
+     * Check for both Symbol and _Symbol, since some compilers generate
+     * C symbols with a leading '_' by default.
      */
 
-    rc = DosQueryProcAddr(handle, 0L, sym1, (PFN *)proc1Ptr);
+    rc = DosQueryProcAddr((HMODULE) clientData, 0L, (PSZ) symbol, &proc);
     if (rc != NO_ERROR) {
 #ifdef VERBOSE
-        printf("DosQueryProcAddr %s ERROR %d\n", sym1, rc);
+        printf("DosQueryProcAddr %s ERROR %d\n", symbol, rc);
 #endif
+        Tcl_DStringInit(&ds);
         Tcl_DStringAppend(&ds, "_", 1);
-        sym1 = Tcl_DStringAppend(&ds, sym1, -1);
-        rc = DosQueryProcAddr(handle, 0L, sym1, (PFN *)proc1Ptr);
-        if (rc != NO_ERROR) {
+        Tcl_DStringAppend(&ds, symbol, -1);
+        rc = DosQueryProcAddr((HMODULE) clientData, 0L,
+                              (PSZ) Tcl_DStringValue(&ds), &proc);
 #ifdef VERBOSE
-            printf("DosQueryProcAddr %s ERROR %d\n", sym1, rc);
-#endif
-            *proc1Ptr = NULL;
-        }
-#ifdef VERBOSE
-          else {
-            printf("DosQueryProcAddr %s OK\n", sym1, rc);
-        }
+        printf("DosQueryProcAddr %s %s %d\n", Tcl_DStringValue(&ds),
+               (rc == NO_ERROR) ? "OK" : "ERROR", rc);
 #endif
         Tcl_DStringFree(&ds);
-    }
-#ifdef VERBOSE
-      else {
-        printf("DosQueryProcAddr %s OK\n", sym1, rc);
-    }
-#endif
-
-    rc = DosQueryProcAddr(handle, 0L, sym2, (PFN *)proc2Ptr);
-    if (rc != NO_ERROR) {
-#ifdef VERBOSE
-        printf("DosQueryProcAddr %s ERROR %d\n", sym2, rc);
-#endif
-        Tcl_DStringAppend(&ds, "_", 1);
-        sym2 = Tcl_DStringAppend(&ds, sym2, -1);
-        rc = DosQueryProcAddr(handle, 0L, sym2, (PFN *)proc2Ptr);
         if (rc != NO_ERROR) {
-#ifdef VERBOSE
-            printf("DosQueryProcAddr %s ERROR %d\n", sym2, rc);
-#endif
-            *proc2Ptr = NULL;
+            return NULL;
         }
-#ifdef VERBOSE
-          else {
-            printf("DosQueryProcAddr %s OK\n", sym2, rc);
-        }
-#endif
-        Tcl_DStringFree(&ds);
-    }
-#ifdef VERBOSE
-      else {
-        printf("DosQueryProcAddr %s OK\n", sym2, rc);
     }
-#endif
-    
-    return TCL_OK;
+    return (Tcl_PackageInitProc *) proc;
 }
 
 /*
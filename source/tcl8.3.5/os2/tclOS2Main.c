@@ -55,6 +55,8 @@ typedef struct ThreadSpecificData {
                                  * into Tcl commands. */
     Tcl_DString line;           /* Used to read the next line from the
                                  * terminal input. */
+    TclCompleteState complete;  /* Parse state of the contents of
+                                 * command. */
     int tty;                    /* Non-zero means standard input is a
                                  * terminal-like device.  Zero means it's
                                  * a file. */
@@ -160,8 +162,9 @@ Tcl_Main(argc, argv, appInitProc)
 {
     Tcl_Obj *resultPtr;
     Tcl_Obj *commandPtr = NULL;
-    char buffer[1000], *args;
+    char buffer[1000], *args, *cmd;
     int code, gotPartial, length;
+    TclCompleteState completeState;
     int exitCode = 0;
     Tcl_Channel inChannel, outChannel, errChannel;
     Tcl_Interp *interp;
@@ -319,6 +322,7 @@ Tcl_Main(argc, argv, appInitProc)
 
     commandPtr = Tcl_NewObj();
     Tcl_IncrRefCount(commandPtr);
+    TclInitCompleteState(&completeState);
 
     inChannel = Tcl_GetStdChannel(TCL_STDIN);
     outChannel = Tcl_GetStdChannel(TCL_STDOUT);
@@ -383,7 +387,8 @@ Tcl_Main(argc, argv, appInitProc)
              */
 
             Tcl_AppendToObj(commandPtr, "\n", 1);
-            if (!TclObjCommandComplete(commandPtr)) {
+            cmd = Tcl_GetStringFromObj(commandPtr, &length);
+            if (!TclIncrCommandComplete(&completeState, cmd, length)) {
                 gotPartial = 1;
                 continue;
             }
@@ -396,6 +401,7 @@ Tcl_Main(argc, argv, appInitProc)
             Tcl_DecrRefCount(commandPtr);
             commandPtr = Tcl_NewObj();
             Tcl_IncrRefCount(commandPtr);
+            TclInitCompleteState(&completeState);
             if (code != TCL_OK) {
                 if (errChannel) {
                     Tcl_WriteObj(errChannel, Tcl_GetObjResult(interp));
@@ -425,6 +431,7 @@ Tcl_Main(argc, argv, appInitProc)
                 }
                 Tcl_DStringInit(&tsdPtr->command);
                 Tcl_DStringInit(&tsdPtr->line);
+                TclInitCompleteState(&tsdPtr->complete);
 
                 (*mainLoopProc)();
                 mainLoopProc = NULL;
@@ -587,7 +594,8 @@ StdinProc(clientData, mask)
             &tsdPtr->line), -1);
     cmd = Tcl_DStringAppend(&tsdPtr->command, "\n", -1);
     Tcl_DStringFree(&tsdPtr->line);
-    if (!Tcl_CommandComplete(cmd)) {
+    if (!TclIncrCommandComplete(&tsdPtr->complete, cmd,
+            Tcl_DStringLength(&tsdPtr->command))) {
         gotPartial = 1;
         goto prompt;
     }
@@ -610,6 +618,7 @@ StdinProc(clientData, mask)
                 (ClientData) chan);
     }
     Tcl_DStringFree(&tsdPtr->command);
+    TclInitCompleteState(&tsdPtr->complete);
     if (Tcl_GetStringResult(interp)[0] != '\0') {
         if ((code != TCL_OK) || (tsdPtr->tty)) {
             chan = Tcl_GetStdChannel(TCL_STDOUT);
@@ -908,7 +908,8 @@ Tcl_WaitForEvent(
                 sizeof(FileHandlerEvent));
             fileEvPtr->header.proc = FileHandlerEventProc;
             fileEvPtr->fd = filePtr->fd;
-            Tcl_QueueEvent((Tcl_Event *) fileEvPtr, TCL_QUEUE_TAIL);
+            TclQueueTypedEvent((Tcl_Event *) fileEvPtr, TCL_QUEUE_TAIL,
+                    TCL_FILE_EVENTS);
         }
         filePtr->readyMask = mask;
     }
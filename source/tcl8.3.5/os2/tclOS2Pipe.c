@@ -182,6 +182,8 @@ static int            PipeBlockModeProc(ClientData instanceData, int mode);
 static void           PipeCheckProc (ClientData clientData, int flags);
 static int            PipeClose2Proc(ClientData instanceData,
                           Tcl_Interp *interp, int flags);
+static int            PipeEventDeleteProc(Tcl_Event *evPtr,
+                          ClientData clientData);
 static int            PipeEventProc(Tcl_Event *evPtr, int flags);
 static void           PipeExitHandler(ClientData clientData);
 static int            PipeGetHandleProc(ClientData instanceData, int direction,
@@ -414,7 +416,8 @@ PipeCheckProc(
             evPtr = (PipeEvent *) ckalloc(sizeof(PipeEvent));
             evPtr->header.proc = PipeEventProc;
             evPtr->infoPtr = infoPtr;
-            Tcl_QueueEvent((Tcl_Event *) evPtr, TCL_QUEUE_TAIL);
+            TclQueueTypedEvent((Tcl_Event *) evPtr, TCL_QUEUE_TAIL,
+                    TCL_FILE_EVENTS);
         }
     }
 }
@@ -2107,6 +2110,10 @@ PipeClose2Proc(
             break;
         }
     }
+    if (pipePtr->flags & PIPE_PENDING) {
+        TclDeleteTypedEvents(TCL_FILE_EVENTS, PipeEventDeleteProc,
+                (ClientData) pipePtr);
+    }
 
     /*
      * Wrap the error file into a channel and give it to the cleanup
@@ -2475,6 +2482,32 @@ PipeEventProc(
     Tcl_NotifyChannel(infoPtr->channel, infoPtr->watchMask & mask);
     return 1;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PipeEventDeleteProc --
+ *
+ *	Tcl_EventDeleteProc used by PipeClose2Proc to remove the event
+ *	still queued for a pipe that is being closed.
+ *
+ * Results:
+ *	1 if evPtr is a PipeEvent for the pipe, 0 otherwise.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+PipeEventDeleteProc(
+    Tcl_Event *evPtr,           /* Event to check. */
+    ClientData clientData)      /* PipeInfo of the pipe being closed. */
+{
+    return ((evPtr->proc == PipeEventProc)
+            && (((PipeEvent *) evPtr)->infoPtr == (PipeInfo *) clientData));
+}
 
 /*
  *----------------------------------------------------------------------
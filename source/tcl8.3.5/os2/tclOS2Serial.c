@@ -167,6 +167,8 @@ static int		SerialBlockProc(ClientData instanceData, int mode);
 static void		SerialCheckProc(ClientData clientData, int flags);
 static int		SerialCloseProc(ClientData instanceData,
 			    Tcl_Interp *interp);
+static int		SerialEventDeleteProc(Tcl_Event *evPtr,
+			    ClientData clientData);
 static int		SerialEventProc(Tcl_Event *evPtr, int flags);
 static void		SerialExitHandler(ClientData clientData);
 static int		SerialGetHandleProc(ClientData instanceData,
@@ -486,7 +488,8 @@ SerialCheckProc(
             evPtr = (SerialEvent *) ckalloc(sizeof(SerialEvent));
             evPtr->header.proc = SerialEventProc;
             evPtr->infoPtr = infoPtr;
-            Tcl_QueueEvent((Tcl_Event *) evPtr, TCL_QUEUE_TAIL);
+            TclQueueTypedEvent((Tcl_Event *) evPtr, TCL_QUEUE_TAIL,
+                    TCL_FILE_EVENTS);
         }
     }
 }
@@ -636,6 +639,10 @@ SerialCloseProc(
 	    break;
 	}
     }
+    if (serialPtr->flags & SERIAL_PENDING) {
+	TclDeleteTypedEvents(TCL_FILE_EVENTS, SerialEventDeleteProc,
+		(ClientData) serialPtr);
+    }
 
     /*
      * Wrap the error file into a channel and give it to the cleanup
@@ -918,6 +925,32 @@ SerialEventProc(
     Tcl_NotifyChannel(infoPtr->channel, infoPtr->watchMask & mask);
     return 1;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SerialEventDeleteProc --
+ *
+ *	Tcl_EventDeleteProc used by SerialCloseProc to remove the event
+ *	still queued for a serial port that is being closed.
+ *
+ * Results:
+ *	1 if evPtr is a SerialEvent for the port, 0 otherwise.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+SerialEventDeleteProc(
+    Tcl_Event *evPtr,		/* Event to check. */
+    ClientData clientData)	/* SerialInfo of the port being closed. */
+{
+    return ((evPtr->proc == SerialEventProc)
+	    && (((SerialEvent *) evPtr)->infoPtr == (SerialInfo *) clientData));
+}
 
 /*
  *----------------------------------------------------------------------
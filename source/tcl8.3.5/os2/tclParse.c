@@ -171,17 +171,286 @@ static char typeTable[] = {
     TYPE_NORMAL,      TYPE_NORMAL,      TYPE_NORMAL,      TYPE_NORMAL,
 };
 
+/*
+ * The structures below are used to cache the parsed form of scripts
+ * evaluated by Tcl_EvalEx.  Callbacks such as "after" handlers and
+ * event bindings evaluate the same script strings over and over, and
+ * parsing them again each time dominates the cost of a simple callback.
+ * Each interpreter keeps a cache (as associated data) keyed by the
+ * script's contents; an entry holds the tokens for all of the
+ * script's commands, plus objects for the words that are simple
+ * literals, so that a repeated evaluation can skip parsing entirely.
+ */
+
+typedef struct CachedCommand {
+    char *commandStart;		/* First character of the command, in the
+				 * entry's copy of the script. */
+    int commandSize;		/* Number of bytes in the command,
+				 * including the terminating character,
+				 * if any. */
+    int numWords;		/* Number of words in the command. */
+    int tokenIndex;		/* Index of the command's first token in
+				 * the entry's token array. */
+    int wordIndex;		/* Index of the command's first word in
+				 * the entry's literal array. */
+} CachedCommand;
+
+typedef struct ParseCacheEntry {
+    char *script;		/* Null-terminated copy of the script.  The
+				 * tokens below point into this copy.
+				 * Malloc-ed. */
+    int numBytes;		/* Number of bytes in the script, not
+				 * including the terminating null. */
+    unsigned int hash;		/* Hash value computed from the script's
+				 * bytes; key of the entry in the cache's
+				 * hash table. */
+    CachedCommand *commands;	/* Array of numCommands commands in the
+				 * script.  Malloc-ed. */
+    int numCommands;
+    Tcl_Token *tokens;		/* Tokens for all of the commands,
+				 * concatenated.  Malloc-ed. */
+    int numTokens;
+    Tcl_Obj **literals;		/* One element for each word of each
+				 * command: an object holding the value of
+				 * the word if it is a simple word, NULL
+				 * otherwise.  Each object holds a
+				 * reference.  Malloc-ed. */
+    int numLiterals;
+    int size;			/* Approximate number of bytes of memory
+				 * used by this entry. */
+    int refCount;		/* Number of calls to Tcl_EvalEx currently
+				 * executing commands from this entry. The
+				 * entry is not freed while this is > 0. */
+    int dead;			/* Non-zero means the entry has been
+				 * removed from its cache and should be
+				 * freed when refCount drops to 0. */
+    struct ParseCache *cachePtr;
+				/* Cache that holds the entry. */
+    struct ParseCacheEntry *hashNextPtr;
+				/* Next entry whose script has the same
+				 * hash value, or NULL. */
+    struct ParseCacheEntry *prevPtr;
+				/* Previous (more recently used) entry in
+				 * the cache's LRU list, or NULL. */
+    struct ParseCacheEntry *nextPtr;
+				/* Next (less recently used) entry in the
+				 * cache's LRU list, or NULL. */
+} ParseCacheEntry;
+
+/*
+ * Words that are simple literals (command names, options such as "-text"
+ * and the like) are interned in a table of shared objects, one per
+ * distinct string, which is also kept in the ParseCache.  Tcl_EvalEx
+ * passes these objects to commands instead of creating a fresh object
+ * for each word, so internal representations computed by a command
+ * (the command lookup for the command name, index lookups for options)
+ * survive from one evaluation to the next.
+ */
+
+typedef struct LiteralWord {
+    Tcl_Obj *objPtr;		/* Object holding the word; the table
+				 * holds a reference to it. */
+    unsigned int hash;		/* Hash value of the word's bytes. */
+    struct LiteralWord *nextPtr;
+				/* Next word with the same hash value, or
+				 * NULL. */
+} LiteralWord;
+
+/*
+ * EvalObjv remembers the commands that recently used command names
+ * resolved to in a small direct-mapped table in the ParseCache, indexed
+ * by the address of the object holding the name.  Because Tcl_EvalEx
+ * passes the same interned object for a literal command name each time,
+ * loops find their commands there without looking at the object's
+ * internal representation, which is lost whenever the same word is
+ * also used as an argument of another type.  A slot is only used if
+ * nothing that could change the outcome of the lookup has happened
+ * since it was filled: the command's cmdEpoch (incremented when it is
+ * renamed, deleted, hidden or exposed) and the current namespace's
+ * cmdRefEpoch (a new command shadows one already resolved from it) and
+ * resolverEpoch (its resolution rules changed) must all be unchanged.
+ */
+
+typedef struct CmdCacheSlot {
+    Tcl_Obj *objPtr;		/* Command name, or NULL if the slot is
+				 * unused.  The slot holds a reference to
+				 * it. */
+    Command *cmdPtr;		/* Command that the name resolved to.  The
+				 * slot holds a reference to it. */
+    int cmdEpoch;		/* Value of cmdPtr->cmdEpoch when the slot
+				 * was filled. */
+    Namespace *nsPtr;		/* Namespace in which the name was
+				 * resolved. */
+    long nsId;			/* Unique id of that namespace, in case it
+				 * is deleted and its storage reused. */
+    int nsCmdRefEpoch;		/* Values of the namespace's cmdRefEpoch */
+    int nsResolverEpoch;	/* and resolverEpoch at that time. */
+} CmdCacheSlot;
+
+#define CMD_CACHE_SIZE		64
+
+typedef struct ParseCache {
+    Tcl_HashTable table;	/* Maps from hash values (one-word keys)
+				 * to the first ParseCacheEntry with that
+				 * hash value. */
+    ParseCacheEntry *firstPtr;	/* Most recently used entry. */
+    ParseCacheEntry *lastPtr;	/* Least recently used entry; the first
+				 * to be evicted. */
+    int numEntries;		/* Number of entries in the cache. */
+    long totalSize;		/* Sum of the size fields of all entries. */
+    long hits;			/* Number of evaluations that found their
+				 * script in the cache. */
+    long misses;		/* Number of evaluations of cacheable
+				 * scripts that had to parse them. */
+    long evictions;		/* Number of entries discarded to keep
+				 * totalSize within PARSE_CACHE_MAX_SIZE. */
+    Tcl_HashTable literalTable;	/* Maps from hash values (one-word keys)
+				 * to the first LiteralWord with that hash
+				 * value. */
+    int numLiterals;		/* Number of words in literalTable. */
+    long literalHits;		/* Number of words found in literalTable. */
+    long literalMisses;		/* Number of words added to literalTable. */
+    CmdCacheSlot cmdCache[CMD_CACHE_SIZE];
+				/* Commands resolved by EvalObjv. */
+    long cmdHits;		/* Number of command names found in
+				 * cmdCache. */
+    long cmdMisses;		/* Number of command names that had to be
+				 * looked up. */
+    long cmdInvalidations;	/* Number of lookups that found their name
+				 * in cmdCache, but with a resolution that
+				 * was no longer valid. */
+} ParseCache;
+
+/*
+ * Scripts longer than PARSE_CACHE_MAX_SCRIPT bytes are never cached: they
+ * are usually sourced once, and keeping a copy of them would only evict
+ * the short callback scripts the cache is meant for.  When the memory
+ * charged to a cache exceeds PARSE_CACHE_MAX_SIZE bytes, least recently
+ * used entries are discarded until it fits again.
+ */
+
+#define PARSE_CACHE_MAX_SCRIPT	4096
+#define PARSE_CACHE_MAX_SIZE	(256*1024)
+
+/*
+ * Only words of up to LITERAL_WORD_MAX bytes are interned.  When the
+ * literal table holds more than LITERAL_TABLE_MAX words it is emptied;
+ * objects still in use by commands or cache entries live on.
+ */
+
+#define LITERAL_WORD_MAX	64
+#define LITERAL_TABLE_MAX	1024
+
+/*
+ * Token arrays that outgrow the static space in a Tcl_Parse structure
+ * are normally allocated with ckalloc, copied each time they double in
+ * size and freed again by Tcl_FreeParse after each command.  While
+ * Tcl_EvalEx is parsing a command, token arrays are carved out of a
+ * per-thread arena instead: a list of large blocks handed out
+ * sequentially, where the most recent array can often grow in place.
+ * Tcl_EvalEx records the arena's fill level before it parses a command
+ * and releases everything above it in one step once the command has
+ * been executed.  Nested evaluations (command substitutions, scripts
+ * invoked by the command) mark and release above the outer level, so
+ * storage is always released in stack order.
+ *
+ * Parses that happen outside of Tcl_EvalEx's parse phase (e.g. those
+ * done by the compiler) never use the arena, because nothing would
+ * ever release their storage in bulk.
+ */
+
+typedef struct ArenaBlock {
+    struct ArenaBlock *nextPtr;	/* Next block in the arena, or NULL. */
+    char *limit;		/* First byte after the block's storage;
+				 * the storage starts right after this
+				 * structure. */
+} ArenaBlock;
+
+#define ARENA_BLOCK_SIZE	(16*1024)
+#define ARENA_STORAGE(blockPtr)	((char *) ((blockPtr) + 1))
+
+/*
+ * An ArenaMark records the fill level of the arena, so that all storage
+ * allocated after the mark was taken can be released at once.
+ */
+
+typedef struct ArenaMark {
+    ArenaBlock *blockPtr;	/* Block being filled; NULL means that the
+				 * arena was empty. */
+    char *free;			/* First free byte in that block. */
+} ArenaMark;
+
+typedef struct ThreadSpecificData {
+    int initialized;		/* Non-zero means the exit handler that
+				 * frees the arena has been registered. */
+    ArenaBlock *firstBlockPtr;	/* First block in the arena, or NULL. Blocks
+				 * past the current one are kept for
+				 * reuse. */
+    ArenaBlock *curBlockPtr;	/* Block that allocations come from, or
+				 * NULL if nothing is allocated. */
+    char *free;			/* First free byte in curBlockPtr. */
+    char *lastAlloc;		/* Most recent allocation; it can be
+				 * extended or released in place. */
+    int parseDepth;		/* Greater than 0 while Tcl_EvalEx is
+				 * parsing: token arrays come from the
+				 * arena only then. */
+    long arenaAllocs;		/* Number of token arrays allocated from
+				 * the arena rather than with ckalloc. */
+    long arenaGrows;		/* Number of token arrays that were
+				 * expanded in place. */
+    long arenaBlocks;		/* Number of blocks allocated for the
+				 * arena with ckalloc. */
+} ThreadSpecificData;
+
+static Tcl_ThreadDataKey dataKey;
+
 /*
  * Prototypes for local procedures defined in this file:
  */
 
+static char *		ArenaAlloc _ANSI_ARGS_((ThreadSpecificData *tsdPtr,
+			    int size));
+static void		ArenaExitHandler _ANSI_ARGS_((
+			    ClientData clientData));
+static void		ArenaMarkLevel _ANSI_ARGS_((
+			    ThreadSpecificData *tsdPtr, ArenaMark *markPtr));
+static void		ArenaRelease _ANSI_ARGS_((ThreadSpecificData *tsdPtr,
+			    ArenaMark *markPtr));
+static int		FreeArenaTokens _ANSI_ARGS_((Tcl_Token *tokenPtr));
 static int		CommandComplete _ANSI_ARGS_((char *script,
 			    int length));
 static int		ParseTokens _ANSI_ARGS_((char *src, int mask,
 			    Tcl_Parse *parsePtr));
-static int		EvalObjv _ANSI_ARGS_((Tcl_Interp *interp, int objc,
+static int		ScanBraces _ANSI_ARGS_((
+			    TclCompleteState *statePtr, char *script,
+			    int length));
+static int		EvalObjv _ANSI_ARGS_((Tcl_Interp *interp,
+			    ParseCache *cachePtr, int objc,
 			    Tcl_Obj *CONST objv[], char *command, int length,
 			    int flags));
+static ParseCacheEntry *	CreateParseCacheEntry _ANSI_ARGS_((
+			    ParseCache *cachePtr, char *script,
+			    int numBytes, unsigned int hash));
+static void		DeleteParseCacheProc _ANSI_ARGS_((
+			    ClientData clientData, Tcl_Interp *interp));
+static int		EvalCachedScript _ANSI_ARGS_((Tcl_Interp *interp,
+			    ParseCacheEntry *entryPtr));
+static void		FlushCommandCache _ANSI_ARGS_((
+			    ParseCache *cachePtr));
+static void		FlushLiteralWords _ANSI_ARGS_((
+			    ParseCache *cachePtr));
+static void		FreeParseCacheEntry _ANSI_ARGS_((
+			    ParseCacheEntry *entryPtr));
+static Tcl_Obj *	GetLiteralWord _ANSI_ARGS_((ParseCache *cachePtr,
+			    char *bytes, int length));
+static ParseCache *	GetParseCache _ANSI_ARGS_((Tcl_Interp *interp));
+static Command *	LookupCommand _ANSI_ARGS_((Tcl_Interp *interp,
+			    ParseCache *cachePtr, Tcl_Obj *objPtr));
+static ParseCacheEntry *	LookupParseCache _ANSI_ARGS_((
+			    ParseCache *cachePtr, char *script,
+			    int numBytes));
+static void		RemoveParseCacheEntry _ANSI_ARGS_((
+			    ParseCacheEntry *entryPtr));
 
 /*
  *----------------------------------------------------------------------
@@ -607,9 +876,7 @@ ParseTokens(src, mask, parsePtr)
 		    return TCL_ERROR;
 		}
 		src = nested.commandStart + nested.commandSize;
-		if (nested.tokenPtr != nested.staticTokens) {
-		    ckfree((char *) nested.tokenPtr);
-		}
+		Tcl_FreeParse(&nested);
 		if ((*nested.term == ']') && !nested.incomplete) {
 		    break;
 		}
@@ -709,7 +976,9 @@ Tcl_FreeParse(parsePtr)
 				 * previous call to Tcl_ParseCommand. */
 {
     if (parsePtr->tokenPtr != parsePtr->staticTokens) {
-	ckfree((char *) parsePtr->tokenPtr);
+	if (!FreeArenaTokens(parsePtr->tokenPtr)) {
+	    ckfree((char *) parsePtr->tokenPtr);
+	}
 	parsePtr->tokenPtr = parsePtr->staticTokens;
     }
 }
@@ -729,6 +998,8 @@ Tcl_FreeParse(parsePtr)
  * Side effects:
  *	Memory is allocated for a new larger token array; the memory
  *	for the old array is freed, if it had been dynamically allocated.
+ *	While Tcl_EvalEx is parsing, the memory comes from the thread's
+ *	token arena instead, and the array may be extended in place.
  *
  *----------------------------------------------------------------------
  */
@@ -738,19 +1009,300 @@ TclExpandTokenArray(parsePtr)
     Tcl_Parse *parsePtr;	/* Parse structure whose token space
 				 * has overflowed. */
 {
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
     int newCount;
     Tcl_Token *newPtr;
 
     newCount = parsePtr->tokensAvailable*2;
-    newPtr = (Tcl_Token *) ckalloc((unsigned) (newCount * sizeof(Tcl_Token)));
+    if (tsdPtr->parseDepth > 0) {
+	/*
+	 * Tcl_EvalEx is parsing: take the space from the arena.  If the
+	 * current array is the arena's most recent allocation and there
+	 * is room after it, just extend it.
+	 */
+
+	if (((char *) parsePtr->tokenPtr == tsdPtr->lastAlloc)
+		&& ((tsdPtr->lastAlloc + newCount * sizeof(Tcl_Token))
+			<= tsdPtr->curBlockPtr->limit)) {
+	    tsdPtr->free = tsdPtr->lastAlloc + newCount * sizeof(Tcl_Token);
+	    parsePtr->tokensAvailable = newCount;
+	    tsdPtr->arenaGrows++;
+	    return;
+	}
+	newPtr = (Tcl_Token *) ArenaAlloc(tsdPtr,
+		(int) (newCount * sizeof(Tcl_Token)));
+	tsdPtr->arenaAllocs++;
+    } else {
+	newPtr = (Tcl_Token *) ckalloc((unsigned)
+		(newCount * sizeof(Tcl_Token)));
+    }
     memcpy((VOID *) newPtr, (VOID *) parsePtr->tokenPtr,
 	    (size_t) (parsePtr->tokensAvailable * sizeof(Tcl_Token)));
-    if (parsePtr->tokenPtr != parsePtr->staticTokens) {
+    if ((parsePtr->tokenPtr != parsePtr->staticTokens)
+	    && !FreeArenaTokens(parsePtr->tokenPtr)) {
 	ckfree((char *) parsePtr->tokenPtr);
     }
     parsePtr->tokenPtr = newPtr;
     parsePtr->tokensAvailable = newCount;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ArenaAlloc --
+ *
+ *	Allocates storage from the calling thread's token arena.
+ *
+ * Results:
+ *	A pointer to size bytes of storage, suitably aligned for an
+ *	array of Tcl_Tokens.
+ *
+ * Side effects:
+ *	A new block is allocated if none of the arena's blocks has
+ *	enough free space.  The first call in a thread registers an
+ *	exit handler to free the arena.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static char *
+ArenaAlloc(tsdPtr, size)
+    ThreadSpecificData *tsdPtr;	/* Thread data holding the arena. */
+    int size;			/* Number of bytes needed. */
+{
+    ArenaBlock *blockPtr, *lastPtr;
+    char *result;
+    int blockSize;
+
+    size = (size + 7) & ~7;
+    blockPtr = tsdPtr->curBlockPtr;
+    if ((blockPtr == NULL) || ((tsdPtr->free + size) > blockPtr->limit)) {
+	/*
+	 * Move on to the next retained block with enough room, or add
+	 * a new block at the end of the arena.
+	 */
+
+	lastPtr = blockPtr;
+	blockPtr = (blockPtr == NULL) ? tsdPtr->firstBlockPtr
+		: blockPtr->nextPtr;
+	for ( ; blockPtr != NULL; blockPtr = blockPtr->nextPtr) {
+	    if ((ARENA_STORAGE(blockPtr) + size) <= blockPtr->limit) {
+		break;
+	    }
+	    lastPtr = blockPtr;
+	}
+	if (blockPtr == NULL) {
+	    if (!tsdPtr->initialized) {
+		tsdPtr->initialized = 1;
+		Tcl_CreateThreadExitHandler(ArenaExitHandler, NULL);
+	    }
+	    blockSize = (size > ARENA_BLOCK_SIZE) ? size : ARENA_BLOCK_SIZE;
+	    blockPtr = (ArenaBlock *) ckalloc((unsigned)
+		    (sizeof(ArenaBlock) + blockSize));
+	    blockPtr->limit = ARENA_STORAGE(blockPtr) + blockSize;
+	    blockPtr->nextPtr = NULL;
+	    while ((lastPtr != NULL) && (lastPtr->nextPtr != NULL)) {
+		lastPtr = lastPtr->nextPtr;
+	    }
+	    if (lastPtr == NULL) {
+		tsdPtr->firstBlockPtr = blockPtr;
+	    } else {
+		lastPtr->nextPtr = blockPtr;
+	    }
+	    tsdPtr->arenaBlocks++;
+	}
+	tsdPtr->curBlockPtr = blockPtr;
+	tsdPtr->free = ARENA_STORAGE(blockPtr);
+    }
+    result = tsdPtr->free;
+    tsdPtr->free += size;
+    tsdPtr->lastAlloc = result;
+    return result;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ArenaMarkLevel --
+ *
+ *	Records the current fill level of the calling thread's token
+ *	arena.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	*markPtr is filled in, for a later call to ArenaRelease.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ArenaMarkLevel(tsdPtr, markPtr)
+    ThreadSpecificData *tsdPtr;	/* Thread data holding the arena. */
+    ArenaMark *markPtr;		/* Filled in with the arena's level. */
+{
+    markPtr->blockPtr = tsdPtr->curBlockPtr;
+    markPtr->free = tsdPtr->free;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ArenaRelease --
+ *
+ *	Releases all storage allocated from the calling thread's token
+ *	arena since a mark was taken.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The storage becomes available for reuse.  When the arena becomes
+ *	empty, all blocks but the first are freed, so that one huge
+ *	command doesn't tie up memory forever.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ArenaRelease(tsdPtr, markPtr)
+    ThreadSpecificData *tsdPtr;	/* Thread data holding the arena. */
+    ArenaMark *markPtr;		/* Level recorded by ArenaMarkLevel. */
+{
+    ArenaBlock *blockPtr, *nextPtr;
+
+    tsdPtr->curBlockPtr = markPtr->blockPtr;
+    tsdPtr->free = markPtr->free;
+    tsdPtr->lastAlloc = NULL;
+    if ((markPtr->blockPtr == NULL) && (tsdPtr->firstBlockPtr != NULL)) {
+	for (blockPtr = tsdPtr->firstBlockPtr->nextPtr; blockPtr != NULL;
+		blockPtr = nextPtr) {
+	    nextPtr = blockPtr->nextPtr;
+	    ckfree((char *) blockPtr);
+	}
+	tsdPtr->firstBlockPtr->nextPtr = NULL;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FreeArenaTokens --
+ *
+ *	Called to free a dynamically allocated token array; determines
+ *	whether the array came from the calling thread's token arena.
+ *
+ * Results:
+ *	Returns 1 if the array is part of the arena (in which case the
+ *	caller must not free it), 0 if it was allocated with ckalloc.
+ *
+ * Side effects:
+ *	If the array is the arena's most recent allocation, its storage
+ *	is reused right away.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+FreeArenaTokens(tokenPtr)
+    Tcl_Token *tokenPtr;	/* Token array to free. */
+{
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+    ArenaBlock *blockPtr;
+    char *p = (char *) tokenPtr;
+
+    if (p == tsdPtr->lastAlloc) {
+	tsdPtr->free = tsdPtr->lastAlloc;
+	tsdPtr->lastAlloc = NULL;
+	return 1;
+    }
+    for (blockPtr = tsdPtr->firstBlockPtr; blockPtr != NULL;
+	    blockPtr = blockPtr->nextPtr) {
+	if ((p >= ARENA_STORAGE(blockPtr)) && (p < blockPtr->limit)) {
+	    return 1;
+	}
+    }
+    return 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ArenaExitHandler --
+ *
+ *	This procedure is a Tcl_ExitProc used to free the token arena
+ *	of a thread.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	All of the arena's blocks are freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ArenaExitHandler(clientData)
+    ClientData clientData;	/* Not used. */
+{
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+    ArenaBlock *blockPtr, *nextPtr;
+
+    for (blockPtr = tsdPtr->firstBlockPtr; blockPtr != NULL;
+	    blockPtr = nextPtr) {
+	nextPtr = blockPtr->nextPtr;
+	ckfree((char *) blockPtr);
+    }
+    tsdPtr->firstBlockPtr = NULL;
+    tsdPtr->curBlockPtr = NULL;
+    tsdPtr->free = NULL;
+    tsdPtr->lastAlloc = NULL;
+    tsdPtr->initialized = 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclParseArenaInfo --
+ *
+ *	Returns statistics about the calling thread's token arena.  Used
+ *	by the "testparsecache" command.
+ *
+ * Results:
+ *	A new object holding a list of alternating names and values:
+ *	allocs (token arrays taken from the arena), grows (arrays expanded
+ *	in place), blocks (ckalloc calls made for the arena itself) and
+ *	saved (the number of ckalloc calls avoided overall).
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tcl_Obj *
+TclParseArenaInfo()
+{
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+    Tcl_Obj *listPtr;
+
+    listPtr = Tcl_NewListObj(0, (Tcl_Obj **) NULL);
+    Tcl_ListObjAppendElement(NULL, listPtr, Tcl_NewStringObj("allocs", -1));
+    Tcl_ListObjAppendElement(NULL, listPtr,
+	    Tcl_NewLongObj(tsdPtr->arenaAllocs));
+    Tcl_ListObjAppendElement(NULL, listPtr, Tcl_NewStringObj("grows", -1));
+    Tcl_ListObjAppendElement(NULL, listPtr,
+	    Tcl_NewLongObj(tsdPtr->arenaGrows));
+    Tcl_ListObjAppendElement(NULL, listPtr, Tcl_NewStringObj("blocks", -1));
+    Tcl_ListObjAppendElement(NULL, listPtr,
+	    Tcl_NewLongObj(tsdPtr->arenaBlocks));
+    Tcl_ListObjAppendElement(NULL, listPtr, Tcl_NewStringObj("saved", -1));
+    Tcl_ListObjAppendElement(NULL, listPtr, Tcl_NewLongObj(
+	    tsdPtr->arenaAllocs + tsdPtr->arenaGrows - tsdPtr->arenaBlocks));
+    return listPtr;
+}
 
 /*
  *----------------------------------------------------------------------
@@ -773,10 +1325,13 @@ TclExpandTokenArray(parsePtr)
  */
 
 static int
-EvalObjv(interp, objc, objv, command, length, flags)
+EvalObjv(interp, cachePtr, objc, objv, command, length, flags)
     Tcl_Interp *interp;		/* Interpreter in which to evaluate the
 				 * command.  Also used for error
 				 * reporting. */
+    ParseCache *cachePtr;	/* Interpreter's parse cache, whose command
+				 * table is used to find the command, or
+				 * NULL to look it up directly. */
     int objc;			/* Number of words in command. */
     Tcl_Obj *CONST objv[];	/* An array of pointers to objects that are
 				 * the words that make up the command. */
@@ -853,7 +1408,7 @@ EvalObjv(interp, objc, objv, command, length, flags)
      * to execute it.
      */
     
-    cmdPtr = (Command *) Tcl_GetCommandFromObj(interp, objv[0]);
+    cmdPtr = LookupCommand(interp, cachePtr, objv[0]);
     if (cmdPtr == NULL) {
 	newObjv = (Tcl_Obj **) ckalloc((unsigned)
 		((objc + 1) * sizeof (Tcl_Obj *)));
@@ -869,7 +1424,8 @@ EvalObjv(interp, objc, objv, command, length, flags)
 		    (char *) NULL);
 	    code = TCL_ERROR;
 	} else {
-	    code = EvalObjv(interp, objc+1, newObjv, command, length, 0);
+	    code = EvalObjv(interp, cachePtr, objc+1, newObjv, command,
+		    length, 0);
 	}
 	Tcl_DecrRefCount(newObjv[0]);
 	ckfree((char *) newObjv);
@@ -1016,7 +1572,8 @@ Tcl_EvalObjv(interp, objc, objv, flags)
      */
     switch (code) {
 	case TCL_OK:
-	    code = EvalObjv(interp, objc, objv, cmdString, cmdLen, flags);
+	    code = EvalObjv(interp, (ParseCache *) NULL, objc, objv,
+		    cmdString, cmdLen, flags);
 	    if (code == TCL_ERROR && cmdLen == 0)
 		goto cmdtraced;
 	    break;
@@ -1316,8 +1873,13 @@ Tcl_EvalEx(interp, script, numBytes, flags)
 				 * supported. */
 {
     Interp *iPtr = (Interp *) interp;
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
     char *p, *next;
     Tcl_Parse parse;
+    ArenaMark mark;		/* Level of the token arena before the
+				 * current command was parsed. */
+    ParseCache *cachePtr;	/* Interpreter's parse cache, or NULL if
+				 * the interpreter is being deleted. */
 #define NUM_STATIC_OBJS 20
     Tcl_Obj *staticObjArray[NUM_STATIC_OBJS], **objv;
     Tcl_Token *tokenPtr;
@@ -1357,9 +1919,37 @@ Tcl_EvalEx(interp, script, numBytes, flags)
 	nested = 0;
     }
     iPtr->evalFlags = 0;
+
+    /*
+     * Look for short scripts in the interpreter's parse cache; if their
+     * commands have been parsed before (or can be parsed without error
+     * now), execute them straight from the cache.  Scripts terminated
+     * by a close bracket are always parsed afresh.
+     */
+
+    if (iPtr->flags & DELETED) {
+	cachePtr = NULL;
+    } else {
+	cachePtr = GetParseCache(interp);
+    }
+    if ((cachePtr != NULL) && (nested == 0)
+	    && (numBytes <= PARSE_CACHE_MAX_SCRIPT)) {
+	ParseCacheEntry *entryPtr;
+
+	entryPtr = LookupParseCache(cachePtr, script, numBytes);
+	if (entryPtr != NULL) {
+	    code = EvalCachedScript(interp, entryPtr);
+	    iPtr->varFramePtr = savedVarFramePtr;
+	    return code;
+	}
+    }
+
     do {
-	if (Tcl_ParseCommand(interp, p, bytesLeft, nested, &parse)
-	        != TCL_OK) {
+	ArenaMarkLevel(tsdPtr, &mark);
+	tsdPtr->parseDepth++;
+	code = Tcl_ParseCommand(interp, p, bytesLeft, nested, &parse);
+	tsdPtr->parseDepth--;
+	if (code != TCL_OK) {
 	    code = TCL_ERROR;
 	    goto error;
 	}
@@ -1367,6 +1957,8 @@ Tcl_EvalEx(interp, script, numBytes, flags)
 	if (parse.numWords > 0) {
 	    /*
 	     * Generate an array of objects for the words of the command.
+	     * Short words that are simple literals are taken from the
+	     * interpreter's table of interned words.
 	     */
     
 	    if (parse.numWords <= NUM_STATIC_OBJS) {
@@ -1378,6 +1970,14 @@ Tcl_EvalEx(interp, script, numBytes, flags)
 	    for (objectsUsed = 0, tokenPtr = parse.tokenPtr;
 		    objectsUsed < parse.numWords;
 		    objectsUsed++, tokenPtr += (tokenPtr->numComponents + 1)) {
+		if ((cachePtr != NULL)
+			&& (tokenPtr->type == TCL_TOKEN_SIMPLE_WORD)
+			&& (tokenPtr[1].size <= LITERAL_WORD_MAX)) {
+		    objv[objectsUsed] = GetLiteralWord(cachePtr,
+			    tokenPtr[1].start, tokenPtr[1].size);
+		    Tcl_IncrRefCount(objv[objectsUsed]);
+		    continue;
+		}
 		objv[objectsUsed] = Tcl_EvalTokens(interp, tokenPtr+1,
 			tokenPtr->numComponents);
 		if (objv[objectsUsed] == NULL) {
@@ -1390,7 +1990,7 @@ Tcl_EvalEx(interp, script, numBytes, flags)
 	     * Execute the command and free the objects for its words.
 	     */
     
-	    code = EvalObjv(interp, objectsUsed, objv, p,
+	    code = EvalObjv(interp, cachePtr, objectsUsed, objv, p,
 	            parse.commandStart + parse.commandSize - p, 0);
 	    if (code != TCL_OK) {
 		goto error;
@@ -1413,6 +2013,7 @@ Tcl_EvalEx(interp, script, numBytes, flags)
 	bytesLeft -= next - p;
 	p = next;
 	Tcl_FreeParse(&parse);
+	ArenaRelease(tsdPtr, &mark);
 	gotParse = 0;
 	if ((nested != 0) && (p > script) && (p[-1] == ']')) {
 	    /*
@@ -1510,6 +2111,7 @@ Tcl_EvalEx(interp, script, numBytes, flags)
     if (objv != staticObjArray) {
 	ckfree((char *) objv);
     }
+    ArenaRelease(tsdPtr, &mark);
     iPtr->varFramePtr = savedVarFramePtr;
     return code;
 }
@@ -1517,94 +2119,1053 @@ Tcl_EvalEx(interp, script, numBytes, flags)
 /*
  *----------------------------------------------------------------------
  *
- * Tcl_Eval --
+ * GetParseCache --
  *
- *	Execute a Tcl command in a string.  This procedure executes the
- *	script directly, rather than compiling it to bytecodes.  Before
- *	the arrival of the bytecode compiler in Tcl 8.0 Tcl_Eval was
- *	the main procedure used for executing Tcl commands, but nowadays
- *	it isn't used much.
+ *	Returns the parse cache for an interpreter, creating it if it
+ *	doesn't exist yet.
  *
  * Results:
- *	The return value is one of the return codes defined in tcl.h
- *	(such as TCL_OK), and interp's result contains a value
- *	to supplement the return code. The value of the result
- *	will persist only until the next call to Tcl_Eval or Tcl_EvalObj:
- *	you must copy it or lose it!
+ *	A pointer to the interpreter's ParseCache.
  *
  * Side effects:
- *	Can be almost arbitrary, depending on the commands in the script.
+ *	The first call for an interpreter allocates the cache and
+ *	registers it as associated data of the interpreter, so that
+ *	it is freed when the interpreter is deleted.
  *
  *----------------------------------------------------------------------
  */
 
-int
-Tcl_Eval(interp, string)
-    Tcl_Interp *interp;		/* Token for command interpreter (returned
-				 * by previous call to Tcl_CreateInterp). */
-    char *string;		/* Pointer to TCL command to execute. */
+static ParseCache *
+GetParseCache(interp)
+    Tcl_Interp *interp;		/* Interpreter whose cache is wanted. */
 {
-    int code;
-
-    code = Tcl_EvalEx(interp, string, -1, 0);
-
-    /*
-     * For backwards compatibility with old C code that predates the
-     * object system in Tcl 8.0, we have to mirror the object result
-     * back into the string result (some callers may expect it there).
-     */
-
-    Tcl_SetResult(interp, TclGetString(Tcl_GetObjResult(interp)),
-	    TCL_VOLATILE);
-    return code;
+    ParseCache *cachePtr;
+
+    cachePtr = (ParseCache *) Tcl_GetAssocData(interp, "tclParseCache",
+	    (Tcl_InterpDeleteProc **) NULL);
+    if (cachePtr == NULL) {
+	cachePtr = (ParseCache *) ckalloc(sizeof(ParseCache));
+	Tcl_InitHashTable(&cachePtr->table, TCL_ONE_WORD_KEYS);
+	cachePtr->firstPtr = NULL;
+	cachePtr->lastPtr = NULL;
+	cachePtr->numEntries = 0;
+	cachePtr->totalSize = 0;
+	cachePtr->hits = 0;
+	cachePtr->misses = 0;
+	cachePtr->evictions = 0;
+	Tcl_InitHashTable(&cachePtr->literalTable, TCL_ONE_WORD_KEYS);
+	cachePtr->numLiterals = 0;
+	cachePtr->literalHits = 0;
+	cachePtr->literalMisses = 0;
+	memset((VOID *) cachePtr->cmdCache, 0, sizeof(cachePtr->cmdCache));
+	cachePtr->cmdHits = 0;
+	cachePtr->cmdMisses = 0;
+	cachePtr->cmdInvalidations = 0;
+	Tcl_SetAssocData(interp, "tclParseCache", DeleteParseCacheProc,
+		(ClientData) cachePtr);
+    }
+    return cachePtr;
 }
-
+
 /*
  *----------------------------------------------------------------------
  *
- * Tcl_EvalObj, Tcl_GlobalEvalObj --
+ * LookupParseCache --
  *
- *	These functions are deprecated but we keep them around for backwards
- *	compatibility reasons.
+ *	Finds the cache entry holding the parsed form of a script.  If
+ *	the script isn't in the cache yet, it is parsed and added to the
+ *	cache.
  *
  * Results:
- *	See the functions they call.
+ *	A pointer to the entry for the script, or NULL if the script
+ *	couldn't be parsed without errors (such scripts aren't cached,
+ *	so that the caller can report the error exactly the way an
+ *	uncached evaluation would).
  *
  * Side effects:
- *	See the functions they call.
+ *	The cache's hit and miss counters are updated, and least recently
+ *	used entries may be discarded to make room for a new one.
  *
  *----------------------------------------------------------------------
  */
 
-#undef Tcl_EvalObj
-int
-Tcl_EvalObj(interp, objPtr)
-    Tcl_Interp * interp;
-    Tcl_Obj * objPtr;
+static ParseCacheEntry *
+LookupParseCache(cachePtr, script, numBytes)
+    ParseCache *cachePtr;	/* Cache of the interpreter that will
+				 * evaluate the script. */
+    char *script;		/* First character of script. */
+    int numBytes;		/* Number of bytes in script. */
 {
-    return Tcl_EvalObjEx(interp, objPtr, 0);
-}
+    ParseCacheEntry *entryPtr;
+    Tcl_HashEntry *hPtr;
+    unsigned int hash;
+    register char *p, *end;
+    int new;
 
-#undef Tcl_GlobalEvalObj
-int
-Tcl_GlobalEvalObj(interp, objPtr)
-    Tcl_Interp * interp;
-    Tcl_Obj * objPtr;
-{
-    return Tcl_EvalObjEx(interp, objPtr, TCL_EVAL_GLOBAL);
+    /*
+     * The hash function is the one used for string keys in tclHash.c,
+     * applied to all of the script's bytes (which needn't be null
+     * terminated and may contain nulls).
+     */
+
+    hash = 0;
+    for (p = script, end = script + numBytes; p < end; p++) {
+	hash += (hash<<3) + UCHAR(*p);
+    }
+
+    hPtr = Tcl_FindHashEntry(&cachePtr->table, (char *) hash);
+    if (hPtr != NULL) {
+	for (entryPtr = (ParseCacheEntry *) Tcl_GetHashValue(hPtr);
+		entryPtr != NULL; entryPtr = entryPtr->hashNextPtr) {
+	    if ((entryPtr->numBytes == numBytes)
+		    && (memcmp((VOID *) entryPtr->script, (VOID *) script,
+			    (size_t) numBytes) == 0)) {
+		break;
+	    }
+	}
+	if (entryPtr != NULL) {
+	    cachePtr->hits++;
+
+	    /*
+	     * Move the entry to the front of the LRU list.
+	     */
+
+	    if (entryPtr->prevPtr != NULL) {
+		entryPtr->prevPtr->nextPtr = entryPtr->nextPtr;
+		if (entryPtr->nextPtr != NULL) {
+		    entryPtr->nextPtr->prevPtr = entryPtr->prevPtr;
+		} else {
+		    cachePtr->lastPtr = entryPtr->prevPtr;
+		}
+		entryPtr->prevPtr = NULL;
+		entryPtr->nextPtr = cachePtr->firstPtr;
+		cachePtr->firstPtr->prevPtr = entryPtr;
+		cachePtr->firstPtr = entryPtr;
+	    }
+	    return entryPtr;
+	}
+    }
+
+    cachePtr->misses++;
+    entryPtr = CreateParseCacheEntry(cachePtr, script, numBytes, hash);
+    if (entryPtr == NULL) {
+	return NULL;
+    }
+
+    hPtr = Tcl_CreateHashEntry(&cachePtr->table, (char *) hash, &new);
+    if (new) {
+	entryPtr->hashNextPtr = NULL;
+    } else {
+	entryPtr->hashNextPtr = (ParseCacheEntry *) Tcl_GetHashValue(hPtr);
+    }
+    Tcl_SetHashValue(hPtr, (ClientData) entryPtr);
+    entryPtr->prevPtr = NULL;
+    entryPtr->nextPtr = cachePtr->firstPtr;
+    if (cachePtr->firstPtr != NULL) {
+	cachePtr->firstPtr->prevPtr = entryPtr;
+    } else {
+	cachePtr->lastPtr = entryPtr;
+    }
+    cachePtr->firstPtr = entryPtr;
+    cachePtr->numEntries++;
+    cachePtr->totalSize += entryPtr->size;
+
+    /*
+     * Discard least recently used entries until the cache fits in its
+     * memory budget again, but never the entry we just made.
+     */
+
+    while ((cachePtr->totalSize > PARSE_CACHE_MAX_SIZE)
+	    && (cachePtr->lastPtr != entryPtr)) {
+	RemoveParseCacheEntry(cachePtr->lastPtr);
+	cachePtr->evictions++;
+    }
+    return entryPtr;
 }
-
+
 /*
  *----------------------------------------------------------------------
  *
- * Tcl_ParseVarName --
+ * GetLiteralWord --
  *
- *	Given a string starting with a $ sign, parse off a variable
- *	name and return information about the parse.
+ *	Returns the interned object for a literal word, creating it if
+ *	the word isn't in the literal table yet.
  *
  * Results:
- *	The return value is TCL_OK if the command was parsed
- *	successfully and TCL_ERROR otherwise.  If an error occurs and
+ *	A pointer to an object holding the word.  The caller must
+ *	increment its reference count if it keeps the object.
+ *
+ * Side effects:
+ *	The word may be added to the literal table; if the table is
+ *	full it is emptied first.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_Obj *
+GetLiteralWord(cachePtr, bytes, length)
+    ParseCache *cachePtr;	/* Cache holding the literal table. */
+    char *bytes;		/* First character of the word. */
+    int length;			/* Number of bytes in the word. */
+{
+    LiteralWord *wordPtr;
+    Tcl_HashEntry *hPtr;
+    unsigned int hash;
+    register char *p, *end;
+    char *wordBytes;
+    int new, wordLength;
+
+    hash = 0;
+    for (p = bytes, end = bytes + length; p < end; p++) {
+	hash += (hash<<3) + UCHAR(*p);
+    }
+
+    hPtr = Tcl_FindHashEntry(&cachePtr->literalTable, (char *) hash);
+    if (hPtr != NULL) {
+	for (wordPtr = (LiteralWord *) Tcl_GetHashValue(hPtr);
+		wordPtr != NULL; wordPtr = wordPtr->nextPtr) {
+	    wordBytes = Tcl_GetStringFromObj(wordPtr->objPtr, &wordLength);
+	    if ((wordLength == length) && (memcmp((VOID *) wordBytes,
+		    (VOID *) bytes, (size_t) length) == 0)) {
+		cachePtr->literalHits++;
+		return wordPtr->objPtr;
+	    }
+	}
+    }
+
+    if (cachePtr->numLiterals >= LITERAL_TABLE_MAX) {
+	FlushLiteralWords(cachePtr);
+    }
+    cachePtr->literalMisses++;
+    wordPtr = (LiteralWord *) ckalloc(sizeof(LiteralWord));
+    wordPtr->objPtr = Tcl_NewStringObj(bytes, length);
+    Tcl_IncrRefCount(wordPtr->objPtr);
+    wordPtr->hash = hash;
+    hPtr = Tcl_CreateHashEntry(&cachePtr->literalTable, (char *) hash, &new);
+    if (new) {
+	wordPtr->nextPtr = NULL;
+    } else {
+	wordPtr->nextPtr = (LiteralWord *) Tcl_GetHashValue(hPtr);
+    }
+    Tcl_SetHashValue(hPtr, (ClientData) wordPtr);
+    cachePtr->numLiterals++;
+    return wordPtr->objPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FlushLiteralWords --
+ *
+ *	Empties the literal table of a parse cache.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The table's references to its objects are released; objects
+ *	still referenced elsewhere remain valid.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FlushLiteralWords(cachePtr)
+    ParseCache *cachePtr;	/* Cache holding the literal table. */
+{
+    LiteralWord *wordPtr, *nextPtr;
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+
+    for (hPtr = Tcl_FirstHashEntry(&cachePtr->literalTable, &search);
+	    hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	for (wordPtr = (LiteralWord *) Tcl_GetHashValue(hPtr);
+		wordPtr != NULL; wordPtr = nextPtr) {
+	    nextPtr = wordPtr->nextPtr;
+	    Tcl_DecrRefCount(wordPtr->objPtr);
+	    ckfree((char *) wordPtr);
+	}
+	Tcl_DeleteHashEntry(hPtr);
+    }
+    cachePtr->numLiterals = 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * LookupCommand --
+ *
+ *	Finds the command named by an object, using the command table
+ *	of an interpreter's parse cache to avoid looking the name up
+ *	again if it was used recently.
+ *
+ * Results:
+ *	A pointer to the command, or NULL if there is no command with
+ *	that name.
+ *
+ * Side effects:
+ *	The command may be entered in the cache, replacing another one.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Command *
+LookupCommand(interp, cachePtr, objPtr)
+    Tcl_Interp *interp;		/* Interpreter in which to find the
+				 * command. */
+    ParseCache *cachePtr;	/* Interpreter's parse cache, or NULL. */
+    Tcl_Obj *objPtr;		/* Object holding the command's name. */
+{
+    Interp *iPtr = (Interp *) interp;
+    Namespace *nsPtr;
+    Command *cmdPtr;
+    CmdCacheSlot *slotPtr;
+
+    /*
+     * Names resolved by application-defined resolvers aren't cached:
+     * there is no way to tell when a resolver would give a different
+     * answer.
+     */
+
+    if ((cachePtr == NULL) || (iPtr->resolverPtr != NULL)) {
+	return (Command *) Tcl_GetCommandFromObj(interp, objPtr);
+    }
+    nsPtr = (iPtr->varFramePtr != NULL) ? iPtr->varFramePtr->nsPtr
+	    : iPtr->globalNsPtr;
+    if (nsPtr->cmdResProc != NULL) {
+	return (Command *) Tcl_GetCommandFromObj(interp, objPtr);
+    }
+
+    slotPtr = &cachePtr->cmdCache[((unsigned long) objPtr / sizeof(Tcl_Obj))
+	    % CMD_CACHE_SIZE];
+    if ((slotPtr->objPtr == objPtr) && (slotPtr->nsPtr == nsPtr)
+	    && (slotPtr->nsId == nsPtr->nsId)) {
+	cmdPtr = slotPtr->cmdPtr;
+	if ((slotPtr->cmdEpoch == cmdPtr->cmdEpoch)
+		&& (slotPtr->nsCmdRefEpoch == nsPtr->cmdRefEpoch)
+		&& (slotPtr->nsResolverEpoch == nsPtr->resolverEpoch)) {
+	    cachePtr->cmdHits++;
+	    return cmdPtr;
+	}
+	cachePtr->cmdInvalidations++;
+    } else {
+	cachePtr->cmdMisses++;
+    }
+
+    cmdPtr = (Command *) Tcl_GetCommandFromObj(interp, objPtr);
+    if (cmdPtr == NULL) {
+	return NULL;
+    }
+
+    /*
+     * Take the new references before releasing the old ones, in case
+     * the slot already refers to the same object or command.
+     */
+
+    Tcl_IncrRefCount(objPtr);
+    cmdPtr->refCount++;
+    if (slotPtr->objPtr != NULL) {
+	Tcl_DecrRefCount(slotPtr->objPtr);
+	TclCleanupCommand(slotPtr->cmdPtr);
+    }
+    slotPtr->objPtr = objPtr;
+    slotPtr->cmdPtr = cmdPtr;
+    slotPtr->cmdEpoch = cmdPtr->cmdEpoch;
+    slotPtr->nsPtr = nsPtr;
+    slotPtr->nsId = nsPtr->nsId;
+    slotPtr->nsCmdRefEpoch = nsPtr->cmdRefEpoch;
+    slotPtr->nsResolverEpoch = nsPtr->resolverEpoch;
+    return cmdPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FlushCommandCache --
+ *
+ *	Empties the command table of a parse cache.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The references held by the table to command names and commands
+ *	are released; commands that have been deleted meanwhile may be
+ *	freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FlushCommandCache(cachePtr)
+    ParseCache *cachePtr;	/* Cache holding the command table. */
+{
+    CmdCacheSlot *slotPtr;
+    int i;
+
+    for (i = 0, slotPtr = cachePtr->cmdCache; i < CMD_CACHE_SIZE;
+	    i++, slotPtr++) {
+	if (slotPtr->objPtr != NULL) {
+	    Tcl_DecrRefCount(slotPtr->objPtr);
+	    TclCleanupCommand(slotPtr->cmdPtr);
+	    slotPtr->objPtr = NULL;
+	    slotPtr->cmdPtr = NULL;
+	}
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CreateParseCacheEntry --
+ *
+ *	Parses all of the commands in a script and saves the results
+ *	in a new cache entry.
+ *
+ * Results:
+ *	A pointer to the new entry, which hasn't been linked into the
+ *	cache yet, or NULL if a parse error occurred.
+ *
+ * Side effects:
+ *	Memory is allocated for the entry and an object is created for
+ *	each simple word in the script.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ParseCacheEntry *
+CreateParseCacheEntry(cachePtr, script, numBytes, hash)
+    ParseCache *cachePtr;	/* Cache that will hold the entry. */
+    char *script;		/* First character of script. */
+    int numBytes;		/* Number of bytes in script. */
+    unsigned int hash;		/* Hash value of the script's bytes. */
+{
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+    ParseCacheEntry *entryPtr;
+    CachedCommand *commandPtr;
+    Tcl_Parse parse;
+    ArenaMark mark;
+    Tcl_Token *tokenPtr;
+    Tcl_Obj *objPtr;
+    char *p, *next;
+    int commandsAvailable, tokensAvailable, literalsAvailable;
+    int i, bytesLeft, result;
+
+    entryPtr = (ParseCacheEntry *) ckalloc(sizeof(ParseCacheEntry));
+    entryPtr->script = ckalloc((unsigned) (numBytes + 1));
+    memcpy((VOID *) entryPtr->script, (VOID *) script, (size_t) numBytes);
+    entryPtr->script[numBytes] = 0;
+    entryPtr->numBytes = numBytes;
+    entryPtr->hash = hash;
+    commandsAvailable = 4;
+    entryPtr->commands = (CachedCommand *) ckalloc((unsigned)
+	    (commandsAvailable * sizeof(CachedCommand)));
+    entryPtr->numCommands = 0;
+    tokensAvailable = NUM_STATIC_TOKENS;
+    entryPtr->tokens = (Tcl_Token *) ckalloc((unsigned)
+	    (tokensAvailable * sizeof(Tcl_Token)));
+    entryPtr->numTokens = 0;
+    literalsAvailable = 8;
+    entryPtr->literals = (Tcl_Obj **) ckalloc((unsigned)
+	    (literalsAvailable * sizeof(Tcl_Obj *)));
+    entryPtr->numLiterals = 0;
+    entryPtr->size = sizeof(ParseCacheEntry) + numBytes + 1;
+    entryPtr->refCount = 0;
+    entryPtr->dead = 0;
+    entryPtr->cachePtr = cachePtr;
+
+    /*
+     * Parse the commands of the script one at a time, exactly the way
+     * Tcl_EvalEx does, appending their tokens to the entry.  The tokens
+     * refer to the entry's copy of the script.
+     */
+
+    p = entryPtr->script;
+    bytesLeft = numBytes;
+    do {
+	ArenaMarkLevel(tsdPtr, &mark);
+	tsdPtr->parseDepth++;
+	result = Tcl_ParseCommand((Tcl_Interp *) NULL, p, bytesLeft, 0,
+		&parse);
+	tsdPtr->parseDepth--;
+	if (result != TCL_OK) {
+	    ArenaRelease(tsdPtr, &mark);
+	    FreeParseCacheEntry(entryPtr);
+	    return NULL;
+	}
+
+	if (entryPtr->numCommands == commandsAvailable) {
+	    commandsAvailable *= 2;
+	    entryPtr->commands = (CachedCommand *) ckrealloc(
+		    (char *) entryPtr->commands, (unsigned)
+		    (commandsAvailable * sizeof(CachedCommand)));
+	}
+	if (entryPtr->numTokens + parse.numTokens > tokensAvailable) {
+	    while (entryPtr->numTokens + parse.numTokens > tokensAvailable) {
+		tokensAvailable *= 2;
+	    }
+	    entryPtr->tokens = (Tcl_Token *) ckrealloc(
+		    (char *) entryPtr->tokens, (unsigned)
+		    (tokensAvailable * sizeof(Tcl_Token)));
+	}
+	if (entryPtr->numLiterals + parse.numWords > literalsAvailable) {
+	    while (entryPtr->numLiterals + parse.numWords
+		    > literalsAvailable) {
+		literalsAvailable *= 2;
+	    }
+	    entryPtr->literals = (Tcl_Obj **) ckrealloc(
+		    (char *) entryPtr->literals, (unsigned)
+		    (literalsAvailable * sizeof(Tcl_Obj *)));
+	}
+
+	commandPtr = &entryPtr->commands[entryPtr->numCommands];
+	commandPtr->commandStart = parse.commandStart;
+	commandPtr->commandSize = parse.commandSize;
+	commandPtr->numWords = parse.numWords;
+	commandPtr->tokenIndex = entryPtr->numTokens;
+	commandPtr->wordIndex = entryPtr->numLiterals;
+	entryPtr->numCommands++;
+
+	memcpy((VOID *) &entryPtr->tokens[entryPtr->numTokens],
+		(VOID *) parse.tokenPtr,
+		(size_t) (parse.numTokens * sizeof(Tcl_Token)));
+	entryPtr->numTokens += parse.numTokens;
+
+	for (i = 0, tokenPtr = parse.tokenPtr; i < parse.numWords;
+		i++, tokenPtr += (tokenPtr->numComponents + 1)) {
+	    if (tokenPtr->type != TCL_TOKEN_SIMPLE_WORD) {
+		objPtr = NULL;
+	    } else if (tokenPtr[1].size <= LITERAL_WORD_MAX) {
+		objPtr = GetLiteralWord(cachePtr, tokenPtr[1].start,
+			tokenPtr[1].size);
+		Tcl_IncrRefCount(objPtr);
+	    } else {
+		objPtr = Tcl_NewStringObj(tokenPtr[1].start, tokenPtr[1].size);
+		Tcl_IncrRefCount(objPtr);
+		entryPtr->size += sizeof(Tcl_Obj) + tokenPtr[1].size + 1;
+	    }
+	    entryPtr->literals[entryPtr->numLiterals++] = objPtr;
+	}
+
+	next = parse.commandStart + parse.commandSize;
+	bytesLeft -= next - p;
+	p = next;
+	Tcl_FreeParse(&parse);
+	ArenaRelease(tsdPtr, &mark);
+    } while (bytesLeft > 0);
+
+    entryPtr->size += entryPtr->numCommands * sizeof(CachedCommand)
+	    + entryPtr->numTokens * sizeof(Tcl_Token)
+	    + entryPtr->numLiterals * sizeof(Tcl_Obj *);
+    return entryPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RemoveParseCacheEntry --
+ *
+ *	Removes an entry from its parse cache.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The entry is freed, unless a Tcl_EvalEx is still executing
+ *	commands from it; in that case it is freed when that evaluation
+ *	completes.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+RemoveParseCacheEntry(entryPtr)
+    ParseCacheEntry *entryPtr;	/* Entry to remove. */
+{
+    ParseCache *cachePtr = entryPtr->cachePtr;
+    ParseCacheEntry *prevPtr;
+    Tcl_HashEntry *hPtr;
+
+    hPtr = Tcl_FindHashEntry(&cachePtr->table, (char *) entryPtr->hash);
+    prevPtr = (ParseCacheEntry *) Tcl_GetHashValue(hPtr);
+    if (prevPtr == entryPtr) {
+	if (entryPtr->hashNextPtr == NULL) {
+	    Tcl_DeleteHashEntry(hPtr);
+	} else {
+	    Tcl_SetHashValue(hPtr, (ClientData) entryPtr->hashNextPtr);
+	}
+    } else {
+	while (prevPtr->hashNextPtr != entryPtr) {
+	    prevPtr = prevPtr->hashNextPtr;
+	}
+	prevPtr->hashNextPtr = entryPtr->hashNextPtr;
+    }
+
+    if (entryPtr->prevPtr != NULL) {
+	entryPtr->prevPtr->nextPtr = entryPtr->nextPtr;
+    } else {
+	cachePtr->firstPtr = entryPtr->nextPtr;
+    }
+    if (entryPtr->nextPtr != NULL) {
+	entryPtr->nextPtr->prevPtr = entryPtr->prevPtr;
+    } else {
+	cachePtr->lastPtr = entryPtr->prevPtr;
+    }
+    cachePtr->numEntries--;
+    cachePtr->totalSize -= entryPtr->size;
+
+    entryPtr->cachePtr = NULL;
+    if (entryPtr->refCount > 0) {
+	entryPtr->dead = 1;
+    } else {
+	FreeParseCacheEntry(entryPtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FreeParseCacheEntry --
+ *
+ *	Frees all of the storage associated with a parse cache entry.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Memory is freed and the references to the entry's literal
+ *	objects are released.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FreeParseCacheEntry(entryPtr)
+    ParseCacheEntry *entryPtr;	/* Entry to free. */
+{
+    int i;
+
+    for (i = 0; i < entryPtr->numLiterals; i++) {
+	if (entryPtr->literals[i] != NULL) {
+	    Tcl_DecrRefCount(entryPtr->literals[i]);
+	}
+    }
+    ckfree((char *) entryPtr->literals);
+    ckfree((char *) entryPtr->tokens);
+    ckfree((char *) entryPtr->commands);
+    ckfree(entryPtr->script);
+    ckfree((char *) entryPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DeleteParseCacheProc --
+ *
+ *	This procedure is invoked when an interpreter is deleted, to
+ *	free its parse cache.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	All entries of the cache that aren't in use are freed, as is
+ *	the cache itself, and the references to interned literal words
+ *	and cached commands are released.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+DeleteParseCacheProc(clientData, interp)
+    ClientData clientData;	/* Pointer to ParseCache structure. */
+    Tcl_Interp *interp;		/* Interpreter being deleted. */
+{
+    ParseCache *cachePtr = (ParseCache *) clientData;
+
+    while (cachePtr->firstPtr != NULL) {
+	RemoveParseCacheEntry(cachePtr->firstPtr);
+    }
+    Tcl_DeleteHashTable(&cachePtr->table);
+    FlushLiteralWords(cachePtr);
+    Tcl_DeleteHashTable(&cachePtr->literalTable);
+    FlushCommandCache(cachePtr);
+    ckfree((char *) cachePtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EvalCachedScript --
+ *
+ *	Executes the commands of a script whose parsed form is held in
+ *	a parse cache entry.  This is the counterpart of the main loop
+ *	in Tcl_EvalEx, minus the calls to Tcl_ParseCommand.
+ *
+ * Results:
+ *	The return value is a standard Tcl completion code such as
+ *	TCL_OK or TCL_ERROR.  A result or error message is left in
+ *	interp's result.
+ *
+ * Side effects:
+ *	Depends on the script.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+EvalCachedScript(interp, entryPtr)
+    Tcl_Interp *interp;		/* Interpreter in which to evaluate the
+				 * script.  Also used for error reporting. */
+    ParseCacheEntry *entryPtr;	/* Entry holding the script's commands. */
+{
+    Interp *iPtr = (Interp *) interp;
+    Tcl_Obj *staticObjArray[NUM_STATIC_OBJS], **objv;
+    CachedCommand *commandPtr;
+    Tcl_Token *tokenPtr;
+    Tcl_Obj **literals;
+    char *p;
+    int i, cmd, code, objectsUsed, commandLength;
+
+    entryPtr->refCount++;
+    objv = staticObjArray;
+    objectsUsed = 0;
+    code = TCL_OK;
+    commandPtr = entryPtr->commands;
+    p = entryPtr->script;
+    for (cmd = 0; cmd < entryPtr->numCommands; cmd++, commandPtr++) {
+	if (commandPtr->numWords > 0) {
+	    if (commandPtr->numWords > NUM_STATIC_OBJS) {
+		objv = (Tcl_Obj **) ckalloc((unsigned)
+			(commandPtr->numWords * sizeof (Tcl_Obj *)));
+	    }
+	    literals = &entryPtr->literals[commandPtr->wordIndex];
+	    for (objectsUsed = 0,
+		    tokenPtr = &entryPtr->tokens[commandPtr->tokenIndex];
+		    objectsUsed < commandPtr->numWords;
+		    objectsUsed++, tokenPtr += (tokenPtr->numComponents + 1)) {
+		if (literals[objectsUsed] != NULL) {
+		    objv[objectsUsed] = literals[objectsUsed];
+		    Tcl_IncrRefCount(objv[objectsUsed]);
+		} else {
+		    objv[objectsUsed] = Tcl_EvalTokens(interp, tokenPtr+1,
+			    tokenPtr->numComponents);
+		    if (objv[objectsUsed] == NULL) {
+			code = TCL_ERROR;
+			goto error;
+		    }
+		}
+	    }
+
+	    code = EvalObjv(interp, entryPtr->cachePtr, objectsUsed, objv, p,
+		    commandPtr->commandStart + commandPtr->commandSize - p, 0);
+	    if (code != TCL_OK) {
+		goto error;
+	    }
+	    for (i = 0; i < objectsUsed; i++) {
+		Tcl_DecrRefCount(objv[i]);
+	    }
+	    objectsUsed = 0;
+	    if (objv != staticObjArray) {
+		ckfree((char *) objv);
+		objv = staticObjArray;
+	    }
+	}
+	p = commandPtr->commandStart + commandPtr->commandSize;
+    }
+    iPtr->termOffset = entryPtr->numBytes;
+    goto done;
+
+    error:
+    if ((code == TCL_ERROR) && !(iPtr->flags & ERR_ALREADY_LOGGED)) {
+	commandLength = commandPtr->commandSize;
+	if ((commandPtr->commandStart + commandLength)
+		!= (entryPtr->script + entryPtr->numBytes)) {
+	    commandLength -= 1;
+	}
+	Tcl_LogCommandInfo(interp, entryPtr->script,
+		commandPtr->commandStart, commandLength);
+    }
+    for (i = 0; i < objectsUsed; i++) {
+	Tcl_DecrRefCount(objv[i]);
+    }
+    if (objv != staticObjArray) {
+	ckfree((char *) objv);
+    }
+    iPtr->termOffset = (commandPtr->commandStart + commandPtr->commandSize)
+	    - entryPtr->script;
+
+    done:
+    entryPtr->refCount--;
+    if ((entryPtr->refCount <= 0) && entryPtr->dead) {
+	FreeParseCacheEntry(entryPtr);
+    }
+    return code;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclParseCacheInfo --
+ *
+ *	Returns statistics about an interpreter's parse cache.  Used
+ *	by the "testparsecache" command.
+ *
+ * Results:
+ *	A new object holding a list of alternating names and values:
+ *	hits, misses, evictions, entries and size for cached scripts,
+ *	and literals, literalhits and literalmisses for interned words.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tcl_Obj *
+TclParseCacheInfo(interp)
+    Tcl_Interp *interp;		/* Interpreter whose cache to describe. */
+{
+    ParseCache *cachePtr;
+    Tcl_Obj *listPtr;
+
+    cachePtr = GetParseCache(interp);
+    listPtr = Tcl_NewListObj(0, (Tcl_Obj **) NULL);
+    Tcl_ListObjAppendElement(NULL, listPtr, Tcl_NewStringObj("hits", -1));
+    Tcl_ListObjAppendElement(NULL, listPtr, Tcl_NewLongObj(cachePtr->hits));
+    Tcl_ListObjAppendElement(NULL, listPtr, Tcl_NewStringObj("misses", -1));
+    Tcl_ListObjAppendElement(NULL, listPtr,
+	    Tcl_NewLongObj(cachePtr->misses));
+    Tcl_ListObjAppendElement(NULL, listPtr,
+	    Tcl_NewStringObj("evictions", -1));
+    Tcl_ListObjAppendElement(NULL, listPtr,
+	    Tcl_NewLongObj(cachePtr->evictions));
+    Tcl_ListObjAppendElement(NULL, listPtr, Tcl_NewStringObj("entries", -1));
+    Tcl_ListObjAppendElement(NULL, listPtr,
+	    Tcl_NewIntObj(cachePtr->numEntries));
+    Tcl_ListObjAppendElement(NULL, listPtr, Tcl_NewStringObj("size", -1));
+    Tcl_ListObjAppendElement(NULL, listPtr,
+	    Tcl_NewLongObj(cachePtr->totalSize));
+    Tcl_ListObjAppendElement(NULL, listPtr,
+	    Tcl_NewStringObj("literals", -1));
+    Tcl_ListObjAppendElement(NULL, listPtr,
+	    Tcl_NewIntObj(cachePtr->numLiterals));
+    Tcl_ListObjAppendElement(NULL, listPtr,
+	    Tcl_NewStringObj("literalhits", -1));
+    Tcl_ListObjAppendElement(NULL, listPtr,
+	    Tcl_NewLongObj(cachePtr->literalHits));
+    Tcl_ListObjAppendElement(NULL, listPtr,
+	    Tcl_NewStringObj("literalmisses", -1));
+    Tcl_ListObjAppendElement(NULL, listPtr,
+	    Tcl_NewLongObj(cachePtr->literalMisses));
+    return listPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclFlushParseCache --
+ *
+ *	Discards all of the entries in an interpreter's parse cache and
+ *	all of its interned literal words, and resets its counters.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Memory held by the cache is freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclFlushParseCache(interp)
+    Tcl_Interp *interp;		/* Interpreter whose cache to flush. */
+{
+    ParseCache *cachePtr;
+
+    cachePtr = GetParseCache(interp);
+    while (cachePtr->firstPtr != NULL) {
+	RemoveParseCacheEntry(cachePtr->firstPtr);
+    }
+    FlushLiteralWords(cachePtr);
+    cachePtr->hits = 0;
+    cachePtr->misses = 0;
+    cachePtr->evictions = 0;
+    cachePtr->literalHits = 0;
+    cachePtr->literalMisses = 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclCommandCacheInfo --
+ *
+ *	Returns statistics about the table of resolved commands in an
+ *	interpreter's parse cache.  Used by the "testcmdcache" command.
+ *
+ * Results:
+ *	A new object holding a list of alternating names and values:
+ *	hits, misses, invalidations and entries.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tcl_Obj *
+TclCommandCacheInfo(interp)
+    Tcl_Interp *interp;		/* Interpreter whose cache to describe. */
+{
+    ParseCache *cachePtr;
+    Tcl_Obj *listPtr;
+    int i, numEntries;
+
+    cachePtr = GetParseCache(interp);
+    numEntries = 0;
+    for (i = 0; i < CMD_CACHE_SIZE; i++) {
+	if (cachePtr->cmdCache[i].objPtr != NULL) {
+	    numEntries++;
+	}
+    }
+    listPtr = Tcl_NewListObj(0, (Tcl_Obj **) NULL);
+    Tcl_ListObjAppendElement(NULL, listPtr, Tcl_NewStringObj("hits", -1));
+    Tcl_ListObjAppendElement(NULL, listPtr,
+	    Tcl_NewLongObj(cachePtr->cmdHits));
+    Tcl_ListObjAppendElement(NULL, listPtr, Tcl_NewStringObj("misses", -1));
+    Tcl_ListObjAppendElement(NULL, listPtr,
+	    Tcl_NewLongObj(cachePtr->cmdMisses));
+    Tcl_ListObjAppendElement(NULL, listPtr,
+	    Tcl_NewStringObj("invalidations", -1));
+    Tcl_ListObjAppendElement(NULL, listPtr,
+	    Tcl_NewLongObj(cachePtr->cmdInvalidations));
+    Tcl_ListObjAppendElement(NULL, listPtr, Tcl_NewStringObj("entries", -1));
+    Tcl_ListObjAppendElement(NULL, listPtr, Tcl_NewIntObj(numEntries));
+    return listPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclFlushCommandCache --
+ *
+ *	Discards all of the commands remembered in an interpreter's
+ *	parse cache and resets the related counters.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Commands that have been deleted meanwhile may be freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclFlushCommandCache(interp)
+    Tcl_Interp *interp;		/* Interpreter whose cache to flush. */
+{
+    ParseCache *cachePtr;
+
+    cachePtr = GetParseCache(interp);
+    FlushCommandCache(cachePtr);
+    cachePtr->cmdHits = 0;
+    cachePtr->cmdMisses = 0;
+    cachePtr->cmdInvalidations = 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_Eval --
+ *
+ *	Execute a Tcl command in a string.  This procedure executes the
+ *	script directly, rather than compiling it to bytecodes.  Before
+ *	the arrival of the bytecode compiler in Tcl 8.0 Tcl_Eval was
+ *	the main procedure used for executing Tcl commands, but nowadays
+ *	it isn't used much.
+ *
+ * Results:
+ *	The return value is one of the return codes defined in tcl.h
+ *	(such as TCL_OK), and interp's result contains a value
+ *	to supplement the return code. The value of the result
+ *	will persist only until the next call to Tcl_Eval or Tcl_EvalObj:
+ *	you must copy it or lose it!
+ *
+ * Side effects:
+ *	Can be almost arbitrary, depending on the commands in the script.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+Tcl_Eval(interp, string)
+    Tcl_Interp *interp;		/* Token for command interpreter (returned
+				 * by previous call to Tcl_CreateInterp). */
+    char *string;		/* Pointer to TCL command to execute. */
+{
+    int code;
+
+    code = Tcl_EvalEx(interp, string, -1, 0);
+
+    /*
+     * For backwards compatibility with old C code that predates the
+     * object system in Tcl 8.0, we have to mirror the object result
+     * back into the string result (some callers may expect it there).
+     */
+
+    Tcl_SetResult(interp, TclGetString(Tcl_GetObjResult(interp)),
+	    TCL_VOLATILE);
+    return code;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_EvalObj, Tcl_GlobalEvalObj --
+ *
+ *	These functions are deprecated but we keep them around for backwards
+ *	compatibility reasons.
+ *
+ * Results:
+ *	See the functions they call.
+ *
+ * Side effects:
+ *	See the functions they call.
+ *
+ *----------------------------------------------------------------------
+ */
+
+#undef Tcl_EvalObj
+int
+Tcl_EvalObj(interp, objPtr)
+    Tcl_Interp * interp;
+    Tcl_Obj * objPtr;
+{
+    return Tcl_EvalObjEx(interp, objPtr, 0);
+}
+
+#undef Tcl_GlobalEvalObj
+int
+Tcl_GlobalEvalObj(interp, objPtr)
+    Tcl_Interp * interp;
+    Tcl_Obj * objPtr;
+{
+    return Tcl_EvalObjEx(interp, objPtr, TCL_EVAL_GLOBAL);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_ParseVarName --
+ *
+ *	Given a string starting with a $ sign, parse off a variable
+ *	name and return information about the parse.
+ *
+ * Results:
+ *	The return value is TCL_OK if the command was parsed
+ *	successfully and TCL_ERROR otherwise.  If an error occurs and
  *	interp isn't NULL then an error message is left in its result. 
  *	On a successful return, tokenPtr and numTokens fields of
  *	parsePtr are filled in with information about the variable name
@@ -2197,30 +3758,169 @@ static int
 CommandComplete(script, length)
     char *script;			/* Script to check. */
     int length;				/* Number of bytes in script. */
+{
+    TclCompleteState state;
+
+    TclInitCompleteState(&state);
+    return TclIncrCommandComplete(&state, script, length);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclInitCompleteState --
+ *
+ *	Prepares a TclCompleteState structure for checking a new script
+ *	with TclIncrCommandComplete.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The structure is reset to describe an empty script.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclInitCompleteState(statePtr)
+    TclCompleteState *statePtr;		/* Structure to initialize. */
+{
+    statePtr->offset = 0;
+    statePtr->scanned = 0;
+    statePtr->level = 0;
+    statePtr->backslash = 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclIncrCommandComplete --
+ *
+ *	Determines whether a script that is assembled a piece at a time
+ *	is complete, like Tcl_CommandComplete, but without examining the
+ *	whole script again each time a piece is added.  Commands that
+ *	are followed by more text can't be changed by text added later,
+ *	so parsing resumes after the last of them.  While the script
+ *	ends inside a braced word (such as the body of a procedure that
+ *	is being typed or pasted) only the new bytes are examined, since
+ *	nothing but braces and backslashes matter until the word is
+ *	closed.
+ *
+ * Results:
+ *	1 is returned if the script is complete, 0 otherwise.  1 is
+ *	also returned if there is a parse error in the script other
+ *	than unmatched delimiters.
+ *
+ * Side effects:
+ *	*statePtr is updated for the next call.  The caller must pass
+ *	the same script each time, possibly with bytes added at its end,
+ *	and call TclInitCompleteState when the script is replaced.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclIncrCommandComplete(statePtr, script, length)
+    TclCompleteState *statePtr;		/* Information kept from earlier
+					 * calls for the same script. */
+    char *script;			/* Script to check. */
+    int length;				/* Number of bytes in script. */
 {
     Tcl_Parse parse;
-    char *p, *end;
+    char *p, *end, *next;
     int result;
 
-    p = script;
-    end = p + length;
+    if (length < statePtr->scanned) {
+	/*
+	 * The script got shorter, so it can't be the one examined by
+	 * the earlier calls.
+	 */
+
+	TclInitCompleteState(statePtr);
+    }
+    if ((statePtr->level > 0) && (ScanBraces(statePtr, script, length) > 0)) {
+	return 0;
+    }
+
+    p = script + statePtr->offset;
+    end = script + length;
     while (Tcl_ParseCommand((Tcl_Interp *) NULL, p, end - p, 0, &parse)
 	    == TCL_OK) {
-	p = parse.commandStart + parse.commandSize;
-	if (*p == 0) {
+	next = parse.commandStart + parse.commandSize;
+	if ((next >= end) || (*next == 0)) {
 	    break;
 	}
+	p = next;
+	statePtr->offset = p - script;
 	Tcl_FreeParse(&parse);
     }
+    statePtr->scanned = length;
+    statePtr->level = 0;
+    statePtr->backslash = 0;
     if (parse.incomplete) {
 	result = 0;
+	if (parse.errorType == TCL_PARSE_MISSING_BRACE) {
+	    statePtr->scanned = parse.term - script;
+	    ScanBraces(statePtr, script, length);
+	}
     } else {
 	result = 1;
     }
     Tcl_FreeParse(&parse);
     return result;
 }
-
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ScanBraces --
+ *
+ *	Helper for TclIncrCommandComplete: continues matching the braces
+ *	of a braced word from the point where an earlier call stopped,
+ *	using the same rules as Tcl_ParseBraces.
+ *
+ * Results:
+ *	The nesting level of the braced word at the end of the script,
+ *	or 0 if the word has been closed.
+ *
+ * Side effects:
+ *	The scanned, level and backslash fields of *statePtr are
+ *	updated.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ScanBraces(statePtr, script, length)
+    TclCompleteState *statePtr;		/* Where to start and the state
+					 * to start in. */
+    char *script;			/* Script being checked. */
+    int length;				/* Number of bytes in script. */
+{
+    register char *p, *end;
+    int level, backslash;
+
+    level = statePtr->level;
+    backslash = statePtr->backslash;
+    end = script + length;
+    for (p = script + statePtr->scanned; p < end; p++) {
+	if (backslash) {
+	    backslash = 0;
+	} else if (*p == '\\') {
+	    backslash = 1;
+	} else if (*p == '{') {
+	    level++;
+	} else if ((*p == '}') && (--level == 0)) {
+	    break;
+	}
+    }
+    statePtr->scanned = p - script;
+    statePtr->level = level;
+    statePtr->backslash = backslash;
+    return level;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -94,6 +94,75 @@ typedef struct TclEncoding {
 
 static int freeCount;
 
+/*
+ * Events queued by the "testeventcoalesce" command, and the number of
+ * them that have been serviced.
+ */
+
+typedef struct CoalesceTestEvent {
+    Tcl_Event header;		/* Standard event header. */
+    int key;			/* Events with the same key are
+				 * coalesced. */
+} CoalesceTestEvent;
+
+static int coalesceTestCount;
+
+/*
+ * Number of events queued by the "testdoevents" command that have been
+ * serviced, and how long each of them sleeps in milliseconds.
+ */
+
+static int doEventsTestCount;
+static int doEventsTestSleep;
+
+/*
+ * Events queued by the "testeventrings" command, and the list that
+ * collects the indices of the ones serviced.
+ */
+
+typedef struct RingTestEvent {
+    Tcl_Event header;		/* Standard event header. */
+    int index;			/* Position of the event in the kind list
+				 * given to the command. */
+    int type;			/* TCL_WINDOW_EVENTS, TCL_FILE_EVENTS,
+				 * TCL_TIMER_EVENTS or 0. */
+} RingTestEvent;
+
+static Tcl_Obj *ringTestOrderPtr = NULL;
+
+/*
+ * Number of calls made to TestStatCountProc, the stat hook installed by
+ * the "teststatcache" command.
+ */
+
+static int statCountCalls;
+
+#ifdef TCL_THREADS
+/*
+ * The following structure is handed to each producer thread started by
+ * the "testthreadqueue" command, and the counter below counts the events
+ * they posted that have been serviced.
+ */
+
+typedef struct ThreadQueueProducer {
+    Tcl_ThreadId targetId;	/* Thread to post the events to. */
+    int numEvents;		/* Number of events to post. */
+} ThreadQueueProducer;
+
+static int threadQueueCount;
+
+/*
+ * The idle threads started by "testthreadqueue" wait on the condition
+ * below until threadQueueIdleDone is set.  threadQueueIdleCount counts
+ * the idle threads that have a notifier and haven't yet been let go.
+ */
+
+TCL_DECLARE_MUTEX(threadQueueMutex)
+static Tcl_Condition threadQueueCond;
+static int threadQueueIdleCount;
+static int threadQueueIdleDone;
+#endif
+
 /*
  * Forward declarations for procedures defined later in this file:
  */
@@ -140,6 +209,9 @@ static int		EncodingFromUtfProc _ANSI_ARGS_((ClientData clientData,
 			    Tcl_EncodingState *statePtr, char *dst,
 			    int dstLen, int *srcReadPtr, int *dstWrotePtr,
 			    int *dstCharsPtr));
+static int		EvalStatList _ANSI_ARGS_((Tcl_Interp *interp,
+			    char *options, Tcl_Obj *namesPtr, int *callsPtr,
+			    Tcl_Obj **resultPtrPtr));
 static void		ExitProcEven _ANSI_ARGS_((ClientData clientData));
 static void		ExitProcOdd _ANSI_ARGS_((ClientData clientData));
 static int              GetTimesCmd _ANSI_ARGS_((ClientData clientData,
@@ -163,6 +235,9 @@ static int		TestAccessProc3 _ANSI_ARGS_((CONST char *path,
 			   int mode));
 static int		TestasyncCmd _ANSI_ARGS_((ClientData dummy,
 			    Tcl_Interp *interp, int argc, char **argv));
+static int		TestcmdcacheObjCmd _ANSI_ARGS_((ClientData dummy,
+			    Tcl_Interp *interp, int objc,
+			    Tcl_Obj *CONST objv[]));
 static int		TestcmdinfoCmd _ANSI_ARGS_((ClientData dummy,
 			    Tcl_Interp *interp, int argc, char **argv));
 static int		TestcmdtokenCmd _ANSI_ARGS_((ClientData dummy,
@@ -179,6 +254,11 @@ static int		TestdelCmd _ANSI_ARGS_((ClientData dummy,
 			    Tcl_Interp *interp, int argc, char **argv));
 static int		TestdelassocdataCmd _ANSI_ARGS_((ClientData dummy,
 			    Tcl_Interp *interp, int argc, char **argv));
+static int		TestdoeventsObjCmd _ANSI_ARGS_((ClientData dummy,
+			    Tcl_Interp *interp, int objc,
+			    Tcl_Obj *CONST objv[]));
+static int		DoEventsTestEventProc _ANSI_ARGS_((Tcl_Event *evPtr,
+			    int flags));
 static int		TestdstringCmd _ANSI_ARGS_((ClientData dummy,
 			    Tcl_Interp *interp, int argc, char **argv));
 static int		TestencodingObjCmd _ANSI_ARGS_((ClientData dummy,
@@ -190,6 +270,19 @@ static int		TestevalexObjCmd _ANSI_ARGS_((ClientData dummy,
 static int		TestevalobjvObjCmd _ANSI_ARGS_((ClientData dummy,
 			    Tcl_Interp *interp, int objc, 
 			    Tcl_Obj *CONST objv[]));
+static int		TesteventcoalesceObjCmd _ANSI_ARGS_((ClientData dummy,
+			    Tcl_Interp *interp, int objc,
+			    Tcl_Obj *CONST objv[]));
+static int		CoalesceTestEventProc _ANSI_ARGS_((Tcl_Event *evPtr,
+			    int flags));
+static ClientData	CoalesceTestKeyProc _ANSI_ARGS_((Tcl_Event *evPtr));
+static int		TesteventringsObjCmd _ANSI_ARGS_((ClientData dummy,
+			    Tcl_Interp *interp, int objc,
+			    Tcl_Obj *CONST objv[]));
+static int		RingTestDeleteProc _ANSI_ARGS_((Tcl_Event *evPtr,
+			    ClientData clientData));
+static int		RingTestEventProc _ANSI_ARGS_((Tcl_Event *evPtr,
+			    int flags));
 static int		TestexithandlerCmd _ANSI_ARGS_((ClientData dummy,
 			    Tcl_Interp *interp, int argc, char **argv));
 static int		TestexprlongCmd _ANSI_ARGS_((ClientData dummy,
@@ -210,6 +303,9 @@ static int		TestgetplatformCmd _ANSI_ARGS_((ClientData dummy,
 static int		TestgetvarfullnameCmd _ANSI_ARGS_((
 			    ClientData dummy, Tcl_Interp *interp,
 			    int objc, Tcl_Obj *CONST objv[]));
+static int		TestglobmatchObjCmd _ANSI_ARGS_((ClientData dummy,
+			    Tcl_Interp *interp, int objc,
+			    Tcl_Obj *CONST objv[]));
 static int		TestinterpdeleteCmd _ANSI_ARGS_((ClientData dummy,
 		            Tcl_Interp *interp, int argc, char **argv));
 static int		TestlinkCmd _ANSI_ARGS_((ClientData dummy,
@@ -231,6 +327,9 @@ static Tcl_Channel	TestOpenFileChannelProc3 _ANSI_ARGS_((Tcl_Interp *interp,
 			    char *filename, char *modeString, int permissions));
 static int		TestpanicCmd _ANSI_ARGS_((ClientData dummy,
 			    Tcl_Interp *interp, int argc, char **argv));
+static int		TestparsecacheObjCmd _ANSI_ARGS_((ClientData dummy,
+			    Tcl_Interp *interp, int objc,
+			    Tcl_Obj *CONST objv[]));
 static int		TestparserObjCmd _ANSI_ARGS_((ClientData dummy,
 			    Tcl_Interp *interp, int objc,
 			    Tcl_Obj *CONST objv[]));
@@ -240,6 +339,9 @@ static int		TestparsevarObjCmd _ANSI_ARGS_((ClientData dummy,
 static int		TestparsevarnameObjCmd _ANSI_ARGS_((ClientData dummy,
 			    Tcl_Interp *interp, int objc,
 			    Tcl_Obj *CONST objv[]));
+static int		TestpreloadObjCmd _ANSI_ARGS_((ClientData dummy,
+			    Tcl_Interp *interp, int objc,
+			    Tcl_Obj *CONST objv[]));
 static int		TestregexpObjCmd _ANSI_ARGS_((ClientData dummy,
 			    Tcl_Interp *interp, int objc,
 			    Tcl_Obj *CONST objv[]));
@@ -263,6 +365,17 @@ static int		TestsetplatformCmd _ANSI_ARGS_((ClientData dummy,
 static int		TestsetrecursionlimitCmd _ANSI_ARGS_((
                             ClientData dummy, Tcl_Interp *interp,
 			    int objc, Tcl_Obj *CONST objv[]));
+#ifdef TCL_THREADS
+static int		TestthreadqueueObjCmd _ANSI_ARGS_((ClientData dummy,
+			    Tcl_Interp *interp, int objc,
+			    Tcl_Obj *CONST objv[]));
+static int		ThreadQueueEventProc _ANSI_ARGS_((Tcl_Event *evPtr,
+			    int flags));
+static Tcl_ThreadCreateType ThreadQueueIdleProc _ANSI_ARGS_((
+			    ClientData clientData));
+static Tcl_ThreadCreateType ThreadQueueProducerProc _ANSI_ARGS_((
+			    ClientData clientData));
+#endif
 static int		TeststaticpkgCmd _ANSI_ARGS_((ClientData dummy,
 			    Tcl_Interp *interp, int argc, char **argv));
 static int		TestStatProc1 _ANSI_ARGS_((CONST char *path,
@@ -271,6 +384,11 @@ static int		TestStatProc2 _ANSI_ARGS_((CONST char *path,
 			    struct stat *buf));
 static int		TestStatProc3 _ANSI_ARGS_((CONST char *path,
 			    struct stat *buf));
+static int		TeststatcacheObjCmd _ANSI_ARGS_((ClientData dummy,
+			    Tcl_Interp *interp, int objc,
+			    Tcl_Obj *CONST objv[]));
+static int		TestStatCountProc _ANSI_ARGS_((CONST char *path,
+			    struct stat *buf));
 static int		TeststatprocCmd _ANSI_ARGS_((ClientData dummy,
 			    Tcl_Interp *interp, int argc, char **argv));
 static int		TesttranslatefilenameCmd _ANSI_ARGS_((ClientData dummy,
@@ -340,6 +458,8 @@ Tcltest_Init(interp)
             (ClientData) 0, (Tcl_CmdDeleteProc *) NULL);
     Tcl_CreateCommand(interp, "testchmod", TestchmodCmd,
             (ClientData) 0, (Tcl_CmdDeleteProc *) NULL);
+    Tcl_CreateObjCommand(interp, "testcmdcache", TestcmdcacheObjCmd,
+	    (ClientData) 0, (Tcl_CmdDeleteProc *) NULL);
     Tcl_CreateCommand(interp, "testcmdtoken", TestcmdtokenCmd, (ClientData) 0,
 	    (Tcl_CmdDeleteProc *) NULL);
     Tcl_CreateCommand(interp, "testcmdinfo", TestcmdinfoCmd, (ClientData) 0,
@@ -354,6 +474,8 @@ Tcltest_Init(interp)
 	    (Tcl_CmdDeleteProc *) NULL);
     Tcl_CreateCommand(interp, "testdelassocdata", TestdelassocdataCmd,
             (ClientData) 0, (Tcl_CmdDeleteProc *) NULL);
+    Tcl_CreateObjCommand(interp, "testdoevents", TestdoeventsObjCmd,
+	    (ClientData) 0, (Tcl_CmdDeleteProc *) NULL);
     Tcl_DStringInit(&dstring);
     Tcl_CreateCommand(interp, "testdstring", TestdstringCmd, (ClientData) 0,
 	    (Tcl_CmdDeleteProc *) NULL);
@@ -363,6 +485,10 @@ Tcltest_Init(interp)
 	    (ClientData) 0, (Tcl_CmdDeleteProc *) NULL);
     Tcl_CreateObjCommand(interp, "testevalobjv", TestevalobjvObjCmd,
 	    (ClientData) 0, (Tcl_CmdDeleteProc *) NULL);
+    Tcl_CreateObjCommand(interp, "testeventcoalesce", TesteventcoalesceObjCmd,
+	    (ClientData) 0, (Tcl_CmdDeleteProc *) NULL);
+    Tcl_CreateObjCommand(interp, "testeventrings", TesteventringsObjCmd,
+	    (ClientData) 0, (Tcl_CmdDeleteProc *) NULL);
     Tcl_CreateCommand(interp, "testexithandler", TestexithandlerCmd,
             (ClientData) 0, (Tcl_CmdDeleteProc *) NULL);
     Tcl_CreateCommand(interp, "testexprlong", TestexprlongCmd,
@@ -382,6 +508,8 @@ Tcltest_Init(interp)
     Tcl_CreateObjCommand(interp, "testgetvarfullname",
 	    TestgetvarfullnameCmd, (ClientData) 0,
 	    (Tcl_CmdDeleteProc *) NULL);
+    Tcl_CreateObjCommand(interp, "testglobmatch", TestglobmatchObjCmd,
+	    (ClientData) 0, (Tcl_CmdDeleteProc *) NULL);
     Tcl_CreateCommand(interp, "testinterpdelete", TestinterpdeleteCmd,
             (ClientData) 0, (Tcl_CmdDeleteProc *) NULL);
     Tcl_CreateCommand(interp, "testlink", TestlinkCmd, (ClientData) 0,
@@ -393,12 +521,16 @@ Tcltest_Init(interp)
     	    (Tcl_CmdDeleteProc *) NULL);
     Tcl_CreateCommand(interp, "testpanic", TestpanicCmd, (ClientData) 0,
             (Tcl_CmdDeleteProc *) NULL);
+    Tcl_CreateObjCommand(interp, "testparsecache", TestparsecacheObjCmd,
+	    (ClientData) 0, (Tcl_CmdDeleteProc *) NULL);
     Tcl_CreateObjCommand(interp, "testparser", TestparserObjCmd,
 	    (ClientData) 0, (Tcl_CmdDeleteProc *) NULL);
     Tcl_CreateObjCommand(interp, "testparsevar", TestparsevarObjCmd,
 	    (ClientData) 0, (Tcl_CmdDeleteProc *) NULL);
     Tcl_CreateObjCommand(interp, "testparsevarname", TestparsevarnameObjCmd,
 	    (ClientData) 0, (Tcl_CmdDeleteProc *) NULL);
+    Tcl_CreateObjCommand(interp, "testpreload", TestpreloadObjCmd,
+	    (ClientData) 0, (Tcl_CmdDeleteProc *) NULL);
     Tcl_CreateObjCommand(interp, "testregexp", TestregexpObjCmd,
 	    (ClientData) 0, (Tcl_CmdDeleteProc *) NULL);
     Tcl_CreateObjCommand(interp, "testsaveresult", TestsaveresultCmd,
@@ -419,6 +551,10 @@ Tcltest_Init(interp)
 	    (ClientData) 0, (Tcl_CmdDeleteProc *) NULL);
     Tcl_CreateCommand(interp, "teststaticpkg", TeststaticpkgCmd,
 	    (ClientData) 0, (Tcl_CmdDeleteProc *) NULL);
+#ifdef TCL_THREADS
+    Tcl_CreateObjCommand(interp, "testthreadqueue", TestthreadqueueObjCmd,
+	    (ClientData) 0, (Tcl_CmdDeleteProc *) NULL);
+#endif
     Tcl_CreateCommand(interp, "testtranslatefilename",
             TesttranslatefilenameCmd, (ClientData) 0,
             (Tcl_CmdDeleteProc *) NULL);
@@ -428,6 +564,8 @@ Tcltest_Init(interp)
 	    (ClientData) 123);
     Tcl_CreateMathFunc(interp, "T2", 0, (Tcl_ValueType *) NULL, TestMathFunc,
 	    (ClientData) 345);
+    Tcl_CreateObjCommand(interp, "teststatcache", TeststatcacheObjCmd,
+	    (ClientData) 0, (Tcl_CmdDeleteProc *) NULL);
     Tcl_CreateCommand(interp, "teststatproc", TeststatprocCmd, (ClientData) 0,
 	    (Tcl_CmdDeleteProc *) NULL);
     t3ArgTypes[0] = TCL_EITHER;
@@ -578,6 +716,58 @@ AsyncHandlerProc(clientData, interp, code)
     return code;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TestcmdcacheObjCmd --
+ *
+ *	This procedure implements the "testcmdcache" command.  It is
+ *	used to examine and flush the table of resolved command names
+ *	that Tcl_EvalEx keeps for each interpreter.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	"testcmdcache flush" discards all cached commands.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+TestcmdcacheObjCmd(clientData, interp, objc, objv)
+    ClientData clientData;	/* Not used. */
+    Tcl_Interp *interp;		/* Current interpreter. */
+    int objc;			/* Number of arguments. */
+    Tcl_Obj *CONST objv[];	/* The argument objects. */
+{
+    int index;
+    static char *optionStrings[] = {
+	"flush",	"info",		NULL
+    };
+    enum options {
+	CCACHE_FLUSH,	CCACHE_INFO
+    };
+
+    if (objc != 2) {
+	Tcl_WrongNumArgs(interp, 1, objv, "option");
+	return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObj(interp, objv[1], optionStrings, "option", 0,
+	    &index) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    switch ((enum options) index) {
+	case CCACHE_FLUSH:
+	    TclFlushCommandCache(interp);
+	    break;
+	case CCACHE_INFO:
+	    Tcl_SetObjResult(interp, TclCommandCacheInfo(interp));
+	    break;
+    }
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1165,6 +1355,112 @@ TestdelassocdataCmd(clientData, interp, argc, argv)
     return TCL_OK;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TestdoeventsObjCmd --
+ *
+ *	This procedure implements the "testdoevents" command.
+ *	"testdoevents numEvents maxEvents ?budget? ?sleep?" queues
+ *	numEvents events, each of which sleeps sleep milliseconds when
+ *	it is serviced, and calls Tcl_DoEvents once with maxEvents and
+ *	a time budget of budget milliseconds (no limit if budget is
+ *	omitted or negative).  The events it leaves are then serviced
+ *	and thrown away.
+ *
+ * Results:
+ *	A standard Tcl result.  The result is a list holding the value
+ *	returned by Tcl_DoEvents and the number of test events it
+ *	serviced.
+ *
+ * Side effects:
+ *	Services events.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+TestdoeventsObjCmd(dummy, interp, objc, objv)
+    ClientData dummy;		/* Not used. */
+    Tcl_Interp *interp;		/* Current interpreter. */
+    int objc;			/* Number of arguments. */
+    Tcl_Obj *CONST objv[];	/* The argument objects. */
+{
+    int numEvents, maxEvents, budget, i, result, serviced;
+    Tcl_Time time;
+    Tcl_Event *evPtr;
+    Tcl_Obj *resultPtr;
+
+    if ((objc < 3) || (objc > 5)) {
+	Tcl_WrongNumArgs(interp, 1, objv,
+		"numEvents maxEvents ?budget? ?sleep?");
+	return TCL_ERROR;
+    }
+    budget = -1;
+    doEventsTestSleep = 0;
+    if ((Tcl_GetIntFromObj(interp, objv[1], &numEvents) != TCL_OK)
+	    || (Tcl_GetIntFromObj(interp, objv[2], &maxEvents) != TCL_OK)
+	    || ((objc > 3) && (Tcl_GetIntFromObj(interp, objv[3], &budget)
+	    != TCL_OK))
+	    || ((objc > 4) && (Tcl_GetIntFromObj(interp, objv[4],
+	    &doEventsTestSleep) != TCL_OK))) {
+	return TCL_ERROR;
+    }
+
+    for (i = 0; i < numEvents; i++) {
+	evPtr = (Tcl_Event *) ckalloc(sizeof(Tcl_Event));
+	evPtr->proc = DoEventsTestEventProc;
+	Tcl_QueueEvent(evPtr, TCL_QUEUE_TAIL);
+    }
+    doEventsTestCount = 0;
+    if (budget >= 0) {
+	time.sec = budget / 1000;
+	time.usec = (budget % 1000) * 1000;
+	result = Tcl_DoEvents(TCL_ALL_EVENTS|TCL_DONT_WAIT, maxEvents, &time);
+    } else {
+	result = Tcl_DoEvents(TCL_ALL_EVENTS|TCL_DONT_WAIT, maxEvents, NULL);
+    }
+    serviced = doEventsTestCount;
+
+    doEventsTestSleep = 0;
+    while (Tcl_DoOneEvent(TCL_ALL_EVENTS|TCL_DONT_WAIT)) {
+	/* Empty loop body. */
+    }
+
+    resultPtr = Tcl_GetObjResult(interp);
+    Tcl_ListObjAppendElement(NULL, resultPtr, Tcl_NewIntObj(result));
+    Tcl_ListObjAppendElement(NULL, resultPtr, Tcl_NewIntObj(serviced));
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DoEventsTestEventProc --
+ *
+ *	Handles the events queued by "testdoevents".
+ *
+ * Results:
+ *	Always 1: the event has been handled.
+ *
+ * Side effects:
+ *	Counts the event and sleeps doEventsTestSleep milliseconds.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+DoEventsTestEventProc(evPtr, flags)
+    Tcl_Event *evPtr;		/* The event. */
+    int flags;			/* Not used. */
+{
+    doEventsTestCount++;
+    if (doEventsTestSleep > 0) {
+	Tcl_Sleep(doEventsTestSleep);
+    }
+    return 1;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1573,6 +1869,292 @@ TestevalobjvObjCmd(dummy, interp, objc, objv)
 	    (evalGlobal) ? TCL_EVAL_GLOBAL : 0);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TesteventcoalesceObjCmd --
+ *
+ *	This procedure implements the "testeventcoalesce" command.
+ *	"testeventcoalesce numEvents numKeys" queues numEvents events
+ *	with Tcl_QueueEventCoalesced, giving them numKeys different keys
+ *	in turn, and then services all queued events.
+ *
+ * Results:
+ *	A standard Tcl result.  The result is a list holding the number
+ *	of events serviced and the number of events that were coalesced.
+ *
+ * Side effects:
+ *	Services events.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+TesteventcoalesceObjCmd(dummy, interp, objc, objv)
+    ClientData dummy;		/* Not used. */
+    Tcl_Interp *interp;		/* Current interpreter. */
+    int objc;			/* Number of arguments. */
+    Tcl_Obj *CONST objv[];	/* The argument objects. */
+{
+    int numEvents, numKeys, i;
+    unsigned long numCoalesced;
+    CoalesceTestEvent *evPtr;
+    Tcl_Obj *resultPtr;
+
+    if (objc != 3) {
+	Tcl_WrongNumArgs(interp, 1, objv, "numEvents numKeys");
+	return TCL_ERROR;
+    }
+    if ((Tcl_GetIntFromObj(interp, objv[1], &numEvents) != TCL_OK)
+	    || (Tcl_GetIntFromObj(interp, objv[2], &numKeys) != TCL_OK)) {
+	return TCL_ERROR;
+    }
+    if (numKeys < 1) {
+	Tcl_AppendResult(interp, "need at least one key", (char *) NULL);
+	return TCL_ERROR;
+    }
+
+    coalesceTestCount = 0;
+    numCoalesced = TclCoalescedEventCount();
+    for (i = 0; i < numEvents; i++) {
+	evPtr = (CoalesceTestEvent *) ckalloc(sizeof(CoalesceTestEvent));
+	evPtr->header.proc = CoalesceTestEventProc;
+	evPtr->key = i % numKeys;
+	Tcl_QueueEventCoalesced((Tcl_Event *) evPtr, TCL_QUEUE_TAIL,
+		CoalesceTestKeyProc);
+    }
+    while (Tcl_DoOneEvent(TCL_ALL_EVENTS|TCL_DONT_WAIT)) {
+	/* Empty loop body. */
+    }
+    numCoalesced = TclCoalescedEventCount() - numCoalesced;
+
+    resultPtr = Tcl_GetObjResult(interp);
+    Tcl_ListObjAppendElement(NULL, resultPtr,
+	    Tcl_NewIntObj(coalesceTestCount));
+    Tcl_ListObjAppendElement(NULL, resultPtr,
+	    Tcl_NewLongObj((long) numCoalesced));
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CoalesceTestEventProc --
+ *
+ *	Handles the events queued by "testeventcoalesce".
+ *
+ * Results:
+ *	Always 1: the event has been handled.
+ *
+ * Side effects:
+ *	Counts the event.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+CoalesceTestEventProc(evPtr, flags)
+    Tcl_Event *evPtr;		/* The event. */
+    int flags;			/* Not used. */
+{
+    coalesceTestCount++;
+    return 1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CoalesceTestKeyProc --
+ *
+ *	Coalescing key procedure for the events queued by
+ *	"testeventcoalesce".
+ *
+ * Results:
+ *	The key of the event.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ClientData
+CoalesceTestKeyProc(evPtr)
+    Tcl_Event *evPtr;		/* The event. */
+{
+    return (ClientData) ((CoalesceTestEvent *) evPtr)->key;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TesteventringsObjCmd --
+ *
+ *	This procedure implements the "testeventrings" command.
+ *	"testeventrings kindList ?deleteKind?" queues one event for each
+ *	element of kindList, which is window, file, timer or other (queued
+ *	at the tail with TclQueueTypedEvent), head or mark.  If deleteKind
+ *	is given, the events of that kind are then removed again with
+ *	TclDeleteTypedEvents.  Finally the events are serviced, first
+ *	with TCL_FILE_EVENTS only and then with TCL_ALL_EVENTS.
+ *
+ * Results:
+ *	A standard Tcl result.  The result is a list of two lists: the
+ *	indices in kindList of the events serviced by each pass, in the
+ *	order they were serviced.
+ *
+ * Side effects:
+ *	Services events.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+TesteventringsObjCmd(dummy, interp, objc, objv)
+    ClientData dummy;		/* Not used. */
+    Tcl_Interp *interp;		/* Current interpreter. */
+    int objc;			/* Number of arguments. */
+    Tcl_Obj *CONST objv[];	/* The argument objects. */
+{
+    static char *kinds[] = {
+	"window", "file", "timer", "other", "head", "mark", (char *) NULL
+    };
+    static int kindTypes[] = {
+	TCL_WINDOW_EVENTS, TCL_FILE_EVENTS, TCL_TIMER_EVENTS, 0, 0, 0
+    };
+    enum kinds {
+	RING_WINDOW, RING_FILE, RING_TIMER, RING_OTHER, RING_HEAD, RING_MARK
+    };
+    int numKinds, kind, deleteKind, i;
+    Tcl_Obj **kindObjv, *resultPtr, *orderPtr;
+    RingTestEvent *evPtr;
+
+    if ((objc != 2) && (objc != 3)) {
+	Tcl_WrongNumArgs(interp, 1, objv, "kindList ?deleteKind?");
+	return TCL_ERROR;
+    }
+    if (Tcl_ListObjGetElements(interp, objv[1], &numKinds, &kindObjv)
+	    != TCL_OK) {
+	return TCL_ERROR;
+    }
+    for (i = 0; i < numKinds; i++) {
+	if (Tcl_GetIndexFromObj(interp, kindObjv[i], kinds, "kind", 0,
+		&kind) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+    }
+    deleteKind = -1;
+    if ((objc == 3) && (Tcl_GetIndexFromObj(interp, objv[2], kinds, "kind",
+	    0, &deleteKind) != TCL_OK)) {
+	return TCL_ERROR;
+    }
+    if (deleteKind > RING_OTHER) {
+	Tcl_AppendResult(interp, "can only delete events of kind window, ",
+		"file, timer or other", (char *) NULL);
+	return TCL_ERROR;
+    }
+
+    for (i = 0; i < numKinds; i++) {
+	Tcl_GetIndexFromObj(NULL, kindObjv[i], kinds, "kind", 0, &kind);
+	evPtr = (RingTestEvent *) ckalloc(sizeof(RingTestEvent));
+	evPtr->header.proc = RingTestEventProc;
+	evPtr->index = i;
+	evPtr->type = kindTypes[kind];
+	switch ((enum kinds) kind) {
+	    case RING_HEAD:
+		Tcl_QueueEvent((Tcl_Event *) evPtr, TCL_QUEUE_HEAD);
+		break;
+	    case RING_MARK:
+		Tcl_QueueEvent((Tcl_Event *) evPtr, TCL_QUEUE_MARK);
+		break;
+	    default:
+		TclQueueTypedEvent((Tcl_Event *) evPtr, TCL_QUEUE_TAIL,
+			evPtr->type);
+		break;
+	}
+    }
+    if (deleteKind >= 0) {
+	TclDeleteTypedEvents(kindTypes[deleteKind], RingTestDeleteProc,
+		(ClientData) NULL);
+    }
+
+    resultPtr = Tcl_GetObjResult(interp);
+    orderPtr = Tcl_NewObj();
+    ringTestOrderPtr = orderPtr;
+    while (Tcl_ServiceEvent(TCL_FILE_EVENTS)) {
+	/* Empty loop body. */
+    }
+    Tcl_ListObjAppendElement(NULL, resultPtr, orderPtr);
+    orderPtr = Tcl_NewObj();
+    ringTestOrderPtr = orderPtr;
+    while (Tcl_ServiceEvent(TCL_ALL_EVENTS)) {
+	/* Empty loop body. */
+    }
+    Tcl_ListObjAppendElement(NULL, resultPtr, orderPtr);
+    ringTestOrderPtr = NULL;
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RingTestEventProc --
+ *
+ *	Handles the events queued by "testeventrings".  Like the event
+ *	procedures of real event sources, it declines events whose kind
+ *	isn't in flags.
+ *
+ * Results:
+ *	1 if the event has been handled, 0 otherwise.
+ *
+ * Side effects:
+ *	Appends the index of the event to ringTestOrderPtr.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+RingTestEventProc(evPtr, flags)
+    Tcl_Event *evPtr;		/* The event. */
+    int flags;			/* Kinds of events being serviced. */
+{
+    RingTestEvent *ringEvPtr = (RingTestEvent *) evPtr;
+
+    if ((ringEvPtr->type != 0) && !(flags & ringEvPtr->type)) {
+	return 0;
+    }
+    if (ringTestOrderPtr != NULL) {
+	Tcl_ListObjAppendElement(NULL, ringTestOrderPtr,
+		Tcl_NewIntObj(ringEvPtr->index));
+    }
+    return 1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RingTestDeleteProc --
+ *
+ *	Tcl_EventDeleteProc used by "testeventrings" to delete its own
+ *	events, leaving any others alone.
+ *
+ * Results:
+ *	1 if evPtr was queued by "testeventrings", 0 otherwise.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+RingTestDeleteProc(evPtr, clientData)
+    Tcl_Event *evPtr;		/* Event to check. */
+    ClientData clientData;	/* Not used. */
+{
+    return (evPtr->proc == RingTestEventProc);
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1791,10 +2373,106 @@ TestgetplatformCmd(clientData, interp, argc, argv)
         return TCL_ERROR;
     }
 
-    Tcl_AppendResult(interp, platformStrings[*platform], NULL);
+    Tcl_AppendResult(interp, platformStrings[*platform], NULL);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TestglobmatchObjCmd --
+ *
+ *	This procedure implements the "testglobmatch" command.  It is
+ *	used to check patterns compiled by TclCompileGlobPattern against
+ *	Tcl_StringCaseMatch, and to time the two against each other:
+ *
+ *	testglobmatch ?-nocase? ?-braces? pattern string ?count?
+ *
+ *	Without count the result is whether the string matches the
+ *	compiled pattern.  With count, both matchers are run count times
+ *	and the result is a list of the match result and the
+ *	microseconds taken by the compiled pattern and by
+ *	Tcl_StringCaseMatch (run on each alternative in turn).
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+TestglobmatchObjCmd(clientData, interp, objc, objv)
+    ClientData clientData;	/* Not used. */
+    Tcl_Interp *interp;		/* Current interpreter. */
+    int objc;			/* Number of arguments. */
+    Tcl_Obj *CONST objv[];	/* The argument objects. */
+{
+    TclGlobPattern *patPtr;
+    Tcl_Time start, stop;
+    Tcl_Obj *resultPtr;
+    char *string, *option;
+    int i, alt, flags, count, length, match;
+    long compiled, interpreted;
+
+    flags = 0;
+    for (i = 1; i < objc; i++) {
+	option = Tcl_GetString(objv[i]);
+	if (strcmp(option, "-nocase") == 0) {
+	    flags |= TCL_GLOBPAT_NOCASE;
+	} else if (strcmp(option, "-braces") == 0) {
+	    flags |= TCL_GLOBPAT_BRACES;
+	} else {
+	    break;
+	}
+    }
+    if ((objc - i != 2) && (objc - i != 3)) {
+	Tcl_WrongNumArgs(interp, 1, objv,
+		"?-nocase? ?-braces? pattern string ?count?");
+	return TCL_ERROR;
+    }
+    count = 0;
+    if ((objc - i == 3)
+	    && (Tcl_GetIntFromObj(interp, objv[i+2], &count) != TCL_OK)) {
+	return TCL_ERROR;
+    }
+
+    patPtr = TclGetGlobPatternFromObj(objv[i], flags);
+    string = Tcl_GetStringFromObj(objv[i+1], &length);
+    match = TclGlobPatternMatch(patPtr, string, length);
+    if (count <= 0) {
+	Tcl_SetIntObj(Tcl_GetObjResult(interp), match);
+	return TCL_OK;
+    }
+
+    TclpGetTime(&start);
+    for (i = 0; i < count; i++) {
+	TclGlobPatternMatch(patPtr, string, length);
+    }
+    TclpGetTime(&stop);
+    compiled = (stop.sec - start.sec)*1000000 + (stop.usec - start.usec);
+
+    TclpGetTime(&start);
+    for (i = 0; i < count; i++) {
+	for (alt = 0; alt < patPtr->numAlts; alt++) {
+	    if (Tcl_StringCaseMatch(string, patPtr->alts[alt].source,
+		    flags & TCL_GLOBPAT_NOCASE)) {
+		break;
+	    }
+	}
+    }
+    TclpGetTime(&stop);
+    interpreted = (stop.sec - start.sec)*1000000 + (stop.usec - start.usec);
+
+    resultPtr = Tcl_GetObjResult(interp);
+    Tcl_ListObjAppendElement(NULL, resultPtr, Tcl_NewIntObj(match));
+    Tcl_ListObjAppendElement(NULL, resultPtr, Tcl_NewLongObj(compiled));
+    Tcl_ListObjAppendElement(NULL, resultPtr, Tcl_NewLongObj(interpreted));
     return TCL_OK;
 }
-
+
 /*
  *----------------------------------------------------------------------
  *
@@ -2205,6 +2883,62 @@ CleanupTestSetassocdataTests(clientData, interp)
     ckfree((char *) clientData);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TestparsecacheObjCmd --
+ *
+ *	This procedure implements the "testparsecache" command.  It is
+ *	used to examine and flush the parse cache that Tcl_EvalEx keeps
+ *	for each interpreter, and to examine the token arena it parses
+ *	commands into.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	"testparsecache flush" discards all cached scripts.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+TestparsecacheObjCmd(clientData, interp, objc, objv)
+    ClientData clientData;	/* Not used. */
+    Tcl_Interp *interp;		/* Current interpreter. */
+    int objc;			/* Number of arguments. */
+    Tcl_Obj *CONST objv[];	/* The argument objects. */
+{
+    int index;
+    static char *optionStrings[] = {
+	"arena",	"flush",	"info",		NULL
+    };
+    enum options {
+	PCACHE_ARENA,	PCACHE_FLUSH,	PCACHE_INFO
+    };
+
+    if (objc != 2) {
+	Tcl_WrongNumArgs(interp, 1, objv, "option");
+	return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObj(interp, objv[1], optionStrings, "option", 0,
+	    &index) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    switch ((enum options) index) {
+	case PCACHE_ARENA:
+	    Tcl_SetObjResult(interp, TclParseArenaInfo());
+	    break;
+	case PCACHE_FLUSH:
+	    TclFlushParseCache(interp);
+	    break;
+	case PCACHE_INFO:
+	    Tcl_SetObjResult(interp, TclParseCacheInfo(interp));
+	    break;
+    }
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -2504,6 +3238,56 @@ TestparsevarnameObjCmd(clientData, interp, objc, objv)
     Tcl_FreeParse(&parse);
     return TCL_OK;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TestpreloadObjCmd --
+ *
+ *	This procedure implements the "testpreload" command.
+ *	"testpreload ?-wait? ?fileName ...?" passes each fileName to
+ *	Tcl_PreloadFile.  With -wait, it then waits for the background
+ *	threads to exit the way Tcl_Finalize does (see TclPreloadCount).
+ *
+ * Results:
+ *	A standard Tcl result.  The result is a list holding the number
+ *	of preloaded files that no "load" command has taken yet and the
+ *	number of those that have finished loading.
+ *
+ * Side effects:
+ *	Loads files.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+TestpreloadObjCmd(dummy, interp, objc, objv)
+    ClientData dummy;		/* Not used. */
+    Tcl_Interp *interp;		/* Current interpreter. */
+    int objc;			/* Number of arguments. */
+    Tcl_Obj *CONST objv[];	/* The argument objects. */
+{
+    int wait, count, done, i;
+    Tcl_Obj *resultPtr;
+
+    wait = 0;
+    i = 1;
+    if ((objc > 1) && (strcmp(Tcl_GetString(objv[1]), "-wait") == 0)) {
+	wait = 1;
+	i++;
+    }
+    for (; i < objc; i++) {
+	if (Tcl_PreloadFile(interp, Tcl_GetString(objv[i])) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+    }
+    count = TclPreloadCount(wait, &done);
+
+    resultPtr = Tcl_GetObjResult(interp);
+    Tcl_ListObjAppendElement(NULL, resultPtr, Tcl_NewIntObj(count));
+    Tcl_ListObjAppendElement(NULL, resultPtr, Tcl_NewIntObj(done));
+    return TCL_OK;
+}
 
 /*
  *----------------------------------------------------------------------
@@ -3045,6 +3829,222 @@ StaticInitProc(interp)
     Tcl_SetVar(interp, "x", "loaded", TCL_GLOBAL_ONLY);
     return TCL_OK;
 }
+
+#ifdef TCL_THREADS
+/*
+ *----------------------------------------------------------------------
+ *
+ * TestthreadqueueObjCmd --
+ *
+ *	This procedure implements the "testthreadqueue" command, a
+ *	throughput benchmark for Tcl_ThreadQueueEvent.  "testthreadqueue
+ *	numThreads numEvents ?numIdle?" starts numThreads threads that
+ *	each post numEvents events to the current thread, alerting it
+ *	after each one, and services events until all of them have been
+ *	handled.  If numIdle is given, that many more threads first set
+ *	up notifiers of their own and wait until the benchmark is over,
+ *	so that the posting threads have to find the current thread's
+ *	notifier among theirs.
+ *
+ * Results:
+ *	A standard Tcl result.  The result is a list holding the number
+ *	of events serviced and the elapsed time in microseconds.
+ *
+ * Side effects:
+ *	Creates threads and services events.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+TestthreadqueueObjCmd(dummy, interp, objc, objv)
+    ClientData dummy;		/* Not used. */
+    Tcl_Interp *interp;		/* Current interpreter. */
+    int objc;			/* Number of arguments. */
+    Tcl_Obj *CONST objv[];	/* The argument objects. */
+{
+    int numThreads, numEvents, numIdle, total, i;
+    ThreadQueueProducer *producerPtr;
+    Tcl_ThreadId threadId;
+    Tcl_Time start, stop;
+    Tcl_Obj *resultPtr;
+    long elapsed;
+
+    if ((objc != 3) && (objc != 4)) {
+	Tcl_WrongNumArgs(interp, 1, objv, "numThreads numEvents ?numIdle?");
+	return TCL_ERROR;
+    }
+    if ((Tcl_GetIntFromObj(interp, objv[1], &numThreads) != TCL_OK)
+	    || (Tcl_GetIntFromObj(interp, objv[2], &numEvents) != TCL_OK)) {
+	return TCL_ERROR;
+    }
+    numIdle = 0;
+    if ((objc == 4)
+	    && (Tcl_GetIntFromObj(interp, objv[3], &numIdle) != TCL_OK)) {
+	return TCL_ERROR;
+    }
+    if ((numThreads < 1) || (numEvents < 0) || (numIdle < 0)) {
+	Tcl_AppendResult(interp, "need at least one thread and a ",
+		"non-negative number of events", (char *) NULL);
+	return TCL_ERROR;
+    }
+
+    /*
+     * Start the idle threads and wait until all of them have notifiers.
+     */
+
+    Tcl_MutexLock(&threadQueueMutex);
+    threadQueueIdleDone = 0;
+    for (i = 0; i < numIdle; i++) {
+	if (Tcl_CreateThread(&threadId, ThreadQueueIdleProc,
+		(ClientData) NULL, TCL_THREAD_STACK_DEFAULT,
+		TCL_THREAD_NOFLAGS) != TCL_OK) {
+	    numIdle = i;
+	    break;
+	}
+    }
+    while (threadQueueIdleCount < numIdle) {
+	Tcl_ConditionWait(&threadQueueCond, &threadQueueMutex, NULL);
+    }
+    Tcl_MutexUnlock(&threadQueueMutex);
+
+    threadQueueCount = 0;
+    total = 0;
+    TclpGetTime(&start);
+    for (i = 0; i < numThreads; i++) {
+	producerPtr = (ThreadQueueProducer *)
+		ckalloc(sizeof(ThreadQueueProducer));
+	producerPtr->targetId = Tcl_GetCurrentThread();
+	producerPtr->numEvents = numEvents;
+	if (Tcl_CreateThread(&threadId, ThreadQueueProducerProc,
+		(ClientData) producerPtr, TCL_THREAD_STACK_DEFAULT,
+		TCL_THREAD_NOFLAGS) != TCL_OK) {
+	    ckfree((char *) producerPtr);
+	    break;
+	}
+	total += numEvents;
+    }
+    while (threadQueueCount < total) {
+	Tcl_DoOneEvent(TCL_ALL_EVENTS);
+    }
+    TclpGetTime(&stop);
+    elapsed = (stop.sec - start.sec)*1000000 + (stop.usec - start.usec);
+
+    /*
+     * Let the idle threads go.
+     */
+
+    Tcl_MutexLock(&threadQueueMutex);
+    threadQueueIdleDone = 1;
+    Tcl_ConditionNotify(&threadQueueCond);
+    while (threadQueueIdleCount > 0) {
+	Tcl_ConditionWait(&threadQueueCond, &threadQueueMutex, NULL);
+    }
+    Tcl_MutexUnlock(&threadQueueMutex);
+
+    resultPtr = Tcl_GetObjResult(interp);
+    Tcl_ListObjAppendElement(NULL, resultPtr, Tcl_NewIntObj(total));
+    Tcl_ListObjAppendElement(NULL, resultPtr, Tcl_NewLongObj(elapsed));
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ThreadQueueProducerProc --
+ *
+ *	Body of the threads started by "testthreadqueue".
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Posts events to the target thread and exits the thread.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_ThreadCreateType
+ThreadQueueProducerProc(clientData)
+    ClientData clientData;	/* The ThreadQueueProducer. */
+{
+    ThreadQueueProducer *producerPtr = (ThreadQueueProducer *) clientData;
+    Tcl_Event *evPtr;
+    int i;
+
+    for (i = 0; i < producerPtr->numEvents; i++) {
+	evPtr = (Tcl_Event *) ckalloc(sizeof(Tcl_Event));
+	evPtr->proc = ThreadQueueEventProc;
+	Tcl_ThreadQueueEvent(producerPtr->targetId, evPtr, TCL_QUEUE_TAIL);
+	Tcl_ThreadAlert(producerPtr->targetId);
+    }
+    ckfree((char *) producerPtr);
+    Tcl_ExitThread(0);
+    TCL_THREAD_CREATE_RETURN;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ThreadQueueIdleProc --
+ *
+ *	Body of the idle threads started by "testthreadqueue".
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Sets up a notifier for the thread, waits until the benchmark is
+ *	over and exits the thread.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_ThreadCreateType
+ThreadQueueIdleProc(clientData)
+    ClientData clientData;	/* Not used. */
+{
+    TclInitSubsystems(NULL);
+
+    Tcl_MutexLock(&threadQueueMutex);
+    threadQueueIdleCount++;
+    Tcl_ConditionNotify(&threadQueueCond);
+    while (!threadQueueIdleDone) {
+	Tcl_ConditionWait(&threadQueueCond, &threadQueueMutex, NULL);
+    }
+    threadQueueIdleCount--;
+    Tcl_ConditionNotify(&threadQueueCond);
+    Tcl_MutexUnlock(&threadQueueMutex);
+
+    Tcl_ExitThread(0);
+    TCL_THREAD_CREATE_RETURN;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ThreadQueueEventProc --
+ *
+ *	Handles the events posted by the "testthreadqueue" threads.
+ *
+ * Results:
+ *	Always 1: the event has been handled.
+ *
+ * Side effects:
+ *	Counts the event.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ThreadQueueEventProc(evPtr, flags)
+    Tcl_Event *evPtr;		/* The event. */
+    int flags;			/* Not used. */
+{
+    threadQueueCount++;
+    return 1;
+}
+#endif
 
 /*
  *----------------------------------------------------------------------
@@ -3987,6 +4987,144 @@ TeststatprocCmd (dummy, interp, argc, argv)
     return retVal;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TeststatcacheObjCmd --
+ *
+ *	This procedure implements the "teststatcache" command.
+ *	"teststatcache nameList" runs "file statlist" over nameList with
+ *	TestStatProc1 and a hook that counts its calls installed.  It
+ *	checks that a second call within the lifetime of the stat cache
+ *	is answered from the cache, that entries expire, and that
+ *	-threads gives the same result as the serial path.
+ *
+ * Results:
+ *	A standard Tcl result.  The result is a list holding the number
+ *	of hook calls made by the first call, by the second (cached)
+ *	call and by a call after the entries expired, followed by 1 if
+ *	the serial and -threads results were the same and 0 otherwise.
+ *
+ * Side effects:
+ *	Leaves the stat cache of the interpreter disabled, unless
+ *	"file statlist" fails.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+TeststatcacheObjCmd(dummy, interp, objc, objv)
+    ClientData dummy;		/* Not used. */
+    Tcl_Interp *interp;		/* Current interpreter. */
+    int objc;			/* Number of arguments. */
+    Tcl_Obj *CONST objv[];	/* The argument objects. */
+{
+    int calls[3], same, result;
+    Tcl_Obj *serialPtr, *threadedPtr, *resultPtr;
+
+    if (objc != 2) {
+	Tcl_WrongNumArgs(interp, 1, objv, "nameList");
+	return TCL_ERROR;
+    }
+
+    TclStatInsertProc(TestStatProc1);
+    TclStatInsertProc(TestStatCountProc);
+    serialPtr = threadedPtr = NULL;
+    result = TCL_ERROR;
+
+    if (EvalStatList(interp, "-ttl 60000", objv[1], &calls[0], NULL)
+	    != TCL_OK) {
+	goto done;
+    }
+    if (EvalStatList(interp, "-ttl 60000", objv[1], &calls[1], NULL)
+	    != TCL_OK) {
+	goto done;
+    }
+    Tcl_Sleep(20);
+    if (EvalStatList(interp, "-ttl 10", objv[1], &calls[2], NULL)
+	    != TCL_OK) {
+	goto done;
+    }
+    if ((EvalStatList(interp, "-ttl 0", objv[1], NULL, &serialPtr)
+	    != TCL_OK)
+	    || (EvalStatList(interp, "-threads 4", objv[1], NULL,
+	    &threadedPtr) != TCL_OK)) {
+	goto done;
+    }
+    same = (strcmp(Tcl_GetString(serialPtr),
+	    Tcl_GetString(threadedPtr)) == 0);
+
+    Tcl_ResetResult(interp);
+    resultPtr = Tcl_GetObjResult(interp);
+    Tcl_ListObjAppendElement(NULL, resultPtr, Tcl_NewIntObj(calls[0]));
+    Tcl_ListObjAppendElement(NULL, resultPtr, Tcl_NewIntObj(calls[1]));
+    Tcl_ListObjAppendElement(NULL, resultPtr, Tcl_NewIntObj(calls[2]));
+    Tcl_ListObjAppendElement(NULL, resultPtr, Tcl_NewIntObj(same));
+    result = TCL_OK;
+
+    done:
+    if (serialPtr != NULL) {
+	Tcl_DecrRefCount(serialPtr);
+    }
+    if (threadedPtr != NULL) {
+	Tcl_DecrRefCount(threadedPtr);
+    }
+    TclStatDeleteProc(TestStatCountProc);
+    TclStatDeleteProc(TestStatProc1);
+    return result;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EvalStatList --
+ *
+ *	Evaluates "file statlist options nameList" for "teststatcache".
+ *
+ * Results:
+ *	A standard Tcl result.  If callsPtr isn't NULL, *callsPtr is set
+ *	to the number of calls made to TestStatCountProc.  If resultPtrPtr
+ *	isn't NULL, *resultPtrPtr is set to the result of the command,
+ *	with its reference count incremented.
+ *
+ * Side effects:
+ *	Whatever "file statlist" does.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+EvalStatList(interp, options, namesPtr, callsPtr, resultPtrPtr)
+    Tcl_Interp *interp;		/* Interpreter to evaluate in. */
+    char *options;		/* Options for "file statlist". */
+    Tcl_Obj *namesPtr;		/* List of file names. */
+    int *callsPtr;		/* Where to store the number of hook calls,
+				 * or NULL. */
+    Tcl_Obj **resultPtrPtr;	/* Where to store the result, or NULL. */
+{
+    Tcl_Obj *cmdPtr;
+    int result;
+
+    cmdPtr = Tcl_NewStringObj("file statlist ", -1);
+    Tcl_AppendToObj(cmdPtr, options, -1);
+    Tcl_IncrRefCount(cmdPtr);
+    if (Tcl_ListObjAppendElement(interp, cmdPtr, namesPtr) != TCL_OK) {
+	Tcl_DecrRefCount(cmdPtr);
+	return TCL_ERROR;
+    }
+    statCountCalls = 0;
+    result = Tcl_EvalObjEx(interp, cmdPtr, 0);
+    Tcl_DecrRefCount(cmdPtr);
+    if (callsPtr != NULL) {
+	*callsPtr = statCountCalls;
+    }
+    if ((result == TCL_OK) && (resultPtrPtr != NULL)) {
+	*resultPtrPtr = Tcl_GetObjResult(interp);
+	Tcl_IncrRefCount(*resultPtrPtr);
+    }
+    return result;
+}
+
 /* Be careful in the compares in these tests, since the Macintosh puts a  
  * leading : in the beginning of non-absolute paths before passing them 
  * into the file command procedures.
@@ -4020,6 +5158,20 @@ TestStatProc3(path, buf)
     buf->st_size = 3456;
     return ((strstr(path, "testStat3%.fil") == NULL) ? -1 : 0);
 }
+
+/*
+ * Counts its calls for "teststatcache" and passes every path on to the
+ * next stat hook.
+ */
+
+static int
+TestStatCountProc(path, buf)
+    CONST char *path;
+    struct stat *buf;
+{
+    statCountCalls++;
+    return -1;
+}
 
 /*
  *----------------------------------------------------------------------
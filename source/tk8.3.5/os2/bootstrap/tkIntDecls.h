@@ -418,6 +418,19 @@ EXTERN KeySym		TkpGetKeySym _ANSI_ARGS_((TkDisplay * dispPtr,
 				XEvent * eventPtr));
 /* 139 */
 EXTERN void		TkpInitKeymapInfo _ANSI_ARGS_((TkDisplay * dispPtr));
+/* 140 */
+EXTERN int		TkSetBindingCoalesce _ANSI_ARGS_((
+				Tcl_Interp * interp, 
+				Tk_BindingTable bindingTable, 
+				ClientData object, char * eventString, 
+				int interval));
+/* 141 */
+EXTERN int		TkBindTestMatcher _ANSI_ARGS_((Tk_Window tkwin, 
+				int numObjects, int numEvents, 
+				unsigned long seed, int * numLookupsPtr));
+/* 142 */
+EXTERN void		TkGetDeferredMotion _ANSI_ARGS_((Tcl_Interp * interp, 
+				Tk_Window tkwin));
 
 typedef struct TkIntStubs {
     int magic;
@@ -673,6 +686,9 @@ typedef struct TkIntStubs {
     void (*tkpSetKeycodeAndState) _ANSI_ARGS_((Tk_Window tkwin, KeySym keySym, XEvent * eventPtr)); /* 137 */
     KeySym (*tkpGetKeySym) _ANSI_ARGS_((TkDisplay * dispPtr, XEvent * eventPtr)); /* 138 */
     void (*tkpInitKeymapInfo) _ANSI_ARGS_((TkDisplay * dispPtr)); /* 139 */
+    int (*tkSetBindingCoalesce) _ANSI_ARGS_((Tcl_Interp * interp, Tk_BindingTable bindingTable, ClientData object, char * eventString, int interval)); /* 140 */
+    int (*tkBindTestMatcher) _ANSI_ARGS_((Tk_Window tkwin, int numObjects, int numEvents, unsigned long seed, int * numLookupsPtr)); /* 141 */
+    void (*tkGetDeferredMotion) _ANSI_ARGS_((Tcl_Interp * interp, Tk_Window tkwin)); /* 142 */
 } TkIntStubs;
 
 #ifdef __cplusplus
@@ -1198,6 +1214,18 @@ extern TkIntStubs *tkIntStubsPtr;
 #define TkpInitKeymapInfo \
 	(tkIntStubsPtr->tkpInitKeymapInfo) /* 139 */
 #endif
+#ifndef TkSetBindingCoalesce
+#define TkSetBindingCoalesce \
+	(tkIntStubsPtr->tkSetBindingCoalesce) /* 140 */
+#endif
+#ifndef TkBindTestMatcher
+#define TkBindTestMatcher \
+	(tkIntStubsPtr->tkBindTestMatcher) /* 141 */
+#endif
+#ifndef TkGetDeferredMotion
+#define TkGetDeferredMotion \
+	(tkIntStubsPtr->tkGetDeferredMotion) /* 142 */
+#endif
 
 #endif /* defined(USE_TK_STUBS) && !defined(USE_TK_STUB_PROCS) */
 
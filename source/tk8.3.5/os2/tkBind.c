@@ -105,10 +105,36 @@ typedef struct BindingTable {
 					 * list of patterns associated with
 					 * that object.  Keys are ClientData,
 					 * values are (PatSeq *). */
+    Tcl_HashTable matcherTable;		/* Compiled form of the lists in
+					 * patternTable, made as events arrive.
+					 * Keys are the (Tcl_HashEntry *) of
+					 * the list in patternTable, values
+					 * are (SeqMatcher *). */
+    unsigned int *typeCounts;		/* Number of pattern sequences in
+					 * patternTable for each event type
+					 * and bucket of objects; see
+					 * TYPE_COUNT below.  NULL until the
+					 * first sequence is added. */
     Tcl_Interp *interp;			/* Interpreter in which commands are
 					 * executed. */
 } BindingTable;
 
+/*
+ * Tk_BindEvent looks an event up in the patternTable of a binding table
+ * once or twice for each of the objects it is given, and most of those
+ * lookups find nothing: few tags have bindings for Motion events, say.
+ * To skip them, the objects are hashed into TYPE_BUCKETS buckets, and
+ * the typeCounts of a binding table count the pattern sequences whose
+ * last event is of a given type, for each bucket.  If the count for an
+ * object's bucket is zero the object can't have a binding for the event.
+ */
+
+#define TYPE_BUCKETS		32
+#define TYPE_BUCKET(object) \
+	((((unsigned int) (unsigned long) (object)) * 0x9E3779B1U) >> 27)
+#define TYPE_COUNT(bindPtr, type, object) \
+	((bindPtr)->typeCounts[(type) * TYPE_BUCKETS + TYPE_BUCKET(object)])
+
 /*
  * The following structure represents virtual event table.  A virtual event
  * table provides a way to map from platform-specific physical events such
@@ -270,6 +296,78 @@ typedef struct PatSeq {
 #define NEARBY_PIXELS		5
 #define NEARBY_MS		500
 
+/*
+ * Most pattern sequences in a binding table are single events, and for
+ * those the only thing the hash key of their list doesn't already decide
+ * is the modifier state.  So the first time an event is looked up in a
+ * list, the list is compiled into a SeqMatcher: its multi-event sequences
+ * are set apart, to be matched against the event ring by MatchSequence
+ * as before, and the best single-event sequence is found once for each
+ * combination of the modifiers that the single-event sequences need and
+ * remembered.  The SeqMatcher is thrown away whenever the list changes.
+ */
+
+typedef struct SeqMatcher {
+    int modMask;		/* Union of the needMods of the single-event
+				 * sequences in the list. */
+    int numMulti;		/* Number of entries in multiPtrs. */
+    PatSeq **multiPtrs;		/* The multi-event sequences in the list, in
+				 * list order (malloc-ed), or NULL. */
+    Tcl_HashTable singleTable;	/* Maps a modifier state, masked with
+				 * modMask, to the best single-event sequence
+				 * for that state, or NULL if there is none.
+				 * Keys are one word. */
+} SeqMatcher;
+
+/*
+ * The clientData of a Tcl binding is a TclBinding.  When the binding is
+ * created its script is split into chunks of literal text, each followed
+ * by a %-field, so that ExpandPercents doesn't have to scan the script
+ * for each event.  If the script is a single command in which every
+ * %-field is a word of its own, the words are kept too, and the command
+ * is invoked with the field values as arguments instead of substituting
+ * them into the script and parsing it again.  A script without %-fields
+ * is kept as an object, so that it is compiled only once.
+ */
+
+typedef struct BindChunk {
+    int length;			/* Number of bytes of literal text. */
+    int field;			/* Character after the '%' that follows the
+				 * text, 0 if that '%' ends the script, or -1
+				 * if the text ends the script. */
+} BindChunk;
+
+typedef struct BindWord {
+    Tcl_Obj *objPtr;		/* Value of a literal word, or NULL if the
+				 * word is a %-field. */
+    int field;			/* Character after the '%' of a %-field. */
+} BindWord;
+
+typedef struct TclBinding {
+    char *script;		/* The binding script (malloc-ed). */
+    int numChunks;		/* Number of entries in chunks. */
+    BindChunk *chunks;		/* The script, split at its %-fields. */
+    int textLength;		/* Total length of the literal text. */
+    int numWords;		/* Number of entries in words, or 0 if the
+				 * script can't be invoked word by word. */
+    BindWord *words;		/* The words of the command, or NULL. */
+    Tcl_Obj *scriptObj;		/* The script as an object if it has no
+				 * %-fields, NULL otherwise. */
+    int coalesce;		/* If greater than 0, motion events that
+				 * match the binding are coalesced: the
+				 * script is invoked this many milliseconds
+				 * after the first of them, for the last. */
+    struct DeferredMotion *deferList;
+				/* The motion events waiting for the script,
+				 * at most one for each window, or NULL. */
+} TclBinding;
+
+/*
+ * Size of the buffer for the value of a numeric %-field.
+ */
+
+#define NUM_SIZE 40
+
 
 /*
  * The following structure keeps track of all the virtual events that are
@@ -279,9 +377,11 @@ typedef struct PatSeq {
 
 typedef struct VirtualOwners {
     int numOwners;		    /* Number of virtual events to trigger. */
+    int space;			    /* Number of entries allocated for
+				     * owners; doubled when it runs out. */
     Tcl_HashEntry *owners[1];	    /* Array of pointers to entries in
 				     * nameTable.  Enough space will
-				     * actually be allocated for numOwners
+				     * actually be allocated for space
 				     * hash entries. */
 } VirtualOwners;
 
@@ -292,11 +392,34 @@ typedef struct VirtualOwners {
  */
 typedef struct PhysicalsOwned {
     int numOwned;		    /* Number of physical events owned. */
+    int space;			    /* Number of entries allocated for
+				     * patSeqs; doubled when it runs out. */
     PatSeq *patSeqs[1];		    /* Array of pointers to physical event
 				     * patterns.  Enough space will actually
-				     * be allocated to hold numOwned. */
+				     * be allocated to hold space. */
 } PhysicalsOwned;
 
+/*
+ * Whether a physical event triggers a virtual event depends only on the
+ * recent events, not on the binding tag being looked at.  So Tk_BindEvent
+ * matches the definitions in the virtual event table against the event
+ * ring once for each event, and keeps the ones that match in the
+ * following structure; for each tag it then only has to check whether
+ * the tag has a binding for one of their virtual events.
+ */
+
+#define NUM_STATIC_CANDIDATES 8
+
+typedef struct VirtualCandidates {
+    int numCands;		    /* Number of matching definitions. */
+    int space;			    /* Number of entries in candPtrs. */
+    PatSeq **candPtrs;		    /* The matching definitions, in the
+				     * order of their hash chain.  Points to
+				     * staticCands unless there are more
+				     * than fit there. */
+    PatSeq *staticCands[NUM_STATIC_CANDIDATES];
+} VirtualCandidates;
+
 /*
  * One of the following structures exists for each interpreter.  This
  * structure keeps track of the current display and screen in the
@@ -354,7 +477,47 @@ typedef struct BindInfo {
 				 * window to be deleted. */
     int deleted;		/* 1 the application has been deleted but
 				 * the structure has been preserved. */
+    struct DeferredMotion *deferList;
+				/* Motion events waiting for coalescing
+				 * bindings in this application, oldest
+				 * first. */
+    unsigned long deferSerial;	/* Number of calls to Tk_BindEvent that
+				 * deferred a motion event. */
 } BindInfo;
+
+/*
+ * A DeferredMotion holds the last motion event in a window that matched a
+ * coalescing binding (see TclBinding), until its timer goes off.  If any
+ * other kind of event for the window reaches Tk_BindEvent through the
+ * same binding table before that, the waiting bindings are invoked first,
+ * so that (for example) a drag's last motion is never seen after the
+ * button release.
+ *
+ * The bindings deferred by one call to Tk_BindEvent are invoked in the
+ * order of the binding tags, and a break or an error in one of them
+ * stops the rest, as if they had not been deferred.
+ */
+
+typedef struct DeferredMotion {
+    TclBinding *bindingPtr;	/* The binding to invoke. */
+    BindInfo *bindInfoPtr;	/* Application the binding belongs to; this
+				 * is in its deferList. */
+    BindingTable *bindPtr;	/* Binding table the binding is in. */
+    Tcl_Interp *interp;		/* Interpreter in which to invoke it. */
+    TkWindow *winPtr;		/* Window where the event occurred. */
+    XEvent event;		/* The most recent motion event. */
+    KeySym keySym;		/* KeySym for %-substitution. */
+    unsigned long serial;	/* Value of bindInfoPtr->deferSerial for
+				 * the call to Tk_BindEvent that deferred
+				 * the event. */
+    int order;			/* Position of the binding among those
+				 * found by that call. */
+    Tcl_TimerToken timer;	/* Invokes the binding, or NULL. */
+    struct DeferredMotion *nextPtr;
+				/* Next in the deferList of the BindInfo. */
+    struct DeferredMotion *nextForBindingPtr;
+				/* Next in the deferList of the binding. */
+} DeferredMotion;
     
 /*
  * In X11R4 and earlier versions, XStringToKeysym is ridiculously
@@ -643,19 +806,43 @@ static TkStateMap visNotify[] = {
  * Prototypes for local procedures defined in this file:
  */
 
+static int		BetterSequence _ANSI_ARGS_((PatSeq *matchPtr,
+			    PatSeq *bestPtr));
+static void		CancelDeferredMotion _ANSI_ARGS_((
+			    DeferredMotion *deferPtr));
 static void		ChangeScreen _ANSI_ARGS_((Tcl_Interp *interp,
 			    char *dispName, int screenIndex));
+static void		ChangeTestBinding _ANSI_ARGS_((Tcl_Interp *interp,
+			    BindingTable *bindPtr, ClientData object,
+			    unsigned long *seedPtr, int add));
+static int		CollectDeferredMotion _ANSI_ARGS_((
+			    BindInfo *bindInfoPtr, unsigned long serial,
+			    int maxOrder, Tcl_DString *dsPtr));
+static void		CountSequence _ANSI_ARGS_((BindingTable *bindPtr,
+			    ClientData object, PatSeq *psPtr, int delta));
 static int		CreateVirtualEvent _ANSI_ARGS_((Tcl_Interp *interp,
 			    VirtualEventTable *vetPtr, char *virtString,
 			    char *eventString));
 static int		DeleteVirtualEvent _ANSI_ARGS_((Tcl_Interp *interp,
 			    VirtualEventTable *vetPtr, char *virtString,
 			    char *eventString));
+static TclBinding *	CompileTclBinding _ANSI_ARGS_((char *script));
+static void		DeferMotion _ANSI_ARGS_((BindInfo *bindInfoPtr,
+			    BindingTable *bindPtr, Tcl_Interp *interp,
+			    TclBinding *bindingPtr, TkWindow *winPtr,
+			    XEvent *eventPtr, KeySym keySym,
+			    unsigned long serial, int order));
+static void		DeferredMotionProc _ANSI_ARGS_((
+			    ClientData clientData));
 static void		DeleteVirtualEventTable _ANSI_ARGS_((
 			    VirtualEventTable *vetPtr));
 static void		ExpandPercents _ANSI_ARGS_((TkWindow *winPtr,
-			    char *before, XEvent *eventPtr, KeySym keySym,
-			    Tcl_DString *dsPtr));
+			    TclBinding *bindingPtr, XEvent *eventPtr,
+			    KeySym keySym, Tcl_DString *dsPtr));
+static void		FindVirtualCandidates _ANSI_ARGS_((TkDisplay *dispPtr,
+			    BindingTable *bindPtr, PatSeq *psPtr,
+			    VirtualCandidates *candsPtr));
+static void		FreeMatcher _ANSI_ARGS_((SeqMatcher *matcherPtr));
 static void		FreeTclBinding _ANSI_ARGS_((ClientData clientData));
 static PatSeq *		FindSequence _ANSI_ARGS_((Tcl_Interp *interp,
 			    Tcl_HashTable *patternTablePtr, ClientData object,
@@ -666,6 +853,10 @@ static void		GetAllVirtualEvents _ANSI_ARGS_((Tcl_Interp *interp,
 static char *		GetField _ANSI_ARGS_((char *p, char *copy, int size));
 static void		GetPatternString _ANSI_ARGS_((PatSeq *psPtr,
 			    Tcl_DString *dsPtr));
+static char *		GetPercentValue _ANSI_ARGS_((TkWindow *winPtr,
+			    int field, XEvent *eventPtr, KeySym keySym,
+			    int flags, char *numStorage, Tcl_DString *bufPtr,
+			    int *numericPtr));
 static int		GetVirtualEvent _ANSI_ARGS_((Tcl_Interp *interp,
 			    VirtualEventTable *vetPtr, char *virtString));
 static Tk_Uid		GetVirtualEventUid _ANSI_ARGS_((Tcl_Interp *interp,
@@ -675,16 +866,31 @@ static int		HandleEventGenerate _ANSI_ARGS_((Tcl_Interp *interp,
 			    Tcl_Obj *CONST objv[]));
 static void		InitVirtualEventTable _ANSI_ARGS_((
 			    VirtualEventTable *vetPtr));
-static PatSeq *		MatchPatterns _ANSI_ARGS_((TkDisplay *dispPtr,
-			    BindingTable *bindPtr, PatSeq *psPtr,
-			    PatSeq *bestPtr, ClientData *objectPtr,
-			    PatSeq **sourcePtrPtr));
+static void		InvalidateMatcher _ANSI_ARGS_((BindingTable *bindPtr,
+			    Tcl_HashEntry *hPtr));
+static PatSeq *		MatchCompiledPatterns _ANSI_ARGS_((
+			    TkDisplay *dispPtr, BindingTable *bindPtr,
+			    Tcl_HashEntry *hPtr));
+static int		MatchSequence _ANSI_ARGS_((TkDisplay *dispPtr,
+			    BindingTable *bindPtr, PatSeq *psPtr));
+static PatSeq *		MatchVirtualCandidates _ANSI_ARGS_((
+			    BindingTable *bindPtr,
+			    VirtualCandidates *candsPtr, PatSeq *bestPtr,
+			    ClientData object, PatSeq **sourcePtrPtr));
 static int		NameToWindow _ANSI_ARGS_((Tcl_Interp *interp,
 			    Tk_Window main, Tcl_Obj *objPtr,
 			    Tk_Window *tkwinPtr));
 static int		ParseEventDescription _ANSI_ARGS_((Tcl_Interp *interp,
 			    char **eventStringPtr, Pattern *patPtr,
 			    unsigned long *eventMaskPtr));
+static PatSeq *		ReferenceMatchPatterns _ANSI_ARGS_((
+			    TkDisplay *dispPtr, BindingTable *bindPtr,
+			    PatSeq *psPtr));
+static Tcl_Obj *	SubstituteWords _ANSI_ARGS_((TkWindow *winPtr,
+			    TclBinding *bindingPtr, XEvent *eventPtr,
+			    KeySym keySym));
+static int		TestRandom _ANSI_ARGS_((unsigned long *seedPtr,
+			    int n));
 static void		DoWarp _ANSI_ARGS_((ClientData clientData));
 
 /*
@@ -696,6 +902,28 @@ static void		DoWarp _ANSI_ARGS_((ClientData clientData));
 
 #define EvalTclBinding	((TkBindEvalProc *) 1)
 
+/*
+ * Kinds of the entries Tk_BindEvent collects before evaluating them:
+ *
+ * BIND_SCRIPT		A %-substituted script in the "scripts" string.
+ * BIND_SCRIPT_OBJ	A Tcl binding's scriptObj.
+ * BIND_WORDS		A list of words made by SubstituteWords.
+ * BIND_PROC		A C binding in the pending list.
+ * BIND_COALESCE	A coalescing Tcl binding in the pending list, for a
+ *			motion event.
+ * BIND_DEFERRED	The script of a DeferredMotion, in "scripts".
+ * BIND_DEFERRED_END	Ends the scripts of the DeferredMotions made by
+ *			one call to Tk_BindEvent.
+ */
+
+#define BIND_SCRIPT		's'
+#define BIND_SCRIPT_OBJ		'o'
+#define BIND_WORDS		'w'
+#define BIND_DEFERRED		'd'
+#define BIND_DEFERRED_END	'e'
+#define BIND_PROC		'c'
+#define BIND_COALESCE		'm'
+
 
 /*
  *---------------------------------------------------------------------------
@@ -779,6 +1007,8 @@ TkBindInit(mainPtr)
     bindInfoPtr->screenInfo.bindingDepth = 0;
     bindInfoPtr->pendingList = NULL;
     bindInfoPtr->deleted = 0;
+    bindInfoPtr->deferList = NULL;
+    bindInfoPtr->deferSerial = 0;
     mainPtr->bindInfo = (TkBindInfo) bindInfoPtr;
 
     TkpInitializeMenuBindings(mainPtr->interp, mainPtr->bindingTable);
@@ -811,6 +1041,9 @@ TkBindFree(mainPtr)
     mainPtr->bindingTable = NULL;
 
     bindInfoPtr = (BindInfo *) mainPtr->bindInfo;
+    while (bindInfoPtr->deferList != NULL) {
+	CancelDeferredMotion(bindInfoPtr->deferList);
+    }
     DeleteVirtualEventTable(&bindInfoPtr->virtualEventTable);
     bindInfoPtr->deleted = 1;
     Tcl_EventuallyFree((ClientData) bindInfoPtr, TCL_DYNAMIC);
@@ -855,6 +1088,8 @@ Tk_CreateBindingTable(interp)
     Tcl_InitHashTable(&bindPtr->patternTable,
 	    sizeof(PatternTableKey)/sizeof(int));
     Tcl_InitHashTable(&bindPtr->objectTable, TCL_ONE_WORD_KEYS);
+    Tcl_InitHashTable(&bindPtr->matcherTable, TCL_ONE_WORD_KEYS);
+    bindPtr->typeCounts = NULL;
     bindPtr->interp = interp;
     return (Tk_BindingTable) bindPtr;
 }
@@ -907,6 +1142,11 @@ Tk_DeleteBindingTable(bindingTable)
 	}
     }
 
+    for (hPtr = Tcl_FirstHashEntry(&bindPtr->matcherTable, &search);
+	    hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	FreeMatcher((SeqMatcher *) Tcl_GetHashValue(hPtr));
+    }
+
     /*
      * Clean up the rest of the information associated with the
      * binding table.
@@ -914,6 +1154,10 @@ Tk_DeleteBindingTable(bindingTable)
 
     Tcl_DeleteHashTable(&bindPtr->patternTable);
     Tcl_DeleteHashTable(&bindPtr->objectTable);
+    Tcl_DeleteHashTable(&bindPtr->matcherTable);
+    if (bindPtr->typeCounts != NULL) {
+	ckfree((char *) bindPtr->typeCounts);
+    }
     ckfree((char *) bindPtr);
 }
 
@@ -963,8 +1207,10 @@ Tk_CreateBinding(interp, bindingTable, object, eventString, command, append)
 {
     BindingTable *bindPtr = (BindingTable *) bindingTable;
     PatSeq *psPtr;
+    TclBinding *bindingPtr;
     unsigned long eventMask;
     char *new, *old;
+    int coalesce;
 
     psPtr = FindSequence(interp, &bindPtr->patternTable, object, eventString,
 	    1, 1, &eventMask);
@@ -990,6 +1236,8 @@ Tk_CreateBinding(interp, bindingTable, object, eventString, command, append)
 	    psPtr->nextObjPtr = (PatSeq *) Tcl_GetHashValue(hPtr);
 	}
 	Tcl_SetHashValue(hPtr, psPtr);
+	InvalidateMatcher(bindPtr, psPtr->hPtr);
+	CountSequence(bindPtr, object, psPtr, 1);
     } else if (psPtr->eventProc != EvalTclBinding) {
 	/*
 	 * Free existing procedural binding.
@@ -1002,10 +1250,13 @@ Tk_CreateBinding(interp, bindingTable, object, eventString, command, append)
 	append = 0;
     }
 
-    old = (char *) psPtr->clientData;
-    if ((append != 0) && (old != NULL)) {
+    bindingPtr = (TclBinding *) psPtr->clientData;
+    coalesce = 0;
+    if ((append != 0) && (bindingPtr != NULL)) {
 	int length;
 
+	coalesce = bindingPtr->coalesce;
+	old = bindingPtr->script;
 	length = strlen(old) + strlen(command) + 2;
 	new = (char *) ckalloc((unsigned) length);
 	sprintf(new, "%s\n%s", old, command);
@@ -1013,12 +1264,14 @@ Tk_CreateBinding(interp, bindingTable, object, eventString, command, append)
 	new = (char *) ckalloc((unsigned) strlen(command) + 1);
 	strcpy(new, command);
     }
-    if (old != NULL) {
-	ckfree(old);
+    if (bindingPtr != NULL) {
+	FreeTclBinding((ClientData) bindingPtr);
     }
     psPtr->eventProc = EvalTclBinding;
     psPtr->freeProc = FreeTclBinding;
-    psPtr->clientData = (ClientData) new;
+    bindingPtr = CompileTclBinding(new);
+    bindingPtr->coalesce = coalesce;
+    psPtr->clientData = (ClientData) bindingPtr;
     return eventMask;
 }
 
@@ -1091,6 +1344,8 @@ TkCreateBindingProcedure(interp, bindingTable, object, eventString,
 	    psPtr->nextObjPtr = (PatSeq *) Tcl_GetHashValue(hPtr);
 	}
 	Tcl_SetHashValue(hPtr, psPtr);
+	InvalidateMatcher(bindPtr, psPtr->hPtr);
+	CountSequence(bindPtr, object, psPtr, 1);
     } else {
 
 	/*
@@ -1170,6 +1425,8 @@ Tk_DeleteBinding(interp, bindingTable, object, eventString)
 	    }
 	}
     }
+    InvalidateMatcher(bindPtr, psPtr->hPtr);
+    CountSequence(bindPtr, object, psPtr, -1);
     prevPtr = (PatSeq *) Tcl_GetHashValue(psPtr->hPtr);
     if (prevPtr == psPtr) {
 	if (psPtr->nextSeqPtr == NULL) {
@@ -1241,7 +1498,7 @@ Tk_GetBinding(interp, bindingTable, object, eventString)
 	return NULL;
     }
     if (psPtr->eventProc == EvalTclBinding) {
-	return (char *) psPtr->clientData;
+	return ((TclBinding *) psPtr->clientData)->script;
     }
     return "";
 }
@@ -1342,6 +1599,8 @@ Tk_DeleteAllBindings(bindingTable, object)
 	 * then delete the hash entry too.
 	 */
 
+	InvalidateMatcher(bindPtr, psPtr->hPtr);
+	CountSequence(bindPtr, object, psPtr, -1);
 	prevPtr = (PatSeq *) Tcl_GetHashValue(psPtr->hPtr);
 	if (prevPtr == psPtr) {
 	    if (psPtr->nextSeqPtr == NULL) {
@@ -1423,13 +1682,16 @@ Tk_BindEvent(bindingTable, eventPtr, tkwin, numObjects, objectPtr)
     BindInfo *bindInfoPtr;
     TkDisplay *oldDispPtr;
     XEvent *ringPtr;
-    PatSeq *vMatchDetailList, *vMatchNoDetailList;
+    VirtualCandidates vDetailCands, vNoDetailCands;
     int flags, oldScreen, i, deferModal;
     unsigned int matchCount, matchSpace;
+    unsigned long deferSerial;
     Tcl_Interp *interp;
-    Tcl_DString scripts, savedResult;
+    Tcl_DString scripts, kinds, savedResult;
+    Tcl_Obj *cmdListPtr, *objPtr;
     Detail detail;
-    char *p, *end;
+    char *p, *kind, *end;
+    int j;
     PendingBinding *pendingPtr;
     PendingBinding staticPending;
     TkWindow *winPtr = (TkWindow *)tkwin;
@@ -1547,8 +1809,10 @@ Tk_BindEvent(bindingTable, eventPtr, tkwin, numObjects, objectPtr)
      * physical event (or sequence of physical events).
      */
 
-    vMatchDetailList = NULL;
-    vMatchNoDetailList = NULL;
+    vDetailCands.numCands = 0;
+    vDetailCands.candPtrs = vDetailCands.staticCands;
+    vNoDetailCands.numCands = 0;
+    vNoDetailCands.candPtrs = vNoDetailCands.staticCands;
     memset(&key, 0, sizeof(key));
 
     if (ringPtr->type != VirtualEvent) {
@@ -1563,14 +1827,16 @@ Tk_BindEvent(bindingTable, eventPtr, tkwin, numObjects, objectPtr)
 
 	hPtr = Tcl_FindHashEntry(veptPtr, (char *) &key);
 	if (hPtr != NULL) {
-	    vMatchDetailList = (PatSeq *) Tcl_GetHashValue(hPtr);
+	    FindVirtualCandidates(dispPtr, bindPtr,
+		    (PatSeq *) Tcl_GetHashValue(hPtr), &vDetailCands);
 	}
 
 	if (key.detail.clientData != 0) {
 	    key.detail.clientData = 0;
 	    hPtr = Tcl_FindHashEntry(veptPtr, (char *) &key);
 	    if (hPtr != NULL) {
-	        vMatchNoDetailList = (PatSeq *) Tcl_GetHashValue(hPtr);
+		FindVirtualCandidates(dispPtr, bindPtr,
+			(PatSeq *) Tcl_GetHashValue(hPtr), &vNoDetailCands);
 	    }
 	}
     }
@@ -1579,22 +1845,76 @@ Tk_BindEvent(bindingTable, eventPtr, tkwin, numObjects, objectPtr)
      * Loop over all the binding tags, finding the binding script or
      * callback for each one.  Append all of the binding scripts, with
      * %-sequences expanded, to "scripts", with null characters separating
-     * the scripts for each object.  Append all the callbacks to the array
-     * of pending callbacks.  
+     * the scripts for each object, or their commands and script objects
+     * to cmdListPtr.  Append all the callbacks to the array of pending
+     * callbacks.  The kind of each binding found is appended to "kinds".
      */
 	       
     pendingPtr = &staticPending;
     matchCount = 0;
     matchSpace = sizeof(staticPending.matchArray) / sizeof(PatSeq *);
     Tcl_DStringInit(&scripts);
+    Tcl_DStringInit(&kinds);
+    cmdListPtr = NULL;
+
+    /*
+     * Any other kind of event in the window first invokes the coalescing
+     * bindings of this table that are waiting for motion events in it,
+     * oldest first.
+     */
+
+    if (eventPtr->type != MotionNotify) {
+	while (1) {
+	    DeferredMotion *deferPtr, *oldestPtr;
+	    char entryKind;
+
+	    oldestPtr = NULL;
+	    for (deferPtr = bindInfoPtr->deferList; deferPtr != NULL;
+		    deferPtr = deferPtr->nextPtr) {
+		if ((deferPtr->winPtr == winPtr)
+			&& (deferPtr->bindPtr == bindPtr)
+			&& ((oldestPtr == NULL)
+				|| (deferPtr->serial < oldestPtr->serial))) {
+		    oldestPtr = deferPtr;
+		}
+	    }
+	    if (oldestPtr == NULL) {
+		break;
+	    }
+	    entryKind = BIND_DEFERRED;
+	    for (j = CollectDeferredMotion(bindInfoPtr, oldestPtr->serial, -1,
+		    &scripts); j > 0; j--) {
+		Tcl_DStringAppend(&kinds, &entryKind, 1);
+	    }
+	    entryKind = BIND_DEFERRED_END;
+	    Tcl_DStringAppend(&kinds, &entryKind, 1);
+	}
+    }
 
     for ( ; numObjects > 0; numObjects--, objectPtr++) {
 	PatSeq *matchPtr, *sourcePtr;
 	Tcl_HashEntry *hPtr;
+	int checkVirtual;
 
 	matchPtr = NULL;
 	sourcePtr = NULL;
 
+	/*
+	 * Skip the object if it can't have a binding for the event, either
+	 * directly or through a virtual event.
+	 */
+
+	if (bindPtr->typeCounts == NULL) {
+	    continue;
+	}
+	checkVirtual = ((vDetailCands.numCands != 0)
+		|| (vNoDetailCands.numCands != 0))
+		&& (TYPE_COUNT(bindPtr, VirtualEvent, *objectPtr) != 0);
+	if (!checkVirtual
+		&& (TYPE_COUNT(bindPtr, ringPtr->type, *objectPtr) == 0)) {
+	    continue;
+	}
+
 	/*
 	 * Match the new event against those recorded in the pattern table,
 	 * saving the longest matching pattern.  For events with details
@@ -1608,14 +1928,13 @@ Tk_BindEvent(bindingTable, eventPtr, tkwin, numObjects, objectPtr)
 	key.detail = detail;
 	hPtr = Tcl_FindHashEntry(&bindPtr->patternTable, (char *) &key);
 	if (hPtr != NULL) {
-	    matchPtr = MatchPatterns(dispPtr, bindPtr, 
-		    (PatSeq *) Tcl_GetHashValue(hPtr), matchPtr, NULL,
-		    &sourcePtr);
+	    matchPtr = MatchCompiledPatterns(dispPtr, bindPtr, hPtr);
+	    sourcePtr = matchPtr;
 	}
 
-	if (vMatchDetailList != NULL) {
-	    matchPtr = MatchPatterns(dispPtr, bindPtr, vMatchDetailList,
-		    matchPtr, objectPtr, &sourcePtr);
+	if (checkVirtual && (vDetailCands.numCands != 0)) {
+	    matchPtr = MatchVirtualCandidates(bindPtr, &vDetailCands,
+		    matchPtr, *objectPtr, &sourcePtr);
 	}
 
 	/*
@@ -1627,25 +1946,57 @@ Tk_BindEvent(bindingTable, eventPtr, tkwin, numObjects, objectPtr)
 	    key.detail.clientData = 0;
 	    hPtr = Tcl_FindHashEntry(&bindPtr->patternTable, (char *) &key);
 	    if (hPtr != NULL) {
-		matchPtr = MatchPatterns(dispPtr, bindPtr,
-			(PatSeq *) Tcl_GetHashValue(hPtr), matchPtr, NULL,
-			&sourcePtr);
+		matchPtr = MatchCompiledPatterns(dispPtr, bindPtr, hPtr);
+		sourcePtr = matchPtr;
 	    }
 
-	    if (vMatchNoDetailList != NULL) {
-	        matchPtr = MatchPatterns(dispPtr, bindPtr, vMatchNoDetailList,
-			matchPtr, objectPtr, &sourcePtr);
+	    if (checkVirtual && (vNoDetailCands.numCands != 0)) {
+		matchPtr = MatchVirtualCandidates(bindPtr, &vNoDetailCands,
+			matchPtr, *objectPtr, &sourcePtr);
 	    }
 
 	}
     
 	if (matchPtr != NULL) {
+	    char entryKind;
+
 	    if (sourcePtr->eventProc == NULL) {
 		panic("Tk_BindEvent: missing command");
 	    }
-	    if (sourcePtr->eventProc == EvalTclBinding) {
-		ExpandPercents(winPtr, (char *) sourcePtr->clientData,
-			eventPtr, detail.keySym, &scripts);
+	    if ((sourcePtr->eventProc == EvalTclBinding)
+		    && ((eventPtr->type != MotionNotify)
+			    || (((TclBinding *) sourcePtr->clientData)->coalesce
+				    <= 0))) {
+		TclBinding *bindingPtr = (TclBinding *) sourcePtr->clientData;
+
+		if (bindingPtr->scriptObj != NULL) {
+		    objPtr = bindingPtr->scriptObj;
+		    entryKind = BIND_SCRIPT_OBJ;
+		} else if (bindingPtr->numWords > 0) {
+		    objPtr = SubstituteWords(winPtr, bindingPtr, eventPtr,
+			    detail.keySym);
+		    entryKind = BIND_WORDS;
+		} else {
+		    ExpandPercents(winPtr, bindingPtr, eventPtr,
+			    detail.keySym, &scripts);
+
+		    /*
+		     * A "" is added to the scripts string to separate the
+		     * various scripts that should be invoked.
+		     */
+
+		    Tcl_DStringAppend(&scripts, "", 1);
+		    entryKind = BIND_SCRIPT;
+		    objPtr = NULL;
+		}
+		if (objPtr != NULL) {
+		    if (cmdListPtr == NULL) {
+			cmdListPtr = Tcl_NewListObj(0, (Tcl_Obj **) NULL);
+			Tcl_IncrRefCount(cmdListPtr);
+		    }
+		    Tcl_ListObjAppendElement((Tcl_Interp *) NULL, cmdListPtr,
+			    objPtr);
+		}
 	    } else {
 		if (matchCount >= matchSpace) {
 		    PendingBinding *new;
@@ -1668,16 +2019,29 @@ Tk_BindEvent(bindingTable, eventPtr, tkwin, numObjects, objectPtr)
 		sourcePtr->refCount++;
 		pendingPtr->matchArray[matchCount] = sourcePtr;
 		matchCount++;
-	    }
-	    /*
-	     * A "" is added to the scripts string to separate the
-	     * various scripts that should be invoked.
-	     */
 
-	    Tcl_DStringAppend(&scripts, "", 1);
+		/*
+		 * A coalescing binding is only deferred when its turn comes
+		 * in the loop below, so that a break in the bindings before
+		 * it stops it as usual.
+		 */
+
+		if (sourcePtr->eventProc == EvalTclBinding) {
+		    entryKind = BIND_COALESCE;
+		} else {
+		    entryKind = BIND_PROC;
+		}
+	    }
+	    Tcl_DStringAppend(&kinds, &entryKind, 1);
 	}
     }
-    if (Tcl_DStringLength(&scripts) == 0) {
+    if (vDetailCands.candPtrs != vDetailCands.staticCands) {
+	ckfree((char *) vDetailCands.candPtrs);
+    }
+    if (vNoDetailCands.candPtrs != vNoDetailCands.staticCands) {
+	ckfree((char *) vNoDetailCands.candPtrs);
+    }
+    if (Tcl_DStringLength(&kinds) == 0) {
 	return;
     }
 
@@ -1742,8 +2106,11 @@ Tk_BindEvent(bindingTable, eventPtr, tkwin, numObjects, objectPtr)
     winPtr->flags &= ~TK_DEFER_MODAL;
 
     p = Tcl_DStringValue(&scripts);
-    end = p + Tcl_DStringLength(&scripts);
+    kind = Tcl_DStringValue(&kinds);
+    end = kind + Tcl_DStringLength(&kinds);
     i = 0;
+    j = 0;
+    deferSerial = 0;
 
     /*
      * Be carefule when dereferencing screenPtr or bindInfoPtr.  If we
@@ -1753,15 +2120,19 @@ Tk_BindEvent(bindingTable, eventPtr, tkwin, numObjects, objectPtr)
      */
 
     Tcl_Preserve((ClientData) bindInfoPtr);
-    while (p < end) {
-	int code;
+    for ( ; kind < end; kind++) {
+	int code, objc;
+	Tcl_Obj **objv;
 	
+	if (*kind == BIND_DEFERRED_END) {
+	    continue;
+	}
 	if (!bindInfoPtr->deleted) {
 	    screenPtr->bindingDepth++;
 	}
 	Tcl_AllowExceptions(interp);
 
-	if (*p == '\0') {
+	if ((*kind == BIND_PROC) || (*kind == BIND_COALESCE)) {
 	    PatSeq *psPtr;
 	    
 	    psPtr = pendingPtr->matchArray[i];
@@ -1769,8 +2140,26 @@ Tk_BindEvent(bindingTable, eventPtr, tkwin, numObjects, objectPtr)
 	    code = TCL_OK;
 	    if ((pendingPtr->deleted == 0)
 		    && ((psPtr->flags & MARKED_DELETED) == 0)) {
-		code = (*psPtr->eventProc)(psPtr->clientData, interp, eventPtr,
-			tkwin, detail.keySym);
+		if (*kind == BIND_PROC) {
+		    code = (*psPtr->eventProc)(psPtr->clientData, interp,
+			    eventPtr, tkwin, detail.keySym);
+		} else if ((psPtr->eventProc == EvalTclBinding)
+			&& (((TclBinding *) psPtr->clientData)->coalesce > 0)
+			&& !bindInfoPtr->deleted) {
+		    /*
+		     * If an earlier binding replaced this one, the new
+		     * script is deferred, as a C binding's new procedure
+		     * would be called.  The binding table is still there,
+		     * since the sequence isn't marked deleted.
+		     */
+
+		    if (deferSerial == 0) {
+			deferSerial = ++bindInfoPtr->deferSerial;
+		    }
+		    DeferMotion(bindInfoPtr, bindPtr, interp,
+			    (TclBinding *) psPtr->clientData, winPtr,
+			    eventPtr, detail.keySym, deferSerial, i);
+		}
 	    }
 	    psPtr->refCount--;
 	    if ((psPtr->refCount == 0) && (psPtr->flags & MARKED_DELETED)) {
@@ -1779,11 +2168,38 @@ Tk_BindEvent(bindingTable, eventPtr, tkwin, numObjects, objectPtr)
 		}
 		ckfree((char *) psPtr);
 	    }
+	} else if (*kind == BIND_SCRIPT_OBJ) {
+	    Tcl_ListObjIndex((Tcl_Interp *) NULL, cmdListPtr, j, &objPtr);
+	    j++;
+	    code = Tcl_EvalObjEx(interp, objPtr, TCL_EVAL_GLOBAL);
+	} else if (*kind == BIND_WORDS) {
+	    Tcl_ListObjIndex((Tcl_Interp *) NULL, cmdListPtr, j, &objPtr);
+	    j++;
+	    Tcl_ListObjGetElements((Tcl_Interp *) NULL, objPtr, &objc, &objv);
+	    code = Tcl_EvalObjv(interp, objc, objv, TCL_EVAL_GLOBAL);
 	} else {
 	    code = Tcl_GlobalEval(interp, p);
-	    p += strlen(p);
+	    p += strlen(p) + 1;
+	    if (*kind == BIND_DEFERRED) {
+		/*
+		 * The script belongs to an earlier event, so it can't
+		 * stop the bindings for this one, only the others that
+		 * were deferred with it.
+		 */
+
+		if (code == TCL_ERROR) {
+		    Tcl_AddErrorInfo(interp, "\n    (command bound to event)");
+		    Tcl_BackgroundError(interp);
+		}
+		if ((code == TCL_BREAK) || (code == TCL_ERROR)) {
+		    while (kind[1] != BIND_DEFERRED_END) {
+			kind++;
+			p += strlen(p) + 1;
+		    }
+		}
+		code = TCL_OK;
+	    }
 	}
-	p++;
 
 	if (!bindInfoPtr->deleted) {
 	    screenPtr->bindingDepth--;
@@ -1833,6 +2249,10 @@ Tk_BindEvent(bindingTable, eventPtr, tkwin, numObjects, objectPtr)
     }
     Tcl_DStringResult(interp, &savedResult);
     Tcl_DStringFree(&scripts);
+    Tcl_DStringFree(&kinds);
+    if (cmdListPtr != NULL) {
+	Tcl_DecrRefCount(cmdListPtr);
+    }
 
     if (matchCount > 0) {
 	if (!bindInfoPtr->deleted) {
@@ -1870,7 +2290,8 @@ Tk_BindEvent(bindingTable, eventPtr, tkwin, numObjects, objectPtr)
  *	None.
  *
  * Side effects:
- *	Any pending C bindings for this window are cancelled.
+ *	Any pending C bindings for this window are cancelled, as are
+ *	the motion events of the window waiting for coalescing bindings.
  *
  *---------------------------------------------------------------------------
  */
@@ -1881,6 +2302,7 @@ TkBindDeadWindow(winPtr)
 {
     BindInfo *bindInfoPtr;
     PendingBinding *curPtr;
+    DeferredMotion *deferPtr, *nextPtr;
 
     bindInfoPtr = (BindInfo *) winPtr->mainPtr->bindInfo;
     curPtr = bindInfoPtr->pendingList;
@@ -1890,168 +2312,1107 @@ TkBindDeadWindow(winPtr)
 	}
 	curPtr = curPtr->nextPtr;
     }
+    for (deferPtr = bindInfoPtr->deferList; deferPtr != NULL;
+	    deferPtr = nextPtr) {
+	nextPtr = deferPtr->nextPtr;
+	if (deferPtr->winPtr == winPtr) {
+	    CancelDeferredMotion(deferPtr);
+	}
+    }
 }
-
+
 /*
- *----------------------------------------------------------------------
+ *---------------------------------------------------------------------------
+ *
+ * TkSetBindingCoalesce --
+ *
+ *	Make the Tcl binding for an event sequence coalesce the motion
+ *	events that match it (see TclBinding), or find out whether it
+ *	does.  This implements the -coalesce option of the "bind"
+ *	command.
+ *
+ * Results:
+ *	A standard Tcl result.  If interval is negative, the interp's
+ *	result is the binding's interval, 0 if it doesn't coalesce, or
+ *	empty if there is no binding for the sequence.  Otherwise it is an
+ *	error if there is no Tcl binding for the sequence.
  *
- * MatchPatterns --
+ * Side effects:
+ *	Unless interval is negative, the binding is from now on invoked at
+ *	most once for each interval milliseconds of pointer motion in a
+ *	window, for the last motion event.  An interval of 0 turns
+ *	coalescing off.
  *
- *      Given a list of pattern sequences and a list of recent events,
- *      return the pattern sequence that best matches the event list,
- *	if there is one.
+ *---------------------------------------------------------------------------
+ */
+
+int
+TkSetBindingCoalesce(interp, bindingTable, object, eventString, interval)
+    Tcl_Interp *interp;		/* Interpreter for error messages. */
+    Tk_BindingTable bindingTable;
+				/* Table in which the binding is. */
+    ClientData object;		/* Object the binding is for. */
+    char *eventString;		/* The binding's event sequence. */
+    int interval;		/* Milliseconds to coalesce motion events
+				 * for, 0, or -1 to only query. */
+{
+    BindingTable *bindPtr = (BindingTable *) bindingTable;
+    PatSeq *psPtr;
+    unsigned long eventMask;
+
+    psPtr = FindSequence(interp, &bindPtr->patternTable, object, eventString,
+	    0, 1, &eventMask);
+    if (interval < 0) {
+	Tcl_ResetResult(interp);
+	if (psPtr == NULL) {
+	    return TCL_OK;
+	}
+	if (psPtr->eventProc == EvalTclBinding) {
+	    interval = ((TclBinding *) psPtr->clientData)->coalesce;
+	} else {
+	    interval = 0;
+	}
+	Tcl_SetObjResult(interp, Tcl_NewIntObj(interval));
+	return TCL_OK;
+    }
+    if (psPtr == NULL) {
+	return TCL_ERROR;
+    }
+    if (psPtr->eventProc != EvalTclBinding) {
+	Tcl_AppendResult(interp, "no Tcl binding for \"", eventString,
+		"\"", (char *) NULL);
+	return TCL_ERROR;
+    }
+    ((TclBinding *) psPtr->clientData)->coalesce = interval;
+    return TCL_OK;
+}
+
+/*
+ *---------------------------------------------------------------------------
  *
- *	This procedure is used in two different ways.  In the simplest
- *	use, "object" is NULL and psPtr is a list of pattern sequences,
- *	each of which corresponds to a binding.  In this case, the
- *	procedure finds the pattern sequences that match the event list
- *	and returns the most specific of those, if there is more than one.
+ * TkGetDeferredMotion --
  *
- *	In the second case, psPtr is a list of pattern sequences, each
- *	of which corresponds to a definition for a virtual binding.
- *	In order for one of these sequences to "match", it must match
- *	the events (as above) but in addition there must be a binding
- *	for its associated virtual event on the current object.  The
- *	"object" argument indicates which object the binding must be for.
+ *	Find the motion events in a window that are waiting for
+ *	coalescing bindings of its application's binding table.  This is
+ *	used by the "testbindcoalesce" command in tkTest.c.
  *
  * Results:
- *      The return value is NULL if bestPtr is NULL and no pattern matches
- *	the recent events from bindPtr.  Otherwise the return value is
- *	the most specific pattern sequence among bestPtr and all those
- *	at psPtr that match the event list and object.  If a pattern
- *	sequence other than bestPtr is returned, then *bestCommandPtr
- *	is filled in with a pointer to the command from the best sequence.
+ *	The interp's result is a list with one element for each waiting
+ *	event, oldest first, each a list of the binding's script and the
+ *	x and y fields of the event.
  *
  * Side effects:
- *      None.
+ *	None.
  *
- *----------------------------------------------------------------------
+ *---------------------------------------------------------------------------
  */
-static PatSeq *
-MatchPatterns(dispPtr, bindPtr, psPtr, bestPtr, objectPtr, sourcePtrPtr)
-    TkDisplay *dispPtr;		/* Display from which the event came. */
-    BindingTable *bindPtr;	/* Information about binding table, such as
-				 * ring of recent events. */
-    PatSeq *psPtr;		/* List of pattern sequences. */
-    PatSeq *bestPtr; 		/* The best match seen so far, from a
-				 * previous call to this procedure.  NULL
-				 * means no prior best match. */
-    ClientData *objectPtr;	/* If NULL, the sequences at psPtr
-				 * correspond to "normal" bindings.  If
-				 * non-NULL, the sequences at psPtr correspond
-				 * to virtual bindings; in order to match each
-				 * sequence must correspond to a virtual
-				 * binding for which a binding exists for
-				 * object in bindPtr. */
-    PatSeq **sourcePtrPtr;	/* Filled with the pattern sequence that
-				 * contains the eventProc and clientData
-				 * associated with the best match.  If this
-				 * differs from the return value, it is the
-				 * virtual event that most closely matched the
-				 * return value (a physical event).  Not
-				 * modified unless a result other than bestPtr
-				 * is returned. */
+
+void
+TkGetDeferredMotion(interp, tkwin)
+    Tcl_Interp *interp;		/* Interpreter for the result. */
+    Tk_Window tkwin;		/* Window to look for. */
 {
-    PatSeq *matchPtr, *bestSourcePtr, *sourcePtr;
+    TkWindow *winPtr = (TkWindow *) tkwin;
+    BindInfo *bindInfoPtr = (BindInfo *) winPtr->mainPtr->bindInfo;
+    DeferredMotion *deferPtr;
+    Tcl_Obj *resultPtr, *objv[3];
+
+    resultPtr = Tcl_NewListObj(0, (Tcl_Obj **) NULL);
+    for (deferPtr = bindInfoPtr->deferList; deferPtr != NULL;
+	    deferPtr = deferPtr->nextPtr) {
+	if ((deferPtr->winPtr != winPtr) || (deferPtr->bindPtr
+		!= (BindingTable *) winPtr->mainPtr->bindingTable)) {
+	    continue;
+	}
+	objv[0] = Tcl_NewStringObj(deferPtr->bindingPtr->script, -1);
+	objv[1] = Tcl_NewIntObj(deferPtr->event.xmotion.x);
+	objv[2] = Tcl_NewIntObj(deferPtr->event.xmotion.y);
+	Tcl_ListObjAppendElement((Tcl_Interp *) NULL, resultPtr,
+		Tcl_NewListObj(3, objv));
+    }
+    Tcl_SetObjResult(interp, resultPtr);
+}
 
-    bestSourcePtr = *sourcePtrPtr;
+/*
+ *---------------------------------------------------------------------------
+ *
+ * DeferMotion --
+ *
+ *	Called by Tk_BindEvent when a coalescing binding is to be invoked
+ *	for a motion event.  The event replaces the one that is waiting
+ *	for the binding in the same window, if there is one; otherwise it
+ *	starts a wait.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	A DeferredMotion and its timer may be created.
+ *
+ *---------------------------------------------------------------------------
+ */
 
-    /*
-     * Iterate over all the pattern sequences.
-     */
+static void
+DeferMotion(bindInfoPtr, bindPtr, interp, bindingPtr, winPtr, eventPtr,
+	keySym, serial, order)
+    BindInfo *bindInfoPtr;	/* Application of the binding. */
+    BindingTable *bindPtr;	/* Binding table the binding is in. */
+    Tcl_Interp *interp;		/* Interpreter for the binding. */
+    TclBinding *bindingPtr;	/* The coalescing binding. */
+    TkWindow *winPtr;		/* Window where the event occurred. */
+    XEvent *eventPtr;		/* The motion event. */
+    KeySym keySym;		/* KeySym for %-substitution. */
+    unsigned long serial;	/* Identifies the call to Tk_BindEvent. */
+    int order;			/* Position of the binding among those
+				 * found by that call. */
+{
+    DeferredMotion *deferPtr, **deferPtrPtr;
 
-    for ( ; psPtr != NULL; psPtr = psPtr->nextSeqPtr) {
-	XEvent *eventPtr;
-	Pattern *patPtr;
-	Window window;
-	Detail *detailPtr;
-	int patCount, ringCount, flags, state;
-	int modMask;
+    for (deferPtr = bindingPtr->deferList; deferPtr != NULL;
+	    deferPtr = deferPtr->nextForBindingPtr) {
+	if (deferPtr->winPtr == winPtr) {
+	    break;
+	}
+    }
+    if (deferPtr == NULL) {
+	deferPtr = (DeferredMotion *) ckalloc(sizeof(DeferredMotion));
+	deferPtr->bindingPtr = bindingPtr;
+	deferPtr->bindInfoPtr = bindInfoPtr;
+	deferPtr->bindPtr = bindPtr;
+	deferPtr->interp = interp;
+	deferPtr->winPtr = winPtr;
+	deferPtr->timer = Tcl_CreateTimerHandler(bindingPtr->coalesce,
+		DeferredMotionProc, (ClientData) deferPtr);
+	deferPtr->nextPtr = NULL;
+	for (deferPtrPtr = &bindInfoPtr->deferList; *deferPtrPtr != NULL;
+		deferPtrPtr = &(*deferPtrPtr)->nextPtr) {
+	    /* Empty loop body. */
+	}
+	*deferPtrPtr = deferPtr;
+	deferPtr->nextForBindingPtr = bindingPtr->deferList;
+	bindingPtr->deferList = deferPtr;
+    }
+    memcpy((VOID *) &deferPtr->event, (VOID *) eventPtr, sizeof(XEvent));
+    deferPtr->keySym = keySym;
+    deferPtr->serial = serial;
+    deferPtr->order = order;
+}
 
-	/*
-	 * Iterate over all the patterns in a sequence to be
-	 * sure that they all match.
-	 */
+/*
+ *---------------------------------------------------------------------------
+ *
+ * DeferredMotionProc --
+ *
+ *	Timer callback that invokes a coalescing binding for the last
+ *	motion event it was waiting for.  The bindings that were deferred
+ *	along with it and come before it are invoked first, since a break
+ *	in one of them must stop it.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Depends on the bindings' scripts.
+ *
+ *---------------------------------------------------------------------------
+ */
 
-	eventPtr = &bindPtr->eventRing[bindPtr->curEvent];
-	detailPtr = &bindPtr->detailRing[bindPtr->curEvent];
-	window = eventPtr->xany.window;
-	patPtr = psPtr->pats;
-	patCount = psPtr->numPats;
-	ringCount = EVENT_BUFFER_SIZE;
-	while (patCount > 0) {
-	    if (ringCount <= 0) {
-		goto nextSequence;
-	    }
-	    if (eventPtr->xany.type != patPtr->eventType) {
-		/*
-		 * Most of the event types are considered superfluous
-		 * in that they are ignored if they occur in the middle
-		 * of a pattern sequence and have mismatching types.  The
-		 * only ones that cannot be ignored are ButtonPress and
-		 * ButtonRelease events (if the next event in the pattern
-		 * is a KeyPress or KeyRelease) and KeyPress and KeyRelease
-		 * events (if the next pattern event is a ButtonPress or
-		 * ButtonRelease).  Here are some tricky cases to consider:
-		 * 1. Double-Button or Double-Key events.
-		 * 2. Double-ButtonRelease or Double-KeyRelease events.
-		 * 3. The arrival of various events like Enter and Leave
-		 *    and FocusIn and GraphicsExpose between two button
-		 *    presses or key presses.
-		 * 4. Modifier keys like Shift and Control shouldn't
-		 *    generate conflicts with button events.
-		 */
+static void
+DeferredMotionProc(clientData)
+    ClientData clientData;	/* The DeferredMotion. */
+{
+    DeferredMotion *deferPtr = (DeferredMotion *) clientData;
+    BindInfo *bindInfoPtr = deferPtr->bindInfoPtr;
+    Tcl_Interp *interp = deferPtr->interp;
+    TkWindow *winPtr = deferPtr->winPtr;
+    unsigned long serial = deferPtr->serial;
+    ScreenInfo *screenPtr;
+    TkDisplay *oldDispPtr;
+    int oldScreen, code, numScripts;
+    Tcl_DString scripts;
+    char *p;
 
-		if ((patPtr->eventType == KeyPress)
-			|| (patPtr->eventType == KeyRelease)) {
-		    if ((eventPtr->xany.type == ButtonPress)
-			    || (eventPtr->xany.type == ButtonRelease)) {
-			goto nextSequence;
-		    }
-		} else if ((patPtr->eventType == ButtonPress)
-			|| (patPtr->eventType == ButtonRelease)) {
-		    if ((eventPtr->xany.type == KeyPress)
-			    || (eventPtr->xany.type == KeyRelease)) {
-			int i;
+    deferPtr->timer = NULL;
+    Tcl_DStringInit(&scripts);
+    numScripts = CollectDeferredMotion(bindInfoPtr, serial, deferPtr->order,
+	    &scripts);
 
-			/*
-			 * Ignore key events if they are modifier keys.
-			 */
+    /*
+     * Make the window's screen the current one while the scripts run,
+     * as Tk_BindEvent does.
+     */
 
-			for (i = 0; i < dispPtr->numModKeyCodes; i++) {
-			    if (dispPtr->modKeyCodes[i]
-				    == eventPtr->xkey.keycode) {
-				/*
-				 * This key is a modifier key, so ignore it.
-				 */
-				goto nextEvent;
-			    }
-			}
-			goto nextSequence;
-		    }
-		}
-		goto nextEvent;
+    Tcl_Preserve((ClientData) bindInfoPtr);
+    Tcl_Preserve((ClientData) interp);
+    screenPtr = &bindInfoPtr->screenInfo;
+    oldDispPtr = screenPtr->curDispPtr;
+    oldScreen = screenPtr->curScreenIndex;
+    if ((winPtr->dispPtr != screenPtr->curDispPtr)
+	    || (Tk_ScreenNumber((Tk_Window) winPtr)
+		    != screenPtr->curScreenIndex)) {
+	screenPtr->curDispPtr = winPtr->dispPtr;
+	screenPtr->curScreenIndex = Tk_ScreenNumber((Tk_Window) winPtr);
+	ChangeScreen(interp, winPtr->dispPtr->name,
+		screenPtr->curScreenIndex);
+    }
+    screenPtr->bindingDepth++;
+    for (p = Tcl_DStringValue(&scripts); numScripts > 0;
+	    numScripts--, p += strlen(p) + 1) {
+	Tcl_AllowExceptions(interp);
+	code = Tcl_GlobalEval(interp, p);
+	if (code == TCL_ERROR) {
+	    Tcl_AddErrorInfo(interp, "\n    (command bound to event)");
+	    Tcl_BackgroundError(interp);
+	}
+	if ((code == TCL_BREAK) || (code == TCL_ERROR)) {
+	    /*
+	     * Drop the bindings deferred along with this one that come
+	     * after it.
+	     */
+
+	    if (!bindInfoPtr->deleted) {
+		CollectDeferredMotion(bindInfoPtr, serial, -1,
+			(Tcl_DString *) NULL);
 	    }
-	    if (eventPtr->xany.window != window) {
-		goto nextSequence;
+	    break;
+	}
+    }
+    if (!bindInfoPtr->deleted) {
+	screenPtr->bindingDepth--;
+	if ((screenPtr->bindingDepth != 0)
+		&& ((oldDispPtr != screenPtr->curDispPtr)
+			|| (oldScreen != screenPtr->curScreenIndex))) {
+	    screenPtr->curDispPtr = oldDispPtr;
+	    screenPtr->curScreenIndex = oldScreen;
+	    ChangeScreen(interp, oldDispPtr->name, oldScreen);
+	}
+    }
+    Tcl_Release((ClientData) interp);
+    Tcl_Release((ClientData) bindInfoPtr);
+    Tcl_DStringFree(&scripts);
+}
+
+/*
+ *---------------------------------------------------------------------------
+ *
+ * CollectDeferredMotion --
+ *
+ *	Take the bindings deferred by one call to Tk_BindEvent off the
+ *	application's deferList, in the order of the binding tags, and
+ *	make their scripts.
+ *
+ * Results:
+ *	The number of bindings.  If dsPtr isn't NULL, their scripts, with
+ *	%-sequences expanded and each followed by a null character, are
+ *	appended to it.
+ *
+ * Side effects:
+ *	The DeferredMotions are freed.
+ *
+ *---------------------------------------------------------------------------
+ */
+
+static int
+CollectDeferredMotion(bindInfoPtr, serial, maxOrder, dsPtr)
+    BindInfo *bindInfoPtr;	/* Application of the bindings. */
+    unsigned long serial;	/* Identifies the call to Tk_BindEvent. */
+    int maxOrder;		/* Leave the bindings whose order is greater
+				 * than this, unless it is -1. */
+    Tcl_DString *dsPtr;		/* Where to append the scripts, or NULL. */
+{
+    DeferredMotion *deferPtr, *firstPtr;
+    int count;
+
+    for (count = 0; ; count++) {
+	firstPtr = NULL;
+	for (deferPtr = bindInfoPtr->deferList; deferPtr != NULL;
+		deferPtr = deferPtr->nextPtr) {
+	    if ((deferPtr->serial == serial)
+		    && ((maxOrder < 0) || (deferPtr->order <= maxOrder))
+		    && ((firstPtr == NULL)
+			    || (deferPtr->order < firstPtr->order))) {
+		firstPtr = deferPtr;
+	    }
+	}
+	if (firstPtr == NULL) {
+	    return count;
+	}
+	if (dsPtr != NULL) {
+	    ExpandPercents(firstPtr->winPtr, firstPtr->bindingPtr,
+		    &firstPtr->event, firstPtr->keySym, dsPtr);
+	    Tcl_DStringAppend(dsPtr, "", 1);
+	}
+	CancelDeferredMotion(firstPtr);
+    }
+}
+
+/*
+ *---------------------------------------------------------------------------
+ *
+ * CancelDeferredMotion --
+ *
+ *	Stop a coalescing binding from waiting for motion events in a
+ *	window.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The DeferredMotion is removed from the deferLists of its
+ *	application and binding and freed, and its timer is deleted.
+ *
+ *---------------------------------------------------------------------------
+ */
+
+static void
+CancelDeferredMotion(deferPtr)
+    DeferredMotion *deferPtr;	/* The waiting binding. */
+{
+    DeferredMotion **deferPtrPtr;
+
+    for (deferPtrPtr = &deferPtr->bindInfoPtr->deferList;
+	    *deferPtrPtr != deferPtr; deferPtrPtr = &(*deferPtrPtr)->nextPtr) {
+	/* Empty loop body. */
+    }
+    *deferPtrPtr = deferPtr->nextPtr;
+    for (deferPtrPtr = &deferPtr->bindingPtr->deferList;
+	    *deferPtrPtr != deferPtr;
+	    deferPtrPtr = &(*deferPtrPtr)->nextForBindingPtr) {
+	/* Empty loop body. */
+    }
+    *deferPtrPtr = deferPtr->nextForBindingPtr;
+    if (deferPtr->timer != NULL) {
+	Tcl_DeleteTimerHandler(deferPtr->timer);
+    }
+    ckfree((char *) deferPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FindVirtualCandidates --
+ *
+ *	Given a list of pattern sequences from a virtual event table,
+ *	find those that match the recent events in a binding table.
+ *
+ * Results:
+ *	The matching sequences are stored in *candsPtr, in the order
+ *	of the list.  The caller must initialize *candsPtr to hold no
+ *	candidates, and must free candsPtr->candPtrs if it no longer
+ *	points to candsPtr->staticCands afterwards.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FindVirtualCandidates(dispPtr, bindPtr, psPtr, candsPtr)
+    TkDisplay *dispPtr;		/* Display from which the event came. */
+    BindingTable *bindPtr;	/* Information about binding table, such as
+				 * ring of recent events. */
+    PatSeq *psPtr;		/* List of virtual event definitions. */
+    VirtualCandidates *candsPtr;/* Filled in with the matching
+				 * definitions. */
+{
+    candsPtr->space = NUM_STATIC_CANDIDATES;
+    for ( ; psPtr != NULL; psPtr = psPtr->nextSeqPtr) {
+	if (!MatchSequence(dispPtr, bindPtr, psPtr)) {
+	    continue;
+	}
+	if (candsPtr->numCands == candsPtr->space) {
+	    PatSeq **newPtrs;
+
+	    candsPtr->space *= 2;
+	    newPtrs = (PatSeq **) ckalloc((unsigned)
+		    (candsPtr->space * sizeof(PatSeq *)));
+	    memcpy((VOID *) newPtrs, (VOID *) candsPtr->candPtrs,
+		    candsPtr->numCands * sizeof(PatSeq *));
+	    if (candsPtr->candPtrs != candsPtr->staticCands) {
+		ckfree((char *) candsPtr->candPtrs);
+	    }
+	    candsPtr->candPtrs = newPtrs;
+	}
+	candsPtr->candPtrs[candsPtr->numCands] = psPtr;
+	candsPtr->numCands++;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * MatchVirtualCandidates --
+ *
+ *	Given the virtual event definitions that match the recent events
+ *	(see FindVirtualCandidates), find the most specific one for
+ *	which there is a binding for its virtual event on a particular
+ *	object.
+ *
+ * Results:
+ *	The return value is NULL if bestPtr is NULL and no definition
+ *	has a binding on object.  Otherwise the return value is the most
+ *	specific pattern sequence among bestPtr and the candidates that
+ *	do.  If a pattern sequence other than bestPtr is returned, then
+ *	*sourcePtrPtr is filled in with the binding for its virtual
+ *	event.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static PatSeq *
+MatchVirtualCandidates(bindPtr, candsPtr, bestPtr, object, sourcePtrPtr)
+    BindingTable *bindPtr;	/* Binding table in which to look for
+				 * bindings on the virtual events. */
+    VirtualCandidates *candsPtr;/* Definitions that match the recent
+				 * events. */
+    PatSeq *bestPtr; 		/* The best match seen so far, from a
+				 * previous call to this procedure.  NULL
+				 * means no prior best match. */
+    ClientData object;		/* The binding must be for this object. */
+    PatSeq **sourcePtrPtr;	/* Filled with the pattern sequence that
+				 * contains the eventProc and clientData
+				 * associated with the best match.  If this
+				 * differs from the return value, it is the
+				 * virtual event that most closely matched the
+				 * return value (a physical event).  Not
+				 * modified unless a result other than bestPtr
+				 * is returned. */
+{
+    PatSeq *psPtr, *bestSourcePtr;
+    PatternTableKey key;
+    int i, iVirt;
+
+    bestSourcePtr = *sourcePtrPtr;
+
+    memset(&key, 0, sizeof(key));
+    key.object = object;
+    key.type = VirtualEvent;
+    key.detail.clientData = 0;
+
+    for (i = 0; i < candsPtr->numCands; i++) {
+	VirtualOwners *voPtr;
+
+	psPtr = candsPtr->candPtrs[i];
+	if ((bestPtr != NULL) && !BetterSequence(psPtr, bestPtr)) {
+	    continue;
+	}
+
+	/*
+	 * The sequence matches the physical constraints.  Is this object
+	 * interested in any of the virtual events that correspond to
+	 * this sequence?
+	 */
+
+	voPtr = psPtr->voPtr;
+	for (iVirt = 0; iVirt < voPtr->numOwners; iVirt++) {
+	    Tcl_HashEntry *hPtr = voPtr->owners[iVirt];
+
+	    key.detail.name = (Tk_Uid) Tcl_GetHashKey(hPtr->tablePtr, hPtr);
+	    hPtr = Tcl_FindHashEntry(&bindPtr->patternTable, (char *) &key);
+	    if (hPtr != NULL) {
+		PatSeq *virtMatchPtr;
+
+		/*
+		 * This tag is interested in this virtual event and its
+		 * corresponding physical event is a good match with the
+		 * virtual event's definition.
+		 */
+
+		virtMatchPtr = (PatSeq *) Tcl_GetHashValue(hPtr);
+		if ((virtMatchPtr->numPats != 1)
+			|| (virtMatchPtr->nextSeqPtr != NULL)) {
+		    panic("MatchVirtualCandidates: bad virtual event");
+		}
+		bestPtr = psPtr;
+		bestSourcePtr = virtMatchPtr;
+		break;
+	    }
+	}
+    }
+
+    *sourcePtrPtr = bestSourcePtr;
+    return bestPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * MatchSequence --
+ *
+ *	Check whether a pattern sequence matches the recent events in
+ *	a binding table.  The sequence's virtual events, if any, are not
+ *	considered.
+ *
+ * Results:
+ *	Returns 1 if the sequence matches, 0 otherwise.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+MatchSequence(dispPtr, bindPtr, psPtr)
+    TkDisplay *dispPtr;		/* Display from which the event came. */
+    BindingTable *bindPtr;	/* Information about binding table, such as
+				 * ring of recent events. */
+    PatSeq *psPtr;		/* Pattern sequence to match. */
+{
+    XEvent *eventPtr;
+    Pattern *patPtr;
+    Window window;
+    Detail *detailPtr;
+    int patCount, ringCount, flags, state;
+    int modMask;
+
+    /*
+     * Iterate over all the patterns in the sequence to be
+     * sure that they all match.
+     */
+
+    eventPtr = &bindPtr->eventRing[bindPtr->curEvent];
+    detailPtr = &bindPtr->detailRing[bindPtr->curEvent];
+    window = eventPtr->xany.window;
+    patPtr = psPtr->pats;
+    patCount = psPtr->numPats;
+    ringCount = EVENT_BUFFER_SIZE;
+    while (patCount > 0) {
+	if (ringCount <= 0) {
+	    return 0;
+	}
+	if (eventPtr->xany.type != patPtr->eventType) {
+	    /*
+	     * Most of the event types are considered superfluous
+	     * in that they are ignored if they occur in the middle
+	     * of a pattern sequence and have mismatching types.  The
+	     * only ones that cannot be ignored are ButtonPress and
+	     * ButtonRelease events (if the next event in the pattern
+	     * is a KeyPress or KeyRelease) and KeyPress and KeyRelease
+	     * events (if the next pattern event is a ButtonPress or
+	     * ButtonRelease).  Here are some tricky cases to consider:
+	     * 1. Double-Button or Double-Key events.
+	     * 2. Double-ButtonRelease or Double-KeyRelease events.
+	     * 3. The arrival of various events like Enter and Leave
+	     *    and FocusIn and GraphicsExpose between two button
+	     *    presses or key presses.
+	     * 4. Modifier keys like Shift and Control shouldn't
+	     *    generate conflicts with button events.
+	     */
+
+	    if ((patPtr->eventType == KeyPress)
+		    || (patPtr->eventType == KeyRelease)) {
+		if ((eventPtr->xany.type == ButtonPress)
+			|| (eventPtr->xany.type == ButtonRelease)) {
+		    return 0;
+		}
+	    } else if ((patPtr->eventType == ButtonPress)
+		    || (patPtr->eventType == ButtonRelease)) {
+		if ((eventPtr->xany.type == KeyPress)
+			|| (eventPtr->xany.type == KeyRelease)) {
+		    int i;
+
+		    /*
+		     * Ignore key events if they are modifier keys.
+		     */
+
+		    for (i = 0; i < dispPtr->numModKeyCodes; i++) {
+			if (dispPtr->modKeyCodes[i]
+				== eventPtr->xkey.keycode) {
+			    /*
+			     * This key is a modifier key, so ignore it.
+			     */
+			    goto nextEvent;
+			}
+		    }
+		    return 0;
+		}
+	    }
+	    goto nextEvent;
+	}
+	if (eventPtr->xany.window != window) {
+	    return 0;
+	}
+
+	/*
+	 * Note: it's important for the keysym check to go before
+	 * the modifier check, so we can ignore unwanted modifier
+	 * keys before choking on the modifier check.
+	 */
+
+	if ((patPtr->detail.clientData != 0)
+		&& (patPtr->detail.clientData != detailPtr->clientData)) {
+	    /*
+	     * The detail appears not to match.  However, if the event
+	     * is a KeyPress for a modifier key then just ignore the
+	     * event.  Otherwise event sequences like "aD" never match
+	     * because the shift key goes down between the "a" and the
+	     * "D".
+	     */
+
+	    if (eventPtr->xany.type == KeyPress) {
+		int i;
+
+		for (i = 0; i < dispPtr->numModKeyCodes; i++) {
+		    if (dispPtr->modKeyCodes[i] == eventPtr->xkey.keycode) {
+			goto nextEvent;
+		    }
+		}
+	    }
+	    return 0;
+	}
+	flags = flagArray[eventPtr->type];
+	if (flags & (KEY_BUTTON_MOTION_VIRTUAL)) {
+	    state = eventPtr->xkey.state;
+	} else if (flags & CROSSING) {
+	    state = eventPtr->xcrossing.state;
+	} else {
+	    state = 0;
+	}
+	if (patPtr->needMods != 0) {
+	    modMask = patPtr->needMods;
+	    if ((modMask & META_MASK) && (dispPtr->metaModMask != 0)) {
+		modMask = (modMask & ~META_MASK) | dispPtr->metaModMask;
+	    }
+	    if ((modMask & ALT_MASK) && (dispPtr->altModMask != 0)) {
+		modMask = (modMask & ~ALT_MASK) | dispPtr->altModMask;
+	    }
+
+	    if ((state & META_MASK) && (dispPtr->metaModMask != 0)) {
+		state = (state & ~META_MASK) | dispPtr->metaModMask;
+	    }
+	    if ((state & ALT_MASK) && (dispPtr->altModMask != 0)) {
+		state = (state & ~ALT_MASK) | dispPtr->altModMask;
+	    }
+
+	    if ((state & modMask) != modMask) {
+		return 0;
+	    }
+	}
+	if (psPtr->flags & PAT_NEARBY) {
+	    XEvent *firstPtr;
+	    int timeDiff;
+
+	    firstPtr = &bindPtr->eventRing[bindPtr->curEvent];
+	    timeDiff = (Time) firstPtr->xkey.time - eventPtr->xkey.time;
+	    if ((firstPtr->xkey.x_root
+			< (eventPtr->xkey.x_root - NEARBY_PIXELS))
+		    || (firstPtr->xkey.x_root
+			> (eventPtr->xkey.x_root + NEARBY_PIXELS))
+		    || (firstPtr->xkey.y_root
+			< (eventPtr->xkey.y_root - NEARBY_PIXELS))
+		    || (firstPtr->xkey.y_root
+			> (eventPtr->xkey.y_root + NEARBY_PIXELS))
+		    || (timeDiff > NEARBY_MS)) {
+		return 0;
+	    }
+	}
+	patPtr++;
+	patCount--;
+	nextEvent:
+	if (eventPtr == bindPtr->eventRing) {
+	    eventPtr = &bindPtr->eventRing[EVENT_BUFFER_SIZE-1];
+	    detailPtr = &bindPtr->detailRing[EVENT_BUFFER_SIZE-1];
+	} else {
+	    eventPtr--;
+	    detailPtr--;
+	}
+	ringCount--;
+    }
+    return 1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * BetterSequence --
+ *
+ *	Decide which of two matching pattern sequences is the more
+ *	specific.  Detail is most important, then needMods.
+ *
+ * Results:
+ *	Returns 1 if matchPtr is more specific than bestPtr, 0 if it
+ *	isn't or if they are equally specific.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+BetterSequence(matchPtr, bestPtr)
+    PatSeq *matchPtr;		/* A sequence that matches. */
+    PatSeq *bestPtr;		/* The best match seen before it. */
+{
+    Pattern *patPtr, *patPtr2;
+    int i;
+
+    if (matchPtr->numPats != bestPtr->numPats) {
+	return (matchPtr->numPats > bestPtr->numPats);
+    }
+    for (i = 0, patPtr = matchPtr->pats, patPtr2 = bestPtr->pats;
+	    i < matchPtr->numPats; i++, patPtr++, patPtr2++) {
+	if (patPtr->detail.clientData != patPtr2->detail.clientData) {
+	    return (patPtr->detail.clientData != 0);
+	}
+	if (patPtr->needMods != patPtr2->needMods) {
+	    if ((patPtr->needMods & patPtr2->needMods)
+		    == patPtr->needMods) {
+		return 0;
+	    } else if ((patPtr->needMods & patPtr2->needMods)
+		    == patPtr2->needMods) {
+		return 1;
+	    }
+	}
+    }
+
+    /*
+     * Tie goes to current best pattern.
+     *
+     * (1) For virtual vs. virtual, the least recently defined
+     * virtual wins, because virtuals are examined in order of
+     * definition.  This order is _not_ guaranteed in the
+     * documentation.
+     *
+     * (2) For virtual vs. physical, the physical wins because all
+     * the physicals are examined before the virtuals.  This order
+     * is guaranteed in the documentation.
+     *
+     * (3) For physical vs. physical pattern, the most recently
+     * defined physical wins, because physicals are examined in
+     * reverse order of definition.  This order is guaranteed in
+     * the documentation.
+     */
+
+    return 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * MatchCompiledPatterns --
+ *
+ *	Find the pattern sequence in a list of a binding table's
+ *	patternTable that best matches the recent events, using the
+ *	list's SeqMatcher, which is made first if the list doesn't have
+ *	one yet.  This gives the same result as calling MatchPatterns
+ *	on the list with no prior best match.
+ *
+ *	A matching multi-event sequence is always more specific than a
+ *	single-event one, so the single-event sequences only need to be
+ *	looked at if none of the multi-event ones match.  Those all
+ *	have the event type and detail of the list's hash key, so
+ *	whether they match depends only on the modifier state of the
+ *	event, and the best one for each state is looked up in the
+ *	matcher's singleTable.
+ *
+ * Results:
+ *	The return value is the best matching sequence, or NULL if no
+ *	sequence matches.
+ *
+ * Side effects:
+ *	The SeqMatcher may be created or extended.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static PatSeq *
+MatchCompiledPatterns(dispPtr, bindPtr, hPtr)
+    TkDisplay *dispPtr;		/* Display from which the event came. */
+    BindingTable *bindPtr;	/* Information about binding table, such as
+				 * ring of recent events. */
+    Tcl_HashEntry *hPtr;	/* Entry in bindPtr->patternTable for the
+				 * most recent event. */
+{
+    SeqMatcher *matcherPtr;
+    Tcl_HashEntry *mPtr, *sPtr;
+    PatSeq *psPtr, *bestPtr;
+    XEvent *eventPtr;
+    int i, new, flags, state, modState;
+
+    mPtr = Tcl_CreateHashEntry(&bindPtr->matcherTable, (char *) hPtr, &new);
+    if (new) {
+	int numMulti;
+
+	/*
+	 * Compile the list.
+	 */
+
+	matcherPtr = (SeqMatcher *) ckalloc(sizeof(SeqMatcher));
+	matcherPtr->modMask = 0;
+	numMulti = 0;
+	for (psPtr = (PatSeq *) Tcl_GetHashValue(hPtr); psPtr != NULL;
+		psPtr = psPtr->nextSeqPtr) {
+	    if (psPtr->numPats == 1) {
+		matcherPtr->modMask |= psPtr->pats[0].needMods;
+	    } else {
+		numMulti++;
+	    }
+	}
+	matcherPtr->numMulti = 0;
+	matcherPtr->multiPtrs = NULL;
+	if (numMulti > 0) {
+	    matcherPtr->multiPtrs = (PatSeq **)
+		    ckalloc((unsigned) (numMulti * sizeof(PatSeq *)));
+	    for (psPtr = (PatSeq *) Tcl_GetHashValue(hPtr); psPtr != NULL;
+		    psPtr = psPtr->nextSeqPtr) {
+		if (psPtr->numPats != 1) {
+		    matcherPtr->multiPtrs[matcherPtr->numMulti++] = psPtr;
+		}
+	    }
+	}
+	Tcl_InitHashTable(&matcherPtr->singleTable, TCL_ONE_WORD_KEYS);
+	Tcl_SetHashValue(mPtr, matcherPtr);
+    } else {
+	matcherPtr = (SeqMatcher *) Tcl_GetHashValue(mPtr);
+    }
+
+    bestPtr = NULL;
+    for (i = 0; i < matcherPtr->numMulti; i++) {
+	psPtr = matcherPtr->multiPtrs[i];
+	if (MatchSequence(dispPtr, bindPtr, psPtr)
+		&& ((bestPtr == NULL) || BetterSequence(psPtr, bestPtr))) {
+	    bestPtr = psPtr;
+	}
+    }
+    if (bestPtr != NULL) {
+	return bestPtr;
+    }
+
+    /*
+     * Express the modifier state of the event in terms of the
+     * modifiers of patterns, with META_MASK and ALT_MASK set if all
+     * the modifiers they stand for on this display are down.  A
+     * single-event sequence then matches if all its needMods are in
+     * the state, as in MatchSequence.
+     */
+
+    eventPtr = &bindPtr->eventRing[bindPtr->curEvent];
+    flags = flagArray[eventPtr->type];
+    if (flags & (KEY_BUTTON_MOTION_VIRTUAL)) {
+	state = eventPtr->xkey.state;
+    } else if (flags & CROSSING) {
+	state = eventPtr->xcrossing.state;
+    } else {
+	state = 0;
+    }
+    if ((state & META_MASK) && (dispPtr->metaModMask != 0)) {
+	state = (state & ~META_MASK) | dispPtr->metaModMask;
+    }
+    if ((state & ALT_MASK) && (dispPtr->altModMask != 0)) {
+	state = (state & ~ALT_MASK) | dispPtr->altModMask;
+    }
+    modState = state & ~(META_MASK|ALT_MASK);
+    if (dispPtr->metaModMask != 0) {
+	if ((state & dispPtr->metaModMask) == dispPtr->metaModMask) {
+	    modState |= META_MASK;
+	}
+    } else {
+	modState |= state & META_MASK;
+    }
+    if (dispPtr->altModMask != 0) {
+	if ((state & dispPtr->altModMask) == dispPtr->altModMask) {
+	    modState |= ALT_MASK;
+	}
+    } else {
+	modState |= state & ALT_MASK;
+    }
+    modState &= matcherPtr->modMask;
+
+    sPtr = Tcl_CreateHashEntry(&matcherPtr->singleTable, (char *) modState,
+	    &new);
+    if (new) {
+	for (psPtr = (PatSeq *) Tcl_GetHashValue(hPtr); psPtr != NULL;
+		psPtr = psPtr->nextSeqPtr) {
+	    if ((psPtr->numPats == 1)
+		    && ((modState & psPtr->pats[0].needMods)
+			    == psPtr->pats[0].needMods)
+		    && ((bestPtr == NULL) || BetterSequence(psPtr, bestPtr))) {
+		bestPtr = psPtr;
 	    }
+	}
+	Tcl_SetHashValue(sPtr, bestPtr);
+    }
+    return (PatSeq *) Tcl_GetHashValue(sPtr);
+}
 
-	    /*
-	     * Note: it's important for the keysym check to go before
-	     * the modifier check, so we can ignore unwanted modifier
-	     * keys before choking on the modifier check.
-	     */
+/*
+ *----------------------------------------------------------------------
+ *
+ * CountSequence --
+ *
+ *	Update the typeCounts of a binding table when a pattern sequence
+ *	is added to or removed from its patternTable.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The typeCounts may be allocated.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+CountSequence(bindPtr, object, psPtr, delta)
+    BindingTable *bindPtr;	/* Binding table that holds the sequence. */
+    ClientData object;		/* Object the sequence is bound to. */
+    PatSeq *psPtr;		/* The sequence. */
+    int delta;			/* 1 if the sequence was added, -1 if it is
+				 * being removed. */
+{
+    if (bindPtr->typeCounts == NULL) {
+	unsigned int size;
+
+	size = TK_LASTEVENT * TYPE_BUCKETS * sizeof(unsigned int);
+	bindPtr->typeCounts = (unsigned int *) ckalloc(size);
+	memset((VOID *) bindPtr->typeCounts, 0, size);
+    }
+    TYPE_COUNT(bindPtr, psPtr->pats[0].eventType, object) += delta;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * InvalidateMatcher --
+ *
+ *	Throw away the SeqMatcher of a list in a binding table's
+ *	patternTable.  This must be called before the list is changed.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Memory is freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+InvalidateMatcher(bindPtr, hPtr)
+    BindingTable *bindPtr;	/* Binding table that holds the list. */
+    Tcl_HashEntry *hPtr;	/* Entry in bindPtr->patternTable for the
+				 * list. */
+{
+    Tcl_HashEntry *mPtr;
+
+    mPtr = Tcl_FindHashEntry(&bindPtr->matcherTable, (char *) hPtr);
+    if (mPtr != NULL) {
+	FreeMatcher((SeqMatcher *) Tcl_GetHashValue(mPtr));
+	Tcl_DeleteHashEntry(mPtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FreeMatcher --
+ *
+ *	Free the memory of a SeqMatcher.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Memory is freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FreeMatcher(matcherPtr)
+    SeqMatcher *matcherPtr;	/* Matcher to free. */
+{
+    if (matcherPtr->multiPtrs != NULL) {
+	ckfree((char *) matcherPtr->multiPtrs);
+    }
+    Tcl_DeleteHashTable(&matcherPtr->singleTable);
+    ckfree((char *) matcherPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ReferenceMatchPatterns --
+ *
+ *	The way Tk_BindEvent found the best match in a list of a binding
+ *	table's patternTable before lists were compiled into SeqMatchers:
+ *	MatchPatterns as it was then, without its virtual event part.
+ *	It is kept, apart from MatchSequence and BetterSequence, only so
+ *	that TkBindTestMatcher can check MatchCompiledPatterns against it.
+ *
+ * Results:
+ *	The return value is the most specific pattern sequence at psPtr
+ *	that matches the recent events, or NULL if none does.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static PatSeq *
+ReferenceMatchPatterns(dispPtr, bindPtr, psPtr)
+    TkDisplay *dispPtr;		/* Display from which the event came. */
+    BindingTable *bindPtr;	/* Information about binding table, such as
+				 * ring of recent events. */
+    PatSeq *psPtr;		/* List of pattern sequences. */
+{
+    PatSeq *matchPtr, *bestPtr;
+
+    bestPtr = NULL;
+    for ( ; psPtr != NULL; psPtr = psPtr->nextSeqPtr) {
+	XEvent *eventPtr;
+	Pattern *patPtr;
+	Window window;
+	Detail *detailPtr;
+	int patCount, ringCount, flags, state;
+	int modMask;
+
+	eventPtr = &bindPtr->eventRing[bindPtr->curEvent];
+	detailPtr = &bindPtr->detailRing[bindPtr->curEvent];
+	window = eventPtr->xany.window;
+	patPtr = psPtr->pats;
+	patCount = psPtr->numPats;
+	ringCount = EVENT_BUFFER_SIZE;
+	while (patCount > 0) {
+	    if (ringCount <= 0) {
+		goto nextSequence;
+	    }
+	    if (eventPtr->xany.type != patPtr->eventType) {
+		if ((patPtr->eventType == KeyPress)
+			|| (patPtr->eventType == KeyRelease)) {
+		    if ((eventPtr->xany.type == ButtonPress)
+			    || (eventPtr->xany.type == ButtonRelease)) {
+			goto nextSequence;
+		    }
+		} else if ((patPtr->eventType == ButtonPress)
+			|| (patPtr->eventType == ButtonRelease)) {
+		    if ((eventPtr->xany.type == KeyPress)
+			    || (eventPtr->xany.type == KeyRelease)) {
+			int i;
 
+			for (i = 0; i < dispPtr->numModKeyCodes; i++) {
+			    if (dispPtr->modKeyCodes[i]
+				    == eventPtr->xkey.keycode) {
+				goto nextEvent;
+			    }
+			}
+			goto nextSequence;
+		    }
+		}
+		goto nextEvent;
+	    }
+	    if (eventPtr->xany.window != window) {
+		goto nextSequence;
+	    }
 	    if ((patPtr->detail.clientData != 0)
 		    && (patPtr->detail.clientData != detailPtr->clientData)) {
-		/*
-		 * The detail appears not to match.  However, if the event
-		 * is a KeyPress for a modifier key then just ignore the
-		 * event.  Otherwise event sequences like "aD" never match
-		 * because the shift key goes down between the "a" and the
-		 * "D".
-		 */
-
 		if (eventPtr->xany.type == KeyPress) {
 		    int i;
 
@@ -2123,67 +3484,6 @@ MatchPatterns(dispPtr, bindPtr, psPtr, bestPtr, objectPtr, sourcePtrPtr)
 	}
 
 	matchPtr = psPtr;
-	sourcePtr = psPtr;
-
-	if (objectPtr != NULL) {
-	    int iVirt;
-	    VirtualOwners *voPtr;
-	    PatternTableKey key;
-
-	    /*
-	     * The sequence matches the physical constraints.
-	     * Is this object interested in any of the virtual events
-	     * that correspond to this sequence?  
-	     */
-
-	    voPtr = psPtr->voPtr;
-
-	    memset(&key, 0, sizeof(key));
-	    key.object = *objectPtr;
-	    key.type = VirtualEvent;
-	    key.detail.clientData = 0;
-
-	    for (iVirt = 0; iVirt < voPtr->numOwners; iVirt++) {
-	        Tcl_HashEntry *hPtr = voPtr->owners[iVirt];
-
-	        key.detail.name = (Tk_Uid) Tcl_GetHashKey(hPtr->tablePtr,
-			hPtr);
-		hPtr = Tcl_FindHashEntry(&bindPtr->patternTable,
-			(char *) &key);
-		if (hPtr != NULL) {
-
-		    /*
-		     * This tag is interested in this virtual event and its
-		     * corresponding physical event is a good match with the
-		     * virtual event's definition.
-		     */
-
-		    PatSeq *virtMatchPtr;
-
-		    virtMatchPtr = (PatSeq *) Tcl_GetHashValue(hPtr);
-		    if ((virtMatchPtr->numPats != 1)
-			    || (virtMatchPtr->nextSeqPtr != NULL)) {
-			panic("MatchPattern: badly constructed virtual event");
-		    }
-		    sourcePtr = virtMatchPtr;
-		    goto match;
-		}
-	    }
-
-	    /*
-	     * The physical event matches a virtual event's definition, but
-	     * the tag isn't interested in it.
-	     */
-	    goto nextSequence;
-	}
-	match:
-
-	/*
-	 * This sequence matches.  If we've already got another match,
-	 * pick whichever is most specific.  Detail is most important,
-	 * then needMods.
-	 */
-
 	if (bestPtr != NULL) {
 	    Pattern *patPtr2;
 	    int i;
@@ -2214,36 +3514,258 @@ MatchPatterns(dispPtr, bindPtr, psPtr, bestPtr, objectPtr, sourcePtrPtr)
 		    }
 		}
 	    }
-	    /*
-	     * Tie goes to current best pattern.
-	     *
-	     * (1) For virtual vs. virtual, the least recently defined
-	     * virtual wins, because virtuals are examined in order of
-	     * definition.  This order is _not_ guaranteed in the
-	     * documentation.
-	     *
-	     * (2) For virtual vs. physical, the physical wins because all
-	     * the physicals are examined before the virtuals.  This order
-	     * is guaranteed in the documentation.
-	     *
-	     * (3) For physical vs. physical pattern, the most recently
-	     * defined physical wins, because physicals are examined in
-	     * reverse order of definition.  This order is guaranteed in
-	     * the documentation.
-	     */
+	    goto nextSequence;
+	}
+	newBest:
+	bestPtr = matchPtr;
+
+	nextSequence:
+	continue;
+    }
+    return bestPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkBindTestMatcher --
+ *
+ *	Check MatchCompiledPatterns against ReferenceMatchPatterns.  A
+ *	new binding table is given random bindings for numObjects
+ *	objects and then fed numEvents random events.  After each event
+ *	the best match of every object is looked up both ways.  Every
+ *	16 events a binding is added or deleted, so that matchers are
+ *	thrown away and made again, and the display's Meta and Alt
+ *	modifiers are changed.  This is used by the "testbindmatch"
+ *	command in tkTest.c.
+ *
+ * Results:
+ *	The number of lookups for which the two gave different pattern
+ *	sequences.  The number of lookups is stored at *numLookupsPtr.
+ *
+ * Side effects:
+ *	The interpreter's result is reset.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TkBindTestMatcher(tkwin, numObjects, numEvents, seed, numLookupsPtr)
+    Tk_Window tkwin;		/* Window whose display and interpreter
+				 * to use. */
+    int numObjects;		/* Number of objects to make bindings
+				 * for. */
+    int numEvents;		/* Number of events to look up. */
+    unsigned long seed;		/* Seed for the random numbers. */
+    int *numLookupsPtr;		/* Where to store the number of lookups. */
+{
+    static int eventTypes[] = {
+	ButtonPress, ButtonRelease, MotionNotify, KeyPress, KeyRelease
+    };
+    static int stateMasks[] = {
+	ShiftMask, LockMask, ControlMask, Mod1Mask, Mod2Mask, Mod3Mask,
+	Mod4Mask, Button1Mask
+    };
+    static int modMasks[] = {
+	0, Mod1Mask, Mod2Mask, Mod1Mask|Mod4Mask
+    };
+    TkWindow *winPtr = (TkWindow *) tkwin;
+    TkDisplay *dispPtr = winPtr->dispPtr;
+    Tcl_Interp *interp = winPtr->mainPtr->interp;
+    BindingTable *bindPtr;
+    Tcl_HashEntry *hPtr;
+    PatternTableKey key;
+    XEvent *eventPtr;
+    Detail detail;
+    Window window;
+    KeySym keySyms[2];
+    int oldMetaMask, oldAltMask, i, j, n, numLookups, numMismatches;
+
+    oldMetaMask = dispPtr->metaModMask;
+    oldAltMask = dispPtr->altModMask;
+    keySyms[0] = TkStringToKeysym("a");
+    keySyms[1] = TkStringToKeysym("b");
+    window = Tk_WindowId(tkwin);
+    bindPtr = (BindingTable *) Tk_CreateBindingTable(interp);
+    for (i = 0; i < numObjects * 8; i++) {
+	ChangeTestBinding(interp, bindPtr, (ClientData) (i % numObjects + 1),
+		&seed, 1);
+    }
+
+    numLookups = 0;
+    numMismatches = 0;
+    memset(&key, 0, sizeof(key));
+    for (n = 0; n < numEvents; n++) {
+	if ((n % 16) == 15) {
+	    ChangeTestBinding(interp, bindPtr,
+		    (ClientData) (TestRandom(&seed, numObjects) + 1), &seed,
+		    TestRandom(&seed, 2));
+	    dispPtr->metaModMask = modMasks[TestRandom(&seed, 4)];
+	    dispPtr->altModMask = modMasks[TestRandom(&seed, 4)];
+	}
+
+	/*
+	 * Put a random event in the ring, as Tk_BindEvent does.  Most
+	 * events are close to the one before, so that Double and Triple
+	 * sequences match now and then.
+	 */
+
+	bindPtr->curEvent++;
+	if (bindPtr->curEvent >= EVENT_BUFFER_SIZE) {
+	    bindPtr->curEvent = 0;
+	}
+	eventPtr = &bindPtr->eventRing[bindPtr->curEvent];
+	memset((VOID *) eventPtr, 0, sizeof(XEvent));
+	eventPtr->xany.type = eventTypes[TestRandom(&seed, 5)];
+	eventPtr->xany.window = (TestRandom(&seed, 8) == 0) ? window + 1
+		: window;
+	eventPtr->xkey.time = (n > 0) ? n * 100 + TestRandom(&seed, 400) : 0;
+	eventPtr->xkey.x_root = TestRandom(&seed, 12);
+	eventPtr->xkey.y_root = TestRandom(&seed, 12);
+	for (i = 0; i < (int) (sizeof(stateMasks) / sizeof(int)); i++) {
+	    if (TestRandom(&seed, 4) == 0) {
+		eventPtr->xkey.state |= stateMasks[i];
+	    }
+	}
+	detail.clientData = 0;
+	if ((eventPtr->type == KeyPress) || (eventPtr->type == KeyRelease)) {
+	    if ((dispPtr->numModKeyCodes > 0) && (TestRandom(&seed, 4) == 0)) {
+		eventPtr->xkey.keycode = dispPtr->modKeyCodes[
+			TestRandom(&seed, dispPtr->numModKeyCodes)];
+	    }
+	    detail.keySym = keySyms[TestRandom(&seed, 2)];
+	} else if (eventPtr->type != MotionNotify) {
+	    eventPtr->xbutton.button = TestRandom(&seed, 3) + 1;
+	    detail.button = eventPtr->xbutton.button;
+	}
+	bindPtr->detailRing[bindPtr->curEvent] = detail;
+
+	for (i = 0; i < numObjects; i++) {
+	    key.object = (ClientData) (i + 1);
+	    key.type = eventPtr->type;
+	    key.detail = detail;
+	    for (j = 0; j < 2; j++) {
+		hPtr = Tcl_FindHashEntry(&bindPtr->patternTable,
+			(char *) &key);
+		if (hPtr != NULL) {
+		    numLookups++;
+		    if (MatchCompiledPatterns(dispPtr, bindPtr, hPtr)
+			    != ReferenceMatchPatterns(dispPtr, bindPtr,
+				    (PatSeq *) Tcl_GetHashValue(hPtr))) {
+			numMismatches++;
+		    }
+		}
+		if (key.detail.clientData == 0) {
+		    break;
+		}
+		key.detail.clientData = 0;
+	    }
+	}
+    }
+
+    Tk_DeleteBindingTable((Tk_BindingTable) bindPtr);
+    dispPtr->metaModMask = oldMetaMask;
+    dispPtr->altModMask = oldAltMask;
+    Tcl_ResetResult(interp);
+    *numLookupsPtr = numLookups;
+    return numMismatches;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ChangeTestBinding --
+ *
+ *	Add a random binding for an object to a binding table, or delete
+ *	one of the object's bindings.  Used by TkBindTestMatcher.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The binding table is changed, and the interpreter's result may
+ *	be too.
+ *
+ *----------------------------------------------------------------------
+ */
 
-	    goto nextSequence;	
+static void
+ChangeTestBinding(interp, bindPtr, object, seedPtr, add)
+    Tcl_Interp *interp;		/* Interpreter of the binding table. */
+    BindingTable *bindPtr;	/* Table to change. */
+    ClientData object;		/* Object whose bindings to change. */
+    unsigned long *seedPtr;	/* Random number seed. */
+    int add;			/* 1 to add a binding, 0 to delete one. */
+{
+    static char *modifiers[] = {
+	"Shift-", "Control-", "Lock-", "Meta-", "Alt-", "Mod2-", "B1-",
+	"Double-", "Triple-"
+    };
+    static char *events[] = {
+	"ButtonPress", "ButtonPress-1", "ButtonPress-2", "ButtonRelease",
+	"ButtonRelease-1", "Motion", "KeyPress", "KeyPress-a", "KeyPress-b",
+	"KeyRelease-a"
+    };
+    Tcl_DString sequence;
+    int i, j, numPats, listArgc;
+    char **listArgv;
+
+    if (!add) {
+	Tk_GetAllBindings(interp, (Tk_BindingTable) bindPtr, object);
+	if ((Tcl_SplitList(interp, Tcl_GetStringResult(interp), &listArgc,
+		&listArgv) == TCL_OK) && (listArgc > 0)) {
+	    Tk_DeleteBinding(interp, (Tk_BindingTable) bindPtr, object,
+		    listArgv[TestRandom(seedPtr, listArgc)]);
+	    ckfree((char *) listArgv);
 	}
-	newBest:
-	bestPtr = matchPtr;
-	bestSourcePtr = sourcePtr;
+	Tcl_ResetResult(interp);
+	return;
+    }
 
-	nextSequence:
-	continue;
+    Tcl_DStringInit(&sequence);
+    numPats = (TestRandom(seedPtr, 4) == 0) ? 2 : 1;
+    for (i = 0; i < numPats; i++) {
+	Tcl_DStringAppend(&sequence, "<", 1);
+	for (j = 0; j < (int) (sizeof(modifiers) / sizeof(char *)); j++) {
+	    if (TestRandom(seedPtr, 5) == 0) {
+		Tcl_DStringAppend(&sequence, modifiers[j], -1);
+	    }
+	}
+	Tcl_DStringAppend(&sequence,
+		events[TestRandom(seedPtr, sizeof(events) / sizeof(char *))],
+		-1);
+	Tcl_DStringAppend(&sequence, ">", 1);
     }
+    Tk_CreateBinding(interp, (Tk_BindingTable) bindPtr, object,
+	    Tcl_DStringValue(&sequence), "list", 0);
+    Tcl_ResetResult(interp);
+    Tcl_DStringFree(&sequence);
+}
 
-    *sourcePtrPtr = bestSourcePtr;
-    return bestPtr;
+/*
+ *----------------------------------------------------------------------
+ *
+ * TestRandom --
+ *
+ *	A small random number generator for TkBindTestMatcher, so that
+ *	a seed always gives the same bindings and events.
+ *
+ * Results:
+ *	A number from 0 to n-1.
+ *
+ * Side effects:
+ *	*seedPtr is advanced.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+TestRandom(seedPtr, n)
+    unsigned long *seedPtr;	/* Random number seed. */
+    int n;			/* Range of the result. */
+{
+    *seedPtr = (*seedPtr * 1103515245 + 12345) & 0xffffffffUL;
+    return (int) ((*seedPtr >> 16) % (unsigned long) n);
 }
 
 /*
@@ -2251,8 +3773,8 @@ MatchPatterns(dispPtr, bindPtr, psPtr, bestPtr, objectPtr, sourcePtrPtr)
  *
  * ExpandPercents --
  *
- *	Given a command and an event, produce a new command
- *	by replacing % constructs in the original command
+ *	Given a Tcl binding and an event, produce a new command
+ *	by replacing % constructs in the binding's script
  *	with information from the X event.
  *
  * Results:
@@ -2266,11 +3788,11 @@ MatchPatterns(dispPtr, bindPtr, psPtr, bestPtr, objectPtr, sourcePtrPtr)
  */
 
 static void
-ExpandPercents(winPtr, before, eventPtr, keySym, dsPtr)
+ExpandPercents(winPtr, bindingPtr, eventPtr, keySym, dsPtr)
     TkWindow *winPtr;		/* Window where event occurred:  needed to
 				 * get input context. */
-    char *before;		/* Command containing percent expressions
-				 * to be replaced. */
+    TclBinding *bindingPtr;	/* Binding whose script contains percent
+				 * expressions to be replaced. */
     XEvent *eventPtr;		/* X event containing information to be
 				 * used in % replacements. */
     KeySym keySym;		/* KeySym: only relevant for KeyPress and
@@ -2280,9 +3802,9 @@ ExpandPercents(winPtr, before, eventPtr, keySym, dsPtr)
 {
     int spaceNeeded, cvtFlags;	/* Used to substitute string as proper Tcl
 				 * list element. */
-    int number, flags, length;
-#define NUM_SIZE 40
-    char *string;
+    int flags, length, numeric, i;
+    char *text, *string;
+    BindChunk *chunkPtr;
     Tcl_DString buf;
     char numStorage[NUM_SIZE+1];
 
@@ -2293,256 +3815,372 @@ ExpandPercents(winPtr, before, eventPtr, keySym, dsPtr)
     } else {
 	flags = 0;
     }
-    while (1) {
-	/*
-	 * Find everything up to the next % character and append it
-	 * to the result string.
-	 */
 
-	for (string = before; (*string != 0) && (*string != '%'); string++) {
-	    /* Empty loop body. */
-	}
-	if (string != before) {
-	    Tcl_DStringAppend(dsPtr, before, (int) (string-before));
-	    before = string;
+    /*
+     * Make room for the whole command at once; most fields are short.
+     */
+
+    length = Tcl_DStringLength(dsPtr);
+    Tcl_DStringSetLength(dsPtr, length + bindingPtr->textLength
+	    + (bindingPtr->numChunks - 1) * NUM_SIZE);
+    Tcl_DStringSetLength(dsPtr, length);
+
+    text = bindingPtr->script;
+    for (i = 0, chunkPtr = bindingPtr->chunks; i < bindingPtr->numChunks;
+	    i++, chunkPtr++) {
+	if (chunkPtr->length > 0) {
+	    Tcl_DStringAppend(dsPtr, text, chunkPtr->length);
+	    text += chunkPtr->length;
 	}
-	if (*before == 0) {
+	if (chunkPtr->field < 0) {
 	    break;
 	}
 
 	/*
-	 * There's a percent sequence here.  Process it.
+	 * Numbers never need quoting; anything else is substituted
+	 * as a proper list element.
 	 */
 
-	number = 0;
-	string = "??";
-	switch (before[1]) {
-	    case '#':
-		number = eventPtr->xany.serial;
-		goto doNumber;
-	    case 'a':
-		if (flags & CONFIG) {
-		    TkpPrintWindowId(numStorage, eventPtr->xconfigure.above);
-		    string = numStorage;
-		}
-		goto doString;
-	    case 'b':
-		number = eventPtr->xbutton.button;
-		goto doNumber;
-	    case 'c':
-		if (flags & EXPOSE) {
-		    number = eventPtr->xexpose.count;
-		}
-		goto doNumber;
-	    case 'd':
-		if (flags & (CROSSING|FOCUS)) {
-		    if (flags & FOCUS) {
-			number = eventPtr->xfocus.detail;
-		    } else {
-			number = eventPtr->xcrossing.detail;
-		    }
-		    string = TkFindStateString(notifyDetail, number);
-		}
-		goto doString;
-	    case 'f':
-		number = eventPtr->xcrossing.focus;
-		goto doNumber;
-	    case 'h':
-		if (flags & EXPOSE) {
-		    number = eventPtr->xexpose.height;
-		} else if (flags & (CONFIG)) {
-		    number = eventPtr->xconfigure.height;
-		}
-		goto doNumber;
-	    case 'k':
-		number = eventPtr->xkey.keycode;
-		goto doNumber;
-	    case 'm':
-		if (flags & CROSSING) {
-		    number = eventPtr->xcrossing.mode;
-		} else if (flags & FOCUS) {
-		    number = eventPtr->xfocus.mode;
-		}
-		string = TkFindStateString(notifyMode, number);
-		goto doString;
-	    case 'o':
-		if (flags & CREATE) {
-		    number = eventPtr->xcreatewindow.override_redirect;
-		} else if (flags & MAP) {
-		    number = eventPtr->xmap.override_redirect;
-		} else if (flags & REPARENT) {
-		    number = eventPtr->xreparent.override_redirect;
-		} else if (flags & CONFIG) {
-		    number = eventPtr->xconfigure.override_redirect;
-		}
-		goto doNumber;
-	    case 'p':
-		string = TkFindStateString(circPlace, eventPtr->xcirculate.place);
-		goto doString;
-	    case 's':
-		if (flags & (KEY_BUTTON_MOTION_VIRTUAL)) {
-		    number = eventPtr->xkey.state;
-		} else if (flags & CROSSING) {
-		    number = eventPtr->xcrossing.state;
-		} else if (flags & VISIBILITY) {
-		    string = TkFindStateString(visNotify,
-			    eventPtr->xvisibility.state);
-		    goto doString;
-		}
-		goto doNumber;
-	    case 't':
-		if (flags & (KEY_BUTTON_MOTION_VIRTUAL)) {
-		    number = (int) eventPtr->xkey.time;
-		} else if (flags & CROSSING) {
-		    number = (int) eventPtr->xcrossing.time;
-		} else if (flags & PROP) {
-		    number = (int) eventPtr->xproperty.time;
-		}
-		goto doNumber;
-	    case 'v':
-		number = eventPtr->xconfigurerequest.value_mask;
-		goto doNumber;
-	    case 'w':
-		if (flags & EXPOSE) {
-		    number = eventPtr->xexpose.width;
-		} else if (flags & CONFIG) {
-		    number = eventPtr->xconfigure.width;
-		}
-		goto doNumber;
-	    case 'x':
-		if (flags & (KEY_BUTTON_MOTION_VIRTUAL)) {
-		    number = eventPtr->xkey.x;
-		} else if (flags & CROSSING) {
-		    number = eventPtr->xcrossing.x;
-		} else if (flags & EXPOSE) {
-		    number = eventPtr->xexpose.x;
-		} else if (flags & (CREATE|CONFIG|GRAVITY)) {
-		    number = eventPtr->xcreatewindow.x;
-		} else if (flags & REPARENT) {
-		    number = eventPtr->xreparent.x;
-		}
-		goto doNumber;
-	    case 'y':
-		if (flags & (KEY_BUTTON_MOTION_VIRTUAL)) {
-		    number = eventPtr->xkey.y;
-		} else if (flags & EXPOSE) {
-		    number = eventPtr->xexpose.y;
-		} else if (flags & (CREATE|CONFIG|GRAVITY)) {
-		    number = eventPtr->xcreatewindow.y;
-		} else if (flags & REPARENT) {
-		    number = eventPtr->xreparent.y;
-		} else if (flags & CROSSING) {
-		    number = eventPtr->xcrossing.y;
+	string = GetPercentValue(winPtr, chunkPtr->field, eventPtr, keySym,
+		flags, numStorage, &buf, &numeric);
+	if (numeric) {
+	    Tcl_DStringAppend(dsPtr, string, -1);
+	} else {
+	    spaceNeeded = Tcl_ScanElement(string, &cvtFlags);
+	    length = Tcl_DStringLength(dsPtr);
+	    Tcl_DStringSetLength(dsPtr, length + spaceNeeded);
+	    spaceNeeded = Tcl_ConvertElement(string,
+		    Tcl_DStringValue(dsPtr) + length,
+		    cvtFlags | TCL_DONT_USE_BRACES);
+	    Tcl_DStringSetLength(dsPtr, length + spaceNeeded);
+	}
+	text += (chunkPtr->field == 0) ? 1 : 2;
+    }
+    Tcl_DStringFree(&buf);
+}
 
-		}
-		goto doNumber;
-	    case 'A':
-		if (flags & KEY) {
-		    Tcl_DStringFree(&buf);
-		    string = TkpGetString(winPtr, eventPtr, &buf);
-		}
-		goto doString;
-	    case 'B':
-		number = eventPtr->xcreatewindow.border_width;
-		goto doNumber;
-	    case 'D':
-		/*
-		 * This is used only by the MouseWheel event.
-		 */
-		    
-		number = eventPtr->xkey.keycode;
-		goto doNumber;
-	    case 'E':
-		number = (int) eventPtr->xany.send_event;
-		goto doNumber;
-	    case 'K':
-		if (flags & KEY) {
-		    char *name;
-
-		    name = TkKeysymToString(keySym);
-		    if (name != NULL) {
-			string = name;
-		    }
-		}
-		goto doString;
-	    case 'N':
-		number = (int) keySym;
-		goto doNumber;
-	    case 'R':
-		TkpPrintWindowId(numStorage, eventPtr->xkey.root);
-		string = numStorage;
-		goto doString;
-            case 'S':
-		TkpPrintWindowId(numStorage, eventPtr->xkey.subwindow);
+/*
+ *--------------------------------------------------------------
+ *
+ * SubstituteWords --
+ *
+ *	Given a Tcl binding whose script is a single command made up
+ *	of literal words and %-fields, and an event, produce the words
+ *	of the command with the fields replaced by information from
+ *	the X event.
+ *
+ * Results:
+ *	A list object holding the words of the command, with a
+ *	reference count of 0.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+static Tcl_Obj *
+SubstituteWords(winPtr, bindingPtr, eventPtr, keySym)
+    TkWindow *winPtr;		/* Window where event occurred:  needed to
+				 * get input context. */
+    TclBinding *bindingPtr;	/* Binding with numWords > 0. */
+    XEvent *eventPtr;		/* X event containing information to be
+				 * used in % replacements. */
+    KeySym keySym;		/* KeySym: only relevant for KeyPress and
+				 * KeyRelease events). */
+{
+    Tcl_Obj *listPtr, *objPtr;
+    BindWord *wordPtr;
+    int flags, numeric, i;
+    char *string;
+    Tcl_DString buf;
+    char numStorage[NUM_SIZE+1];
+
+    Tcl_DStringInit(&buf);
+
+    if (eventPtr->type < TK_LASTEVENT) {
+	flags = flagArray[eventPtr->type];
+    } else {
+	flags = 0;
+    }
+
+    listPtr = Tcl_NewListObj(0, (Tcl_Obj **) NULL);
+    for (i = 0, wordPtr = bindingPtr->words; i < bindingPtr->numWords;
+	    i++, wordPtr++) {
+	if (wordPtr->objPtr != NULL) {
+	    objPtr = wordPtr->objPtr;
+	} else {
+	    string = GetPercentValue(winPtr, wordPtr->field, eventPtr,
+		    keySym, flags, numStorage, &buf, &numeric);
+	    objPtr = Tcl_NewStringObj(string, -1);
+	}
+	Tcl_ListObjAppendElement((Tcl_Interp *) NULL, listPtr, objPtr);
+    }
+    Tcl_DStringFree(&buf);
+    return listPtr;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * GetPercentValue --
+ *
+ *	Find the value of one % construct for an event.
+ *
+ * Results:
+ *	Returns the string to substitute for the construct.  It may be
+ *	stored in numStorage or in *bufPtr, or be static.  *numericPtr
+ *	is set to 1 if the value is a decimal number, 0 otherwise.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+static char *
+GetPercentValue(winPtr, field, eventPtr, keySym, flags, numStorage, bufPtr,
+	numericPtr)
+    TkWindow *winPtr;		/* Window where event occurred:  needed to
+				 * get input context. */
+    int field;			/* Character after the '%', or 0 if the
+				 * '%' ended the script. */
+    XEvent *eventPtr;		/* X event containing information to be
+				 * used in % replacements. */
+    KeySym keySym;		/* KeySym: only relevant for KeyPress and
+				 * KeyRelease events). */
+    int flags;			/* Entry of flagArray for the event. */
+    char *numStorage;		/* Buffer of NUM_SIZE+1 bytes for the value
+				 * of numeric fields. */
+    Tcl_DString *bufPtr;	/* Initialized dynamic string that may be
+				 * used to hold the value. */
+    int *numericPtr;		/* Set to 1 if the value is a number. */
+{
+    int number;
+    char *string;
+
+    *numericPtr = 0;
+    number = 0;
+    string = "??";
+    switch (field) {
+	case '#':
+	    number = eventPtr->xany.serial;
+	    goto doNumber;
+	case 'a':
+	    if (flags & CONFIG) {
+		TkpPrintWindowId(numStorage, eventPtr->xconfigure.above);
 		string = numStorage;
-		goto doString;
-	    case 'T':
-		number = eventPtr->type;
-		goto doNumber;
-	    case 'W': {
-		Tk_Window tkwin;
-
-		tkwin = Tk_IdToWindow(eventPtr->xany.display,
-			eventPtr->xany.window);
-		if (tkwin != NULL) {
-		    string = Tk_PathName(tkwin);
+	    }
+	    goto doString;
+	case 'b':
+	    number = eventPtr->xbutton.button;
+	    goto doNumber;
+	case 'c':
+	    if (flags & EXPOSE) {
+		number = eventPtr->xexpose.count;
+	    }
+	    goto doNumber;
+	case 'd':
+	    if (flags & (CROSSING|FOCUS)) {
+		if (flags & FOCUS) {
+		    number = eventPtr->xfocus.detail;
 		} else {
-		    string = "??";
+		    number = eventPtr->xcrossing.detail;
 		}
+		string = TkFindStateString(notifyDetail, number);
+	    }
+	    goto doString;
+	case 'f':
+	    number = eventPtr->xcrossing.focus;
+	    goto doNumber;
+	case 'h':
+	    if (flags & EXPOSE) {
+		number = eventPtr->xexpose.height;
+	    } else if (flags & (CONFIG)) {
+		number = eventPtr->xconfigure.height;
+	    }
+	    goto doNumber;
+	case 'k':
+	    number = eventPtr->xkey.keycode;
+	    goto doNumber;
+	case 'm':
+	    if (flags & CROSSING) {
+		number = eventPtr->xcrossing.mode;
+	    } else if (flags & FOCUS) {
+		number = eventPtr->xfocus.mode;
+	    }
+	    string = TkFindStateString(notifyMode, number);
+	    goto doString;
+	case 'o':
+	    if (flags & CREATE) {
+		number = eventPtr->xcreatewindow.override_redirect;
+	    } else if (flags & MAP) {
+		number = eventPtr->xmap.override_redirect;
+	    } else if (flags & REPARENT) {
+		number = eventPtr->xreparent.override_redirect;
+	    } else if (flags & CONFIG) {
+		number = eventPtr->xconfigure.override_redirect;
+	    }
+	    goto doNumber;
+	case 'p':
+	    string = TkFindStateString(circPlace, eventPtr->xcirculate.place);
+	    goto doString;
+	case 's':
+	    if (flags & (KEY_BUTTON_MOTION_VIRTUAL)) {
+		number = eventPtr->xkey.state;
+	    } else if (flags & CROSSING) {
+		number = eventPtr->xcrossing.state;
+	    } else if (flags & VISIBILITY) {
+		string = TkFindStateString(visNotify,
+			eventPtr->xvisibility.state);
 		goto doString;
 	    }
-	    case 'X': {
-		Tk_Window tkwin;
-		int x, y;
-		int width, height;
-
-		number = eventPtr->xkey.x_root;
-		tkwin = Tk_IdToWindow(eventPtr->xany.display,
-			eventPtr->xany.window);
-		if (tkwin != NULL) {
-		    Tk_GetVRootGeometry(tkwin, &x, &y, &width, &height);
-		    number -= x;
-		}
-		goto doNumber;
+	    goto doNumber;
+	case 't':
+	    if (flags & (KEY_BUTTON_MOTION_VIRTUAL)) {
+		number = (int) eventPtr->xkey.time;
+	    } else if (flags & CROSSING) {
+		number = (int) eventPtr->xcrossing.time;
+	    } else if (flags & PROP) {
+		number = (int) eventPtr->xproperty.time;
+	    }
+	    goto doNumber;
+	case 'v':
+	    number = eventPtr->xconfigurerequest.value_mask;
+	    goto doNumber;
+	case 'w':
+	    if (flags & EXPOSE) {
+		number = eventPtr->xexpose.width;
+	    } else if (flags & CONFIG) {
+		number = eventPtr->xconfigure.width;
+	    }
+	    goto doNumber;
+	case 'x':
+	    if (flags & (KEY_BUTTON_MOTION_VIRTUAL)) {
+		number = eventPtr->xkey.x;
+	    } else if (flags & CROSSING) {
+		number = eventPtr->xcrossing.x;
+	    } else if (flags & EXPOSE) {
+		number = eventPtr->xexpose.x;
+	    } else if (flags & (CREATE|CONFIG|GRAVITY)) {
+		number = eventPtr->xcreatewindow.x;
+	    } else if (flags & REPARENT) {
+		number = eventPtr->xreparent.x;
+	    }
+	    goto doNumber;
+	case 'y':
+	    if (flags & (KEY_BUTTON_MOTION_VIRTUAL)) {
+		number = eventPtr->xkey.y;
+	    } else if (flags & EXPOSE) {
+		number = eventPtr->xexpose.y;
+	    } else if (flags & (CREATE|CONFIG|GRAVITY)) {
+		number = eventPtr->xcreatewindow.y;
+	    } else if (flags & REPARENT) {
+		number = eventPtr->xreparent.y;
+	    } else if (flags & CROSSING) {
+		number = eventPtr->xcrossing.y;
+
 	    }
-	    case 'Y': {
-		Tk_Window tkwin;
-		int x, y;
-		int width, height;
-
-		number = eventPtr->xkey.y_root;
-		tkwin = Tk_IdToWindow(eventPtr->xany.display,
-			eventPtr->xany.window);
-		if (tkwin != NULL) {
-		    Tk_GetVRootGeometry(tkwin, &x, &y, &width, &height);
-		    number -= y;
+	    goto doNumber;
+	case 'A':
+	    if (flags & KEY) {
+		Tcl_DStringFree(bufPtr);
+		string = TkpGetString(winPtr, eventPtr, bufPtr);
+	    }
+	    goto doString;
+	case 'B':
+	    number = eventPtr->xcreatewindow.border_width;
+	    goto doNumber;
+	case 'D':
+	    /*
+	     * This is used only by the MouseWheel event.
+	     */
+	    
+	    number = eventPtr->xkey.keycode;
+	    goto doNumber;
+	case 'E':
+	    number = (int) eventPtr->xany.send_event;
+	    goto doNumber;
+	case 'K':
+	    if (flags & KEY) {
+		char *name;
+
+		name = TkKeysymToString(keySym);
+		if (name != NULL) {
+		    string = name;
 		}
-		goto doNumber;
 	    }
-	    default:
-		numStorage[0] = before[1];
-		numStorage[1] = '\0';
-		string = numStorage;
-		goto doString;
+	    goto doString;
+	case 'N':
+	    number = (int) keySym;
+	    goto doNumber;
+	case 'R':
+	    TkpPrintWindowId(numStorage, eventPtr->xkey.root);
+	    string = numStorage;
+	    goto doString;
+	case 'S':
+	    TkpPrintWindowId(numStorage, eventPtr->xkey.subwindow);
+	    string = numStorage;
+	    goto doString;
+	case 'T':
+	    number = eventPtr->type;
+	    goto doNumber;
+	case 'W': {
+	    Tk_Window tkwin;
+
+	    tkwin = Tk_IdToWindow(eventPtr->xany.display,
+		    eventPtr->xany.window);
+	    if (tkwin != NULL) {
+		string = Tk_PathName(tkwin);
+	    } else {
+		string = "??";
+	    }
+	    goto doString;
+	}
+	case 'X': {
+	    Tk_Window tkwin;
+	    int x, y;
+	    int width, height;
+
+	    number = eventPtr->xkey.x_root;
+	    tkwin = Tk_IdToWindow(eventPtr->xany.display,
+		    eventPtr->xany.window);
+	    if (tkwin != NULL) {
+		Tk_GetVRootGeometry(tkwin, &x, &y, &width, &height);
+		number -= x;
+	    }
+	    goto doNumber;
 	}
+	case 'Y': {
+	    Tk_Window tkwin;
+	    int x, y;
+	    int width, height;
+
+	    number = eventPtr->xkey.y_root;
+	    tkwin = Tk_IdToWindow(eventPtr->xany.display,
+		    eventPtr->xany.window);
+	    if (tkwin != NULL) {
+		Tk_GetVRootGeometry(tkwin, &x, &y, &width, &height);
+		number -= y;
+	    }
+	    goto doNumber;
+	}
+	default:
+	    numStorage[0] = (char) field;
+	    numStorage[1] = '\0';
+	    string = numStorage;
+	    goto doString;
+    }
 
-	doNumber:
-	sprintf(numStorage, "%d", number);
-	string = numStorage;
+    doNumber:
+    sprintf(numStorage, "%d", number);
+    *numericPtr = 1;
+    return numStorage;
 
-	doString:
-	spaceNeeded = Tcl_ScanElement(string, &cvtFlags);
-	length = Tcl_DStringLength(dsPtr);
-	Tcl_DStringSetLength(dsPtr, length + spaceNeeded);
-	spaceNeeded = Tcl_ConvertElement(string,
-		Tcl_DStringValue(dsPtr) + length,
-		cvtFlags | TCL_DONT_USE_BRACES);
-	Tcl_DStringSetLength(dsPtr, length + spaceNeeded);
-	before += 2;
-    }
-    Tcl_DStringFree(&buf);
+    doString:
+    return string;
 }
-
+
 /*
  *----------------------------------------------------------------------
  *
@@ -2838,6 +4476,7 @@ CreateVirtualEvent(interp, vetPtr, virtString, eventString)
     if (poPtr == NULL) {
 	poPtr = (PhysicalsOwned *) ckalloc(sizeof(PhysicalsOwned));
 	poPtr->numOwned = 0;
+	poPtr->space = 1;
     } else {
         /*
 	 * See if this virtual event is already defined for this physical
@@ -2850,8 +4489,12 @@ CreateVirtualEvent(interp, vetPtr, virtString, eventString)
 	        return TCL_OK;
 	    }
 	}
-	poPtr = (PhysicalsOwned *) ckrealloc((char *) poPtr,
-		sizeof(PhysicalsOwned) + poPtr->numOwned * sizeof(PatSeq *));
+	if (poPtr->numOwned == poPtr->space) {
+	    poPtr->space *= 2;
+	    poPtr = (PhysicalsOwned *) ckrealloc((char *) poPtr,
+		    sizeof(PhysicalsOwned)
+		    + (poPtr->space - 1) * sizeof(PatSeq *));
+	}
     }	
     Tcl_SetHashValue(vhPtr, (ClientData) poPtr);
     poPtr->patSeqs[poPtr->numOwned] = psPtr;
@@ -2865,10 +4508,12 @@ CreateVirtualEvent(interp, vetPtr, virtString, eventString)
     if (voPtr == NULL) {
         voPtr = (VirtualOwners *) ckalloc(sizeof(VirtualOwners));
 	voPtr->numOwners = 0;
-    } else {
+	voPtr->space = 1;
+    } else if (voPtr->numOwners == voPtr->space) {
+	voPtr->space *= 2;
         voPtr = (VirtualOwners *) ckrealloc((char *) voPtr,
 		sizeof(VirtualOwners)
-		+ voPtr->numOwners * sizeof(Tcl_HashEntry *));
+		+ (voPtr->space - 1) * sizeof(Tcl_HashEntry *));
     }
     psPtr->voPtr = voPtr;
     voPtr->owners[voPtr->numOwners] = vhPtr;
@@ -4416,7 +6061,156 @@ static void
 FreeTclBinding(clientData)
     ClientData clientData;
 {
-    ckfree((char *) clientData);
+    TclBinding *bindingPtr = (TclBinding *) clientData;
+    int i;
+
+    while (bindingPtr->deferList != NULL) {
+	CancelDeferredMotion(bindingPtr->deferList);
+    }
+    for (i = 0; i < bindingPtr->numWords; i++) {
+	if (bindingPtr->words[i].objPtr != NULL) {
+	    Tcl_DecrRefCount(bindingPtr->words[i].objPtr);
+	}
+    }
+    if (bindingPtr->words != NULL) {
+	ckfree((char *) bindingPtr->words);
+    }
+    if (bindingPtr->scriptObj != NULL) {
+	Tcl_DecrRefCount(bindingPtr->scriptObj);
+    }
+    ckfree((char *) bindingPtr->chunks);
+    ckfree(bindingPtr->script);
+    ckfree((char *) bindingPtr);
+}
+
+/*
+ *---------------------------------------------------------------------------
+ *
+ * CompileTclBinding --
+ *
+ *	Make the TclBinding for a binding script: split the script at
+ *	its %-fields, and find out whether it can be invoked word by
+ *	word or as an object (see TclBinding).
+ *
+ * Results:
+ *	The new TclBinding.  It owns script, and is freed with
+ *	FreeTclBinding.
+ *
+ * Side effects:
+ *	Memory is allocated.
+ *
+ *---------------------------------------------------------------------------
+ */
+
+static TclBinding *
+CompileTclBinding(script)
+    char *script;		/* Binding script (malloc-ed). */
+{
+    TclBinding *bindingPtr;
+    BindChunk *chunkPtr;
+    BindWord *words;
+    Tcl_Parse parse;
+    Tcl_Token *tokenPtr;
+    char *p, *start;
+    int numFields, i;
+
+    numFields = 0;
+    for (p = script; *p != 0; p++) {
+	if (*p == '%') {
+	    numFields++;
+	    if (p[1] == 0) {
+		break;
+	    }
+	    p++;
+	}
+    }
+
+    bindingPtr = (TclBinding *) ckalloc(sizeof(TclBinding));
+    bindingPtr->script = script;
+    bindingPtr->chunks = (BindChunk *)
+	    ckalloc((unsigned) ((numFields + 1) * sizeof(BindChunk)));
+    bindingPtr->numChunks = 0;
+    bindingPtr->textLength = 0;
+    bindingPtr->numWords = 0;
+    bindingPtr->words = NULL;
+    bindingPtr->scriptObj = NULL;
+    bindingPtr->coalesce = 0;
+    bindingPtr->deferList = NULL;
+
+    p = script;
+    while (1) {
+	chunkPtr = &bindingPtr->chunks[bindingPtr->numChunks];
+	bindingPtr->numChunks++;
+	for (start = p; (*p != 0) && (*p != '%'); p++) {
+	    /* Empty loop body. */
+	}
+	chunkPtr->length = p - start;
+	bindingPtr->textLength += chunkPtr->length;
+	if (*p == 0) {
+	    chunkPtr->field = -1;
+	    break;
+	}
+	chunkPtr->field = UCHAR(p[1]);
+	p += (p[1] == 0) ? 1 : 2;
+    }
+
+    if (numFields == 0) {
+	bindingPtr->scriptObj = Tcl_NewStringObj(script, -1);
+	Tcl_IncrRefCount(bindingPtr->scriptObj);
+	return bindingPtr;
+    }
+
+    /*
+     * The script can be invoked word by word if it is one command without
+     * comments, each of whose words is either literal text without a '%'
+     * or a bare %-field.  (Substituting a field in braces or quotes, or
+     * as part of a word, could give a different word.)
+     */
+
+    if (Tcl_ParseCommand((Tcl_Interp *) NULL, script, -1, 0, &parse)
+	    != TCL_OK) {
+	return bindingPtr;
+    }
+    for (p = parse.commandStart + parse.commandSize; *p != 0; p++) {
+	if (!isspace(UCHAR(*p))) {
+	    break;
+	}
+    }
+    if ((*p == 0) && (parse.commentSize == 0) && (parse.numWords > 0)) {
+	words = (BindWord *)
+		ckalloc((unsigned) (parse.numWords * sizeof(BindWord)));
+	for (i = 0, tokenPtr = parse.tokenPtr; i < parse.numWords;
+		i++, tokenPtr += tokenPtr->numComponents + 1) {
+	    if (tokenPtr->type != TCL_TOKEN_SIMPLE_WORD) {
+		break;
+	    }
+	    p = tokenPtr[1].start;
+	    if (memchr(p, '%', (size_t) tokenPtr[1].size) == NULL) {
+		words[i].objPtr = Tcl_NewStringObj(p, tokenPtr[1].size);
+		Tcl_IncrRefCount(words[i].objPtr);
+		words[i].field = -1;
+	    } else if ((tokenPtr[1].size == 2) && (p[0] == '%')
+		    && (tokenPtr->start == p)) {
+		words[i].objPtr = NULL;
+		words[i].field = UCHAR(p[1]);
+	    } else {
+		break;
+	    }
+	}
+	if (i == parse.numWords) {
+	    bindingPtr->numWords = i;
+	    bindingPtr->words = words;
+	} else {
+	    while (i-- > 0) {
+		if (words[i].objPtr != NULL) {
+		    Tcl_DecrRefCount(words[i].objPtr);
+		}
+	    }
+	    ckfree((char *) words);
+	}
+    }
+    Tcl_FreeParse(&parse);
+    return bindingPtr;
 }
 
 /*
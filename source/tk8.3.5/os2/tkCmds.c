@@ -27,11 +27,47 @@
 #include "tkUnixInt.h"
 #endif
 
+/*
+ * TkBindEventProc turns the binding tags of a window into the array of
+ * objects that Tk_BindEvent wants.  That takes a hash lookup for each tag
+ * that names a window, and one for "all", so the array is kept for each
+ * window in a BindTagCache and only made again when it may have changed:
+ * when the window's tags or class change, or when a window is destroyed
+ * whose pathName may be in the array.  An array in which a tag names a
+ * window that doesn't exist isn't kept, since the window may be created
+ * at any time.
+ */
+
+typedef struct BindTagCache {
+    int epoch;			/* Value of bindTagEpoch when the array was
+				 * made, or -1 if it has no tags naming
+				 * windows. */
+    Tk_Uid classUid;		/* Class of the window when the array was
+				 * made. */
+    int count;			/* Number of entries in objects. */
+    ClientData objects[1];	/* The objects for Tk_BindEvent.  Enough
+				 * space is allocated for count entries. */
+} BindTagCache;
+
+typedef struct ThreadSpecificData {
+    int initialized;		/* Non-zero means the fields below have been
+				 * initialized. */
+    Tcl_HashTable bindTagTable;	/* Maps from (TkWindow *) to the window's
+				 * BindTagCache. */
+    int bindTagEpoch;		/* Incremented whenever a window's binding
+				 * tags are freed, which is also done when
+				 * any window is destroyed. */
+    Tk_Uid allUid;		/* The Uid "all". */
+} ThreadSpecificData;
+static Tcl_ThreadDataKey dataKey;
+
 /*
  * Forward declarations for procedures defined later in this file:
  */
 
 static TkWindow *	GetToplevel _ANSI_ARGS_((Tk_Window tkwin));
+static BindTagCache *	ResolveBindTags _ANSI_ARGS_((TkWindow *winPtr,
+			    ThreadSpecificData *tsdPtr, int *keepPtr));
 static char *		WaitVariableProc _ANSI_ARGS_((ClientData clientData,
 			    Tcl_Interp *interp, char *name1, char *name2,
 			    int flags));
@@ -119,7 +155,31 @@ Tk_BindCmd(clientData, interp, argc, argv)
     Tk_Window tkwin = (Tk_Window) clientData;
     TkWindow *winPtr;
     ClientData object;
+    int coalesce = -1;
+
+    /*
+     * "bind window pattern -coalesce interval command" makes the binding
+     * coalesce motion events; the interval is in milliseconds, with an
+     * optional "ms" suffix.  "bind window pattern -coalesce" returns the
+     * interval.
+     */
 
+    if ((argc == 4) && (strcmp(argv[3], "-coalesce") == 0)) {
+	coalesce = -2;
+	argc = 3;
+    } else if ((argc == 6) && (strcmp(argv[3], "-coalesce") == 0)) {
+	char *end;
+
+	coalesce = (int) strtol(argv[4], &end, 10);
+	if ((end == argv[4]) || (coalesce < 0)
+		|| ((*end != 0) && (strcmp(end, "ms") != 0))) {
+	    Tcl_AppendResult(interp, "bad coalesce interval \"", argv[4],
+		    "\": must be a number of milliseconds", (char *) NULL);
+	    return TCL_ERROR;
+	}
+	argv[3] = argv[5];
+	argc = 4;
+    }
     if ((argc < 2) || (argc > 4)) {
 	Tcl_AppendResult(interp, "wrong # args: should be \"", argv[0],
 		" window ?pattern? ?command?\"", (char *) NULL);
@@ -153,6 +213,14 @@ Tk_BindCmd(clientData, interp, argc, argv)
 	if (mask == 0) {
 	    return TCL_ERROR;
 	}
+	if ((coalesce >= 0) && (TkSetBindingCoalesce(interp,
+		winPtr->mainPtr->bindingTable, object, argv[2], coalesce)
+		!= TCL_OK)) {
+	    return TCL_ERROR;
+	}
+    } else if (coalesce == -2) {
+	return TkSetBindingCoalesce(interp, winPtr->mainPtr->bindingTable,
+		object, argv[2], -1);
     } else if (argc == 3) {
 	char *command;
 
@@ -192,62 +260,125 @@ TkBindEventProc(winPtr, eventPtr)
     TkWindow *winPtr;			/* Pointer to info about window. */
     XEvent *eventPtr;			/* Information about event. */
 {
-#define MAX_OBJS 20
-    ClientData objects[MAX_OBJS], *objPtr;
-    TkWindow *topLevPtr;
-    int i, count;
-    char *p;
+    BindTagCache *cachePtr;
     Tcl_HashEntry *hPtr;
+    int keep, new;
+    ThreadSpecificData *tsdPtr = (ThreadSpecificData *)
+	    Tcl_GetThreadData(&dataKey, sizeof(ThreadSpecificData));
 
     if ((winPtr->mainPtr == NULL) || (winPtr->mainPtr->bindingTable == NULL)) {
 	return;
     }
+    if (!tsdPtr->initialized) {
+	Tcl_InitHashTable(&tsdPtr->bindTagTable, TCL_ONE_WORD_KEYS);
+	tsdPtr->bindTagEpoch = 0;
+	tsdPtr->allUid = Tk_GetUid("all");
+	tsdPtr->initialized = 1;
+    }
+
+    hPtr = Tcl_FindHashEntry(&tsdPtr->bindTagTable, (char *) winPtr);
+    if (hPtr != NULL) {
+	cachePtr = (BindTagCache *) Tcl_GetHashValue(hPtr);
+	if ((cachePtr->classUid != winPtr->classUid)
+		|| ((cachePtr->epoch >= 0)
+		&& (cachePtr->epoch != tsdPtr->bindTagEpoch))) {
+	    ckfree((char *) cachePtr);
+	    Tcl_DeleteHashEntry(hPtr);
+	    hPtr = NULL;
+	}
+    }
+    if (hPtr == NULL) {
+	cachePtr = ResolveBindTags(winPtr, tsdPtr, &keep);
+	if (keep) {
+	    hPtr = Tcl_CreateHashEntry(&tsdPtr->bindTagTable, (char *) winPtr,
+		    &new);
+	    Tcl_SetHashValue(hPtr, cachePtr);
+	}
+    }
+    Tk_BindEvent(winPtr->mainPtr->bindingTable, eventPtr, (Tk_Window) winPtr,
+	    cachePtr->count, cachePtr->objects);
+    if (hPtr == NULL) {
+	ckfree((char *) cachePtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ResolveBindTags --
+ *
+ *	Make the array of objects that Tk_BindEvent is given for events
+ *	on a window: the window's binding tags, with the names of
+ *	windows replaced by pointers to the pathName of the windows.
+ *
+ * Results:
+ *	Returns a new BindTagCache (malloc-ed).  *keepPtr is set to 0 if
+ *	one of the tags names a window that doesn't exist, so that the
+ *	array may only be used once, and to 1 otherwise.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static BindTagCache *
+ResolveBindTags(winPtr, tsdPtr, keepPtr)
+    TkWindow *winPtr;			/* Window whose tags are wanted. */
+    ThreadSpecificData *tsdPtr;		/* Thread data of this file. */
+    int *keepPtr;			/* Set to 0 if the result may not be
+					 * kept. */
+{
+    BindTagCache *cachePtr;
+    TkWindow *topLevPtr;
+    int i, count;
+    char *p;
+    Tcl_HashEntry *hPtr;
 
-    objPtr = objects;
+    count = (winPtr->numTags != 0) ? winPtr->numTags : 4;
+    cachePtr = (BindTagCache *) ckalloc((unsigned) (sizeof(BindTagCache)
+	    + (count - 1) * sizeof(ClientData)));
+    cachePtr->epoch = -1;
+    cachePtr->classUid = winPtr->classUid;
+    *keepPtr = 1;
     if (winPtr->numTags != 0) {
 	/*
 	 * Make a copy of the tags for the window, replacing window names
 	 * with pointers to the pathName from the appropriate window.
 	 */
 
-	if (winPtr->numTags > MAX_OBJS) {
-	    objPtr = (ClientData *) ckalloc((unsigned)
-		    (winPtr->numTags * sizeof(ClientData)));
-	}
 	for (i = 0; i < winPtr->numTags; i++) {
 	    p = (char *) winPtr->tagPtr[i];
 	    if (*p == '.') {
+		cachePtr->epoch = tsdPtr->bindTagEpoch;
 		hPtr = Tcl_FindHashEntry(&winPtr->mainPtr->nameTable, p);
 		if (hPtr != NULL) {
 		    p = ((TkWindow *) Tcl_GetHashValue(hPtr))->pathName;
 		} else {
 		    p = NULL;
+		    *keepPtr = 0;
 		}
 	    }
-	    objPtr[i] = (ClientData) p;
+	    cachePtr->objects[i] = (ClientData) p;
 	}
-	count = winPtr->numTags;
+	cachePtr->count = winPtr->numTags;
     } else {
-	objPtr[0] = (ClientData) winPtr->pathName;
-	objPtr[1] = (ClientData) winPtr->classUid;
+	cachePtr->objects[0] = (ClientData) winPtr->pathName;
+	cachePtr->objects[1] = (ClientData) winPtr->classUid;
 	for (topLevPtr = winPtr;
 		(topLevPtr != NULL) && !(topLevPtr->flags & TK_TOP_LEVEL);
 		topLevPtr = topLevPtr->parentPtr) {
 	    /* Empty loop body. */
 	}
 	if ((winPtr != topLevPtr) && (topLevPtr != NULL)) {
-	    count = 4;
-	    objPtr[2] = (ClientData) topLevPtr->pathName;
+	    cachePtr->count = 4;
+	    cachePtr->objects[2] = (ClientData) topLevPtr->pathName;
 	} else {
-	    count = 3;
+	    cachePtr->count = 3;
 	}
-	objPtr[count-1] = (ClientData) Tk_GetUid("all");
-    }
-    Tk_BindEvent(winPtr->mainPtr->bindingTable, eventPtr, (Tk_Window) winPtr,
-	    count, objPtr);
-    if (objPtr != objects) {
-	ckfree((char *) objPtr);
+	cachePtr->objects[cachePtr->count-1] = (ClientData) tsdPtr->allUid;
     }
+    return cachePtr;
 }
 
 /*
@@ -308,9 +439,7 @@ Tk_BindtagsCmd(clientData, interp, argc, argv)
 	}
 	return TCL_OK;
     }
-    if (winPtr->tagPtr != NULL) {
-	TkFreeBindingTags(winPtr);
-    }
+    TkFreeBindingTags(winPtr);
     if (argv[2][0] == 0) {
 	return TCL_OK;
     }
@@ -349,14 +478,16 @@ Tk_BindtagsCmd(clientData, interp, argc, argv)
  * TkFreeBindingTags --
  *
  *	This procedure is called to free all of the binding tags
- *	associated with a window;  typically it is only invoked where
- *	there are window-specific tags.
+ *	associated with a window, when they are changed and when the
+ *	window is destroyed.
  *
  * Results:
  *	None.
  *
  * Side effects:
- *	Any binding tags for winPtr are freed.
+ *	Any binding tags for winPtr are freed, as is the window's
+ *	BindTagCache.  The BindTagCaches that may hold the pathName of
+ *	the window are made out of date.
  *
  *----------------------------------------------------------------------
  */
@@ -367,7 +498,21 @@ TkFreeBindingTags(winPtr)
 {
     int i;
     char *p;
+    Tcl_HashEntry *hPtr;
+    ThreadSpecificData *tsdPtr = (ThreadSpecificData *)
+	    Tcl_GetThreadData(&dataKey, sizeof(ThreadSpecificData));
 
+    if (tsdPtr->initialized) {
+	hPtr = Tcl_FindHashEntry(&tsdPtr->bindTagTable, (char *) winPtr);
+	if (hPtr != NULL) {
+	    ckfree((char *) Tcl_GetHashValue(hPtr));
+	    Tcl_DeleteHashEntry(hPtr);
+	}
+	tsdPtr->bindTagEpoch++;
+    }
+    if (winPtr->tagPtr == NULL) {
+	return;
+    }
     for (i = 0; i < winPtr->numTags; i++) {
 	p = (char *) (winPtr->tagPtr[i]);
 	if (*p == '.') {
@@ -300,6 +300,9 @@ TkIntStubs tkIntStubs = {
     TkpSetKeycodeAndState, /* 137 */
     TkpGetKeySym, /* 138 */
     TkpInitKeymapInfo, /* 139 */
+    TkSetBindingCoalesce, /* 140 */
+    TkBindTestMatcher, /* 141 */
+    TkGetDeferredMotion, /* 142 */
 };
 
 TkIntPlatStubs tkIntPlatStubs = {
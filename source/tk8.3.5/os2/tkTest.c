@@ -162,6 +162,16 @@ static void		CBindingFreeProc _ANSI_ARGS_((ClientData clientData));
 int			Tktest_Init _ANSI_ARGS_((Tcl_Interp *interp));
 static int		ImageCmd _ANSI_ARGS_((ClientData dummy,
 			    Tcl_Interp *interp, int argc, char **argv));
+static long		SendMotionEvents _ANSI_ARGS_((Tk_Window tkwin,
+			    int count));
+static int		TestbindcoalesceCmd _ANSI_ARGS_((ClientData dummy,
+			    Tcl_Interp *interp, int argc, char **argv));
+static int		TestbindmatchCmd _ANSI_ARGS_((ClientData dummy,
+			    Tcl_Interp *interp, int argc, char **argv));
+static int		TestbindmotionCmd _ANSI_ARGS_((ClientData dummy,
+			    Tcl_Interp *interp, int argc, char **argv));
+static int		TestbindvirtualCmd _ANSI_ARGS_((ClientData dummy,
+			    Tcl_Interp *interp, int argc, char **argv));
 static int		TestcbindCmd _ANSI_ARGS_((ClientData dummy,
 			    Tcl_Interp *interp, int argc, char **argv));
 static int		TestbitmapObjCmd _ANSI_ARGS_((ClientData dummy,
@@ -255,6 +265,14 @@ Tktest_Init(interp)
 
     Tcl_CreateObjCommand(interp, "square", SquareObjCmd,
 	    (ClientData) NULL, (Tcl_CmdDeleteProc *) NULL);
+    Tcl_CreateCommand(interp, "testbindcoalesce", TestbindcoalesceCmd,
+	    (ClientData) Tk_MainWindow(interp), (Tcl_CmdDeleteProc *) NULL);
+    Tcl_CreateCommand(interp, "testbindmatch", TestbindmatchCmd,
+	    (ClientData) Tk_MainWindow(interp), (Tcl_CmdDeleteProc *) NULL);
+    Tcl_CreateCommand(interp, "testbindmotion", TestbindmotionCmd,
+	    (ClientData) Tk_MainWindow(interp), (Tcl_CmdDeleteProc *) NULL);
+    Tcl_CreateCommand(interp, "testbindvirtual", TestbindvirtualCmd,
+	    (ClientData) Tk_MainWindow(interp), (Tcl_CmdDeleteProc *) NULL);
     Tcl_CreateCommand(interp, "testcbind", TestcbindCmd,
 	    (ClientData) Tk_MainWindow(interp), (Tcl_CmdDeleteProc *) NULL);
     Tcl_CreateObjCommand(interp, "testbitmap", TestbitmapObjCmd,
@@ -420,6 +438,302 @@ CBindingFreeProc(clientData)
     ckfree((char *) cbindPtr->command);
     ckfree((char *) cbindPtr);
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TestbindcoalesceCmd --
+ *
+ *	This procedure implements the "testbindcoalesce" command.
+ *	"testbindcoalesce window" returns the motion events of window
+ *	that are waiting for bindings made with "bind -coalesce".
+ *
+ * Results:
+ *	A standard Tcl result.  The result is a list with an element for
+ *	each waiting event, oldest first, holding the binding's script
+ *	and the x and y of the event.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+TestbindcoalesceCmd(clientData, interp, argc, argv)
+    ClientData clientData;		/* Main window for application. */
+    Tcl_Interp *interp;			/* Current interpreter. */
+    int argc;				/* Number of arguments. */
+    char **argv;			/* Argument strings. */
+{
+    Tk_Window tkwin;
+
+    if (argc != 2) {
+	Tcl_AppendResult(interp, "wrong # args: should be \"", argv[0],
+		" window\"", (char *) NULL);
+	return TCL_ERROR;
+    }
+    tkwin = Tk_NameToWindow(interp, argv[1], (Tk_Window) clientData);
+    if (tkwin == NULL) {
+	return TCL_ERROR;
+    }
+    TkGetDeferredMotion(interp, tkwin);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TestbindmatchCmd --
+ *
+ *	This procedure implements the "testbindmatch" command.
+ *	"testbindmatch window numObjects numEvents ?seed?" makes random
+ *	bindings for numObjects objects in a new binding table on the
+ *	display of window, and for each of numEvents random events
+ *	checks that the compiled pattern lists give the same best match
+ *	as the old way of walking every sequence of a list.
+ *
+ * Results:
+ *	A standard Tcl result.  The result is a list holding the number
+ *	of lookups made and the number that gave different matches.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+TestbindmatchCmd(clientData, interp, argc, argv)
+    ClientData clientData;		/* Main window for application. */
+    Tcl_Interp *interp;			/* Current interpreter. */
+    int argc;				/* Number of arguments. */
+    char **argv;			/* Argument strings. */
+{
+    Tk_Window tkwin;
+    int numObjects, numEvents, seed, numLookups, numMismatches;
+    char buf[TCL_INTEGER_SPACE * 2 + 2];
+
+    if ((argc != 4) && (argc != 5)) {
+	Tcl_AppendResult(interp, "wrong # args: should be \"", argv[0],
+		" window numObjects numEvents ?seed?\"", (char *) NULL);
+	return TCL_ERROR;
+    }
+    tkwin = Tk_NameToWindow(interp, argv[1], (Tk_Window) clientData);
+    if (tkwin == NULL) {
+	return TCL_ERROR;
+    }
+    if ((Tcl_GetInt(interp, argv[2], &numObjects) != TCL_OK)
+	    || (Tcl_GetInt(interp, argv[3], &numEvents) != TCL_OK)) {
+	return TCL_ERROR;
+    }
+    if (numObjects < 1) {
+	Tcl_AppendResult(interp, "bad object count \"", argv[2],
+		"\": must be at least 1", (char *) NULL);
+	return TCL_ERROR;
+    }
+    seed = 1;
+    if ((argc == 5) && (Tcl_GetInt(interp, argv[4], &seed) != TCL_OK)) {
+	return TCL_ERROR;
+    }
+    numMismatches = TkBindTestMatcher(tkwin, numObjects, numEvents,
+	    (unsigned long) seed, &numLookups);
+    sprintf(buf, "%d %d", numLookups, numMismatches);
+    Tcl_SetResult(interp, buf, TCL_VOLATILE);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TestbindmotionCmd --
+ *
+ *	This procedure implements the "testbindmotion" command.
+ *	"testbindmotion window count" sends count Motion events to
+ *	window, each at a new position, the way "event generate window
+ *	<Motion> -x x -y y" does, and times how long their bindings take.
+ *
+ * Results:
+ *	A standard Tcl result.  The result is a list holding count and
+ *	the number of microseconds spent handling the events.
+ *
+ * Side effects:
+ *	Whatever the Motion bindings of the window do.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+TestbindmotionCmd(clientData, interp, argc, argv)
+    ClientData clientData;		/* Main window for application. */
+    Tcl_Interp *interp;			/* Current interpreter. */
+    int argc;				/* Number of arguments. */
+    char **argv;			/* Argument strings. */
+{
+    Tk_Window tkwin;
+    int count;
+    char buf[TCL_INTEGER_SPACE * 2 + 2];
+
+    if (argc != 3) {
+	Tcl_AppendResult(interp, "wrong # args: should be \"", argv[0],
+		" window count\"", (char *) NULL);
+	return TCL_ERROR;
+    }
+    tkwin = Tk_NameToWindow(interp, argv[1], (Tk_Window) clientData);
+    if (tkwin == NULL) {
+	return TCL_ERROR;
+    }
+    if (Tcl_GetInt(interp, argv[2], &count) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    sprintf(buf, "%d %ld", count, SendMotionEvents(tkwin, count));
+    Tcl_SetResult(interp, buf, TCL_VOLATILE);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TestbindvirtualCmd --
+ *
+ *	This procedure implements the "testbindvirtual" command.
+ *	"testbindvirtual window numVirtual count" defines numVirtual
+ *	virtual events <<TestVirtual0>>, <<TestVirtual1>> ... that are
+ *	all triggered by <Motion>, binds each of them on window, and
+ *	times how long count Motion events for window take, as
+ *	testbindmotion does.  The virtual events and their bindings are
+ *	deleted again afterwards.
+ *
+ * Results:
+ *	A standard Tcl result.  The result is a list holding count and
+ *	the number of microseconds spent handling the events.
+ *
+ * Side effects:
+ *	Whatever the other Motion bindings of the window do.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+TestbindvirtualCmd(clientData, interp, argc, argv)
+    ClientData clientData;		/* Main window for application. */
+    Tcl_Interp *interp;			/* Current interpreter. */
+    int argc;				/* Number of arguments. */
+    char **argv;			/* Argument strings. */
+{
+    Tk_Window tkwin;
+    int numVirtual, count, i, result;
+    long usecs = 0;
+    char buf[TCL_INTEGER_SPACE * 2 + 2];
+    Tcl_DString cmd;
+    Tcl_Obj *errorPtr;
+
+    if (argc != 4) {
+	Tcl_AppendResult(interp, "wrong # args: should be \"", argv[0],
+		" window numVirtual count\"", (char *) NULL);
+	return TCL_ERROR;
+    }
+    tkwin = Tk_NameToWindow(interp, argv[1], (Tk_Window) clientData);
+    if (tkwin == NULL) {
+	return TCL_ERROR;
+    }
+    if ((Tcl_GetInt(interp, argv[2], &numVirtual) != TCL_OK)
+	    || (Tcl_GetInt(interp, argv[3], &count) != TCL_OK)) {
+	return TCL_ERROR;
+    }
+
+    Tcl_DStringInit(&cmd);
+    result = TCL_OK;
+    for (i = 0; (i < numVirtual) && (result == TCL_OK); i++) {
+	sprintf(buf, "%d", i);
+	Tcl_DStringSetLength(&cmd, 0);
+	Tcl_DStringAppend(&cmd, "event add <<TestVirtual", -1);
+	Tcl_DStringAppend(&cmd, buf, -1);
+	Tcl_DStringAppend(&cmd, ">> <Motion>; bind ", -1);
+	Tcl_DStringAppendElement(&cmd, argv[1]);
+	Tcl_DStringAppend(&cmd, " <<TestVirtual", -1);
+	Tcl_DStringAppend(&cmd, buf, -1);
+	Tcl_DStringAppend(&cmd, ">> list", -1);
+	result = Tcl_GlobalEval(interp, Tcl_DStringValue(&cmd));
+    }
+    if (result == TCL_OK) {
+	usecs = SendMotionEvents(tkwin, count);
+	errorPtr = NULL;
+    } else {
+	errorPtr = Tcl_GetObjResult(interp);
+	Tcl_IncrRefCount(errorPtr);
+    }
+    while (--i >= 0) {
+	sprintf(buf, "%d", i);
+	Tcl_DStringSetLength(&cmd, 0);
+	Tcl_DStringAppend(&cmd, "bind ", -1);
+	Tcl_DStringAppendElement(&cmd, argv[1]);
+	Tcl_DStringAppend(&cmd, " <<TestVirtual", -1);
+	Tcl_DStringAppend(&cmd, buf, -1);
+	Tcl_DStringAppend(&cmd, ">> {}; event delete <<TestVirtual", -1);
+	Tcl_DStringAppend(&cmd, buf, -1);
+	Tcl_DStringAppend(&cmd, ">>", -1);
+	Tcl_GlobalEval(interp, Tcl_DStringValue(&cmd));
+    }
+    Tcl_DStringFree(&cmd);
+    if (errorPtr != NULL) {
+	Tcl_SetObjResult(interp, errorPtr);
+	Tcl_DecrRefCount(errorPtr);
+	return TCL_ERROR;
+    }
+    sprintf(buf, "%d %ld", count, usecs);
+    Tcl_SetResult(interp, buf, TCL_VOLATILE);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SendMotionEvents --
+ *
+ *	Passes count Motion events for a window to Tk_HandleEvent, each
+ *	one pixel further right and down than the one before.
+ *
+ * Results:
+ *	The number of microseconds it took.
+ *
+ * Side effects:
+ *	Whatever the Motion bindings of the window do.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static long
+SendMotionEvents(tkwin, count)
+    Tk_Window tkwin;			/* Window to send the events to. */
+    int count;				/* Number of events. */
+{
+    XEvent event;
+    Tcl_Time start, end;
+    int i;
+
+    Tk_MakeWindowExist(tkwin);
+    memset((VOID *) &event, 0, sizeof(event));
+    event.xmotion.type = MotionNotify;
+    event.xmotion.send_event = False;
+    event.xmotion.display = Tk_Display(tkwin);
+    event.xmotion.window = Tk_WindowId(tkwin);
+    event.xmotion.root = RootWindow(Tk_Display(tkwin), Tk_ScreenNumber(tkwin));
+    event.xmotion.subwindow = None;
+    event.xmotion.time = CurrentTime;
+    event.xmotion.is_hint = NotifyNormal;
+    event.xmotion.same_screen = True;
+
+    TclpGetTime(&start);
+    for (i = 0; i < count; i++) {
+	event.xmotion.serial = NextRequest(Tk_Display(tkwin));
+	event.xmotion.x = event.xmotion.x_root = i % 1000;
+	event.xmotion.y = event.xmotion.y_root = i % 1000;
+	Tk_HandleEvent(&event);
+    }
+    TclpGetTime(&end);
+    return (end.sec - start.sec) * 1000000 + (end.usec - start.usec);
+}
 
 /*
  *----------------------------------------------------------------------
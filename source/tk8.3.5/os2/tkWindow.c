@@ -1280,9 +1280,7 @@ Tk_DestroyWindow(tkwin)
 	XDestroyIC(winPtr->inputContext);
     }
 #endif /* TK_USE_INPUT_METHODS */
-    if (winPtr->tagPtr != NULL) {
-	TkFreeBindingTags(winPtr);
-    }
+    TkFreeBindingTags(winPtr);
     TkOptionDeadWindow(winPtr);
     TkSelDeadWindow(winPtr);
     TkGrabDeadWindow(winPtr);